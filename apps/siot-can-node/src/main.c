@@ -1,12 +1,95 @@
 
+#include <point.h>
+#include <point_can.h>
+#include <siot-string.h>
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/can.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/zbus/zbus.h>
 
 LOG_MODULE_REGISTER(siot, LOG_LEVEL_DBG);
 
+ZBUS_CHAN_DECLARE(point_chan);
+
+// Every node sends its uptime and board, keyed by node id. The node that long
+// strings are sent to (CONFIG_SIOT_CAN_STRING_PEER) acts as the gateway and
+// receives them instead.
+#define GATEWAY    (CONFIG_SIOT_CAN_NODE_ID == CONFIG_SIOT_CAN_STRING_PEER)
+#define NODE_FLAGS (GATEWAY ? POINT_CAN_RX : POINT_CAN_TX)
+
+static const struct point_can_type can_types[] = {
+	{1, &point_def_uptime, NODE_FLAGS},
+	{2, &point_def_board, NODE_FLAGS},
+};
+
+static const struct device *const can_dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_canbus));
+
+ZBUS_MSG_SUBSCRIBER_DEFINE(gateway_sub);
+
+static void gateway_loop(void)
+{
+	const struct zbus_channel *chan;
+	point p;
+
+	zbus_chan_add_obs(&point_chan, &gateway_sub, K_SECONDS(5));
+
+	while (!zbus_sub_wait_msg(&gateway_sub, &chan, &p, K_FOREVER)) {
+		LOG_DBG_POINT("Point", &p);
+	}
+}
+
+static void node_loop(void)
+{
+	char key[ITOA_I32_LEN];
+	point p = {0};
+
+	itoa_i32(CONFIG_SIOT_CAN_NODE_ID, key, sizeof(key));
+
+	point_set_type_key(&p, POINT_TYPE_BOARD, key);
+	point_put_string(&p, CONFIG_BOARD_TARGET);
+	zbus_chan_pub(&point_chan, &p, K_MSEC(500));
+
+	point_set_type_key(&p, POINT_TYPE_UPTIME, key);
+
+	while (true) {
+		point_put_int(&p, k_uptime_seconds());
+		zbus_chan_pub(&point_chan, &p, K_MSEC(500));
+		k_sleep(K_SECONDS(1));
+	}
+}
+
 int main(void)
 {
-	LOG_INF("SIOT CAN Node! %s", CONFIG_BOARD_TARGET);
+	int ret;
+
+	LOG_INF("SIOT CAN Node! %s, node %i", CONFIG_BOARD_TARGET, CONFIG_SIOT_CAN_NODE_ID);
+
+#if defined(CONFIG_SIOT_CAN_FD)
+	ret = can_set_mode(can_dev, CAN_MODE_FD);
+	if (ret) {
+		LOG_ERR("Error setting CAN FD mode: %i", ret);
+		return ret;
+	}
+#endif
+
+	ret = can_start(can_dev);
+	if (ret) {
+		LOG_ERR("Error starting CAN: %i", ret);
+		return ret;
+	}
+
+	ret = point_can_init(can_dev, can_types, ARRAY_SIZE(can_types));
+	if (ret) {
+		return ret;
+	}
+
+	if (GATEWAY) {
+		gateway_loop();
+	} else {
+		node_loop();
+	}
 
 	return 0;
 }
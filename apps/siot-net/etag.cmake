@@ -0,0 +1,8 @@
+# Generates a C string literal containing a strong HTTP ETag for a file.
+#
+# cmake -DINPUT=<file> -DOUTPUT=<file.etag.inc> -P etag.cmake
+
+file(SHA256 ${INPUT} hash)
+string(SUBSTRING ${hash} 0 16 hash)
+
+file(WRITE ${OUTPUT} "\"\\\"${hash}\\\"\"\n")
@@ -1,6 +1,8 @@
 #include "zephyr/sys/util.h"
 #include <nvs.h>
 #include <point.h>
+#include <point_coap.h>
+#include <point_mqtt.h>
 
 #include <zephyr/net/http/server.h>
 #include <zephyr/net/net_mgmt.h>
@@ -25,6 +27,20 @@ static const struct nvs_point nvs_pts[] = {
 	{5, &point_def_gateway, "0"},    {6, &point_def_netmask, "0"},
 };
 
+// Points are also served over CoAP, for clients that cannot afford a TCP
+// connection per poll
+static const struct point_coap_config coap_config = {0};
+
+// and published to an MQTT broker if one is configured
+static const struct point_mqtt_config mqtt_config = {
+	.host = CONFIG_APP_MQTT_HOST,
+	.port = CONFIG_APP_MQTT_PORT,
+	.client_id = CONFIG_APP_MQTT_PREFIX,
+	.prefix = CONFIG_APP_MQTT_PREFIX,
+	.qos = 1,
+	.sec_tag = -1,
+};
+
 // ==================================================
 // Network manager
 
@@ -143,6 +159,10 @@ int main(void)
 	}
 
 	nvs_init(nvs_pts, ARRAY_SIZE(nvs_pts));
+	point_coap_init(&coap_config);
+	if (strlen(CONFIG_APP_MQTT_HOST) > 0) {
+		point_mqtt_init(&mqtt_config);
+	}
 
 #if defined(CONFIG_FAT_FILESYSTEM_ELM)
 	sd_card_init();
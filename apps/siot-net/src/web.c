@@ -1,4 +1,8 @@
+#include <gzip.h>
+#include <html.h>
+#include <nvs.h>
 #include <point.h>
+#include <point_queue.h>
 
 #include <zephyr/data/json.h>
 #include <zephyr/fs/nvs.h>
@@ -6,13 +10,22 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/net/http/server.h>
 #include <zephyr/net/http/service.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/websocket.h>
+#include <zephyr/random/random.h>
+#include <zephyr/shell/shell.h>
 #include <zephyr/sys/util.h>
 #include <zephyr/zbus/zbus.h>
 
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
-#define STACKSIZE 1024
-#define PRIORITY  7
+#define STACKSIZE    1024
+#define PRIORITY     7
+#define WS_STACKSIZE 3072
+// the web thread also encodes points and sends them to websocket clients
+#define WEB_STACKSIZE 2048
 
 LOG_MODULE_REGISTER(siot_web, LOG_LEVEL_DBG);
 
@@ -26,10 +39,415 @@ ZBUS_CHAN_DECLARE(point_chan);
 K_MUTEX_DEFINE(web_points_lock);
 static point web_points[40] = {};
 
+// Every upsert into web_points gets the next value of a global sequence
+// number, which allows clients to ask only for points that changed since the
+// last sequence number they saw.
+static uint32_t web_points_seq[ARRAY_SIZE(web_points)];
+static uint32_t web_seq;
+
+// The sequence number restarts at every boot, so cursors also carry a boot
+// epoch. It is random, and the boot count is mixed in when it is published, as
+// some targets (like native_sim) start with the same random seed every time.
+static uint32_t web_boot;
+
+// Index of the point cache: a hash of the type stored in each slot, so
+// lookups and filtered reads only compare strings for slots whose type
+// hash matches.
+static uint32_t web_points_type_hash[ARRAY_SIZE(web_points)];
+
+// JSON cache. Each slot keeps its point encoded as a JSON object, which is
+// only re-encoded after the point changes. The full /v1/points response is
+// assembled from the fragments and kept until the next change, so a GET in
+// steady state is a copy of the cached response.
+#define WEB_FRAG_LEN 128
+static char web_points_frag[ARRAY_SIZE(web_points)][WEB_FRAG_LEN];
+static uint8_t web_points_frag_len[ARRAY_SIZE(web_points)];
+static bool web_points_frag_dirty[ARRAY_SIZE(web_points)];
+static char web_points_json[2048];
+// 0 if the cached response must be rebuilt
+static size_t web_points_json_len;
+
+static struct {
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t frag_encodes;
+	uint32_t rebuild_us_last;
+	uint32_t rebuild_us_max;
+} web_cache_stats;
+
+// Recent point updates, oldest first starting at web_history_head
+#define WEB_HISTORY_LEN 32
+static point web_history[WEB_HISTORY_LEN];
+static int web_history_head;
+
+// FNV-1a
+static uint32_t web_hash(const char *s)
+{
+	uint32_t h = 2166136261u;
+
+	while (*s) {
+		h ^= (uint8_t)*s++;
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+// returns the index of the point in the cache, or -1 if not found.
+// web_points_lock must be held
+static int web_points_find(const char *type, const char *key)
+{
+	uint32_t hash = web_hash(type);
+
+	for (int i = 0; i < ARRAY_SIZE(web_points); i++) {
+		if (web_points_type_hash[i] == hash && strcmp(web_points[i].type, type) == 0 &&
+		    strcmp(web_points[i].key, key) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+// web_points_lock must be held
+static int web_points_upsert(point *p)
+{
+	int i = web_points_find(p->type, p->key);
+
+	web_history[web_history_head] = *p;
+	web_history_head = (web_history_head + 1) % WEB_HISTORY_LEN;
+
+	// rewriting a point with the same value does not change the cache
+	// version, so pollers and the JSON cache are not disturbed
+	if (i >= 0 && web_points[i].data_type == p->data_type &&
+	    memcmp(web_points[i].data, p->data, sizeof(p->data)) == 0) {
+		return 0;
+	}
+
+	i = points_upsert(web_points, ARRAY_SIZE(web_points), p);
+	if (i < 0) {
+		return i;
+	}
+
+	web_points_seq[i] = ++web_seq;
+	web_points_type_hash[i] = web_hash(web_points[i].type);
+	web_points_frag_dirty[i] = true;
+	web_points_json_len = 0;
+
+	return 0;
+}
+
 // ==================================================
-// HTTP Service
+// Ingest queue. Points received from web clients are queued, and published on
+// the point bus by the dispatch thread, so a slow bus subscriber (such as a
+// flash write) cannot stall the HTTP server or websocket threads.
+
+#define WEB_INGEST_QUEUE_LEN 32
+POINT_QUEUE_DEFINE(web_ingest_q, WEB_INGEST_QUEUE_LEN);
+K_SEM_DEFINE(web_ingest_sem, 0, 1);
+
+static atomic_t web_ingest_dispatched;
+static atomic_t web_ingest_rejected;
+static atomic_t web_ingest_pub_errors;
+
+// queues points received from a web client for publishing. Returns the number
+// of points queued. If there is not room for all of the points, none are
+// queued unless another client filled the queue at the same time.
+static int web_points_publish(point *pts, int count)
+{
+	int i = 0;
+
+	if (point_queue_size(&web_ingest_q) - point_queue_count(&web_ingest_q) >= count) {
+		for (; i < count; i++) {
+			if (point_queue_put(&web_ingest_q, &pts[i]) != 0) {
+				break;
+			}
+		}
+	}
+
+	if (i > 0) {
+		k_sem_give(&web_ingest_sem);
+	}
+
+	if (i < count) {
+		atomic_add(&web_ingest_rejected, count - i);
+	}
+
+	return i;
+}
+
+static void web_dispatch_thread(void *arg1, void *arg2, void *arg3)
+{
+	point p;
 
-static uint8_t recv_buffer[2048];
+	while (true) {
+		k_sem_take(&web_ingest_sem, K_FOREVER);
+
+		while (point_queue_get(&web_ingest_q, &p) == 0) {
+			int ret = zbus_chan_pub(&point_chan, &p, K_MSEC(500));
+			if (ret != 0) {
+				LOG_ERR("Error publishing point %s: %i", p.type, ret);
+				atomic_inc(&web_ingest_pub_errors);
+			} else {
+				atomic_inc(&web_ingest_dispatched);
+			}
+		}
+	}
+}
+
+K_THREAD_DEFINE(web_dispatch, STACKSIZE, web_dispatch_thread, NULL, NULL, NULL, PRIORITY, 0, 0);
+
+// ==================================================
+// JSON cache
+
+// re-encodes the fragment for slot i if needed, returns the fragment length
+// or less than 0 for error. -ENOMEM means the point does not fit in a
+// fragment, which happens for strings with many escaped characters, and the
+// caller must encode it directly. web_points_lock must be held
+static int web_points_frag_encode(int i)
+{
+	if (web_points_frag_dirty[i]) {
+		int ret = point_json_encode(&web_points[i], web_points_frag[i], WEB_FRAG_LEN);
+		if (ret == -ENOMEM) {
+			return ret;
+		}
+		if (ret != 0) {
+			LOG_ERR("Error encoding point %s: %i", web_points[i].type, ret);
+			return ret;
+		}
+		web_points_frag_len[i] = strlen(web_points_frag[i]);
+		web_points_frag_dirty[i] = false;
+		web_cache_stats.frag_encodes++;
+	}
+
+	return web_points_frag_len[i];
+}
+
+// assembles a JSON array from the fragments of the points the filter returns
+// true for (all points for a NULL filter). Returns the length of the JSON
+// written to buf or less than 0 for error. web_points_lock must be held
+static int web_points_json_filter(point_filter filter, void *ctx, char *buf, size_t len)
+{
+	size_t offset = 0;
+
+	if (len < 3) {
+		return -ENOMEM;
+	}
+
+	buf[offset++] = '[';
+
+	for (int i = 0; i < ARRAY_SIZE(web_points); i++) {
+		if (web_points[i].type[0] == 0 ||
+		    (filter != NULL && !filter(&web_points[i], i, ctx))) {
+			continue;
+		}
+
+		int frag_len = web_points_frag_encode(i);
+		if (frag_len < 0 && frag_len != -ENOMEM) {
+			return frag_len;
+		}
+
+		// room for separator, closing bracket and null
+		if (offset + 3 > len) {
+			return -ENOMEM;
+		}
+
+		if (offset > 1) {
+			buf[offset++] = ',';
+		}
+
+		if (frag_len == -ENOMEM) {
+			// too long to cache, encode it straight into buf leaving
+			// room for the closing bracket
+			int ret = point_json_encode(&web_points[i], buf + offset, len - offset - 1);
+			if (ret != 0) {
+				return ret;
+			}
+			offset += strlen(buf + offset);
+			continue;
+		}
+
+		// room for fragment, closing bracket and null
+		if (offset + frag_len + 2 > len) {
+			return -ENOMEM;
+		}
+
+		memcpy(buf + offset, web_points_frag[i], frag_len);
+		offset += frag_len;
+	}
+
+	buf[offset++] = ']';
+	buf[offset] = 0;
+
+	return offset;
+}
+
+// copies the JSON array of all points into buf, rebuilding the cached
+// response first if a point changed. Returns the length of the JSON or less
+// than 0 for error. web_points_lock must be held
+static int web_points_json_get(char *buf, size_t len)
+{
+	if (web_points_json_len == 0) {
+		uint32_t start = k_cycle_get_32();
+		int ret = web_points_json_filter(NULL, NULL, web_points_json,
+						 sizeof(web_points_json));
+		if (ret < 0) {
+			return ret;
+		}
+		web_points_json_len = ret;
+
+		uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+		web_cache_stats.rebuild_us_last = us;
+		web_cache_stats.rebuild_us_max = MAX(web_cache_stats.rebuild_us_max, us);
+		web_cache_stats.misses++;
+	} else {
+		web_cache_stats.hits++;
+	}
+
+	if (web_points_json_len >= len) {
+		return -ENOMEM;
+	}
+
+	memcpy(buf, web_points_json, web_points_json_len + 1);
+
+	return web_points_json_len;
+}
+
+static int cmd_web_cache(const struct shell *sh, size_t argc, char **argv)
+{
+	k_mutex_lock(&web_points_lock, K_FOREVER);
+	shell_print(sh, "hits:          %u", web_cache_stats.hits);
+	shell_print(sh, "misses:        %u", web_cache_stats.misses);
+	shell_print(sh, "frag encodes:  %u", web_cache_stats.frag_encodes);
+	shell_print(sh, "rebuild (us):  %u last, %u max", web_cache_stats.rebuild_us_last,
+		    web_cache_stats.rebuild_us_max);
+	shell_print(sh, "response size: %zu", web_points_json_len);
+	k_mutex_unlock(&web_points_lock);
+
+	return 0;
+}
+
+static int cmd_web_queue(const struct shell *sh, size_t argc, char **argv)
+{
+	shell_print(sh, "depth:       %zu/%zu", point_queue_count(&web_ingest_q),
+		    point_queue_size(&web_ingest_q));
+	shell_print(sh, "dispatched:  %ld", atomic_get(&web_ingest_dispatched));
+	shell_print(sh, "rejected:    %ld", atomic_get(&web_ingest_rejected));
+	shell_print(sh, "pub errors:  %ld", atomic_get(&web_ingest_pub_errors));
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(web_cmds,
+			       SHELL_CMD(cache, NULL, "JSON cache statistics", cmd_web_cache),
+			       SHELL_CMD(queue, NULL, "Ingest queue statistics", cmd_web_queue),
+			       SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(web, &web_cmds, "Web server commands", NULL);
+
+// ==================================================
+// Query parameters
+
+// returns the value of the query parameter name in url, or NULL if it is not
+// present. The value is terminated by '&' or the end of the string, and its
+// length is returned in len.
+static const char *web_query_param(const char *url, const char *name, size_t *len)
+{
+	const char *q = strchr(url, '?');
+	size_t name_len = strlen(name);
+
+	while (q != NULL) {
+		q++;
+		if (strncmp(q, name, name_len) == 0 && q[name_len] == '=') {
+			const char *v = q + name_len + 1;
+			*len = strcspn(v, "&");
+			return v;
+		}
+		q = strchr(q, '&');
+	}
+
+	return NULL;
+}
+
+// copies and URL decodes len characters of src into dst
+static void web_copy_decoded(char *dst, size_t dst_len, const char *src, size_t len)
+{
+	len = MIN(len, dst_len - 1);
+	memcpy(dst, src, len);
+	dst[len] = 0;
+	url_decode(dst, dst);
+}
+
+// filter for reads of the point cache. Empty fields match everything.
+struct web_query {
+	char type[sizeof(((point *)0)->type)];
+	char key[sizeof(((point *)0)->key)];
+	uint32_t type_hash;
+	uint32_t since;
+	bool has_since;
+	uint32_t boot;
+	bool has_boot;
+};
+
+// parses ?t=<type>&k=<key>&since=<seq>&boot=<boot>
+static void web_query_parse(struct web_query *q, const char *url)
+{
+	const char *v;
+	size_t len;
+
+	memset(q, 0, sizeof(*q));
+
+	v = web_query_param(url, "t", &len);
+	if (v != NULL) {
+		web_copy_decoded(q->type, sizeof(q->type), v, len);
+		q->type_hash = web_hash(q->type);
+	}
+
+	v = web_query_param(url, "k", &len);
+	if (v != NULL) {
+		web_copy_decoded(q->key, sizeof(q->key), v, len);
+	}
+
+	v = web_query_param(url, "since", &len);
+	if (v != NULL) {
+		q->since = strtoul(v, NULL, 10);
+		q->has_since = true;
+	}
+
+	v = web_query_param(url, "boot", &len);
+	if (v != NULL) {
+		q->boot = strtoul(v, NULL, 10);
+		q->has_boot = true;
+	}
+}
+
+static bool web_query_match_type_key(const struct web_query *q, const point *p, uint32_t hash)
+{
+	if (q->type[0] != 0 && (hash != q->type_hash || strcmp(p->type, q->type) != 0)) {
+		return false;
+	}
+
+	return q->key[0] == 0 || strcmp(p->key, q->key) == 0;
+}
+
+static bool web_points_query_filter(const point *p, int index, void *ctx)
+{
+	const struct web_query *q = ctx;
+
+	if (q->has_since && web_points_seq[index] <= q->since) {
+		return false;
+	}
+
+	return web_query_match_type_key(q, p, web_points_type_hash[index]);
+}
+
+static bool web_points_config_filter(const point *p, int index, void *ctx)
+{
+	return nvs_point_persisted(p->type, p->key) && web_points_query_filter(p, index, ctx);
+}
+
+// ==================================================
+// HTTP Service
 
 static uint16_t http_service_port = 80;
 HTTP_SERVICE_DEFINE(siot_http_service, "0.0.0.0", &http_service_port, 1, 10, NULL, NULL, NULL);
@@ -42,34 +460,134 @@ const static uint8_t index_js_gz[] = {
 #include "index.js.gz.inc"
 };
 
+// Strong ETags for the static resources are generated at build time from the
+// contents of the frontend files.
+const static char index_html_etag[] =
+#include "index.html.etag.inc"
+	;
+
+const static char index_js_etag[] =
+#include "index.js.etag.inc"
+	;
+
+HTTP_SERVER_REGISTER_HEADER_CAPTURE(if_none_match_header, "If-None-Match");
+HTTP_SERVER_REGISTER_HEADER_CAPTURE(accept_encoding_header, "Accept-Encoding");
+
+// returns the value of a captured request header, or NULL if not present
+static const char *web_header_get(const struct http_request_ctx *request_ctx, const char *name)
+{
+	if (request_ctx->headers_status != HTTP_HEADER_STATUS_OK) {
+		return NULL;
+	}
+
+	for (int i = 0; i < request_ctx->header_count; i++) {
+		if (strcasecmp(request_ctx->headers[i].name, name) == 0) {
+			return request_ctx->headers[i].value;
+		}
+	}
+
+	return NULL;
+}
+
+// returns true if the request If-None-Match header matches etag, in which case
+// the client already has the current version of the resource
+static bool web_etag_match(const struct http_request_ctx *request_ctx, const char *etag)
+{
+	return html_etag_match(web_header_get(request_ctx, "If-None-Match"), etag);
+}
+
 // ==================================================
-// index.html resource
+// Static resources
+//
+// These are served by a dynamic handler (rather than HTTP_RESOURCE_TYPE_STATIC)
+// so we can add validators and answer conditional requests with 304.
+
+struct web_static_asset {
+	const uint8_t *data;
+	size_t len;
+	const struct http_header *headers;
+	size_t header_count;
+};
+
+static int static_handler(struct http_client_ctx *client, enum http_data_status status,
+			  const struct http_request_ctx *request_ctx,
+			  struct http_response_ctx *resp, void *user_data)
+{
+	const struct web_static_asset *asset = user_data;
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
 
-struct http_resource_detail_static index_html_gz_resource_detail = {
+	// the ETag header is always the second one
+	if (web_etag_match(request_ctx, asset->headers[1].value)) {
+		resp->status = HTTP_304_NOT_MODIFIED;
+		resp->headers = asset->headers + 1;
+		resp->header_count = asset->header_count - 1;
+		resp->final_chunk = true;
+		return 0;
+	}
+
+	resp->headers = asset->headers;
+	resp->header_count = asset->header_count;
+	resp->body = asset->data;
+	resp->body_len = asset->len;
+	resp->final_chunk = true;
+
+	return 0;
+}
+
+// index.html and index.js are not content hashed, so clients must always
+// revalidate
+static const struct http_header index_html_headers[] = {
+	{.name = "Content-Encoding", .value = "gzip"},
+	{.name = "ETag", .value = index_html_etag},
+	{.name = "Cache-Control", .value = "no-cache"},
+};
+
+static const struct web_static_asset index_html_asset = {
+	.data = index_html_gz,
+	.len = sizeof(index_html_gz),
+	.headers = index_html_headers,
+	.header_count = ARRAY_SIZE(index_html_headers),
+};
+
+struct http_resource_detail_dynamic index_html_gz_resource_detail = {
 	.common =
 		{
-			.type = HTTP_RESOURCE_TYPE_STATIC,
+			.type = HTTP_RESOURCE_TYPE_DYNAMIC,
 			.bitmask_of_supported_http_methods = BIT(HTTP_GET),
-			.content_encoding = "gzip",
 			.content_type = "text/html",
 		},
-	.static_data = index_html_gz,
-	.static_data_len = sizeof(index_html_gz),
+	.cb = static_handler,
+	.user_data = (void *)&index_html_asset,
 };
 
 HTTP_RESOURCE_DEFINE(index_html_gz_resource, siot_http_service, "/",
 		     &index_html_gz_resource_detail);
 
-struct http_resource_detail_static index_js_gz_resource_detail = {
+static const struct http_header index_js_headers[] = {
+	{.name = "Content-Encoding", .value = "gzip"},
+	{.name = "ETag", .value = index_js_etag},
+	{.name = "Cache-Control", .value = "no-cache"},
+};
+
+static const struct web_static_asset index_js_asset = {
+	.data = index_js_gz,
+	.len = sizeof(index_js_gz),
+	.headers = index_js_headers,
+	.header_count = ARRAY_SIZE(index_js_headers),
+};
+
+struct http_resource_detail_dynamic index_js_gz_resource_detail = {
 	.common =
 		{
-			.type = HTTP_RESOURCE_TYPE_STATIC,
+			.type = HTTP_RESOURCE_TYPE_DYNAMIC,
 			.bitmask_of_supported_http_methods = BIT(HTTP_GET),
-			.content_encoding = "gzip",
 			.content_type = "application/javascript",
 		},
-	.static_data = index_js_gz,
-	.static_data_len = sizeof(index_js_gz),
+	.cb = static_handler,
+	.user_data = (void *)&index_js_asset,
 };
 
 HTTP_RESOURCE_DEFINE(index_js_gz_resource, siot_http_service, "/index.js",
@@ -83,76 +601,546 @@ HTTP_RESOURCE_DEFINE(index_js_gz_resource, siot_http_service, "/index.js",
 // 	JSON_OBJ_DESCR_FIELD(point_js, key, JSON_TOK_STRING),
 // };
 
+// Form fields accepted by POST /v1/form, and the points they are stored in
+struct web_form_field {
+	const char *name;
+	const point_def *def;
+};
+
+static const struct web_form_field web_form_fields[] = {
+	{"did", &point_def_description},     {"ipaddr", &point_def_address},
+	{"subnet-mask", &point_def_netmask}, {"gateway", &point_def_gateway},
+	{"ipstatic", &point_def_staticip},
+};
+
+// state of a form post being parsed. Points are indexed like
+// web_form_fields, and a field that is posted twice keeps the last value.
+struct web_form {
+	struct html_form_parser parser;
+	char buf[64];
+	point pts[ARRAY_SIZE(web_form_fields)];
+	uint32_t set;
+	int ignored;
+};
+
+// Each client using the v1 API gets its own request context from a small
+// pool, so request bodies from concurrent clients do not share buffers. A
+// context is bound to a client for the duration of one request. Responses are
+// built in v1_resp, which is shared: the HTTP server calls the v1 handler and
+// sends the response from one thread, so a response is always sent before the
+// next callback can build another one.
+struct v1_ctx {
+	const struct http_client_ctx *client;
+	size_t cursor;
+	union {
+		char payload[256];
+		struct web_form form;
+	};
+	char etag[32];
+	// room for the Content-Encoding and Vary headers of compressed
+	// responses
+	struct http_header headers[4];
+	struct web_query query;
+};
+
+K_MUTEX_DEFINE(v1_ctx_lock);
+static struct v1_ctx v1_ctxs[CONFIG_HTTP_SERVER_MAX_CLIENTS];
+static char v1_resp[2048];
+
+// returns the context bound to client, or binds a free one. Returns NULL if
+// the pool is exhausted.
+static struct v1_ctx *v1_ctx_get(const struct http_client_ctx *client)
+{
+	struct v1_ctx *ctx = NULL;
+
+	k_mutex_lock(&v1_ctx_lock, K_FOREVER);
+	for (int i = 0; i < ARRAY_SIZE(v1_ctxs); i++) {
+		if (v1_ctxs[i].client == client) {
+			ctx = &v1_ctxs[i];
+			break;
+		}
+		if (ctx == NULL && v1_ctxs[i].client == NULL) {
+			ctx = &v1_ctxs[i];
+		}
+	}
+
+	if (ctx != NULL && ctx->client == NULL) {
+		ctx->client = client;
+		ctx->cursor = 0;
+		ctx->etag[0] = 0;
+	}
+	k_mutex_unlock(&v1_ctx_lock);
+
+	return ctx;
+}
+
+static void v1_ctx_put(struct v1_ctx *ctx)
+{
+	k_mutex_lock(&v1_ctx_lock, K_FOREVER);
+	ctx->client = NULL;
+	ctx->cursor = 0;
+	k_mutex_unlock(&v1_ctx_lock);
+}
+
+static void v1_error(struct v1_ctx *ctx, struct http_response_ctx *resp, enum http_status status,
+		     const char *msg)
+{
+	resp->status = status;
+	snprintf(v1_resp, sizeof(v1_resp), "{\"error\":\"%s\"}", msg);
+}
+
+// ********************************
+// v1 response compression
+//
+// Responses of at least V1_GZIP_MIN bytes are compressed with gzip for clients
+// that send Accept-Encoding: gzip. The HTTP server calls the v1 handler and
+// sends its response from one thread, so a single buffer is enough.
+
+#define V1_GZIP_MIN 256
+
+static struct gzip v1_gz;
+static uint8_t v1_gz_buf[sizeof(v1_resp)];
+
+// returns true if the request Accept-Encoding header allows gzip
+static bool v1_accepts_gzip(const struct http_request_ctx *request_ctx)
+{
+	const char *ae = web_header_get(request_ctx, "Accept-Encoding");
+	const char *gz = ae != NULL ? strstr(ae, "gzip") : NULL;
+
+	if (gz == NULL) {
+		return false;
+	}
+
+	// gzip;q=0 refuses it
+	gz += 4;
+	return strncmp(gz, ";q=", 3) != 0 || strtod(gz + 3, NULL) > 0;
+}
+
+static void v1_compress(struct v1_ctx *ctx, const struct http_request_ctx *request_ctx,
+			struct http_response_ctx *resp)
+{
+	// a 304 keeps the tag the client sent
+	if (resp->status == HTTP_304_NOT_MODIFIED) {
+		return;
+	}
+
+	if (resp->body_len < V1_GZIP_MIN || !v1_accepts_gzip(request_ctx)) {
+		return;
+	}
+
+	int ret = gzip_compress(&v1_gz, resp->body, resp->body_len, v1_gz_buf, sizeof(v1_gz_buf));
+	if (ret < 0 || ret >= resp->body_len) {
+		return;
+	}
+
+	// the gzip body is a different representation, so it gets its own tag
+	if (ctx->etag[0] != 0 && html_etag_gzip(ctx->etag, sizeof(ctx->etag))) {
+		return;
+	}
+
+	// handlers only set headers from ctx->headers
+	size_t n = resp->headers != NULL ? resp->header_count : 0;
+
+	ctx->headers[n++] = (struct http_header){.name = "Content-Encoding", .value = "gzip"};
+	ctx->headers[n++] = (struct http_header){.name = "Vary", .value = "Accept-Encoding"};
+	resp->headers = ctx->headers;
+	resp->header_count = n;
+	resp->body = v1_gz_buf;
+	resp->body_len = ret;
+}
+
+// queues points posted by a client and returns the queue status
+static void v1_publish(struct v1_ctx *ctx, struct http_response_ctx *resp, point *pts, int count)
+{
+	int queued = web_points_publish(pts, count);
+	const char *err = "";
+
+	if (queued < count) {
+		err = "ingest queue full";
+		resp->status = HTTP_503_SERVICE_UNAVAILABLE;
+		ctx->headers[0] = (struct http_header){.name = "Retry-After", .value = "1"};
+		resp->headers = ctx->headers;
+		resp->header_count = 1;
+	} else {
+		resp->status = HTTP_202_ACCEPTED;
+	}
+
+	snprintf(v1_resp, sizeof(v1_resp),
+		 "{\"error\":\"%s\",\"queued\":%i,\"depth\":%zu,\"size\":%zu}", err, queued,
+		 point_queue_count(&web_ingest_q), point_queue_size(&web_ingest_q));
+}
+
+// GET/POST /v1/points
+static void v1_points(struct v1_ctx *ctx, const char *args, struct http_client_ctx *client,
+		      const struct http_request_ctx *request_ctx, struct http_response_ctx *resp)
+{
+	struct web_query *q = &ctx->query;
+
+	if (client->method == HTTP_POST) {
+		ctx->payload[ctx->cursor] = 0;
+
+		point pts[5] = {};
+		int ret = points_json_decode(ctx->payload, ctx->cursor, pts, ARRAY_SIZE(pts));
+
+		if (ret < 0) {
+			LOG_DBG("Post error decoding data: %i", ret);
+			v1_error(ctx, resp, HTTP_400_BAD_REQUEST, "error decoding data");
+		} else {
+			LOG_DBG_POINTS("Received points", pts, ret);
+			v1_publish(ctx, resp, pts, ret);
+		}
+		return;
+	}
+
+	int ret;
+
+	if (q->has_since) {
+		// delta query, only return points changed after since, along with
+		// the current cursor
+		k_mutex_lock(&web_points_lock, K_FOREVER);
+		// sequence numbers from another boot cannot be compared, so the
+		// client gets all points and knows to replace what it has
+		bool full = q->since == 0 || !q->has_boot || q->boot != web_boot;
+
+		if (full) {
+			q->since = 0;
+		}
+		int cnt = snprintf(v1_resp, sizeof(v1_resp),
+				   "{\"boot\":%u,\"seq\":%u,\"full\":%s,\"points\":", web_boot,
+				   web_seq, full ? "true" : "false");
+		ret = web_points_json_filter(web_points_query_filter, q, v1_resp + cnt,
+					     sizeof(v1_resp) - cnt - 1);
+		k_mutex_unlock(&web_points_lock);
+		strcat(v1_resp, "}");
+	} else if (q->type[0] != 0 || q->key[0] != 0) {
+		k_mutex_lock(&web_points_lock, K_FOREVER);
+		ret = web_points_json_filter(web_points_query_filter, q, v1_resp,
+					     sizeof(v1_resp));
+		k_mutex_unlock(&web_points_lock);
+	} else {
+		ctx->headers[0] = (struct http_header){.name = "ETag", .value = ctx->etag};
+		ctx->headers[1] = (struct http_header){.name = "Cache-Control", .value = "no-cache"};
+		resp->headers = ctx->headers;
+		resp->header_count = 2;
+
+		k_mutex_lock(&web_points_lock, K_FOREVER);
+		// the point cache sequence number is the version of the point
+		// snapshot. It restarts at boot, so the boot epoch keeps a client
+		// from getting a 304 for a snapshot from before a reboot.
+		// v1_compress() adds the -gz suffix if the snapshot is sent
+		// gzipped, so a client that accepts gzip may hold either tag.
+		snprintf(ctx->etag, sizeof(ctx->etag), "\"p%08x-%u\"", web_boot, web_seq);
+		const char *inm = web_header_get(request_ctx, "If-None-Match");
+		bool match;
+
+		if (v1_accepts_gzip(request_ctx)) {
+			match = html_etag_match_gzip(inm, ctx->etag, sizeof(ctx->etag));
+		} else {
+			match = html_etag_match(inm, ctx->etag);
+		}
+		if (match) {
+			k_mutex_unlock(&web_points_lock);
+			resp->status = HTTP_304_NOT_MODIFIED;
+			v1_resp[0] = 0;
+			return;
+		}
+		ret = web_points_json_get(v1_resp, sizeof(v1_resp));
+		k_mutex_unlock(&web_points_lock);
+	}
+
+	if (ret < 0) {
+		LOG_ERR("Error returning JSON points: %i", ret);
+		v1_error(ctx, resp, HTTP_500_INTERNAL_SERVER_ERROR, "error encoding points");
+	}
+}
+
+// GET /v1/points/<type>/<key>
+static void v1_point(struct v1_ctx *ctx, const char *args, struct http_client_ctx *client,
+		     const struct http_request_ctx *request_ctx, struct http_response_ctx *resp)
+{
+	char type[sizeof(((point *)0)->type)];
+	char key[sizeof(((point *)0)->key)];
+	size_t type_len = strcspn(args, "/?");
+
+	web_copy_decoded(type, sizeof(type), args, type_len);
+
+	if (args[type_len] == '/') {
+		args += type_len + 1;
+		web_copy_decoded(key, sizeof(key), args, strcspn(args, "/?"));
+	} else {
+		strcpy(key, "0");
+	}
+
+	k_mutex_lock(&web_points_lock, K_FOREVER);
+	int i = web_points_find(type, key);
+	int ret = -ENOENT;
+	if (i >= 0) {
+		ret = point_json_encode(&web_points[i], v1_resp, sizeof(v1_resp));
+	}
+	k_mutex_unlock(&web_points_lock);
+
+	if (ret == -ENOENT) {
+		v1_error(ctx, resp, HTTP_404_NOT_FOUND, "point not found");
+	} else if (ret != 0) {
+		v1_error(ctx, resp, HTTP_500_INTERNAL_SERVER_ERROR, "error encoding point");
+	}
+}
+
+// GET /v1/history, recent point updates, oldest first
+static void v1_history(struct v1_ctx *ctx, const char *args, struct http_client_ctx *client,
+		       const struct http_request_ctx *request_ctx, struct http_response_ctx *resp)
+{
+	struct web_query *q = &ctx->query;
+	size_t len = sizeof(v1_resp) - 1;
+	size_t offset = 0;
+
+	v1_resp[offset++] = '[';
+
+	k_mutex_lock(&web_points_lock, K_FOREVER);
+	for (int n = 0; n < WEB_HISTORY_LEN; n++) {
+		point *p = &web_history[(web_history_head + n) % WEB_HISTORY_LEN];
+
+		if (p->type[0] == 0 || !web_query_match_type_key(q, p, web_hash(p->type))) {
+			continue;
+		}
+
+		if (offset > 1) {
+			v1_resp[offset++] = ',';
+		}
+
+		if (point_json_encode(p, v1_resp + offset, len - offset) != 0) {
+			LOG_ERR("History response truncated");
+			offset -= offset > 1 ? 1 : 0;
+			break;
+		}
+		offset += strlen(v1_resp + offset);
+	}
+	k_mutex_unlock(&web_points_lock);
+
+	v1_resp[offset++] = ']';
+	v1_resp[offset] = 0;
+}
+
+// GET /v1/config, the points that are persisted in flash
+static void v1_config(struct v1_ctx *ctx, const char *args, struct http_client_ctx *client,
+		      const struct http_request_ctx *request_ctx, struct http_response_ctx *resp)
+{
+	k_mutex_lock(&web_points_lock, K_FOREVER);
+	int ret = web_points_json_filter(web_points_config_filter, &ctx->query, v1_resp,
+					 sizeof(v1_resp));
+	k_mutex_unlock(&web_points_lock);
+
+	if (ret < 0) {
+		LOG_ERR("Error returning JSON config: %i", ret);
+		v1_error(ctx, resp, HTTP_500_INTERNAL_SERVER_ERROR, "error encoding points");
+	}
+}
+
+static int web_form_field_cb(const char *key, const char *value, void *ctx)
+{
+	struct web_form *f = ctx;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(web_form_fields); i++) {
+		if (strcmp(key, web_form_fields[i].name) == 0) {
+			break;
+		}
+	}
+
+	if (i == ARRAY_SIZE(web_form_fields)) {
+		f->ignored++;
+		return 0;
+	}
+
+	const point_def *def = web_form_fields[i].def;
+	point *p = &f->pts[i];
+
+	if (def->data_type == POINT_DATA_TYPE_INT) {
+		// checkboxes post on/true
+		if (strcmp(value, "on") == 0 || strcmp(value, "true") == 0) {
+			value = "1";
+		} else if (strcmp(value, "off") == 0 || strcmp(value, "false") == 0) {
+			value = "0";
+		}
+	}
+
+	// numbers out of range and strings that do not fit in a point are
+	// rejected rather than changed
+	int ret = point_put_text(p, def->data_type, value);
+	if (ret) {
+		return ret;
+	}
+
+	point_set_type_key(p, def->type, "0");
+	f->set |= BIT(i);
+
+	return 0;
+}
+
+// streams a form body into the parser as it arrives
+static int v1_form_data(struct v1_ctx *ctx, const uint8_t *data, size_t len)
+{
+	struct web_form *f = &ctx->form;
+
+	if (ctx->cursor == 0) {
+		memset(f->pts, 0, sizeof(f->pts));
+		f->set = 0;
+		f->ignored = 0;
+		html_form_parser_init(&f->parser, f->buf, sizeof(f->buf), web_form_field_cb, f);
+	}
+
+	ctx->cursor += len;
+
+	// errors are sticky in the parser, and reported when the body is complete
+	html_form_parser_feed(&f->parser, (const char *)data, len);
+
+	return 0;
+}
+
+// POST /v1/form, application/x-www-form-urlencoded settings
+static void v1_form(struct v1_ctx *ctx, const char *args, struct http_client_ctx *client,
+		    const struct http_request_ctx *request_ctx, struct http_response_ctx *resp)
+{
+	struct web_form *f = &ctx->form;
+	point pts[ARRAY_SIZE(web_form_fields)];
+	int count = 0;
+
+	if (ctx->cursor == 0) {
+		// empty body, the data callback was never called
+		v1_form_data(ctx, NULL, 0);
+	}
+
+	int ret = html_form_parser_finish(&f->parser);
+
+	if (ret == -ENOMEM) {
+		v1_error(ctx, resp, HTTP_413_PAYLOAD_TOO_LARGE, "form field too long");
+		return;
+	} else if (ret < 0) {
+		v1_error(ctx, resp, HTTP_400_BAD_REQUEST, "invalid form value");
+		return;
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(web_form_fields); i++) {
+		if (f->set & BIT(i)) {
+			pts[count++] = f->pts[i];
+		}
+	}
+
+	if (f->ignored > 0) {
+		LOG_DBG("Form post ignored %i unknown fields", f->ignored);
+	}
+
+	LOG_DBG_POINTS("Received form points", pts, count);
+	v1_publish(ctx, resp, pts, count);
+}
+
+typedef void (*v1_route_handler)(struct v1_ctx *ctx, const char *args,
+				 struct http_client_ctx *client,
+				 const struct http_request_ctx *request_ctx,
+				 struct http_response_ctx *resp);
+
+// called with each chunk of a request body as it arrives. Returns 0, or a
+// negative error to abort the request.
+typedef int (*v1_route_data_handler)(struct v1_ctx *ctx, const uint8_t *data, size_t len);
+
+struct v1_route {
+	const char *path;
+	// if set, path is a prefix and the remainder of the URL is passed to the
+	// handler in args
+	bool prefix;
+	uint32_t methods;
+	v1_route_handler handler;
+	// if NULL, the body is collected in ctx->payload before calling handler
+	v1_route_data_handler data;
+};
+
+static const struct v1_route v1_routes[] = {
+	{"/v1/points", false, BIT(HTTP_GET) | BIT(HTTP_POST), v1_points},
+	{"/v1/points/", true, BIT(HTTP_GET), v1_point},
+	{"/v1/history", false, BIT(HTTP_GET), v1_history},
+	{"/v1/config", false, BIT(HTTP_GET), v1_config},
+	{"/v1/form", false, BIT(HTTP_POST), v1_form, v1_form_data},
+};
+
+static const struct v1_route *v1_route_find(const char *url, const char **args)
+{
+	size_t path_len = strcspn(url, "?");
+
+	for (int i = 0; i < ARRAY_SIZE(v1_routes); i++) {
+		const struct v1_route *r = &v1_routes[i];
+		size_t len = strlen(r->path);
+
+		if (r->prefix ? (path_len > len && strncmp(url, r->path, len) == 0)
+			      : (path_len == len && strncmp(url, r->path, len) == 0)) {
+			*args = url + len;
+			return r;
+		}
+	}
+
+	return NULL;
+}
+
 static int v1_handler(struct http_client_ctx *client, enum http_data_status status,
 		      const struct http_request_ctx *request_ctx, struct http_response_ctx *resp,
 		      void *user_data)
 {
+	struct v1_ctx *ctx = v1_ctx_get(client);
 
-	static uint8_t v1_payload_buf[256];
-	static size_t cursor;
+	if (ctx == NULL) {
+		LOG_ERR("No free v1 request context");
+		return -EBUSY;
+	}
 
-	if (client->method == HTTP_POST) {
+	const char *args;
+	const struct v1_route *route = v1_route_find((const char *)client->url_buffer, &args);
+
+	if (client->method == HTTP_POST && route != NULL && route->data != NULL) {
+		if (request_ctx->data_len > 0) {
+			int ret = route->data(ctx, request_ctx->data, request_ctx->data_len);
+			if (ret < 0) {
+				v1_ctx_put(ctx);
+				return ret;
+			}
+		}
+	} else if (client->method == HTTP_POST) {
 		// Copy payload to our buffer. Note that even for a small payload, it
 		// may arrive split into chunks (e.g. if the header size was such that
 		// the whole HTTP request exceeds the size of the client buffer).
-		if (request_ctx->data_len + cursor > sizeof(v1_payload_buf)) {
-			cursor = 0;
+		if (request_ctx->data_len + ctx->cursor >= sizeof(ctx->payload)) {
+			v1_ctx_put(ctx);
 			return -ENOMEM;
 		}
 
-		memcpy(v1_payload_buf + cursor, request_ctx->data, request_ctx->data_len);
-		cursor += request_ctx->data_len;
+		memcpy(ctx->payload + ctx->cursor, request_ctx->data, request_ctx->data_len);
+		ctx->cursor += request_ctx->data_len;
 	}
 
 	if (status == HTTP_SERVER_DATA_ABORTED) {
-		cursor = 0;
+		v1_ctx_put(ctx);
 		return 0;
 	}
 
-	if (status == HTTP_SERVER_DATA_FINAL) {
-		if (strcmp(client->url_buffer, "/v1/points") == 0) {
-			if (client->method == HTTP_GET) {
-				k_mutex_lock(&web_points_lock, K_FOREVER);
-				int ret = points_json_encode(web_points, ARRAY_SIZE(web_points),
-							     recv_buffer, sizeof(recv_buffer));
-				k_mutex_unlock(&web_points_lock);
-				if (ret != 0) {
-					LOG_ERR("Error returning JSON points: %i", ret);
-				}
-			} else {
-				// must be a post
-				v1_payload_buf[cursor] = 0;
-				// LOG_DBG("data: %s", v1_payload_buf);
-
-				point pts[5] = {};
-				int ret = points_json_decode(v1_payload_buf, cursor, pts,
-							     ARRAY_SIZE(pts));
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
 
-				if (ret < 0) {
-					LOG_DBG("Post error decoding data: %i", ret);
-					strcpy(recv_buffer, "{\"error\":\"error decoding data\"}");
-				} else {
-					LOG_DBG_POINTS("Received points", pts, ret);
-					k_mutex_lock(&web_points_lock, K_FOREVER);
-					for (int i = 0; i < ret; i++) {
-						points_merge(web_points, ARRAY_SIZE(web_points),
-							     &pts[i]);
-						zbus_chan_pub(&point_chan, &pts[i], K_MSEC(500));
-					}
-					k_mutex_unlock(&web_points_lock);
-				}
-				strcpy(recv_buffer, "{\"error\":\"\"}");
-			}
-		} else {
-			sprintf(recv_buffer, "%s", CONFIG_BOARD_TARGET);
-		}
+	v1_resp[0] = 0;
 
-		resp->body = recv_buffer;
-		resp->body_len = strlen(recv_buffer);
-		resp->final_chunk = true;
-		cursor = 0;
+	if (route == NULL) {
+		v1_error(ctx, resp, HTTP_404_NOT_FOUND, "not found");
+	} else if ((route->methods & BIT(client->method)) == 0) {
+		v1_error(ctx, resp, HTTP_405_METHOD_NOT_ALLOWED, "method not allowed");
+	} else {
+		web_query_parse(&ctx->query, (const char *)client->url_buffer);
+		route->handler(ctx, args, client, request_ctx, resp);
 	}
 
+	resp->body = (uint8_t *)v1_resp;
+	resp->body_len = strlen(v1_resp);
+	resp->final_chunk = true;
+	v1_compress(ctx, request_ctx, resp);
+	v1_ctx_put(ctx);
+
 	return 0;
 }
 
@@ -168,12 +1156,302 @@ struct http_resource_detail_dynamic v1_resource_detail = {
 
 HTTP_RESOURCE_DEFINE(points_resource, siot_http_service, "/v1/*", &v1_resource_detail);
 
+// ********************************
+// v1 WebSocket point channel
+//
+// Clients connected to /v1/ws receive every point that shows up on the point
+// bus, and points they send are merged and published just like a POST to
+// /v1/points. Text frames carry JSON point arrays, binary frames carry the
+// binary point encoding. Updates are sent to each client in the format it
+// last sent (JSON until the client sends a binary frame).
+
+#define WS_MAX_CLIENTS     CONFIG_WEBSOCKET_MAX_CONTEXTS
+#define WS_POLL_MS         100
+#define WS_RECV_TIMEOUT_MS 100
+#define WS_SEND_TIMEOUT_MS 100
+
+struct ws_client {
+	int sock;
+	bool binary;
+};
+
+K_MUTEX_DEFINE(ws_lock);
+K_SEM_DEFINE(ws_sem, 0, 1);
+static struct ws_client ws_clients[WS_MAX_CLIENTS] = {
+	[0 ... WS_MAX_CLIENTS - 1] = {.sock = -1},
+};
+
+// used by the HTTP server to parse websocket frames
+static uint8_t ws_frame_buffer[512];
+
+// Sends to a client are serialized by ws_send_lock rather than ws_lock, so a
+// slow client does not hold up the client table while a frame goes out.
+K_MUTEX_DEFINE(ws_send_lock);
+
+// the caller holds ws_send_lock
+static int ws_send_frame(int sock, bool binary, const uint8_t *data, size_t len)
+{
+	enum websocket_opcode opcode =
+		binary ? WEBSOCKET_OPCODE_DATA_BINARY : WEBSOCKET_OPCODE_DATA_TEXT;
+
+	int ret = websocket_send_msg(sock, data, len, opcode, false, true, WS_SEND_TIMEOUT_MS);
+	if (ret < 0) {
+		LOG_ERR("Error sending to websocket %i: %i", sock, ret);
+	}
+
+	return ret;
+}
+
+static int ws_send(int sock, bool binary, const uint8_t *data, size_t len)
+{
+	k_mutex_lock(&ws_send_lock, K_FOREVER);
+	int ret = ws_send_frame(sock, binary, data, len);
+	k_mutex_unlock(&ws_send_lock);
+
+	return ret;
+}
+
+// Adds a client and sends it the point cache. The client is added and the
+// snapshot encoded under web_points_lock, so every point stored after the
+// snapshot is broadcast to it, and ws_send_lock is held until the snapshot is
+// sent, so those updates go out after it.
+static int ws_setup(int ws_socket, struct http_request_ctx *request_ctx, void *user_data)
+{
+	static char buf[2048];
+	int ret = -ENOENT;
+
+	k_mutex_lock(&ws_send_lock, K_FOREVER);
+	k_mutex_lock(&web_points_lock, K_FOREVER);
+
+	k_mutex_lock(&ws_lock, K_FOREVER);
+	for (int i = 0; i < ARRAY_SIZE(ws_clients); i++) {
+		if (ws_clients[i].sock < 0) {
+			ws_clients[i].sock = ws_socket;
+			ws_clients[i].binary = false;
+			ret = 0;
+			break;
+		}
+	}
+	k_mutex_unlock(&ws_lock);
+
+	// new clients start with the full point state, as JSON until they send
+	// a binary frame
+	int len = ret == 0 ? web_points_json_get(buf, sizeof(buf)) : 0;
+
+	k_mutex_unlock(&web_points_lock);
+
+	if (ret < 0) {
+		k_mutex_unlock(&ws_send_lock);
+		LOG_ERR("No free websocket slot for client");
+		return ret;
+	}
+
+	LOG_INF("Websocket client connected: %i", ws_socket);
+
+	if (len < 0) {
+		LOG_ERR("Error encoding websocket snapshot: %i", len);
+	} else {
+		ws_send_frame(ws_socket, false, (const uint8_t *)buf, len);
+	}
+	k_mutex_unlock(&ws_send_lock);
+
+	k_sem_give(&ws_sem);
+
+	return 0;
+}
+
+struct http_resource_detail_websocket ws_resource_detail = {
+	.common =
+		{
+			.type = HTTP_RESOURCE_TYPE_WEBSOCKET,
+			// HTTP/1.1 GET is used to upgrade the connection
+			.bitmask_of_supported_http_methods = BIT(HTTP_GET),
+		},
+	.cb = ws_setup,
+	.data_buffer = ws_frame_buffer,
+	.data_buffer_len = sizeof(ws_frame_buffer),
+	.user_data = NULL,
+};
+
+// Resources are matched in name order, so this must sort before
+// points_resource, otherwise the /v1/* wildcard swallows the upgrade request.
+HTTP_RESOURCE_DEFINE(api_ws_resource, siot_http_service, "/v1/ws", &ws_resource_detail);
+
+static void ws_close(struct ws_client *c)
+{
+	k_mutex_lock(&ws_lock, K_FOREVER);
+	LOG_INF("Websocket client disconnected: %i", c->sock);
+	websocket_unregister(c->sock);
+	c->sock = -1;
+	k_mutex_unlock(&ws_lock);
+}
+
+static void ws_receive(struct ws_client *c)
+{
+	static uint8_t buf[256];
+	uint32_t msg_type;
+	uint64_t remaining;
+
+	int ret = websocket_recv_msg(c->sock, buf, sizeof(buf) - 1, &msg_type, &remaining,
+				     WS_RECV_TIMEOUT_MS);
+	if (ret == -EAGAIN) {
+		return;
+	}
+
+	if (ret < 0 || (msg_type & WEBSOCKET_FLAG_CLOSE)) {
+		ws_close(c);
+		return;
+	}
+
+	if (msg_type & WEBSOCKET_FLAG_PING) {
+		k_mutex_lock(&ws_send_lock, K_FOREVER);
+		websocket_send_msg(c->sock, buf, ret, WEBSOCKET_OPCODE_PONG, false, true,
+				   WS_SEND_TIMEOUT_MS);
+		k_mutex_unlock(&ws_send_lock);
+		return;
+	}
+
+	if (remaining > 0) {
+		LOG_ERR("Websocket message too large, closing client");
+		ws_close(c);
+		return;
+	}
+
+	point pts[5] = {};
+
+	if (msg_type & WEBSOCKET_FLAG_BINARY) {
+		c->binary = true;
+		ret = points_bin_decode(buf, ret, pts, ARRAY_SIZE(pts));
+	} else if (msg_type & WEBSOCKET_FLAG_TEXT) {
+		c->binary = false;
+		buf[ret] = 0;
+		ret = points_json_decode((char *)buf, ret, pts, ARRAY_SIZE(pts));
+	} else {
+		return;
+	}
+
+	if (ret < 0) {
+		static const char err[] = "{\"error\":\"error decoding data\"}";
+
+		// none of the points are published, and the client is told so in
+		// a text frame like the body of an HTTP 400
+		LOG_DBG("Websocket error decoding data: %i", ret);
+		ws_send(c->sock, false, (const uint8_t *)err, sizeof(err) - 1);
+		return;
+	}
+
+	LOG_DBG_POINTS("Websocket received points", pts, ret);
+	if (web_points_publish(pts, ret) < ret) {
+		LOG_WRN("Ingest queue full, dropped websocket points");
+	}
+}
+
+// called for every point on the bus
+static void ws_broadcast(point *p)
+{
+	// only used from the web thread
+	static char json_buf[128];
+	static uint8_t bin_buf[64];
+	struct {
+		int sock;
+		bool binary;
+	} targets[WS_MAX_CLIENTS];
+	int json_len = -1;
+	int bin_len = -1;
+	int cnt = 0;
+
+	// the clients are copied so no lock is held while sending. A client that
+	// closes in the meantime only makes its send fail.
+	k_mutex_lock(&ws_lock, K_FOREVER);
+	for (int i = 0; i < ARRAY_SIZE(ws_clients); i++) {
+		if (ws_clients[i].sock >= 0) {
+			targets[cnt].sock = ws_clients[i].sock;
+			targets[cnt++].binary = ws_clients[i].binary;
+		}
+	}
+	k_mutex_unlock(&ws_lock);
+
+	for (int i = 0; i < cnt; i++) {
+		// encode lazily, and only once per format
+		if (targets[i].binary) {
+			if (bin_len < 0) {
+				bin_len = point_bin_encode(p, bin_buf, sizeof(bin_buf));
+			}
+			if (bin_len > 0) {
+				ws_send(targets[i].sock, true, bin_buf, bin_len);
+			}
+		} else {
+			if (json_len < 0) {
+				// send single points as an array so clients only need one decoder
+				json_buf[0] = '[';
+				if (point_json_encode(p, json_buf + 1, sizeof(json_buf) - 2) == 0) {
+					json_len = strlen(json_buf);
+					json_buf[json_len++] = ']';
+				} else {
+					json_len = 0;
+				}
+			}
+			if (json_len > 0) {
+				ws_send(targets[i].sock, false, (uint8_t *)json_buf, json_len);
+			}
+		}
+	}
+}
+
+void ws_thread(void *arg1, void *arg2, void *arg3)
+{
+	struct zsock_pollfd fds[WS_MAX_CLIENTS];
+	struct ws_client *clients[WS_MAX_CLIENTS];
+
+	while (1) {
+		int cnt = 0;
+
+		k_mutex_lock(&ws_lock, K_FOREVER);
+		for (int i = 0; i < ARRAY_SIZE(ws_clients); i++) {
+			if (ws_clients[i].sock >= 0) {
+				fds[cnt].fd = ws_clients[i].sock;
+				fds[cnt].events = ZSOCK_POLLIN;
+				fds[cnt].revents = 0;
+				clients[cnt++] = &ws_clients[i];
+			}
+		}
+		k_mutex_unlock(&ws_lock);
+
+		if (cnt == 0) {
+			k_sem_take(&ws_sem, K_FOREVER);
+			continue;
+		}
+
+		int ret = zsock_poll(fds, cnt, WS_POLL_MS);
+		if (ret < 0) {
+			LOG_ERR("Websocket poll error: %i", errno);
+			k_msleep(WS_POLL_MS);
+			continue;
+		}
+
+		for (int i = 0; i < cnt; i++) {
+			if (fds[i].revents & (ZSOCK_POLLERR | ZSOCK_POLLHUP | ZSOCK_POLLNVAL)) {
+				ws_close(clients[i]);
+			} else if (fds[i].revents & ZSOCK_POLLIN) {
+				ws_receive(clients[i]);
+			}
+		}
+	}
+}
+
+K_THREAD_DEFINE(web_ws, WS_STACKSIZE, ws_thread, NULL, NULL, NULL, PRIORITY, 0, 0);
+
 ZBUS_MSG_SUBSCRIBER_DEFINE(web_sub);
 ZBUS_CHAN_ADD_OBS(point_chan, web_sub, 3);
 
 void web_thread(void *arg1, void *arg2, void *arg3)
 {
 	LOG_INF("siot web thread");
+
+	k_mutex_lock(&web_points_lock, K_FOREVER);
+	web_boot = sys_rand32_get();
+	k_mutex_unlock(&web_points_lock);
+
 	http_server_start();
 
 	point p;
@@ -183,13 +1461,18 @@ void web_thread(void *arg1, void *arg2, void *arg3)
 		if (chan == &point_chan) {
 
 			k_mutex_lock(&web_points_lock, K_FOREVER);
-			int ret = points_merge(web_points, ARRAY_SIZE(web_points), &p);
+			if (strcmp(p.type, POINT_TYPE_BOOT_COUNT) == 0) {
+				web_boot ^= point_get_int(&p) * 2654435761u;
+			}
+			int ret = web_points_upsert(&p);
 			k_mutex_unlock(&web_points_lock);
 			if (ret != 0) {
 				LOG_ERR("Error storing point in web point cache: %i", ret);
 			}
+
+			ws_broadcast(&p);
 		}
 	}
 }
 
-K_THREAD_DEFINE(web, STACKSIZE, web_thread, NULL, NULL, NULL, PRIORITY, K_ESSENTIAL, 0);
+K_THREAD_DEFINE(web, WEB_STACKSIZE, web_thread, NULL, NULL, NULL, PRIORITY, K_ESSENTIAL, 0);
@@ -0,0 +1,407 @@
+// Command loadgen drives the siot-net HTTP server with concurrent requests and
+// reports throughput and latency percentiles for each kind of request.
+//
+// It is meant to be run against the native_sim build of siot-net (see the
+// siot-net README), but works against any device running the firmware:
+//
+//	go run ./loadgen -url http://192.0.2.1 -c 4 -d 30s
+package main
+
+import (
+	"encoding/json"
+	"flag"
+	"fmt"
+	"io"
+	"log"
+	"math"
+	"math/rand/v2"
+	"net/http"
+	"os"
+	"slices"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// scenario is one kind of request. run returns the HTTP status code.
+type scenario struct {
+	name string
+	run  func(w *worker) (int, error)
+}
+
+var scenarios = []scenario{
+	{"points", getPoints},
+	{"cached", getPointsCached},
+	{"post", postPoints},
+	{"static", getStatic},
+}
+
+// statuses that count as success, 503 from a full ingest queue is an error
+var okStatus = map[int]bool{
+	http.StatusOK:          true,
+	http.StatusAccepted:    true,
+	http.StatusNotModified: true,
+}
+
+type worker struct {
+	id     int
+	url    string
+	client *http.Client
+	rand   *rand.Rand
+
+	// ETag of the last GET /v1/points response, for conditional requests
+	etag string
+	// number of requests sent, used for posted values and static assets
+	count int
+
+	latency map[string][]time.Duration
+	errors  map[string]int
+	status  map[int]int
+}
+
+func (w *worker) do(req *http.Request) (*http.Response, error) {
+	resp, err := w.client.Do(req)
+	if err != nil {
+		return nil, err
+	}
+
+	// the request is not complete until the body has been read
+	_, err = io.Copy(io.Discard, resp.Body)
+	resp.Body.Close()
+
+	return resp, err
+}
+
+func getPoints(w *worker) (int, error) {
+	req, err := http.NewRequest(http.MethodGet, w.url+"/v1/points", nil)
+	if err != nil {
+		return 0, err
+	}
+
+	resp, err := w.do(req)
+	if err != nil {
+		return 0, err
+	}
+
+	return resp.StatusCode, nil
+}
+
+func getPointsCached(w *worker) (int, error) {
+	req, err := http.NewRequest(http.MethodGet, w.url+"/v1/points", nil)
+	if err != nil {
+		return 0, err
+	}
+
+	if w.etag != "" {
+		req.Header.Set("If-None-Match", w.etag)
+	}
+
+	resp, err := w.do(req)
+	if err != nil {
+		return 0, err
+	}
+
+	if etag := resp.Header.Get("ETag"); etag != "" {
+		w.etag = etag
+	}
+
+	return resp.StatusCode, nil
+}
+
+func postPoints(w *worker) (int, error) {
+	body := fmt.Sprintf(`[{"t":"temp","k":"loadgen%v","dt":"FLT","d":"%v.5"}]`,
+		w.id, w.count%1000)
+
+	req, err := http.NewRequest(http.MethodPost, w.url+"/v1/points", strings.NewReader(body))
+	if err != nil {
+		return 0, err
+	}
+	req.Header.Set("Content-Type", "application/json")
+
+	resp, err := w.do(req)
+	if err != nil {
+		return 0, err
+	}
+
+	return resp.StatusCode, nil
+}
+
+func getStatic(w *worker) (int, error) {
+	path := "/"
+	if w.count%2 == 1 {
+		path = "/index.js"
+	}
+
+	req, err := http.NewRequest(http.MethodGet, w.url+path, nil)
+	if err != nil {
+		return 0, err
+	}
+
+	// the assets are always served gzipped
+	req.Header.Set("Accept-Encoding", "gzip")
+
+	resp, err := w.do(req)
+	if err != nil {
+		return 0, err
+	}
+
+	return resp.StatusCode, nil
+}
+
+// parseMix parses a list of scenario weights like "points=4,post=1" into a
+// list of scenario indexes where each scenario shows up weight times.
+func parseMix(mix string) ([]int, error) {
+	var ret []int
+
+	for _, field := range strings.Split(mix, ",") {
+		name, weightS, found := strings.Cut(strings.TrimSpace(field), "=")
+		weight := 1
+		if found {
+			var err error
+			weight, err = strconv.Atoi(weightS)
+			if err != nil || weight < 0 {
+				return nil, fmt.Errorf("invalid weight in %q", field)
+			}
+		}
+
+		i := slices.IndexFunc(scenarios, func(s scenario) bool { return s.name == name })
+		if i < 0 {
+			return nil, fmt.Errorf("unknown scenario %q", name)
+		}
+
+		for range weight {
+			ret = append(ret, i)
+		}
+	}
+
+	if len(ret) == 0 {
+		return nil, fmt.Errorf("mix has no requests")
+	}
+
+	return ret, nil
+}
+
+// Stats are the results for one scenario, or for all of them.
+type Stats struct {
+	Name      string  `json:"name"`
+	Requests  int     `json:"requests"`
+	Errors    int     `json:"errors"`
+	PerSecond float64 `json:"perSecond"`
+	MeanMs    float64 `json:"meanMs"`
+	P50Ms     float64 `json:"p50Ms"`
+	P99Ms     float64 `json:"p99Ms"`
+	P999Ms    float64 `json:"p999Ms"`
+	MaxMs     float64 `json:"maxMs"`
+}
+
+// Report is the output of a run.
+type Report struct {
+	URL         string         `json:"url"`
+	Concurrency int            `json:"concurrency"`
+	Seconds     float64        `json:"seconds"`
+	Scenarios   []Stats        `json:"scenarios"`
+	Total       Stats          `json:"total"`
+	Status      map[string]int `json:"status"`
+}
+
+func ms(d time.Duration) float64 {
+	return float64(d) / float64(time.Millisecond)
+}
+
+// percentile returns the p quantile of sorted, using the nearest rank
+func percentile(sorted []time.Duration, p float64) time.Duration {
+	if len(sorted) == 0 {
+		return 0
+	}
+
+	i := int(math.Ceil(p*float64(len(sorted)))) - 1
+	return sorted[max(i, 0)]
+}
+
+func newStats(name string, latency []time.Duration, errors int, elapsed time.Duration) Stats {
+	sort.Slice(latency, func(i, j int) bool { return latency[i] < latency[j] })
+
+	s := Stats{
+		Name:      name,
+		Requests:  len(latency),
+		Errors:    errors,
+		PerSecond: float64(len(latency)) / elapsed.Seconds(),
+		P50Ms:     ms(percentile(latency, 0.50)),
+		P99Ms:     ms(percentile(latency, 0.99)),
+		P999Ms:    ms(percentile(latency, 0.999)),
+		MaxMs:     ms(percentile(latency, 1)),
+	}
+
+	if len(latency) > 0 {
+		var sum time.Duration
+		for _, l := range latency {
+			sum += l
+		}
+		s.MeanMs = ms(sum / time.Duration(len(latency)))
+	}
+
+	return s
+}
+
+func main() {
+	flagURL := flag.String("url", "http://192.0.2.1", "URL of the device")
+	flagConcurrency := flag.Int("c", 4, "number of concurrent clients")
+	flagDuration := flag.Duration("d", 10*time.Second, "duration of the test")
+	flagRequests := flag.Int("n", 0, "stop after this many requests (overrides -d)")
+	flagWarmup := flag.Duration("warmup", time.Second, "requests during warmup are not counted")
+	flagMix := flag.String("mix", "points=4,cached=2,post=2,static=2",
+		"request mix, scenario=weight, scenarios are "+
+			"points (GET /v1/points), cached (GET /v1/points with If-None-Match), "+
+			"post (POST /v1/points), static (GET / and /index.js)")
+	flagTimeout := flag.Duration("timeout", 5*time.Second, "request timeout")
+	flagKeepAlive := flag.Bool("keepalive", true, "reuse connections")
+	flagJSON := flag.Bool("json", false, "print the report as JSON")
+	flag.Parse()
+
+	mix, err := parseMix(*flagMix)
+	if err != nil {
+		log.Fatal("Error parsing -mix: ", err)
+	}
+
+	url := strings.TrimSuffix(*flagURL, "/")
+
+	// compression is disabled so the time to decompress responses is not measured
+	transport := &http.Transport{
+		MaxIdleConnsPerHost: *flagConcurrency,
+		DisableKeepAlives:   !*flagKeepAlive,
+		DisableCompression:  true,
+	}
+	client := &http.Client{Transport: transport, Timeout: *flagTimeout}
+
+	start := time.Now()
+	measureStart := start.Add(*flagWarmup)
+	end := measureStart.Add(*flagDuration)
+
+	var sent atomic.Int64
+	limit := int64(*flagRequests)
+
+	workers := make([]*worker, *flagConcurrency)
+	var wg sync.WaitGroup
+
+	for i := range workers {
+		w := &worker{
+			id:      i,
+			url:     url,
+			client:  client,
+			rand:    rand.New(rand.NewPCG(uint64(start.UnixNano()), uint64(i))),
+			latency: make(map[string][]time.Duration),
+			errors:  make(map[string]int),
+			status:  make(map[int]int),
+		}
+		workers[i] = w
+
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+
+			for {
+				now := time.Now()
+				if limit > 0 {
+					if now.After(measureStart) && sent.Add(1) > limit {
+						return
+					}
+				} else if now.After(end) {
+					return
+				}
+
+				s := scenarios[mix[w.rand.IntN(len(mix))]]
+				status, err := s.run(w)
+				latency := time.Since(now)
+				w.count++
+
+				if now.Before(measureStart) {
+					continue
+				}
+
+				w.status[status]++
+				if err != nil || !okStatus[status] {
+					w.errors[s.name]++
+					continue
+				}
+				w.latency[s.name] = append(w.latency[s.name], latency)
+			}
+		}()
+	}
+
+	wg.Wait()
+	elapsed := time.Since(measureStart)
+
+	report := Report{
+		URL:         url,
+		Concurrency: *flagConcurrency,
+		Seconds:     elapsed.Seconds(),
+		Status:      make(map[string]int),
+	}
+
+	var all []time.Duration
+	allErrors := 0
+
+	for _, s := range scenarios {
+		var latency []time.Duration
+		errors := 0
+		for _, w := range workers {
+			latency = append(latency, w.latency[s.name]...)
+			errors += w.errors[s.name]
+		}
+
+		if len(latency) == 0 && errors == 0 {
+			continue
+		}
+
+		all = append(all, latency...)
+		allErrors += errors
+		report.Scenarios = append(report.Scenarios, newStats(s.name, latency, errors, elapsed))
+	}
+
+	report.Total = newStats("total", all, allErrors, elapsed)
+
+	for _, w := range workers {
+		for status, count := range w.status {
+			name := strconv.Itoa(status)
+			if status == 0 {
+				name = "error"
+			}
+			report.Status[name] += count
+		}
+	}
+
+	if *flagJSON {
+		enc := json.NewEncoder(os.Stdout)
+		enc.SetIndent("", "  ")
+		if err := enc.Encode(report); err != nil {
+			log.Fatal("Error encoding report: ", err)
+		}
+	} else {
+		printReport(report)
+	}
+
+	if report.Total.Requests == 0 {
+		os.Exit(1)
+	}
+}
+
+func printReport(r Report) {
+	fmt.Printf("%v, %v clients, %.1fs\n\n", r.URL, r.Concurrency, r.Seconds)
+	fmt.Printf("%-8s %9s %7s %9s %9s %9s %9s %9s\n",
+		"", "requests", "errors", "req/s", "p50 ms", "p99 ms", "p999 ms", "max ms")
+
+	for _, s := range append(r.Scenarios, r.Total) {
+		fmt.Printf("%-8s %9d %7d %9.1f %9.2f %9.2f %9.2f %9.2f\n",
+			s.Name, s.Requests, s.Errors, s.PerSecond, s.P50Ms, s.P99Ms, s.P999Ms, s.MaxMs)
+	}
+
+	var status []string
+	for name, count := range r.Status {
+		status = append(status, fmt.Sprintf("%v: %v", name, count))
+	}
+	sort.Strings(status)
+	fmt.Printf("\nstatus: %v\n", strings.Join(status, ", "))
+}
@@ -7,26 +7,15 @@
 #ifndef _CLOUD_H
 #define _CLOUD_H
 
-struct device_data {
-	bool do_something;
-};
-
-/**
- * @brief Publish data to the cloud
- *
- * @param data Pointer to device data
- * @return int 0 if successful, negative errno otherwise
- *
- */
-int cloud_publish(struct device_data *data);
-
 /**
  * @brief Initialize the cloud
  *
- * @param callback Callback function to be called when data is received
+ * Provisions the CA certificate to the modem. Data is sent to the cloud by
+ * the SIOT uplink, see uplink.h.
+ *
  * @return int 0 if successful, negative errno otherwise
  *
  */
-int cloud_init(void (*callback)(struct device_data *data));
+int cloud_init(void);
 
 #endif
\ No newline at end of file
@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <string.h>
 #include <zephyr/kernel.h>
 #include <zephyr/pm/device.h>
 #include <zephyr/logging/log.h>
@@ -14,6 +15,11 @@ LOG_MODULE_REGISTER(main);
 #include <modem/lte_lc.h>
 #include <modem/modem_info.h>
 
+/* SIOT */
+#include <point.h>
+#include <point_coap.h>
+#include <uplink.h>
+
 /* Local */
 #include "cloud/cloud.h"
 
@@ -24,24 +30,69 @@ K_TIMER_DEFINE(timer, timeout_handler, NULL);
 /* Thread control */
 K_SEM_DEFINE(thread_sem, 0, 1);
 
-/* Variables */
-static struct device_data data = {
-	.do_something = true,
-};
-
-void cloud_cb(struct device_data *p_data)
+/* The SIOT metrics thread (lib/metrics.c) publishes metricSysCPUPercent and
+ * uptime points every second. Passed on as they are, they would fill the uplink
+ * queue long before a batch is due, and notify CoAP observers every second.
+ * The filter goes by the point type alone: CPU use is not sent at all, and
+ * uptime at most once every CONFIG_DEFAULT_DELAY minutes, as the heartbeat of
+ * the device. ctx holds the uptime in ms when the last uptime point passed, so
+ * the uplink and CoAP each get their own.
+ */
+static bool metrics_filter(const point *p, int index, void *ctx)
 {
-	LOG_INF("Cloud callback");
+	int64_t *last_ms = ctx;
+
+	if (strcmp(p->type, POINT_TYPE_METRIC_SYS_CPU_PERCENT) == 0) {
+		return false;
+	}
+
+	if (strcmp(p->type, POINT_TYPE_UPTIME) == 0) {
+		int64_t now = k_uptime_get();
 
-	/* TODO: handle data here */
+		if (*last_ms != 0 && now - *last_ms < CONFIG_DEFAULT_DELAY * 60 * MSEC_PER_SEC) {
+			return false;
+		}
+		*last_ms = now;
+	}
+
+	return true;
 }
 
+static int64_t uplink_uptime_ms;
+static int64_t coap_uptime_ms;
+
+/* Points are queued and sent in batches, see uplink.h */
+static const struct uplink_config uplink_config = {
+	.host = CONFIG_CLOUD_HOSTNAME,
+	.port = CONFIG_CLOUD_PORT,
+	.path = CONFIG_CLOUD_PUBLISH_PATH,
+	.sec_tag = CONFIG_CLOUD_TLS_SEC_TAG,
+	.filter = metrics_filter,
+	.filter_ctx = &uplink_uptime_ms,
+};
+
+/* The same points are served over CoAP, see point_coap.h */
+static const struct point_coap_config coap_config = {
+	.filter = metrics_filter,
+	.filter_ctx = &coap_uptime_ms,
+};
+
 static void timeout_handler(struct k_timer *timer_id)
 {
 	LOG_INF("Timeout");
 	k_sem_give(&thread_sem);
 }
 
+static void lte_handler(const struct lte_lc_evt *const evt)
+{
+	/* The radio is on anyway, so send what is queued in the same wake
+	 * window instead of waking it again later.
+	 */
+	if (evt->type == LTE_LC_EVT_RRC_UPDATE && evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED) {
+		uplink_flush();
+	}
+}
+
 int main(void)
 {
 	int err;
@@ -56,9 +107,23 @@ int main(void)
 	}
 
 	/* Cloud init */
-	err = cloud_init(cloud_cb);
+	err = cloud_init();
 	if (err < 0) {
-		LOG_ERR("Unable to set callback. Err: %i", err);
+		LOG_ERR("Unable to init cloud. Err: %i", err);
+		return err;
+	}
+
+	/* Uplink */
+	err = uplink_init(&uplink_config);
+	if (err < 0) {
+		LOG_ERR("Unable to start uplink. Err: %i", err);
+		return err;
+	}
+
+	/* CoAP server */
+	err = point_coap_init(&coap_config);
+	if (err < 0) {
+		LOG_ERR("Unable to start CoAP server. Err: %i", err);
 		return err;
 	}
 
@@ -69,6 +134,8 @@ int main(void)
 		return err;
 	}
 
+	lte_lc_register_handler(lte_handler);
+
 	/* Power saving is turned on */
 	lte_lc_psm_req(true);
 
@@ -88,10 +155,9 @@ int main(void)
 	while (1) {
 		k_sem_take(&thread_sem, K_FOREVER);
 
-		// the following is crashing
-		// /* Publish and sleep .. */
-		// err = cloud_publish(&data);
-		// if (err < 0)
-		//     LOG_ERR("Unable to publish. Err: %i", err);
+		/* The uplink sends the queued points, including the uptime
+		 * heartbeat, in one batch
+		 */
+		uplink_flush();
 	}
 }
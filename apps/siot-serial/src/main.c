@@ -1,12 +1,43 @@
 
+#include <point.h>
+#include <point_serial.h>
+
+#include <zephyr/device.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/zbus/zbus.h>
 
 LOG_MODULE_REGISTER(siot, LOG_LEVEL_DBG);
 
+ZBUS_CHAN_DECLARE(point_chan);
+
+static const struct device *const serial_dev = DEVICE_DT_GET(DT_CHOSEN(siot_serial));
+
 int main(void)
 {
-	LOG_INF("SIOT Zephyr Application! %s", CONFIG_BOARD_TARGET);
+	point p = {0};
+	int ret;
+
+	LOG_INF("SIOT Zephyr Serial Connection! %s", CONFIG_BOARD_TARGET);
+
+	// the other end of the link is a host, so everything on point_chan is
+	// sent, including points received from the host
+	ret = point_serial_init(serial_dev, NULL, NULL);
+	if (ret) {
+		return ret;
+	}
+
+	point_set_type_key(&p, POINT_TYPE_BOARD, "0");
+	point_put_string(&p, CONFIG_BOARD_TARGET);
+	zbus_chan_pub(&point_chan, &p, K_MSEC(500));
+
+	point_set_type_key(&p, POINT_TYPE_UPTIME, "0");
+
+	while (true) {
+		point_put_int(&p, k_uptime_seconds());
+		zbus_chan_pub(&point_chan, &p, K_MSEC(500));
+		k_sleep(K_SECONDS(10));
+	}
 
 	return 0;
 }
@@ -0,0 +1,208 @@
+#!/usr/bin/env python3
+"""Measure point throughput of the siot-serial link.
+
+Sends INT points in frames to the app, paced at the given baud rates, and
+counts the points the app echoes back. On native_sim the link is a pseudo
+terminal, which has no baud rate of its own, so this script sends no faster
+than a real UART at each rate would.
+
+  ./build/zephyr/zephyr.exe   # prints "uart_1 connected to pseudotty: /dev/pts/N"
+  apps/siot-serial/test/bench.py /dev/pts/N
+
+Frames are COBS(points, crc16) 0x00, see include/point_frame.h.
+"""
+
+import argparse
+import binascii
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+
+POINT_DATA_TYPE_INT = 2
+# POINT_FRAME_DATA_LEN, frames with more point data are dropped by the app
+FRAME_DATA_LEN = 256
+BENCH_TYPE = b"temp"
+BENCH_KEY = b"bench"
+
+
+def cobs_encode(data):
+    out = bytearray()
+    block = bytearray()
+    for b in data:
+        if b == 0:
+            out += bytes([len(block) + 1]) + block
+            block = bytearray()
+            continue
+        block.append(b)
+        if len(block) == 254:
+            out += b"\xff" + block
+            block = bytearray()
+    out += bytes([len(block) + 1]) + block
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1 : i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def frame_encode(data):
+    crc = binascii.crc_hqx(data, 0xFFFF)
+    return cobs_encode(data + struct.pack("<H", crc)) + b"\x00"
+
+
+def frame_decode(frame):
+    data = cobs_decode(frame)
+    if data is None or len(data) < 3:
+        return None
+    if binascii.crc_hqx(data[:-2], 0xFFFF) != struct.unpack("<H", data[-2:])[0]:
+        return None
+    return data[:-2]
+
+
+def point_encode(typ, key, value):
+    return (
+        bytes([len(typ)]) + typ + bytes([len(key)]) + key
+        + bytes([POINT_DATA_TYPE_INT, 4]) + struct.pack("<i", value)
+    )
+
+
+def points_decode(data):
+    pts = []
+    i = 0
+    while i < len(data):
+        typ = data[i + 1 : i + 1 + data[i]]
+        i += 1 + data[i]
+        key = data[i + 1 : i + 1 + data[i]]
+        i += 1 + data[i]
+        data_type, n = data[i], data[i + 1]
+        value = data[i + 2 : i + 2 + n]
+        i += 2 + n
+        pts.append((typ, key, data_type, value))
+    return pts
+
+
+def run(fd, baud, count, batch, timeout):
+    frames = []
+    for first in range(0, count, batch):
+        data = b"".join(
+            point_encode(BENCH_TYPE, BENCH_KEY, v) for v in range(first, min(first + batch, count))
+        )
+        frames.append(frame_encode(data))
+    frame_len = len(frames[0])
+
+    termios.tcflush(fd, termios.TCIOFLUSH)
+
+    sent_bytes = 0
+    received = set()
+    rx = bytearray()
+    errors = 0
+    start = time.monotonic()
+    done_sending = None
+
+    while len(received) < count:
+        now = time.monotonic()
+        if done_sending is not None and now - done_sending > timeout:
+            break
+
+        # send the next frame once the line would be free at this baud rate
+        wait = 0.05
+        if frames:
+            line_free = start + sent_bytes * 10 / baud
+            if now >= line_free:
+                frame = frames.pop(0)
+                os.write(fd, frame)
+                sent_bytes += len(frame)
+                if not frames:
+                    done_sending = time.monotonic()
+                continue
+            wait = line_free - now
+
+        r, _, _ = select.select([fd], [], [], wait)
+        if not r:
+            continue
+
+        rx += os.read(fd, 4096)
+        while True:
+            end = rx.find(0)
+            if end < 0:
+                break
+            frame = bytes(rx[:end])
+            del rx[: end + 1]
+            if not frame:
+                continue
+            data = frame_decode(frame)
+            if data is None:
+                errors += 1
+                continue
+            for typ, key, data_type, value in points_decode(data):
+                if typ == BENCH_TYPE and key == BENCH_KEY and data_type == POINT_DATA_TYPE_INT:
+                    received.add(struct.unpack("<i", value)[0])
+
+    elapsed = time.monotonic() - start
+    point_len = len(point_encode(BENCH_TYPE, BENCH_KEY, 0))
+    framing = (frame_len - min(batch, count) * point_len) / min(batch, count)
+    wire_per_point = sent_bytes / count
+
+    print(f"baud {baud}:")
+    print(f"  points:       {len(received)}/{count} received, {errors} bad frames")
+    print(f"  elapsed:      {elapsed:.2f} s")
+    print(f"  throughput:   {len(received) / elapsed:.0f} points/s")
+    print(f"  wire bytes:   {wire_per_point:.1f} per point ({point_len} point, "
+          f"{framing:.1f} framing)")
+    print(f"  line limit:   {baud / 10 / wire_per_point:.0f} points/s")
+
+    return len(received) == count
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("tty", help="pseudo terminal or serial port of the link")
+    parser.add_argument("--baud", type=int, nargs="+", default=[115200, 1000000])
+    parser.add_argument("-n", "--points", type=int, default=5000, help="points per run")
+    parser.add_argument("--batch", type=int, default=15, help="points per frame")
+    parser.add_argument("--timeout", type=float, default=2.0,
+                        help="seconds to wait for echoes after sending")
+    args = parser.parse_args()
+
+    point_len = len(point_encode(BENCH_TYPE, BENCH_KEY, 0))
+    if args.batch * point_len > FRAME_DATA_LEN:
+        parser.error(f"--batch {args.batch} is more than {FRAME_DATA_LEN} bytes of points, "
+                     f"at most {FRAME_DATA_LEN // point_len} fit in a frame")
+
+    fd = os.open(args.tty, os.O_RDWR | os.O_NOCTTY)
+    tty.setraw(fd)
+
+    ok = True
+    for baud in args.baud:
+        # real serial ports run at the rate, pseudo terminals ignore it
+        try:
+            attrs = termios.tcgetattr(fd)
+            speed = getattr(termios, f"B{baud}")
+            attrs[4] = attrs[5] = speed
+            termios.tcsetattr(fd, termios.TCSANOW, attrs)
+        except (AttributeError, termios.error):
+            pass
+
+        ok = run(fd, baud, args.points, args.batch, args.timeout) and ok
+
+    os.close(fd)
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -88,6 +88,45 @@ siot_test_native() {
 	siot_build_native_sim tests && ./build/zephyr/zephyr.exe
 }
 
+# run the network tests (uplink and other clients against local stand-in servers) on host platform
+siot_test_net_native() {
+	siot_build_native_sim tests/net && ./build/zephyr/zephyr.exe
+}
+
+# create the TAP interface that siot-net on native_sim connects to
+siot_net_native_tap() {
+	sudo ip tuntap add zeth mode tap user "$USER" &&
+		sudo ip link set zeth up &&
+		sudo ip addr add 192.0.2.2/24 dev zeth
+}
+
+# run siot-net on the host, the web UI is at http://192.0.2.1
+siot_net_native() {
+	siot_build_native_sim apps/siot-net && ./build/zephyr/zephyr.exe
+}
+
+# load test siot-net, arguments are passed to the load generator, e.g. -c 4 -d 30s
+siot_net_loadgen() {
+	(cd apps/siot-net/test && go run ./loadgen "$@")
+}
+
+# measure siot-serial throughput, the argument is the pty that siot-serial on
+# native_sim prints for uart_1, e.g. /dev/pts/5
+siot_serial_bench() {
+	python3 apps/siot-serial/test/bench.py "$@"
+}
+
+# run library benchmarks on host platform (see tests/bench/README.md)
+siot_bench_native() {
+	siot_build_native_sim tests/bench && ./build/zephyr/zephyr.exe
+}
+
+# run library benchmarks on host platform and fail on regressions against tests/bench/baseline.json
+siot_bench_check() {
+	siot_build_native_sim tests/bench && ./build/zephyr/zephyr.exe | tee build/bench.txt &&
+		python3 tests/bench/check.py build/bench.txt
+}
+
 # See https://community.tmpdir.org/t/zephyr-on-the-esp32/1310 for a comparison of ESP hardware
 
 # https://www.olimex.com/Products/IoT/ESP32/ESP32-POE/open-source-hardware
@@ -0,0 +1,31 @@
+#ifndef __GZIP_H_
+#define __GZIP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compresses buffers in the gzip format (RFC 1952), for HTTP bodies sent with
+// Content-Encoding: gzip, which every HTTP client and server can decode.
+//
+// This trades ratio for code size and speed: matches are found with a single
+// hash probe per position and coded with the fixed Huffman codes of deflate
+// (RFC 1951), so no tables are built per block. Point JSON, which repeats the
+// same keys in every element, still compresses to about a quarter of its size.
+// No heap is used, the only state is the hash table in struct gzip.
+
+#define GZIP_HASH_BITS 10
+
+// header and trailer, and the worst case of 9 bits for every input byte
+#define GZIP_MAX_LEN(n) (10 + 8 + 5 + (n) + (n) / 8 + 1)
+
+struct gzip {
+	// position + 1 of the last 3 bytes with each hash
+	uint16_t head[1 << GZIP_HASH_BITS];
+};
+
+// Compresses len bytes of src, which must be less than 64 KiB. Returns the
+// compressed length, or -ENOMEM if dst is too small. dst_len of
+// GZIP_MAX_LEN(len) is always enough.
+int gzip_compress(struct gzip *gz, const uint8_t *src, size_t len, uint8_t *dst, size_t dst_len);
+
+#endif // __GZIP_H_
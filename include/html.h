@@ -1,8 +1,71 @@
 #ifndef HTML_H_
 #define HTML_H_
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 typedef void (*html_form_callback)(char *key, char *value);
 
+// URL decodes src into dst. dst may be the same buffer as src.
+void url_decode(char *src, char *dst);
+
+// parses a complete form body. Kept for existing callers, new code should use
+// html_form_parser, which does not allocate. Fields are parsed as by
+// html_form_parser, so unlike older versions keys are URL decoded too, and a
+// value keeps any '=' after the first one ("a=1=2" gives "1=2", not "1").
 void html_parse_form_data(const char *body, html_form_callback callback);
 
+// called for each key/value pair in a form. key and value are URL decoded and
+// null terminated, and are only valid during the callback. Return 0 to
+// continue parsing, or a negative error to stop.
+typedef int (*html_form_field_cb)(const char *key, const char *value, void *ctx);
+
+// Streaming application/x-www-form-urlencoded parser. Body chunks can be fed
+// as they arrive, and fields are URL decoded into a buffer supplied by the
+// caller, so no memory is allocated. The buffer must hold the longest decoded
+// key and value plus two null terminators.
+struct html_form_parser {
+	char *buf;
+	size_t buf_len;
+	size_t pos;
+	// length of the key at the start of buf once '=' has been seen,
+	// otherwise 0 and buf holds the key
+	size_t key_len;
+	bool in_value;
+	// number of characters of a %XX escape seen so far, and the first digit
+	uint8_t escape;
+	char escape_hi;
+	int err;
+	html_form_field_cb cb;
+	void *ctx;
+};
+
+void html_form_parser_init(struct html_form_parser *p, char *buf, size_t buf_len,
+			   html_form_field_cb cb, void *ctx);
+
+// returns 0, -ENOMEM if a field does not fit in the buffer, or the error
+// returned by the callback. Once an error is returned, the parser ignores
+// further input.
+int html_form_parser_feed(struct html_form_parser *p, const char *data, size_t len);
+
+// emits the last field. Returns the same errors as html_form_parser_feed.
+int html_form_parser_finish(struct html_form_parser *p);
+
+// Returns true if the If-None-Match header value inm (NULL if the request has
+// none) lists the quoted etag, or is *.
+bool html_etag_match(const char *inm, const char *etag);
+
+// The gzip encoding of a resource is a different representation, so it is
+// tagged with the ETag of the resource with a -gz suffix. Adds the suffix to
+// the quoted etag, or returns -ENOMEM if it does not fit in etag_size.
+int html_etag_gzip(char *etag, size_t etag_size);
+
+// html_etag_match() for a client that accepts gzip. Such a client holds the
+// -gz tag if the resource was sent gzipped, and etag if it was sent as is, for
+// example because it was too small to compress, so either matches. On a match
+// with the -gz tag, the suffix is added to etag, as a 304 must carry the tag
+// the client holds.
+bool html_etag_match_gzip(const char *inm, char *etag, size_t etag_size);
+
 #endif // HTML_H_
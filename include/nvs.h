@@ -2,6 +2,7 @@
 #define __NVS_H_
 
 #include <point.h>
+#include <stdbool.h>
 #include <sys/types.h>
 
 struct nvs_point {
@@ -12,4 +13,7 @@ struct nvs_point {
 
 int nvs_init(const struct nvs_point *nvs_pts_in, size_t len);
 
+// returns true if the point is one of the points stored in NVS
+bool nvs_point_persisted(const char *type, const char *key);
+
 #endif // __NVS_H_
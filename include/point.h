@@ -39,17 +39,19 @@ typedef struct {
 // These defines should match those in the SIOT schema
 // https://github.com/simpleiot/simpleiot/blob/master/data/schema.go
 
-#define POINT_TYPE_DESCRIPTION            "description"
-#define POINT_TYPE_STATICIP               "staticIP"
-#define POINT_TYPE_ADDRESS                "address"
-#define POINT_TYPE_NETMASK                "netmask"
-#define POINT_TYPE_GATEWAY                "gateway"
-#define POINT_TYPE_METRIC_SYS_CPU_PERCENT "metricSysCPUPercent"
-#define POINT_TYPE_UPTIME                 "uptime"
-#define POINT_TYPE_TEMPERATURE            "temp"
-#define POINT_TYPE_BOARD                  "board"
-#define POINT_TYPE_BOOT_COUNT             "bootCount"
-#define POINT_TYPE_VERSION_FW             "versionFW"
+#define POINT_TYPE_DESCRIPTION              "description"
+#define POINT_TYPE_STATICIP                 "staticIP"
+#define POINT_TYPE_ADDRESS                  "address"
+#define POINT_TYPE_NETMASK                  "netmask"
+#define POINT_TYPE_GATEWAY                  "gateway"
+#define POINT_TYPE_METRIC_SYS_CPU_PERCENT   "metricSysCPUPercent"
+#define POINT_TYPE_UPTIME                   "uptime"
+#define POINT_TYPE_TEMPERATURE              "temp"
+#define POINT_TYPE_BOARD                    "board"
+#define POINT_TYPE_BOOT_COUNT               "bootCount"
+#define POINT_TYPE_VERSION_FW               "versionFW"
+#define POINT_TYPE_METRIC_UPLINK_CONNECTS   "metricUplinkConnects"
+#define POINT_TYPE_METRIC_UPLINK_CONNECT_MS "metricUplinkConnectMs"
 
 typedef struct {
 	char *type;
@@ -66,6 +68,8 @@ extern const point_def point_def_uptime;
 extern const point_def point_def_temperature;
 extern const point_def point_def_board;
 extern const point_def point_def_boot_count;
+extern const point_def point_def_metric_uplink_connects;
+extern const point_def point_def_metric_uplink_connect_ms;
 
 void point_set_type(point *p, const char *t);
 void point_set_key(point *p, const char *k);
@@ -79,16 +83,34 @@ void point_put_int(point *p, const int v);
 void point_put_float(point *p, const float v);
 void point_put_string(point *p, const char *v);
 
+// Sets the point data from text, such as a form field, of the given data type.
+// INT and FLT text must be a number in the range of the type, and STR text must
+// fit in the data field with its null terminator. Returns -EINVAL for text that
+// does not parse or is out of range, -ENOMEM for a string that does not fit, or
+// -ENOTSUP for other data types. The point is not changed on error.
+int point_put_text(point *p, int data_type, const char *text);
+
 int point_data_len(point *p);
 int point_dump(point *p, char *buf, size_t len);
 int points_dump(point *pts, size_t pts_len, char *buf, size_t len);
 int points_merge(point *pts, size_t pts_len, point *p);
+int points_upsert(point *pts, size_t pts_len, point *p);
+
+// return true to include the point at index in the output
+typedef bool (*point_filter)(const point *p, int index, void *ctx);
 
 int point_json_encode(point *p, char *buf, size_t len);
 int point_json_decode(char *json, size_t json_len, point *p);
 int points_json_encode(point *pts_in, int count, char *buf, size_t len);
+int points_json_encode_filter(point *pts_in, int count, point_filter filter, void *ctx, char *buf,
+			      size_t len);
 int points_json_decode(char *json, size_t json_len, point *pts, size_t p_cnt);
 
+int point_bin_encode(point *p, uint8_t *buf, size_t len);
+int point_bin_decode(const uint8_t *buf, size_t len, point *p);
+int points_bin_encode(point *pts, int count, uint8_t *buf, size_t len);
+int points_bin_decode(const uint8_t *buf, size_t len, point *pts, size_t p_cnt);
+
 #define LOG_DBG_POINT(msg, p)                                                                      \
 	Z_LOG_EVAL(LOG_LEVEL_DBG, ({                                                               \
 			   char buf[40];                                                           \
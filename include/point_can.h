@@ -0,0 +1,79 @@
+#ifndef __POINT_CAN_H_
+#define __POINT_CAN_H_
+
+#include <point.h>
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/can.h>
+
+// Points are sent on CAN as single frames with 29 bit identifiers:
+//
+//   bits 28-24  0
+//   bits 23-16  type id
+//   bits 15-8   key, points with keys other than "0" to "255" are not sent
+//   bits 7-0    node id of the sender
+//
+// Type strings are too long for CAN, so each node has a table that interns the
+// point types it sends or receives as 8 bit ids. Nodes on the same bus must use
+// the same id for a type. The data type comes from the table, so the frame data
+// is just the value: INT and FLT are 4 bytes little endian, and STR is the
+// string without the null terminator. Strings that do not fit in a classic CAN
+// frame are sent with ISO-TP to CONFIG_SIOT_CAN_STRING_PEER (see point_can.c).
+//
+// Lower ids win arbitration, so important types should get low ids.
+
+#define POINT_CAN_TYPE_POS 16
+#define POINT_CAN_KEY_POS  8
+
+// type id and the fixed upper bits, used for acceptance filters
+#define POINT_CAN_TYPE_MASK 0x1FFF0000
+
+// points of this type are sent on the bus when they show up on point_chan
+#define POINT_CAN_TX BIT(0)
+// points of this type are received from the bus and published on point_chan
+#define POINT_CAN_RX BIT(1)
+
+struct point_can_type {
+	uint8_t id;
+	const point_def *point_def;
+	// POINT_CAN_TX or POINT_CAN_RX, a type can not be both, or received
+	// points would be sent again
+	uint8_t flags;
+};
+
+// Starts sending and receiving the points in the types table. An acceptance
+// filter is added for each received type, so frames of other types never reach
+// the CPU. The CAN device must be started.
+int point_can_init(const struct device *dev, const struct point_can_type *types, size_t len);
+
+static inline uint32_t point_can_id(uint8_t type_id, uint8_t key, uint8_t node)
+{
+	return ((uint32_t)type_id << POINT_CAN_TYPE_POS) | ((uint32_t)key << POINT_CAN_KEY_POS) |
+	       node;
+}
+
+// fills in a filter that matches frames of a point type from any node
+void point_can_filter(uint8_t type_id, struct can_filter *filter);
+
+// returns 0, -ENOENT if the type is not in the table, -EINVAL if the key is not
+// 0 to 255, -ENOTSUP for data types that can not be sent, or -EMSGSIZE for a
+// string that does not fit in a frame
+int point_can_encode(const struct point_can_type *types, size_t len, const point *p,
+		     struct can_frame *frame);
+
+// returns 0, -ENOENT if the type is not in the table, or -EINVAL if the frame
+// does not hold a valid point
+int point_can_decode(const struct point_can_type *types, size_t len,
+		     const struct can_frame *frame, point *p);
+
+// Strings sent with ISO-TP are encoded as type id, key, and the string without
+// the null terminator. Returns the number of bytes written, or the same errors
+// as point_can_encode.
+int point_can_string_encode(const struct point_can_type *types, size_t len, const point *p,
+			    uint8_t *buf, size_t buf_len);
+
+// returns 0, or the same errors as point_can_decode
+int point_can_string_decode(const struct point_can_type *types, size_t len, const uint8_t *buf,
+			    size_t buf_len, point *p);
+
+#endif // __POINT_CAN_H_
@@ -0,0 +1,55 @@
+#ifndef __POINT_COAP_H_
+#define __POINT_COAP_H_
+
+#include <point.h>
+
+#include <stdint.h>
+
+// Serves the points on point_chan over CoAP (RFC 7252) on UDP.
+//
+// GET /points returns the latest value of each point in the binary encoding
+// of points_bin_encode(), with Content-Format 42 (application/octet-stream).
+// A type=<type> query only returns points of that type. The ETag changes
+// whenever a point changes.
+//
+// Snapshots larger than CONFIG_SIOT_COAP_BLOCK_SIZE, or the block size the
+// client asks for, are sent in blocks (RFC 7959 Block2). A snapshot is encoded
+// once per ETag and type query, and its blocks are cut from that encoding.
+//
+// A GET with Observe 0 registers the client for notifications (RFC 7641).
+// The response is the snapshot, and each notification carries only the points
+// that changed since the last one. Changes within CONFIG_SIOT_COAP_NOTIFY_MS
+// of the first one are sent together, with the latest value of each point.
+// Every CONFIG_SIOT_COAP_CON_INTERVAL notification is confirmable. Observers
+// that answer one with a reset, or do not acknowledge it, are removed.
+
+struct point_coap_config {
+	// 0 for the default CoAP port 5683
+	uint16_t port;
+	// points the filter returns false for are not served, NULL serves all
+	point_filter filter;
+	void *filter_ctx;
+};
+
+struct point_coap_stats {
+	// points dropped because the queue or the point table was full
+	uint32_t dropped;
+	uint32_t requests;
+	// responses that were one block of a larger snapshot
+	uint32_t blocks;
+	// snapshots encoded, the blocks of one snapshot share an encoding
+	uint32_t encodes;
+	uint32_t notifications;
+	uint32_t observers;
+	// observers removed because they reset or did not acknowledge a
+	// notification
+	uint32_t removed;
+	uint32_t errors;
+};
+
+// cfg must stay valid while the server runs. This must only be called once.
+int point_coap_init(const struct point_coap_config *cfg);
+
+void point_coap_stats(struct point_coap_stats *stats);
+
+#endif // __POINT_COAP_H_
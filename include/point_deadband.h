@@ -0,0 +1,36 @@
+#ifndef __POINT_DEADBAND_H_
+#define __POINT_DEADBAND_H_
+
+#include <point.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Suppresses publishes of sampled values that did not change meaningfully, so
+// a sensor polled often does not flood point_chan (and every uplink behind it)
+// with noise.
+//
+// A point passes the deadband if it is the first one, if its data type
+// changed, if an INT or FLT value moved more than the deadband away from the
+// last value that passed, if a STR value changed, or if the last value that
+// passed is at least max_age_ms old. The state must be zeroed before the first
+// use.
+
+struct point_deadband {
+	point last;
+	// uptime in ms when last passed, 0 before the first point
+	int64_t last_ms;
+};
+
+// Returns true if p passes, and then records it as the last value. A
+// deadband of 0 passes every change, and a max_age_ms of 0 never repeats an
+// unchanged value.
+bool point_deadband_check(struct point_deadband *db, const point *p, float deadband,
+			  uint32_t max_age_ms);
+
+// Publishes p on point_chan if it passes. Returns 1 if it was published, 0 if
+// it was suppressed, or a negative error from zbus.
+int point_deadband_publish(struct point_deadband *db, const point *p, float deadband,
+			   uint32_t max_age_ms);
+
+#endif // __POINT_DEADBAND_H_
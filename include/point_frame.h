@@ -0,0 +1,59 @@
+#ifndef __POINT_FRAME_H_
+#define __POINT_FRAME_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Framing for sending binary encoded points over byte streams like UARTs.
+// Each frame is:
+//
+//   COBS(points, crc16) 0x00
+//
+// where points is one or more points in the binary point encoding, and crc16
+// is the CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF) of the
+// points, little endian. COBS (Consistent Overhead Byte Stuffing) removes all
+// zero bytes from the frame, so a zero always marks the end of a frame and a
+// receiver that starts in the middle of a frame, or loses bytes, is back in
+// sync at the next zero.
+
+// maximum size of the encoded points in a frame
+#define POINT_FRAME_DATA_LEN 256
+
+// maximum size of n bytes after COBS encoding
+#define COBS_MAX_LEN(n) ((n) + (n) / 254 + 1)
+
+// maximum size of a frame, including the delimiter
+#define POINT_FRAME_LEN (COBS_MAX_LEN(POINT_FRAME_DATA_LEN + 2) + 1)
+
+// returns the encoded length, or -ENOMEM if dst is smaller than COBS_MAX_LEN(len)
+int cobs_encode(const uint8_t *src, size_t len, uint8_t *dst, size_t dst_len);
+
+// returns the decoded length, or -EINVAL for invalid data. src and dst can be
+// the same buffer.
+int cobs_decode(const uint8_t *src, size_t len, uint8_t *dst, size_t dst_len);
+
+// Encodes a frame of binary encoded points. Returns the length of the frame,
+// -EMSGSIZE if len is larger than POINT_FRAME_DATA_LEN, or -ENOMEM if frame is
+// too small.
+int point_frame_encode(const uint8_t *data, size_t len, uint8_t *frame, size_t frame_len);
+
+// called with the binary encoded points of each valid frame
+typedef void (*point_frame_cb)(const uint8_t *data, size_t len, void *ctx);
+
+// receive state, zero initialized
+struct point_frame_rx {
+	uint8_t buf[POINT_FRAME_LEN];
+	size_t len;
+	// bytes are dropped until the next delimiter after a frame that is too long
+	bool overflow;
+	uint32_t frames;
+	uint32_t errors;
+};
+
+// Adds received bytes to the frame being received, and calls cb for each
+// complete frame with a valid CRC. Invalid frames are counted in rx->errors.
+void point_frame_rx_feed(struct point_frame_rx *rx, const uint8_t *data, size_t len,
+			 point_frame_cb cb, void *ctx);
+
+#endif // __POINT_FRAME_H_
@@ -0,0 +1,117 @@
+#ifndef __POINT_MODBUS_H_
+#define __POINT_MODBUS_H_
+
+#include <point.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Maps Modbus registers to points, in both directions.
+//
+// The client polls Modbus devices over TCP, or over RTU with
+// CONFIG_SIOT_MODBUS_RTU, and publishes the values on point_chan through a
+// deadband (see point_deadband.h). Registers of a device that are in the same
+// table and contiguous are read with one request, up to the limits of the
+// protocol, so a device with 20 registers in one block costs one round trip
+// per poll.
+//
+// The server serves the latest points on point_chan as registers, and
+// publishes the points of registers that Modbus clients write.
+//
+// Register tables must be sorted by table and then address, without overlaps.
+
+enum point_modbus_table {
+	// 1 bit, read with function 1, written with 5 and 15
+	POINT_MODBUS_COIL,
+	// 1 bit, read with function 2
+	POINT_MODBUS_DISCRETE_INPUT,
+	// read with function 4
+	POINT_MODBUS_INPUT_REG,
+	// read with function 3, written with 6 and 16
+	POINT_MODBUS_HOLDING_REG,
+};
+
+// Encoding of the value in registers, ignored for coils and discrete
+// inputs. 32 bit values take two registers, with the high word first.
+enum point_modbus_format {
+	POINT_MODBUS_U16,
+	POINT_MODBUS_S16,
+	POINT_MODBUS_U32,
+	POINT_MODBUS_S32,
+	POINT_MODBUS_F32,
+};
+
+struct point_modbus_reg {
+	enum point_modbus_table table;
+	uint16_t addr;
+	enum point_modbus_format format;
+	// type and data type of the point, INT or FLT
+	const point_def *point_def;
+	const char *key;
+	// the point value is the register value times scale, 0 for 1
+	float scale;
+	// polled values are only published when they move more than this from
+	// the last published value, in point units
+	float deadband;
+};
+
+struct point_modbus_device {
+	// Modbus TCP server, or NULL for an RTU device on iface
+	const char *host;
+	// 0 for the default port 502
+	uint16_t port;
+	// name of the Zephyr Modbus serial interface, with CONFIG_SIOT_MODBUS_RTU
+	const char *iface;
+	uint8_t unit_id;
+	uint32_t period_ms;
+	// values are published at least this often even if they did not change,
+	// 0 for only on changes
+	uint32_t max_age_ms;
+	const struct point_modbus_reg *regs;
+	size_t regs_len;
+};
+
+struct point_modbus_server_config {
+	// TCP port, 0 for 502
+	uint16_t port;
+	// Zephyr Modbus serial interface that is also served, or NULL, with
+	// CONFIG_SIOT_MODBUS_RTU
+	const char *iface;
+	// RTU unit id, TCP requests are answered for any unit id
+	uint8_t unit_id;
+	const struct point_modbus_reg *regs;
+	size_t regs_len;
+};
+
+struct point_modbus_stats {
+	// client: requests sent, registers or bits read, and points published
+	// and suppressed by the deadband
+	uint32_t reads;
+	uint32_t registers;
+	uint32_t published;
+	uint32_t suppressed;
+	// polls that ended after the next one was due, which then starts one
+	// period later
+	uint32_t overruns;
+	uint32_t errors;
+	// exception responses received by the client
+	uint32_t exceptions;
+	// server: Modbus TCP requests, and points published for writes
+	uint32_t requests;
+	uint32_t writes;
+	uint32_t server_errors;
+};
+
+// Starts polling the devices. devs must stay valid while the client runs. This
+// must only be called once. With no devices, it returns 0 without starting the
+// thread. Returns -EINVAL if a register table is not sorted or does not fit the
+// limits set in Kconfig.
+int point_modbus_client_init(const struct point_modbus_device *devs, size_t len);
+
+// Starts serving the registers. cfg must stay valid while the server runs.
+// This must only be called once.
+int point_modbus_server_init(const struct point_modbus_server_config *cfg);
+
+void point_modbus_stats(struct point_modbus_stats *stats);
+
+#endif // __POINT_MODBUS_H_
@@ -0,0 +1,68 @@
+#ifndef __POINT_MQTT_H_
+#define __POINT_MQTT_H_
+
+#include <point.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Publishes points from point_chan to an MQTT 3.1.1 broker, and publishes the
+// setpoints received from the broker on point_chan.
+//
+// The latest value of each point is kept in a table of CONFIG_SIOT_MQTT_POINTS
+// entries. The first change after a publish opens a window of
+// CONFIG_SIOT_MQTT_WINDOW_MS, and changes to the same point within the window
+// replace each other. When the window closes, the changed points of each type
+// are published as one JSON array on the topic <prefix>/<type>.
+//
+// With QoS 1, up to CONFIG_SIOT_MQTT_INFLIGHT publishes are sent without
+// waiting for their PUBACK. If the connection is lost, the points of
+// publishes that were not acknowledged are published again after reconnecting,
+// with their latest values.
+//
+// Setpoints are JSON point arrays published to <prefix>/set. They are
+// published on point_chan, and so come back on their <prefix>/<type> topic
+// unless the filter drops them, which confirms them to the sender.
+
+struct point_mqtt_config {
+	const char *host;
+	uint16_t port;
+	const char *client_id;
+	// NULL for brokers without authentication
+	const char *user;
+	const char *password;
+	const char *prefix;
+	// 0 or 1
+	int qos;
+	// the broker keeps the last publish on each topic for new subscribers
+	bool retain;
+	// TLS security tag of the CA certificate, or -1 for plain MQTT
+	int sec_tag;
+	// points the filter returns false for are not published, NULL
+	// publishes all
+	point_filter filter;
+	void *filter_ctx;
+};
+
+struct point_mqtt_stats {
+	// points dropped because the queue or the point table was full
+	uint32_t dropped;
+	// point changes that replaced one that was not published yet
+	uint32_t coalesced;
+	uint32_t publishes;
+	uint32_t points;
+	uint32_t acks;
+	// publishes waiting for a PUBACK
+	uint32_t inflight;
+	// setpoints received from the broker
+	uint32_t received;
+	uint32_t connects;
+	uint32_t errors;
+};
+
+// cfg must stay valid while the client runs. This must only be called once.
+int point_mqtt_init(const struct point_mqtt_config *cfg);
+
+void point_mqtt_stats(struct point_mqtt_stats *stats);
+
+#endif // __POINT_MQTT_H_
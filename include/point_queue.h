@@ -0,0 +1,57 @@
+#ifndef __POINT_QUEUE_H_
+#define __POINT_QUEUE_H_
+
+#include <point.h>
+
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/toolchain.h>
+
+// Bounded lock-free multi-producer single-consumer queue of points. Producers
+// never block: point_queue_put fails immediately when the queue is full, so
+// callers can report overload instead of stalling.
+//
+// Each cell carries a sequence number that tells producers and the consumer
+// whether it is free or holds a point for the current lap of the ring
+// (D. Vyukov's bounded queue). Sequence numbers are stored relative to the
+// cell index, so a zero initialized queue is empty and ready to use.
+
+struct point_queue_cell {
+	atomic_t seq;
+	point p;
+};
+
+struct point_queue {
+	struct point_queue_cell *cells;
+	// size - 1, size must be a power of 2
+	uintptr_t mask;
+	atomic_t head;
+	atomic_t tail;
+};
+
+#define POINT_QUEUE_DEFINE(name, size)                                                             \
+	BUILD_ASSERT(IS_POWER_OF_TWO(size), "point queue size must be a power of 2");             \
+	static struct point_queue_cell _point_queue_cells_##name[size];                            \
+	struct point_queue name = {                                                                \
+		.cells = _point_queue_cells_##name,                                                \
+		.mask = (size) - 1,                                                                \
+	}
+
+// returns 0, or -ENOSPC if the queue is full. Safe to call from multiple
+// threads at once.
+int point_queue_put(struct point_queue *q, const point *p);
+
+// returns 0, or -EAGAIN if the queue is empty. Must only be called from a
+// single consumer thread.
+int point_queue_get(struct point_queue *q, point *p);
+
+// number of points in the queue. This is a snapshot, and may be stale by the
+// time it is used if other threads are using the queue.
+size_t point_queue_count(struct point_queue *q);
+
+static inline size_t point_queue_size(struct point_queue *q)
+{
+	return q->mask + 1;
+}
+
+#endif // __POINT_QUEUE_H_
@@ -0,0 +1,36 @@
+#ifndef __POINT_SERIAL_H_
+#define __POINT_SERIAL_H_
+
+#include <point.h>
+
+#include <zephyr/device.h>
+
+// Sends and receives points on a UART using the framing in point_frame.h.
+//
+// Received frames are decoded and each point is published on point_chan.
+// Points published on point_chan are sent if tx_filter returns true for them,
+// or all points if tx_filter is NULL. Points that are published while a frame
+// is being sent are batched into the next frame, so the link carries many
+// points per frame under load.
+//
+// Points received on the link are published on point_chan like any other, so
+// they are sent back unless tx_filter drops them. Two devices linked with a
+// NULL filter on both ends would send points back and forth forever.
+
+struct point_serial_stats {
+	uint32_t rx_frames;
+	uint32_t rx_errors;
+	uint32_t rx_points;
+	// bytes dropped because the RX thread fell behind the UART
+	uint32_t rx_dropped;
+	uint32_t tx_frames;
+	uint32_t tx_points;
+	uint32_t tx_bytes;
+};
+
+// the UART must support the async API. This must only be called once.
+int point_serial_init(const struct device *dev, point_filter tx_filter, void *ctx);
+
+void point_serial_stats(struct point_serial_stats *stats);
+
+#endif // __POINT_SERIAL_H_
@@ -1,9 +1,46 @@
 #ifndef __SIOT_STRING_H__
 #define __SIOT_STRING_H__
 
+#include <stddef.h>
+#include <stdint.h>
+
+// buffer size that holds any ftoa_shortest output
+#define FTOA_SHORTEST_LEN 16
+
 void ftoa(float num, char *str, int precision);
+
+// writes the shortest decimal string that parses back to num. Numbers from
+// 0.0001 up to but not including 1e9 are written in fixed notation, others in
+// scientific notation (e.g. 9.5e-5, 1.5e-7). Returns the string length, or
+// -ENOMEM if len is too small.
+int ftoa_shortest(float num, char *str, size_t len);
+
 char *itoa(int num, char *str, int base);
+
+// buffer sizes that hold any itoa_i32 and itoa_i64/itoa_u64 output
+#define ITOA_I32_LEN 12
+#define ITOA_I64_LEN 21
+
+// write num in decimal. Return the string length, or -ENOMEM if len is too
+// small.
+int itoa_i32(int32_t num, char *str, size_t len);
+int itoa_i64(int64_t num, char *str, size_t len);
+int itoa_u64(uint64_t num, char *str, size_t len);
+
 int atoi(const char *str);
 float atof(const char *str);
 
+// parse_int and parse_float convert exactly len characters of str, which does
+// not need to be null terminated. They return 0, -EINVAL if str is not a valid
+// number, or -ERANGE if the number is out of range, in which case out is set
+// to the closest value (INT32_MIN/MAX, +-Inf, or 0).
+
+// [+-]digits
+int parse_int(const char *str, size_t len, int32_t *out);
+
+// [+-]digits[.digits][(e|E)[+-]digits], inf, infinity, or nan. The result is
+// the float closest to the decimal value. Numbers that need more than 19
+// significant digits to round are limited to 63 characters.
+int parse_float(const char *str, size_t len, float *out);
+
 #endif // __SIOT_STRING__
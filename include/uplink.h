@@ -0,0 +1,75 @@
+#ifndef __UPLINK_H_
+#define __UPLINK_H_
+
+#include <point.h>
+
+#include <stdint.h>
+
+// Sends points from point_chan to a server in batches, for devices where every
+// connection costs radio on time, like LTE-M modules in PSM.
+//
+// Points are queued as they are published, and sent in one HTTP POST, as a
+// JSON array or with CONFIG_SIOT_UPLINK_FORMAT_BINARY in the binary encoding,
+// when:
+//
+// - CONFIG_SIOT_UPLINK_BATCH_LEN points are queued
+// - the oldest queued point is CONFIG_SIOT_UPLINK_MAX_DELAY seconds old
+// - uplink_flush() is called, e.g. when the radio is woken up for other reasons
+//
+// Points stay queued until the server answers with a 2xx status, so points
+// published during an outage are sent when the server is reachable again, as
+// long as they fit in the queue. With CONFIG_SIOT_UPLINK_STORE, batches that
+// fail are kept in flash instead, see uplink_store.h.
+//
+// The connection is kept open between batches for up to
+// CONFIG_SIOT_UPLINK_KEEPALIVE seconds, and TLS sessions are resumed when it
+// has to be opened again. Each connect publishes the metricUplinkConnects and
+// metricUplinkConnectMs points for other subscribers, the uplink does not queue
+// them itself.
+//
+// With CONFIG_SIOT_UPLINK_GZIP, batches are compressed and sent with
+// Content-Encoding: gzip. If the server answers 415 Unsupported Media Type, the
+// batch is sent again uncompressed, and so are all later ones. Stored batches
+// are sent uncompressed, as they are read from flash while they are sent.
+
+struct uplink_config {
+	const char *host;
+	uint16_t port;
+	const char *path;
+	// TLS security tag of the CA certificate, or -1 for plain HTTP
+	int sec_tag;
+	// points the filter returns false for are not sent, NULL sends all
+	point_filter filter;
+	void *filter_ctx;
+};
+
+struct uplink_stats {
+	uint32_t queued;
+	// points dropped because the queue was full
+	uint32_t dropped;
+	uint32_t sent;
+	uint32_t posts;
+	uint32_t errors;
+	// connections opened, and how long the last one took to open,
+	// including the TLS handshake
+	uint32_t connects;
+	uint32_t connect_ms;
+	// with CONFIG_SIOT_UPLINK_STORE, points waiting in flash, and points
+	// lost because the store was full
+	uint32_t stored;
+	uint32_t lost;
+	// with CONFIG_SIOT_UPLINK_GZIP, payload bytes before and after
+	// compression, for the requests that were sent compressed
+	uint32_t gzip_in;
+	uint32_t gzip_out;
+};
+
+// cfg must stay valid while the uplink runs. This must only be called once.
+int uplink_init(const struct uplink_config *cfg);
+
+// sends all queued points now, without waiting for the batch to fill
+void uplink_flush(void);
+
+void uplink_stats(struct uplink_stats *stats);
+
+#endif // __UPLINK_H_
@@ -0,0 +1,82 @@
+#ifndef __UPLINK_STORE_H_
+#define __UPLINK_STORE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/fs/fcb.h>
+#include <zephyr/storage/flash_map.h>
+
+// A circular queue in a flash partition for uplink batches that could not be
+// sent, so they survive outages and reboots. It is a flash circular buffer
+// (FCB) holding two kinds of entries:
+//
+// - batches: the encoded points of one batch, and the sequence number of its
+//   first point
+// - marks: the first sequence number that has not been delivered, and the
+//   highest sequence number that may have been used
+//
+// Every point sent by the uplink gets a sequence number, whether it goes
+// through the store or not, so the server can drop points it receives twice.
+// Sequence numbers are handed out in blocks that are recorded in a mark, so
+// they keep increasing across reboots without a flash write per batch.
+//
+// When the store is full, the oldest sector is erased and the batches in it
+// that were not delivered are lost.
+
+// most sectors a store partition can have
+#define UPLINK_STORE_MAX_SECTORS 32
+
+struct uplink_store {
+	struct fcb fcb;
+	struct flash_sector sectors[UPLINK_STORE_MAX_SECTORS];
+	// points with lower sequence numbers have been delivered
+	uint32_t sent;
+	// sequence numbers below this may have been used
+	uint32_t reserved;
+	uint32_t next_seq;
+	// points stored and not delivered yet
+	uint32_t pending;
+	// points that were not delivered when their sector was erased
+	uint32_t lost;
+};
+
+// consecutive stored batches with consecutive sequence numbers, sent in one
+// request
+struct uplink_store_batch {
+	struct fcb_entry first;
+	uint32_t seq;
+	uint32_t count;
+	int entries;
+	// total length of the batch data
+	size_t len;
+};
+
+// called for each chunk of stored data, start is true for the first chunk of
+// a batch. Returns less than 0 to stop reading.
+typedef int (*uplink_store_read_fn)(const uint8_t *buf, size_t len, bool start, void *ctx);
+
+// opens the store on a flash area and finds the batches that were not
+// delivered before the last reboot
+int uplink_store_init(struct uplink_store *s, uint8_t area_id);
+
+// returns the first of count new sequence numbers
+uint32_t uplink_store_seq(struct uplink_store *s, uint32_t count);
+
+// stores a batch of count points starting at sequence number seq
+int uplink_store_append(struct uplink_store *s, uint32_t seq, uint32_t count, const void *data,
+			size_t len);
+
+// finds the oldest stored batches that were not delivered, up to max_len
+// bytes of data, but at least one. Returns -ENOENT if there are none.
+int uplink_store_peek(struct uplink_store *s, size_t max_len, struct uplink_store_batch *b);
+
+// reads the data of the batches found by uplink_store_peek
+int uplink_store_read(struct uplink_store *s, const struct uplink_store_batch *b,
+		      uplink_store_read_fn fn, void *ctx);
+
+// records that the batches were delivered, and erases sectors that only hold
+// delivered batches
+int uplink_store_sent(struct uplink_store *s, const struct uplink_store_batch *b);
+
+#endif // __UPLINK_STORE_H_
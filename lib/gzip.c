@@ -0,0 +1,179 @@
+#include <gzip.h>
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/util.h>
+
+#define GZIP_MIN_MATCH 3
+#define GZIP_MAX_MATCH 258
+#define GZIP_MAX_DIST  32768
+
+struct gzip_out {
+	uint8_t *buf;
+	size_t len;
+	size_t pos;
+	uint32_t bits;
+	int bit_count;
+	int err;
+};
+
+static void gzip_put_byte(struct gzip_out *o, uint8_t b)
+{
+	if (o->pos >= o->len) {
+		o->err = -ENOMEM;
+		return;
+	}
+	o->buf[o->pos++] = b;
+}
+
+// deflate packs values starting at the least significant bit
+static void gzip_put_bits(struct gzip_out *o, uint32_t value, int count)
+{
+	o->bits |= value << o->bit_count;
+	o->bit_count += count;
+
+	while (o->bit_count >= 8) {
+		gzip_put_byte(o, o->bits & 0xFF);
+		o->bits >>= 8;
+		o->bit_count -= 8;
+	}
+}
+
+// Huffman codes are packed starting at the most significant bit
+static void gzip_put_code(struct gzip_out *o, uint32_t code, int count)
+{
+	uint32_t rev = 0;
+
+	for (int i = 0; i < count; i++) {
+		rev = (rev << 1) | ((code >> i) & 1);
+	}
+
+	gzip_put_bits(o, rev, count);
+}
+
+// literal/length symbol with the fixed codes of RFC 1951 section 3.2.6
+static void gzip_put_symbol(struct gzip_out *o, int sym)
+{
+	if (sym < 144) {
+		gzip_put_code(o, 0x30 + sym, 8);
+	} else if (sym < 256) {
+		gzip_put_code(o, 0x190 + sym - 144, 9);
+	} else if (sym < 280) {
+		gzip_put_code(o, sym - 256, 7);
+	} else {
+		gzip_put_code(o, 0xC0 + sym - 280, 8);
+	}
+}
+
+static const uint16_t gzip_len_base[] = {3,  4,  5,  6,  7,  8,  9,  10,  11,  13,
+					 15, 17, 19, 23, 27, 31, 35, 43,  51,  59,
+					 67, 83, 99, 115, 131, 163, 195, 227, 258};
+
+static const uint8_t gzip_len_extra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+					 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+static const uint16_t gzip_dist_base[] = {1,    2,    3,    4,    5,    7,     9,     13,
+					  17,   25,   33,   49,   65,   97,    129,   193,
+					  257,  385,  513,  769,  1025, 1537,  2049,  3073,
+					  4097, 6145, 8193, 12289, 16385, 24577};
+
+static void gzip_put_match(struct gzip_out *o, int len, int dist)
+{
+	int i = ARRAY_SIZE(gzip_len_base) - 1;
+
+	while (gzip_len_base[i] > len) {
+		i--;
+	}
+	gzip_put_symbol(o, 257 + i);
+	gzip_put_bits(o, len - gzip_len_base[i], gzip_len_extra[i]);
+
+	i = ARRAY_SIZE(gzip_dist_base) - 1;
+	while (gzip_dist_base[i] > dist) {
+		i--;
+	}
+	gzip_put_code(o, i, 5);
+	// distance codes 0-3 have no extra bits, then two codes per bit
+	gzip_put_bits(o, dist - gzip_dist_base[i], i < 4 ? 0 : i / 2 - 1);
+}
+
+static uint32_t gzip_hash(const uint8_t *p)
+{
+	uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+
+	return (v * 2654435761U) >> (32 - GZIP_HASH_BITS);
+}
+
+int gzip_compress(struct gzip *gz, const uint8_t *src, size_t len, uint8_t *dst, size_t dst_len)
+{
+	static const uint8_t header[] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF};
+	struct gzip_out o = {.buf = dst, .len = dst_len};
+	size_t pos = 0;
+
+	if (len > UINT16_MAX) {
+		return -EINVAL;
+	}
+
+	if (dst_len < sizeof(header)) {
+		return -ENOMEM;
+	}
+	memcpy(dst, header, sizeof(header));
+	o.pos = sizeof(header);
+
+	memset(gz->head, 0, sizeof(gz->head));
+
+	// a single final block with fixed codes
+	gzip_put_bits(&o, 1 | (1 << 1), 3);
+
+	while (pos < len && o.err == 0) {
+		int match = 0;
+		size_t dist = 0;
+
+		if (pos + GZIP_MIN_MATCH <= len) {
+			uint32_t h = gzip_hash(src + pos);
+			size_t cand = gz->head[h];
+
+			gz->head[h] = pos + 1;
+
+			if (cand > 0 && pos - (cand - 1) <= GZIP_MAX_DIST) {
+				const uint8_t *a = src + cand - 1;
+				size_t max = MIN(len - pos, GZIP_MAX_MATCH);
+
+				while (match < max && a[match] == src[pos + match]) {
+					match++;
+				}
+				dist = pos - (cand - 1);
+			}
+		}
+
+		if (match < GZIP_MIN_MATCH) {
+			gzip_put_symbol(&o, src[pos++]);
+			continue;
+		}
+
+		gzip_put_match(&o, match, dist);
+
+		// later matches can start inside this one
+		for (size_t end = pos + match, p = pos + 1; p < end; p++) {
+			if (p + GZIP_MIN_MATCH <= len) {
+				gz->head[gzip_hash(src + p)] = p + 1;
+			}
+		}
+		pos += match;
+	}
+
+	// end of block, then flush the last bits
+	gzip_put_symbol(&o, 256);
+	gzip_put_bits(&o, 0, 7);
+
+	uint8_t trailer[8];
+
+	sys_put_le32(crc32_ieee(src, len), trailer);
+	sys_put_le32(len, trailer + 4);
+	for (int i = 0; i < sizeof(trailer); i++) {
+		gzip_put_byte(&o, trailer[i]);
+	}
+
+	return o.err ? o.err : o.pos;
+}
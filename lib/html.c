@@ -1,19 +1,10 @@
 #include <ctype.h>
+#include <errno.h>
 #include <zephyr/kernel.h>
 #include <string.h>
 
 #include "html.h"
 
-char *z_strdup(const char *str)
-{
-	size_t len = strlen(str) + 1;
-	char *new_str = k_malloc(len);
-	if (new_str) {
-		memcpy(new_str, str, len);
-	}
-	return new_str;
-}
-
 // Function to URL-decode form data (since form data is URL-encoded by default)
 void url_decode(char *src, char *dst)
 {
@@ -49,33 +40,203 @@ void url_decode(char *src, char *dst)
 	*dst = '\0';
 }
 
+static int hex_value(char c)
+{
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	c |= 0x20;
+	if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+	return -1;
+}
+
+void html_form_parser_init(struct html_form_parser *p, char *buf, size_t buf_len,
+			   html_form_field_cb cb, void *ctx)
+{
+	*p = (struct html_form_parser){
+		.buf = buf,
+		.buf_len = buf_len,
+		.cb = cb,
+		.ctx = ctx,
+	};
+}
+
+static void form_put(struct html_form_parser *p, char c)
+{
+	// always leave room for the null terminator
+	if (p->pos + 1 >= p->buf_len) {
+		p->err = -ENOMEM;
+		return;
+	}
+	p->buf[p->pos++] = c;
+}
+
+// flushes a partial %XX escape as literal characters
+static void form_flush_escape(struct html_form_parser *p)
+{
+	if (p->escape > 0) {
+		form_put(p, '%');
+	}
+	if (p->escape > 1) {
+		form_put(p, p->escape_hi);
+	}
+	p->escape = 0;
+}
+
+static void form_end_field(struct html_form_parser *p)
+{
+	const char *value;
+
+	form_flush_escape(p);
+
+	if (p->err != 0) {
+		return;
+	}
+
+	if (p->pos == 0) {
+		// empty field, e.g. "a=1&&b=2"
+		p->in_value = false;
+		return;
+	}
+
+	p->buf[p->pos] = 0;
+	value = p->in_value ? p->buf + p->key_len + 1 : p->buf + p->pos;
+
+	p->err = p->cb(p->buf, value, p->ctx);
+
+	p->pos = 0;
+	p->key_len = 0;
+	p->in_value = false;
+}
+
+int html_form_parser_feed(struct html_form_parser *p, const char *data, size_t len)
+{
+	for (size_t i = 0; i < len && p->err == 0; i++) {
+		char c = data[i];
+
+		if (p->escape == 1) {
+			if (hex_value(c) >= 0) {
+				p->escape_hi = c;
+				p->escape = 2;
+				continue;
+			}
+			form_flush_escape(p);
+		} else if (p->escape == 2) {
+			if (hex_value(c) >= 0) {
+				p->escape = 0;
+				form_put(p, hex_value(p->escape_hi) * 16 + hex_value(c));
+				continue;
+			}
+			form_flush_escape(p);
+		}
+
+		switch (c) {
+		case '&':
+			form_end_field(p);
+			break;
+		case '=':
+			if (p->in_value) {
+				form_put(p, c);
+			} else {
+				// terminate the key, the value is decoded after it
+				p->key_len = p->pos;
+				form_put(p, 0);
+				p->in_value = true;
+			}
+			break;
+		case '%':
+			p->escape = 1;
+			break;
+		case '+':
+			form_put(p, ' ');
+			break;
+		default:
+			form_put(p, c);
+		}
+	}
+
+	return p->err;
+}
+
+int html_form_parser_finish(struct html_form_parser *p)
+{
+	if (p->err == 0) {
+		form_end_field(p);
+	}
+
+	return p->err;
+}
+
+static int legacy_form_cb(const char *key, const char *value, void *ctx)
+{
+	html_form_callback callback = ctx;
+
+	callback((char *)key, (char *)value);
+
+	return 0;
+}
+
 // Function to parse form data (key=value pairs separated by '&')
 void html_parse_form_data(const char *body, html_form_callback callback)
 {
-	char *key_value, *key, *value, *decoded_value;
-	char *form_data = z_strdup(body); // Duplicate the string as we'll modify it
-	char *saveptr1, *saveptr2;
+	// decoding never makes a field longer, so a buffer the size of the body
+	// holds any key and value with their terminators
+	size_t len = strlen(body);
+	char *buf = k_malloc(len + 1);
+	struct html_form_parser p;
 
-	key_value = strtok_r(form_data, "&", &saveptr1);
+	if (buf == NULL) {
+		return;
+	}
 
-	while (key_value != NULL) {
-		key = strtok_r(key_value, "=", &saveptr2); // Extract the key
-		value = strtok_r(NULL, "=", &saveptr2);    // Extract the value
+	html_form_parser_init(&p, buf, len + 1, legacy_form_cb, callback);
+	html_form_parser_feed(&p, body, len);
+	html_form_parser_finish(&p);
 
-		if (key) {
-			value = value ? value : "";
-			decoded_value = (char *)k_malloc(strlen(value) +
-							 1); // Allocate space for decoded value
-			url_decode(value,
-				   decoded_value); // Decode the value (since it's URL-encoded)
+	k_free(buf);
+}
 
-			callback(key, decoded_value);
+bool html_etag_match(const char *inm, const char *etag)
+{
+	if (inm == NULL) {
+		return false;
+	}
 
-			k_free(decoded_value); // Free the decoded value after use
-		}
+	return strcmp(inm, "*") == 0 || strstr(inm, etag) != NULL;
+}
+
+int html_etag_gzip(char *etag, size_t etag_size)
+{
+	size_t len = strlen(etag);
+
+	if (len < 2 || len + 3 >= etag_size) {
+		return -ENOMEM;
+	}
 
-		key_value = strtok_r(NULL, "&", &saveptr1); // Get the next key-value pair
+	// the suffix goes inside the closing quote
+	strcpy(etag + len - 1, "-gz\"");
+
+	return 0;
+}
+
+bool html_etag_match_gzip(const char *inm, char *etag, size_t etag_size)
+{
+	if (html_etag_match(inm, etag)) {
+		return true;
 	}
 
-	k_free(form_data); // Free the duplicated form data string
+	if (html_etag_gzip(etag, etag_size)) {
+		return false;
+	}
+
+	if (html_etag_match(inm, etag)) {
+		return true;
+	}
+
+	// back to the tag without the suffix
+	strcpy(etag + strlen(etag) - 4, "\"");
+
+	return false;
 }
@@ -38,6 +38,17 @@ int point_type_key_to_nvs_id(const struct nvs_point *pts, size_t len, char *type
 	return -1;
 }
 
+bool nvs_point_persisted(const char *type, const char *key)
+{
+	for (int i = 0; i < nvs_pts_count; i++) {
+		if (strcmp(type, nvs_pts[i].point_def->type) == 0 &&
+		    strcmp(key, nvs_pts[i].key) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
 // this needs to be called early on from your application
 int nvs_init(const struct nvs_point *nvs_pts_in, size_t len)
 {
@@ -1,11 +1,13 @@
 #include <point.h>
 #include <siot-string.h>
 
+#include <ctype.h>
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
-#include <zephyr/data/json.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
 #include <zephyr/sys/util.h>
 #include <zephyr/shell/shell.h>
 #include <zephyr/zbus/zbus.h>
@@ -25,6 +27,10 @@ const point_def point_def_uptime = {POINT_TYPE_UPTIME, POINT_DATA_TYPE_INT};
 const point_def point_def_temperature = {POINT_TYPE_TEMPERATURE, POINT_DATA_TYPE_FLOAT};
 const point_def point_def_board = {POINT_TYPE_BOARD, POINT_DATA_TYPE_STRING};
 const point_def point_def_boot_count = {POINT_TYPE_BOOT_COUNT, POINT_DATA_TYPE_INT};
+const point_def point_def_metric_uplink_connects = {POINT_TYPE_METRIC_UPLINK_CONNECTS,
+						    POINT_DATA_TYPE_INT};
+const point_def point_def_metric_uplink_connect_ms = {POINT_TYPE_METRIC_UPLINK_CONNECT_MS,
+						      POINT_DATA_TYPE_INT};
 
 void point_set_type(point *p, const char *t)
 {
@@ -75,6 +81,41 @@ void point_put_string(point *p, const char *v)
 	strncpy(p->data, v, sizeof(p->data));
 }
 
+int point_put_text(point *p, int data_type, const char *text)
+{
+	size_t len = strlen(text);
+	int32_t i;
+	float f;
+
+	switch (data_type) {
+	case POINT_DATA_TYPE_INT:
+		if (parse_int(text, len, &i)) {
+			return -EINVAL;
+		}
+		memcpy(p->data, &i, sizeof(i));
+		break;
+	case POINT_DATA_TYPE_FLOAT:
+		if (parse_float(text, len, &f)) {
+			return -EINVAL;
+		}
+		memcpy(p->data, &f, sizeof(f));
+		break;
+	case POINT_DATA_TYPE_STRING:
+		if (len >= sizeof(p->data)) {
+			return -ENOMEM;
+		}
+		memset(p->data, 0, sizeof(p->data));
+		memcpy(p->data, text, len);
+		break;
+	default:
+		return -ENOTSUP;
+	}
+
+	p->data_type = data_type;
+
+	return 0;
+}
+
 int point_data_len(point *p)
 {
 	switch (p->data_type) {
@@ -179,187 +220,799 @@ int points_dump(point *pts, size_t pts_len, char *buf, size_t buf_len)
 	return offset;
 }
 
-// When transmitting points over web APIs using JSON, we encode
-// then using all text fields. The JSON encoder cannot encode fixed
-// length char fields, so we have use pointers for now.
-struct point_js {
-	char *t;                 // type
-	char *k;                 // key
-	char *dt;                // datatype
-	struct json_obj_token d; // data
+// When transmitting points over web APIs using JSON, all fields are encoded as
+// strings:
+//
+//   {"t":"temp","k":"0","dt":"FLT","d":"23.5"}
+//
+// As the schema is fixed, the encoder and decoder below are written for it
+// directly instead of using the generic Zephyr JSON library. Points are
+// encoded in one pass straight from the point struct, and decoded in one pass
+// straight into it, without an intermediate struct or copies.
+
+// JSON output with a sticky error, so a run of writes can be checked once at
+// the end
+struct json_out {
+	char *buf;
+	size_t len;
+	size_t pos;
+	int err;
 };
 
-#define POINT_JS_ARRAY_MAX 47
+static void json_out_raw(struct json_out *o, const char *s, size_t n)
+{
+	// always leave room for the null terminator
+	if (o->err == 0 && o->pos + n >= o->len) {
+		o->err = -ENOMEM;
+	}
+
+	if (o->err < 0) {
+		return;
+	}
 
-struct point_js_array {
-	struct point_js points[POINT_JS_ARRAY_MAX];
-	size_t len;
-};
+	memcpy(o->buf + o->pos, s, n);
+	o->pos += n;
+}
+
+// writes s as the contents of a JSON string, escaping as needed
+static void json_out_escaped(struct json_out *o, const char *s, size_t n)
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t start = 0;
 
-static const struct json_obj_descr point_js_descr[] = {
-	JSON_OBJ_DESCR_PRIM(struct point_js, t, JSON_TOK_STRING),
-	JSON_OBJ_DESCR_PRIM(struct point_js, k, JSON_TOK_STRING),
-	JSON_OBJ_DESCR_PRIM(struct point_js, dt, JSON_TOK_STRING),
-	JSON_OBJ_DESCR_PRIM(struct point_js, d, JSON_TOK_OPAQUE)};
+	for (size_t i = 0; i < n; i++) {
+		uint8_t c = s[i];
+		char esc[6] = {'\\', c};
+		size_t esc_len = 2;
 
-static const struct json_obj_descr point_js_array_descr[] = {
-	JSON_OBJ_DESCR_OBJ_ARRAY(struct point_js_array, points, POINT_JS_ARRAY_MAX, len,
-				 point_js_descr, ARRAY_SIZE(point_js_descr)),
-};
+		if (c >= 0x20 && c != '"' && c != '\\') {
+			continue;
+		}
+
+		switch (c) {
+		case '"':
+		case '\\':
+			break;
+		case '\b':
+			esc[1] = 'b';
+			break;
+		case '\f':
+			esc[1] = 'f';
+			break;
+		case '\n':
+			esc[1] = 'n';
+			break;
+		case '\r':
+			esc[1] = 'r';
+			break;
+		case '\t':
+			esc[1] = 't';
+			break;
+		default:
+			memcpy(esc + 1, "u00", 3);
+			esc[4] = hex[c >> 4];
+			esc[5] = hex[c & 0xf];
+			esc_len = 6;
+		}
 
-// point_js has pointers to strings, so the buf is used to store these strings
-// Note: this functions assumes the input point will be valid for the duration of
-// of the p_js lifecycle, as we are populating points to strings in the original
-// p.
-void point_to_point_js(point *p, struct point_js *p_js, char *buf, size_t buf_len)
+		json_out_raw(o, s + start, i - start);
+		json_out_raw(o, esc, esc_len);
+		start = i + 1;
+	}
+
+	json_out_raw(o, s + start, n - start);
+}
+
+static void point_json_out(struct json_out *o, const point *p)
 {
-	p_js->t = p->type;
-	p_js->k = p->key;
+	char buf[MAX(FTOA_SHORTEST_LEN, ITOA_I32_LEN)];
+	const char *dt = "";
+	int len = 0;
+
+	// data is not aligned in the point struct, so copy it out
+	float f;
+	int32_t i;
 
 	switch (p->data_type) {
 	case POINT_DATA_TYPE_FLOAT:
-		p_js->dt = POINT_DATA_TYPE_FLOAT_S;
-		// snprintf has caused problems in the past, so use a leaner custom version
-		ftoa(point_get_float(p), buf, 4);
-		p_js->d.start = buf;
-		p_js->d.length = strlen(buf);
+		dt = POINT_DATA_TYPE_FLOAT_S;
+		memcpy(&f, p->data, sizeof(f));
+		len = ftoa_shortest(f, buf, sizeof(buf));
 		break;
 	case POINT_DATA_TYPE_INT:
-		p_js->dt = POINT_DATA_TYPE_INT_S;
-		itoa(point_get_int(p), buf, 10);
-		p_js->d.start = buf;
-		p_js->d.length = strlen(buf);
+		dt = POINT_DATA_TYPE_INT_S;
+		memcpy(&i, p->data, sizeof(i));
+		len = itoa_i32(i, buf, sizeof(buf));
 		break;
 	case POINT_DATA_TYPE_STRING:
-		p_js->dt = POINT_DATA_TYPE_STRING_S;
-		strncpy(buf, p->data, buf_len);
-		p_js->d.start = buf;
-		p_js->d.length = strlen(buf);
+		dt = POINT_DATA_TYPE_STRING_S;
 		break;
-	default:
-		p_js->d.start = NULL;
-		p_js->d.length = 0;
 	}
+
+	json_out_raw(o, "{\"t\":\"", 6);
+	json_out_escaped(o, p->type, strnlen(p->type, sizeof(p->type)));
+	json_out_raw(o, "\",\"k\":\"", 7);
+	json_out_escaped(o, p->key, strnlen(p->key, sizeof(p->key)));
+	json_out_raw(o, "\",\"dt\":\"", 8);
+	json_out_raw(o, dt, strlen(dt));
+	json_out_raw(o, "\",\"d\":\"", 7);
+	if (p->data_type == POINT_DATA_TYPE_STRING) {
+		json_out_escaped(o, p->data, strnlen(p->data, sizeof(p->data)));
+	} else if (len > 0) {
+		json_out_raw(o, buf, len);
+	}
+	json_out_raw(o, "\"}", 2);
 }
 
-int point_js_to_point(struct point_js *p_js, point *p)
+// JSON input. A null character also ends the input, as callers often pass the
+// size of a buffer rather than the length of the string in it.
+struct json_in {
+	const char *s;
+	const char *end;
+};
+
+static void json_in_ws(struct json_in *in)
 {
-	char buf[30];
-	p->time = 0;
+	while (in->s < in->end &&
+	       (*in->s == ' ' || *in->s == '\t' || *in->s == '\n' || *in->s == '\r')) {
+		in->s++;
+	}
+}
 
-	if (p_js->t == NULL || p_js->k == NULL) {
-		LOG_ERR("Refusing to decode point with null type or key");
-		return -1;
+static void json_in_init(struct json_in *in, const char *json, size_t len)
+{
+	in->s = json;
+	in->end = json + len;
+}
+
+// true if only whitespace is left
+static bool json_in_done(struct json_in *in)
+{
+	json_in_ws(in);
+
+	return in->s == in->end || *in->s == 0;
+}
+
+// skips whitespace, then consumes c if it is next
+static bool json_in_char(struct json_in *in, char c)
+{
+	json_in_ws(in);
+
+	if (in->s < in->end && *in->s == c) {
+		in->s++;
+		return true;
+	}
+
+	return false;
+}
+
+// reads a string and returns its raw contents, escapes are left as is
+static int json_in_string(struct json_in *in, const char **str, size_t *len, bool *escaped)
+{
+	if (!json_in_char(in, '"')) {
+		return -EINVAL;
+	}
+
+	const char *s = in->s;
+
+	*escaped = false;
+	while (s < in->end && *s != '"' && *s != 0) {
+		if (*s == '\\' && s + 1 < in->end && s[1] != 0) {
+			*escaped = true;
+			s++;
+		}
+		s++;
+	}
+
+	if (s >= in->end || *s != '"') {
+		return -EINVAL;
 	}
 
-	strncpy(p->type, p_js->t, sizeof(p->type));
-	strncpy(p->key, p_js->k, sizeof(p->key));
+	*str = in->s;
+	*len = s - in->s;
+	in->s = s + 1;
 
-	if (strncmp(p_js->dt, POINT_DATA_TYPE_FLOAT_S, 3) == 0) {
+	return 0;
+}
+
+// reads a number, true, false or null
+static int json_in_literal(struct json_in *in, const char **str, size_t *len)
+{
+	json_in_ws(in);
+
+	const char *s = in->s;
+
+	while (s < in->end && (isalnum((unsigned char)*s) || *s == '-' || *s == '+' || *s == '.')) {
+		s++;
+	}
+
+	if (s == in->s) {
+		return -EINVAL;
+	}
+
+	*str = in->s;
+	*len = s - in->s;
+	in->s = s;
+
+	return 0;
+}
+
+// skips a value of any type, including objects and arrays
+static int json_in_skip(struct json_in *in)
+{
+	int depth = 0;
+	const char *str;
+	size_t len;
+	bool escaped;
+	int ret;
+
+	do {
+		json_in_ws(in);
+		if (in->s >= in->end) {
+			return -EINVAL;
+		}
+
+		switch (*in->s) {
+		case '"':
+			ret = json_in_string(in, &str, &len, &escaped);
+			break;
+		case '{':
+		case '[':
+			depth++;
+			in->s++;
+			ret = 0;
+			break;
+		case '}':
+		case ']':
+			depth--;
+			in->s++;
+			ret = depth < 0 ? -EINVAL : 0;
+			break;
+		case ',':
+		case ':':
+			in->s++;
+			ret = depth > 0 ? 0 : -EINVAL;
+			break;
+		default:
+			ret = json_in_literal(in, &str, &len);
+		}
+
+		if (ret < 0) {
+			return ret;
+		}
+	} while (depth > 0);
+
+	return 0;
+}
+
+static int json_hex4(const char *s, uint32_t *v)
+{
+	*v = 0;
+
+	for (int i = 0; i < 4; i++) {
+		char c = s[i];
+		*v <<= 4;
+		if (c >= '0' && c <= '9') {
+			*v |= c - '0';
+		} else if (c >= 'a' && c <= 'f') {
+			*v |= c - 'a' + 10;
+		} else if (c >= 'A' && c <= 'F') {
+			*v |= c - 'A' + 10;
+		} else {
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+// copies the raw contents of a JSON string into dst, which must be zeroed,
+// decoding escapes. Like strncpy, the result is not null terminated if it fills
+// dst. Returns -EINVAL for a bad escape.
+static int json_unescape(const char *s, size_t len, char *dst, size_t dst_len)
+{
+	const char *end = s + len;
+	size_t n = 0;
+
+	while (s < end && n < dst_len) {
+		char c = *s++;
+		char utf8[4];
+		size_t utf8_len = 1;
+
+		if (c != '\\') {
+			dst[n++] = c;
+			continue;
+		}
+
+		if (s >= end) {
+			return -EINVAL;
+		}
+
+		c = *s++;
+		switch (c) {
+		case 'b':
+			utf8[0] = '\b';
+			break;
+		case 'f':
+			utf8[0] = '\f';
+			break;
+		case 'n':
+			utf8[0] = '\n';
+			break;
+		case 'r':
+			utf8[0] = '\r';
+			break;
+		case 't':
+			utf8[0] = '\t';
+			break;
+		case 'u': {
+			uint32_t cp;
+			uint32_t lo;
+
+			if (end - s < 4 || json_hex4(s, &cp) < 0) {
+				return -EINVAL;
+			}
+			s += 4;
+
+			// surrogate pair
+			if (cp >= 0xd800 && cp < 0xdc00 && end - s >= 6 && s[0] == '\\' &&
+			    s[1] == 'u' && json_hex4(s + 2, &lo) == 0 && lo >= 0xdc00 &&
+			    lo < 0xe000) {
+				cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+				s += 6;
+			}
+
+			if (cp < 0x80) {
+				utf8[0] = cp;
+			} else if (cp < 0x800) {
+				utf8[0] = 0xc0 | (cp >> 6);
+				utf8[1] = 0x80 | (cp & 0x3f);
+				utf8_len = 2;
+			} else if (cp < 0x10000) {
+				utf8[0] = 0xe0 | (cp >> 12);
+				utf8[1] = 0x80 | ((cp >> 6) & 0x3f);
+				utf8[2] = 0x80 | (cp & 0x3f);
+				utf8_len = 3;
+			} else {
+				utf8[0] = 0xf0 | (cp >> 18);
+				utf8[1] = 0x80 | ((cp >> 12) & 0x3f);
+				utf8[2] = 0x80 | ((cp >> 6) & 0x3f);
+				utf8[3] = 0x80 | (cp & 0x3f);
+				utf8_len = 4;
+			}
+			break;
+		}
+		default:
+			// \" \\ and \/
+			utf8[0] = c;
+		}
+
+		// don't split a multi-byte character when truncating
+		if (n + utf8_len > dst_len) {
+			break;
+		}
+		memcpy(dst + n, utf8, utf8_len);
+		n += utf8_len;
+	}
+
+	return 0;
+}
+
+// same as json_unescape, dst must be zeroed
+static int json_string_copy(const char *s, size_t len, bool escaped, char *dst, size_t dst_len)
+{
+	if (escaped) {
+		return json_unescape(s, len, dst, dst_len);
+	}
+
+	memcpy(dst, s, MIN(len, dst_len));
+
+	return 0;
+}
+
+// sets the point data from the dt and d strings. p->data must be zeroed.
+// Returns -EINVAL for an unknown data type or data that does not parse, and
+// leaves the point with an unknown data type.
+static int point_data_decode(point *p, const char *dt, size_t dt_len, const char *d, size_t d_len,
+			     bool escaped)
+{
+	int ret = 0;
+	float f;
+	int32_t i;
+
+	// data is not aligned in the point struct, so copy it in
+	if (dt_len == 3 && memcmp(dt, POINT_DATA_TYPE_FLOAT_S, 3) == 0) {
 		p->data_type = POINT_DATA_TYPE_FLOAT;
-		// null terminate string so we can scan it
-		int cnt = MIN(p_js->d.length, sizeof(buf) - 1);
-		memcpy(buf, p_js->d.start, cnt);
-		buf[cnt] = 0;
-		*(float *)p->data = atof(buf);
-	} else if (strncmp(p_js->dt, POINT_DATA_TYPE_INT_S, 3) == 0) {
+		ret = parse_float(d, d_len, &f);
+		memcpy(p->data, &f, sizeof(f));
+	} else if (dt_len == 3 && memcmp(dt, POINT_DATA_TYPE_INT_S, 3) == 0) {
 		p->data_type = POINT_DATA_TYPE_INT;
-		// null terminate string so we can scan it
-		int cnt = MIN(p_js->d.length, sizeof(buf) - 1);
-		memcpy(buf, p_js->d.start, cnt);
-		buf[cnt] = 0;
-		*(int *)p->data = atoi(buf);
-	} else if (strncmp(p_js->dt, POINT_DATA_TYPE_STRING_S, 3) == 0) {
+		ret = parse_int(d, d_len, &i);
+		memcpy(p->data, &i, sizeof(i));
+	} else if (dt_len == 3 && memcmp(dt, POINT_DATA_TYPE_STRING_S, 3) == 0) {
 		p->data_type = POINT_DATA_TYPE_STRING;
-		int cnt = MIN(p_js->d.length, sizeof(p->data) - 1);
-		memcpy(p->data, p_js->d.start, cnt);
-		// make sure string is null terminated
-		p->data[cnt] = 0;
+		// always null terminate string data
+		ret = json_string_copy(d, d_len, escaped, p->data, sizeof(p->data) - 1);
 	} else {
 		p->data_type = POINT_DATA_TYPE_UNKNOWN;
-		p->data[0] = 0;
-		return -1;
+		return -EINVAL;
+	}
+
+	if (ret == -ERANGE) {
+		// keep the saturated value, same as the sender overflowing
+		LOG_WRN("Point %s value out of range: %.*s", p->type, (int)d_len, d);
+	} else if (ret < 0) {
+		LOG_ERR("Point %s has invalid value: %.*s", p->type, (int)d_len, d);
+		p->data_type = POINT_DATA_TYPE_UNKNOWN;
+		memset(p->data, 0, sizeof(p->data));
+		return ret;
 	}
 
 	return 0;
 }
 
-// all of the point_js fields MUST be filled in or the encoder will crash
-int point_json_encode(point *p, char *buf, size_t len)
+// decodes one point object. Returns -ENOENT if the type or key is missing, and
+// -EINVAL for invalid JSON or data that does not match its data type. A point
+// without a data type is decoded with an unknown data type. Unknown fields are
+// skipped.
+static int point_json_in(struct json_in *in, point *p)
 {
-	struct point_js p_js = {};
+	const char *dt = "";
+	const char *d = "";
+	size_t dt_len = 0;
+	size_t d_len = 0;
+	bool d_escaped = false;
+	bool have_t = false;
+	bool have_k = false;
+	int ret;
+
+	memset(p, 0, sizeof(*p));
+
+	if (!json_in_char(in, '{')) {
+		return -EINVAL;
+	}
 
-	char data_buf[20];
+	if (!json_in_char(in, '}')) {
+		do {
+			const char *name;
+			const char *v;
+			size_t name_len;
+			size_t v_len;
+			bool escaped;
+
+			ret = json_in_string(in, &name, &name_len, &escaped);
+			if (ret < 0) {
+				return ret;
+			}
 
-	point_to_point_js(p, &p_js, data_buf, sizeof(data_buf));
+			if (!json_in_char(in, ':')) {
+				return -EINVAL;
+			}
 
-	/* Calculate the encoded length. (could be smaller) */
-	ssize_t enc_len = json_calc_encoded_len(point_js_descr, ARRAY_SIZE(point_js_descr), &p_js);
-	if (enc_len > len) {
-		return -ENOMEM;
+			if (name_len > 2 || (name_len == 2 && memcmp(name, "dt", 2) != 0)) {
+				ret = json_in_skip(in);
+			} else if (name_len == 2) {
+				ret = json_in_string(in, &dt, &dt_len, &escaped);
+			} else if (name_len == 1 && name[0] == 't') {
+				ret = json_in_string(in, &v, &v_len, &escaped);
+				if (ret == 0) {
+					ret = json_string_copy(v, v_len, escaped, p->type,
+							       sizeof(p->type));
+				}
+				have_t = true;
+			} else if (name_len == 1 && name[0] == 'k') {
+				ret = json_in_string(in, &v, &v_len, &escaped);
+				if (ret == 0) {
+					ret = json_string_copy(v, v_len, escaped, p->key,
+							       sizeof(p->key));
+				}
+				have_k = true;
+			} else if (name_len == 1 && name[0] == 'd') {
+				// data is normally a string, but accept a bare number
+				json_in_ws(in);
+				if (in->s < in->end && *in->s == '"') {
+					ret = json_in_string(in, &d, &d_len, &d_escaped);
+				} else {
+					ret = json_in_literal(in, &d, &d_len);
+				}
+			} else {
+				ret = json_in_skip(in);
+			}
+
+			if (ret < 0) {
+				return ret;
+			}
+		} while (json_in_char(in, ','));
+
+		if (!json_in_char(in, '}')) {
+			return -EINVAL;
+		}
 	}
 
-	return json_obj_encode_buf(point_js_descr, ARRAY_SIZE(point_js_descr), &p_js, buf, len);
+	if (!have_t || !have_k) {
+		LOG_ERR("Invalid JSON, does not have type or key");
+		return -ENOENT;
+	}
+
+	if (dt_len == 0) {
+		return 0;
+	}
+
+	return point_data_decode(p, dt, dt_len, d, d_len, d_escaped);
+}
+
+int point_json_encode(point *p, char *buf, size_t len)
+{
+	struct json_out o = {.buf = buf, .len = len};
+
+	point_json_out(&o, p);
+	if (o.err < 0) {
+		return o.err;
+	}
+
+	buf[o.pos] = 0;
+
+	return 0;
 }
 
 int point_json_decode(char *json, size_t json_len, point *p)
 {
-	struct point_js p_js = {};
-	int ret = json_obj_parse(json, json_len, point_js_descr, ARRAY_SIZE(point_js_descr), &p_js);
+	struct json_in in;
+
+	json_in_init(&in, json, json_len);
+
+	int ret = point_json_in(&in, p);
 	if (ret < 0) {
 		return ret;
 	}
 
-	if (p_js.t == NULL || p_js.k == NULL) {
-		LOG_ERR("Invalid JSON, does not have type or key");
-		return -200;
+	return json_in_done(&in) ? 0 : -EINVAL;
+}
+
+int points_json_encode(point *pts_in, int count, char *buf, size_t len)
+{
+	return points_json_encode_filter(pts_in, count, NULL, NULL, buf, len);
+}
+
+// encodes only the points the filter returns true for. A NULL filter encodes
+// all points.
+int points_json_encode_filter(point *pts_in, int count, point_filter filter, void *ctx, char *buf,
+			      size_t len)
+{
+	struct json_out o = {.buf = buf, .len = len};
+	bool first = true;
+
+	json_out_raw(&o, "[", 1);
+
+	for (int i = 0; i < count; i++) {
+		// make sure it is not an empty point
+		if (pts_in[i].type[0] != 0 && (filter == NULL || filter(&pts_in[i], i, ctx))) {
+			if (!first) {
+				json_out_raw(&o, ",", 1);
+			}
+			point_json_out(&o, &pts_in[i]);
+			first = false;
+		}
+	}
+
+	json_out_raw(&o, "]", 1);
+	if (o.err < 0) {
+		return o.err;
 	}
 
-	point_js_to_point(&p_js, p);
+	buf[o.pos] = 0;
+
 	return 0;
 }
 
-int points_json_encode(point *pts_in, int count, char *buf, size_t len)
+// returns the number of points decoded, or less than 0 for error. Points
+// without a type or key are skipped, and a point whose data does not match its
+// data type fails the whole array.
+int points_json_decode(char *json, size_t json_len, point *pts, size_t p_cnt)
+{
+	struct json_in in;
+	size_t count = 0;
+	size_t total = 0;
+
+	json_in_init(&in, json, json_len);
+
+	if (!json_in_char(&in, '[')) {
+		return -EINVAL;
+	}
+
+	if (!json_in_char(&in, ']')) {
+		do {
+			point discard;
+			point *p = count < p_cnt ? &pts[count] : &discard;
+
+			int ret = point_json_in(&in, p);
+			if (ret == -ENOENT) {
+				continue;
+			} else if (ret < 0) {
+				return ret;
+			}
+
+			total++;
+			if (p != &discard) {
+				count++;
+			}
+		} while (json_in_char(&in, ','));
+
+		if (!json_in_char(&in, ']')) {
+			return -EINVAL;
+		}
+	}
+
+	if (!json_in_done(&in)) {
+		return -EINVAL;
+	}
+
+	if (total > p_cnt) {
+		LOG_ERR("Points array decode, decoded more points than target array: %zu", total);
+	}
+
+	return count;
+}
+
+// The binary point encoding is a compact alternative to JSON for links where
+// bytes and CPU matter (websockets, serial, cellular). Each point is encoded as:
+//
+//   u8 type_len, type[type_len]
+//   u8 key_len, key[key_len]
+//   u8 data_type
+//   u8 data_len, data[data_len]
+//
+// INT and FLT data is 4 bytes little endian, STR data is sent without the null
+// terminator. Arrays of points are simply concatenated. Points of other data
+// types can not be decoded, so they are not encoded either.
+// returns the number of bytes written, -ENOTSUP for a data type that has no
+// binary encoding, or less than 0 for other errors
+int point_bin_encode(point *p, uint8_t *buf, size_t len)
 {
-	// buffers for data types and fields
-	char data_buf[POINT_JS_ARRAY_MAX][20];
-	struct point_js_array pts_out = {.len = 0};
+	size_t type_len = strnlen(p->type, sizeof(p->type) - 1);
+	size_t key_len = strnlen(p->key, sizeof(p->key) - 1);
+	size_t data_len;
 
-	if (count > POINT_JS_ARRAY_MAX) {
+	switch (p->data_type) {
+	case POINT_DATA_TYPE_INT:
+	case POINT_DATA_TYPE_FLOAT:
+		data_len = 4;
+		break;
+	case POINT_DATA_TYPE_STRING:
+		// the decoder needs room for the null terminator
+		data_len = strnlen(p->data, sizeof(p->data) - 1);
+		break;
+	default:
+		return -ENOTSUP;
+	}
+
+	size_t enc_len = 4 + type_len + key_len + data_len;
+	if (enc_len > len) {
 		return -ENOMEM;
 	}
 
+	uint8_t *b = buf;
+
+	*b++ = type_len;
+	memcpy(b, p->type, type_len);
+	b += type_len;
+
+	*b++ = key_len;
+	memcpy(b, p->key, key_len);
+	b += key_len;
+
+	*b++ = p->data_type;
+	*b++ = data_len;
+	if (p->data_type == POINT_DATA_TYPE_STRING) {
+		memcpy(b, p->data, data_len);
+	} else {
+		// data is stored in native order in the point
+		uint32_t v;
+		memcpy(&v, p->data, sizeof(v));
+		sys_put_le32(v, b);
+	}
+
+	return enc_len;
+}
+
+// returns the number of bytes consumed, or less than 0 for error
+int point_bin_decode(const uint8_t *buf, size_t len, point *p)
+{
+	const uint8_t *b = buf;
+	const uint8_t *end = buf + len;
+
+	memset(p, 0, sizeof(*p));
+
+	if (b >= end || *b >= sizeof(p->type) || b + 1 + *b > end) {
+		return -EINVAL;
+	}
+	memcpy(p->type, b + 1, *b);
+	b += 1 + *b;
+
+	if (b >= end || *b >= sizeof(p->key) || b + 1 + *b > end) {
+		return -EINVAL;
+	}
+	memcpy(p->key, b + 1, *b);
+	b += 1 + *b;
+
+	if (b + 2 > end) {
+		return -EINVAL;
+	}
+	p->data_type = b[0];
+	size_t data_len = b[1];
+	b += 2;
+
+	if (b + data_len > end) {
+		return -EINVAL;
+	}
+
+	switch (p->data_type) {
+	case POINT_DATA_TYPE_INT:
+	case POINT_DATA_TYPE_FLOAT: {
+		if (data_len != 4) {
+			return -EINVAL;
+		}
+		uint32_t v = sys_get_le32(b);
+		memcpy(p->data, &v, sizeof(v));
+		break;
+	}
+	case POINT_DATA_TYPE_STRING:
+		if (data_len >= sizeof(p->data)) {
+			return -EINVAL;
+		}
+		memcpy(p->data, b, data_len);
+		break;
+	default:
+		LOG_ERR("binary decode, unknown data type: %i", p->data_type);
+		return -EINVAL;
+	}
+
+	return b + data_len - buf;
+}
+
+// returns the number of bytes written, or less than 0 for error
+int points_bin_encode(point *pts, int count, uint8_t *buf, size_t len)
+{
+	size_t offset = 0;
+
 	for (int i = 0; i < count; i++) {
 		// make sure it is not an empty point
-		if (pts_in[i].type[0] != 0) {
-			point_to_point_js(&pts_in[i], &pts_out.points[pts_out.len],
-					  data_buf[pts_out.len], sizeof(data_buf[pts_out.len]));
-			pts_out.len++;
+		if (pts[i].type[0] == 0) {
+			continue;
 		}
+
+		int ret = point_bin_encode(&pts[i], buf + offset, len - offset);
+		if (ret == -ENOTSUP) {
+			// one point the receiver can not decode would make it drop
+			// all of them
+			continue;
+		} else if (ret < 0) {
+			return ret;
+		}
+		offset += ret;
 	}
 
-	return json_arr_encode_buf(point_js_array_descr, &pts_out, buf, len);
+	return offset;
 }
 
 // returns the number of points decoded, or less than 0 for error
-int points_json_decode(char *json, size_t json_len, point *pts, size_t p_cnt)
+int points_bin_decode(const uint8_t *buf, size_t len, point *pts, size_t p_cnt)
 {
-	struct point_js_array pts_js;
-
-	int ret = json_arr_parse(json, json_len, point_js_array_descr, &pts_js);
-	if (ret != 0) {
-		return ret;
-	}
+	size_t offset = 0;
+	int i = 0;
 
-	if (pts_js.len > p_cnt) {
-		LOG_ERR("Points array decode, decoded more points than target array: %zu",
-			pts_js.len);
-	}
+	while (offset < len) {
+		if (i >= p_cnt) {
+			LOG_ERR("Points binary decode, more points than target array: %zu", p_cnt);
+			break;
+		}
 
-	int len = MIN(p_cnt, pts_js.len);
-	int i;
-	for (i = 0; i < len; i++) {
-		point_js_to_point(&pts_js.points[i], &pts[i]);
+		int ret = point_bin_decode(buf + offset, len - offset, &pts[i]);
+		if (ret < 0) {
+			return ret;
+		}
+		offset += ret;
+		i++;
 	}
 
 	return i;
@@ -367,6 +1020,14 @@ int points_json_decode(char *json, size_t json_len, point *pts, size_t p_cnt)
 
 // pts must be initialized and not have random data in the string fields
 int points_merge(point *pts, size_t pts_len, point *p)
+{
+	int ret = points_upsert(pts, pts_len, p);
+
+	return ret < 0 ? ret : 0;
+}
+
+// same as points_merge, but returns the index the point was stored at
+int points_upsert(point *pts, size_t pts_len, point *p)
 {
 	// look for existing points
 	int empty_i = -1;
@@ -391,14 +1052,14 @@ int points_merge(point *pts, size_t pts_len, point *p)
 			   strncmp(pts[i].key, p->key, sizeof(p->key)) == 0) {
 			// we have a match
 			pts[i] = *p;
-			return 0;
+			return i;
 		}
 	}
 
 	// need to add a new point
 	if (empty_i >= 0) {
 		pts[empty_i] = *p;
-		return 0;
+		return empty_i;
 	}
 
 	return -ENOMEM;
@@ -412,16 +1073,10 @@ static int handle_sendpoint(const struct shell *shell, size_t argc, char **argv)
 		return -1;
 	}
 
-	struct point_js p_js;
-
-	p_js.t = argv[1];
-	p_js.k = argv[2];
-	p_js.dt = argv[3];
-	p_js.d.start = argv[4];
-	p_js.d.length = strlen(argv[4]);
+	point p = {0};
 
-	point p;
-	int ret = point_js_to_point(&p_js, &p);
+	point_set_type_key(&p, argv[1], argv[2]);
+	int ret = point_data_decode(&p, argv[3], strlen(argv[3]), argv[4], strlen(argv[4]), false);
 
 	if (ret != 0) {
 		shell_print(shell, "Invalid point");
@@ -0,0 +1,451 @@
+#include <point.h>
+#include <point_can.h>
+#include <siot-string.h>
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/drivers/can.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/zbus/zbus.h>
+
+#if !defined(CONFIG_SIOT_CAN_FD)
+#include <zephyr/canbus/isotp.h>
+#endif
+
+#define STACKSIZE 1024
+#define PRIORITY  7
+
+LOG_MODULE_REGISTER(point_can, LOG_LEVEL_INF);
+
+ZBUS_CHAN_DECLARE(point_chan);
+
+#if defined(CONFIG_SIOT_CAN_FD)
+#define POINT_CAN_FRAME_LEN CANFD_MAX_DLEN
+#define POINT_CAN_FLAGS     (CAN_FRAME_IDE | CAN_FRAME_FDF)
+#else
+#define POINT_CAN_FRAME_LEN 8
+#define POINT_CAN_FLAGS     CAN_FRAME_IDE
+#endif
+
+// ISO-TP messages are type id, key and string
+#define POINT_CAN_STRING_LEN (2 + SIZEOF_FIELD(point, data))
+
+static const struct device *can_dev;
+static const struct point_can_type *can_types;
+static size_t can_types_len;
+
+static const struct point_can_type *point_can_type_by_name(const struct point_can_type *types,
+							     size_t len, const char *type)
+{
+	for (int i = 0; i < len; i++) {
+		if (strcmp(type, types[i].point_def->type) == 0) {
+			return &types[i];
+		}
+	}
+	return NULL;
+}
+
+static const struct point_can_type *point_can_type_by_id(const struct point_can_type *types,
+							   size_t len, uint8_t id)
+{
+	for (int i = 0; i < len; i++) {
+		if (types[i].id == id) {
+			return &types[i];
+		}
+	}
+	return NULL;
+}
+
+// finds the type of the point and converts the key to a number
+static int point_can_lookup(const struct point_can_type *types, size_t len, const point *p,
+			    const struct point_can_type **t, uint8_t *key)
+{
+	int32_t k;
+
+	*t = point_can_type_by_name(types, len, p->type);
+	if (*t == NULL) {
+		return -ENOENT;
+	}
+
+	if (p->data_type != (*t)->point_def->data_type) {
+		return -EINVAL;
+	}
+
+	if (parse_int(p->key, strnlen(p->key, sizeof(p->key)), &k) || k < 0 || k > UINT8_MAX) {
+		return -EINVAL;
+	}
+	*key = k;
+
+	return 0;
+}
+
+// sets up an empty point of type t, the data type is set by the caller
+static void point_can_point(const struct point_can_type *t, uint8_t key, point *p)
+{
+	memset(p, 0, sizeof(*p));
+	point_set_type(p, t->point_def->type);
+	itoa_i32(key, p->key, sizeof(p->key));
+	p->data_type = t->point_def->data_type;
+}
+
+void point_can_filter(uint8_t type_id, struct can_filter *filter)
+{
+	filter->id = point_can_id(type_id, 0, 0);
+	filter->mask = POINT_CAN_TYPE_MASK;
+	filter->flags = CAN_FILTER_IDE;
+}
+
+int point_can_encode(const struct point_can_type *types, size_t len, const point *p,
+		     struct can_frame *frame)
+{
+	const struct point_can_type *t;
+	size_t data_len;
+	uint8_t key;
+
+	int ret = point_can_lookup(types, len, p, &t, &key);
+	if (ret) {
+		return ret;
+	}
+
+	memset(frame, 0, sizeof(*frame));
+
+	switch (p->data_type) {
+	case POINT_DATA_TYPE_INT:
+	case POINT_DATA_TYPE_FLOAT: {
+		// data is stored in native order in the point
+		uint32_t v;
+		memcpy(&v, p->data, sizeof(v));
+		sys_put_le32(v, frame->data);
+		data_len = 4;
+		break;
+	}
+	case POINT_DATA_TYPE_STRING:
+		data_len = strnlen(p->data, sizeof(p->data));
+		if (data_len > POINT_CAN_FRAME_LEN) {
+			return -EMSGSIZE;
+		}
+		memcpy(frame->data, p->data, data_len);
+		break;
+	default:
+		return -ENOTSUP;
+	}
+
+	frame->id = point_can_id(t->id, key, CONFIG_SIOT_CAN_NODE_ID);
+	frame->flags = POINT_CAN_FLAGS;
+	// CAN FD lengths above 8 are rounded up, the padding is zeros
+	frame->dlc = can_bytes_to_dlc(data_len);
+
+	return 0;
+}
+
+int point_can_decode(const struct point_can_type *types, size_t len,
+		     const struct can_frame *frame, point *p)
+{
+	// point frames have the top 5 bits clear, unlike ISO-TP frames
+	if (!(frame->flags & CAN_FRAME_IDE) || (frame->id & 0x1F000000) != 0) {
+		return -EINVAL;
+	}
+
+	const struct point_can_type *t =
+		point_can_type_by_id(types, len, frame->id >> POINT_CAN_TYPE_POS);
+	if (t == NULL) {
+		return -ENOENT;
+	}
+
+	size_t data_len = can_dlc_to_bytes(frame->dlc);
+
+	point_can_point(t, frame->id >> POINT_CAN_KEY_POS, p);
+
+	switch (p->data_type) {
+	case POINT_DATA_TYPE_INT:
+	case POINT_DATA_TYPE_FLOAT: {
+		if (data_len != 4) {
+			return -EINVAL;
+		}
+		uint32_t v = sys_get_le32(frame->data);
+		memcpy(p->data, &v, sizeof(v));
+		break;
+	}
+	case POINT_DATA_TYPE_STRING:
+		data_len = strnlen((const char *)frame->data, data_len);
+		if (data_len >= sizeof(p->data)) {
+			return -EINVAL;
+		}
+		memcpy(p->data, frame->data, data_len);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int point_can_string_encode(const struct point_can_type *types, size_t len, const point *p,
+			    uint8_t *buf, size_t buf_len)
+{
+	const struct point_can_type *t;
+	uint8_t key;
+
+	int ret = point_can_lookup(types, len, p, &t, &key);
+	if (ret) {
+		return ret;
+	}
+
+	if (p->data_type != POINT_DATA_TYPE_STRING) {
+		return -ENOTSUP;
+	}
+
+	size_t data_len = strnlen(p->data, sizeof(p->data));
+	if (2 + data_len > buf_len) {
+		return -EMSGSIZE;
+	}
+
+	buf[0] = t->id;
+	buf[1] = key;
+	memcpy(buf + 2, p->data, data_len);
+
+	return 2 + data_len;
+}
+
+int point_can_string_decode(const struct point_can_type *types, size_t len, const uint8_t *buf,
+			    size_t buf_len, point *p)
+{
+	if (buf_len < 2) {
+		return -EINVAL;
+	}
+
+	const struct point_can_type *t = point_can_type_by_id(types, len, buf[0]);
+	if (t == NULL) {
+		return -ENOENT;
+	}
+
+	size_t data_len = buf_len - 2;
+	if (t->point_def->data_type != POINT_DATA_TYPE_STRING || data_len >= sizeof(p->data)) {
+		return -EINVAL;
+	}
+
+	point_can_point(t, buf[1], p);
+	memcpy(p->data, buf + 2, data_len);
+
+	return 0;
+}
+
+// ==================================================
+// ISO-TP
+//
+// Strings that do not fit in a classic CAN frame are sent with ISO-TP, using
+// normal fixed addressing (29 bit ids 0x18DA<target><source>). ISO-TP is point
+// to point, as the receiver has to send flow control frames, so these strings
+// only go to CONFIG_SIOT_CAN_STRING_PEER, which is usually a gateway that
+// bridges the bus to other systems. Each node receives strings sent to its own
+// node id from any node, one message at a time.
+
+#if !defined(CONFIG_SIOT_CAN_FD)
+
+#define POINT_CAN_ISOTP_ID 0x18DA0000
+
+static const struct isotp_fc_opts point_can_fc_opts = {.bs = 8, .stmin = 0};
+
+static uint32_t point_can_isotp_id(uint8_t target, uint8_t source)
+{
+	return POINT_CAN_ISOTP_ID | (target << ISOTP_FIXED_ADDR_TA_POS) |
+	       (source << ISOTP_FIXED_ADDR_SA_POS);
+}
+
+static int point_can_send_string(const point *p)
+{
+	static struct isotp_send_ctx ctx;
+	uint8_t buf[POINT_CAN_STRING_LEN];
+
+	const struct isotp_msg_id tx_addr = {
+		.ext_id = point_can_isotp_id(CONFIG_SIOT_CAN_STRING_PEER, CONFIG_SIOT_CAN_NODE_ID),
+		.flags = ISOTP_MSG_IDE | ISOTP_MSG_FIXED_ADDR,
+	};
+	const struct isotp_msg_id rx_addr = {
+		.ext_id = point_can_isotp_id(CONFIG_SIOT_CAN_NODE_ID, CONFIG_SIOT_CAN_STRING_PEER),
+		.flags = ISOTP_MSG_IDE | ISOTP_MSG_FIXED_ADDR,
+	};
+
+	int len = point_can_string_encode(can_types, can_types_len, p, buf, sizeof(buf));
+	if (len < 0) {
+		return len;
+	}
+
+	// blocks until the peer has received the string
+	return isotp_send(&ctx, can_dev, buf, len, &tx_addr, &rx_addr, NULL, NULL);
+}
+
+static void point_can_isotp_thread(void *arg1, void *arg2, void *arg3)
+{
+	static struct isotp_recv_ctx ctx;
+	uint8_t buf[POINT_CAN_STRING_LEN];
+	point p;
+
+	const struct isotp_msg_id rx_addr = {
+		.ext_id = point_can_isotp_id(CONFIG_SIOT_CAN_NODE_ID, 0),
+		.flags = ISOTP_MSG_IDE | ISOTP_MSG_FIXED_ADDR,
+	};
+	// with fixed addressing, flow control frames are sent back to the
+	// source address of each message
+	const struct isotp_msg_id tx_addr = {
+		.ext_id = point_can_isotp_id(0, CONFIG_SIOT_CAN_NODE_ID),
+		.flags = ISOTP_MSG_IDE | ISOTP_MSG_FIXED_ADDR,
+	};
+
+	int ret = isotp_bind(&ctx, can_dev, &rx_addr, &tx_addr, &point_can_fc_opts, K_FOREVER);
+	if (ret != ISOTP_N_OK) {
+		LOG_ERR("Error binding ISO-TP: %i", ret);
+		return;
+	}
+
+	while (true) {
+		ret = isotp_recv(&ctx, buf, sizeof(buf), K_FOREVER);
+		if (ret < 0) {
+			LOG_ERR("ISO-TP receive error: %i", ret);
+			continue;
+		}
+
+		ret = point_can_string_decode(can_types, can_types_len, buf, ret, &p);
+		if (ret) {
+			LOG_ERR("Error decoding ISO-TP point: %i", ret);
+			continue;
+		}
+
+		// ISO-TP messages are not filtered by type in hardware
+		const struct point_can_type *t =
+			point_can_type_by_name(can_types, can_types_len, p.type);
+		if (!(t->flags & POINT_CAN_RX)) {
+			continue;
+		}
+
+		zbus_chan_pub(&point_chan, &p, K_MSEC(500));
+	}
+}
+
+K_THREAD_DEFINE(point_can_isotp, STACKSIZE, point_can_isotp_thread, NULL, NULL, NULL, PRIORITY, 0,
+		SYS_FOREVER_MS);
+
+#endif
+
+// ==================================================
+// Threads
+//
+// The threads are started by point_can_init
+
+CAN_MSGQ_DEFINE(point_can_rx_msgq, 16);
+
+static void point_can_rx_thread(void *arg1, void *arg2, void *arg3)
+{
+	struct can_frame frame;
+	point p;
+
+	while (!k_msgq_get(&point_can_rx_msgq, &frame, K_FOREVER)) {
+		int ret = point_can_decode(can_types, can_types_len, &frame, &p);
+		if (ret) {
+			LOG_ERR("Error decoding CAN point %08x: %i", frame.id, ret);
+			continue;
+		}
+
+		zbus_chan_pub(&point_chan, &p, K_MSEC(500));
+	}
+}
+
+K_THREAD_DEFINE(point_can_rx, STACKSIZE, point_can_rx_thread, NULL, NULL, NULL, PRIORITY, 0,
+		SYS_FOREVER_MS);
+
+ZBUS_MSG_SUBSCRIBER_DEFINE(point_can_sub);
+
+static void point_can_send(const point *p)
+{
+	const struct point_can_type *t = point_can_type_by_name(can_types, can_types_len, p->type);
+	struct can_frame frame;
+
+	if (t == NULL || !(t->flags & POINT_CAN_TX)) {
+		return;
+	}
+
+	int ret = point_can_encode(can_types, can_types_len, p, &frame);
+	if (ret == 0) {
+		ret = can_send(can_dev, &frame, K_MSEC(100), NULL, NULL);
+	}
+#if !defined(CONFIG_SIOT_CAN_FD)
+	else if (ret == -EMSGSIZE) {
+		ret = point_can_send_string(p);
+	}
+#endif
+
+	if (ret) {
+		LOG_ERR("Error sending %s.%s on CAN: %i", p->type, p->key, ret);
+	}
+}
+
+static void point_can_tx_thread(void *arg1, void *arg2, void *arg3)
+{
+	const struct zbus_channel *chan;
+	point p;
+
+	while (!zbus_sub_wait_msg(&point_can_sub, &chan, &p, K_FOREVER)) {
+		if (chan == &point_chan) {
+			point_can_send(&p);
+		}
+	}
+}
+
+K_THREAD_DEFINE(point_can_tx, STACKSIZE, point_can_tx_thread, NULL, NULL, NULL, PRIORITY, 0,
+		SYS_FOREVER_MS);
+
+// this must only be called once
+int point_can_init(const struct device *dev, const struct point_can_type *types, size_t len)
+{
+	struct can_filter filter;
+	int ret;
+
+	if (!device_is_ready(dev)) {
+		LOG_ERR("CAN device %s is not ready", dev->name);
+		return -ENODEV;
+	}
+
+	for (int i = 0; i < len; i++) {
+		if ((types[i].flags & POINT_CAN_TX) && (types[i].flags & POINT_CAN_RX)) {
+			LOG_ERR("CAN point type %s can not be both sent and received",
+				types[i].point_def->type);
+			return -EINVAL;
+		}
+	}
+
+	can_dev = dev;
+	can_types = types;
+	can_types_len = len;
+
+	for (int i = 0; i < len; i++) {
+		if (!(types[i].flags & POINT_CAN_RX)) {
+			continue;
+		}
+
+		point_can_filter(types[i].id, &filter);
+		ret = can_add_rx_filter_msgq(dev, &point_can_rx_msgq, &filter);
+		if (ret < 0) {
+			LOG_ERR("Error adding CAN filter for %s: %i", types[i].point_def->type, ret);
+			return ret;
+		}
+	}
+
+	ret = zbus_chan_add_obs(&point_chan, &point_can_sub, K_SECONDS(5));
+	if (ret) {
+		LOG_ERR("Error adding CAN observer: %i", ret);
+		return ret;
+	}
+
+	k_thread_start(point_can_rx);
+	k_thread_start(point_can_tx);
+#if !defined(CONFIG_SIOT_CAN_FD)
+	k_thread_start(point_can_isotp);
+#endif
+
+	LOG_INF("CAN node %i, %zu point types", CONFIG_SIOT_CAN_NODE_ID, len);
+
+	return 0;
+}
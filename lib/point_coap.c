@@ -0,0 +1,822 @@
+#include <point.h>
+#include <point_coap.h>
+#include <point_queue.h>
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/zbus/zbus.h>
+
+#define STACKSIZE 2048
+#define PRIORITY  7
+
+#define COAP_PORT 5683
+// how long the thread waits for requests before it looks at the queue again
+#define COAP_POLL_MS  100
+// how long to wait before opening the socket again after an error
+#define COAP_RETRY_MS 1000
+
+// An observer has this long to acknowledge a confirmable notification, and is
+// removed after missing COAP_MAX_MISSED in a row. Notifications are not
+// retransmitted, a client that sees a gap in the Observe numbers can GET the
+// snapshot.
+#define COAP_ACK_TIMEOUT_MS 10000
+#define COAP_MAX_MISSED     2
+
+// options of a request past this many are not looked at
+#define COAP_OPTS_NUM 16
+// the options of any response this server sends fit in this
+#define COAP_OPTS_MAX 32
+// longest point in the binary encoding
+#define COAP_POINT_MAX (4 + SIZEOF_FIELD(point, type) + SIZEOF_FIELD(point, key) + \
+			SIZEOF_FIELD(point, data))
+
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_SIOT_COAP_BLOCK_SIZE),
+	     "CONFIG_SIOT_COAP_BLOCK_SIZE must be a power of 2");
+BUILD_ASSERT(CONFIG_SIOT_COAP_BLOCK_SIZE >= COAP_POINT_MAX,
+	     "a notification must fit at least one point");
+BUILD_ASSERT(SIZEOF_FIELD(struct coap_option, value) >= 5 + SIZEOF_FIELD(point, type) - 1,
+	     "CONFIG_COAP_EXTENDED_OPTIONS_LEN_VALUE must fit a type=<type> query");
+
+LOG_MODULE_REGISTER(point_coap, LOG_LEVEL_INF);
+
+ZBUS_CHAN_DECLARE(point_chan);
+
+static const struct point_coap_config *coap_cfg;
+
+POINT_QUEUE_DEFINE(coap_q, CONFIG_SIOT_COAP_QUEUE_LEN);
+
+static atomic_t stat_dropped;
+static uint32_t stat_requests;
+static uint32_t stat_blocks;
+static uint32_t stat_encodes;
+static uint32_t stat_notifications;
+static uint32_t stat_removed;
+static uint32_t stat_errors;
+
+// ==================================================
+// Queue
+
+static void coap_listener(const struct zbus_channel *chan)
+{
+	const point *p = zbus_chan_const_msg(chan);
+
+	if (coap_cfg->filter != NULL && !coap_cfg->filter(p, 0, coap_cfg->filter_ctx)) {
+		return;
+	}
+
+	if (point_queue_put(&coap_q, p)) {
+		atomic_inc(&stat_dropped);
+	}
+}
+
+ZBUS_LISTENER_DEFINE(coap_lis, coap_listener);
+
+// ==================================================
+// Point table
+//
+// Only used by the thread. Each point is dirty if it changed since the last
+// notification.
+
+static point coap_points[CONFIG_SIOT_COAP_POINTS];
+static bool coap_dirty[CONFIG_SIOT_COAP_POINTS];
+// changes with every point change, sent as the ETag of the snapshot
+static uint32_t coap_version;
+// uptime in ms when the first point since the last notification changed,
+// valid while a point is dirty
+static uint32_t coap_window_ms;
+
+static bool coap_any_dirty(void)
+{
+	for (int i = 0; i < ARRAY_SIZE(coap_dirty); i++) {
+		if (coap_dirty[i]) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void coap_merge_queued(void)
+{
+	point p;
+
+	while (point_queue_get(&coap_q, &p) == 0) {
+		if (!coap_any_dirty()) {
+			coap_window_ms = k_uptime_get_32();
+		}
+
+		int i = points_upsert(coap_points, ARRAY_SIZE(coap_points), &p);
+		if (i < 0) {
+			atomic_inc(&stat_dropped);
+			continue;
+		}
+
+		coap_dirty[i] = true;
+		coap_version++;
+	}
+}
+
+// type is empty to match all points
+static bool coap_type_match(const point *p, const char *type)
+{
+	return p->type[0] != 0 && (type[0] == 0 || strcmp(p->type, type) == 0);
+}
+
+// ==================================================
+// Observers
+
+struct coap_observer_slot {
+	struct sockaddr_in addr;
+	bool used;
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	uint8_t token_len;
+	// only points of this type are sent, empty for all
+	char type[SIZEOF_FIELD(point, type)];
+	// Observe number of the last notification
+	uint32_t seq;
+	uint32_t sent;
+	// message id of the last notification, a reset for it removes the
+	// observer
+	uint16_t mid;
+	// the confirmable notification waiting for an acknowledgement
+	bool con_pending;
+	uint16_t con_mid;
+	uint32_t con_ms;
+	uint8_t missed;
+};
+
+static struct coap_observer_slot coap_observers[CONFIG_SIOT_COAP_OBSERVERS];
+
+static struct coap_observer_slot *coap_observer_find(const struct sockaddr_in *addr,
+						     const uint8_t *token, uint8_t token_len)
+{
+	for (int i = 0; i < ARRAY_SIZE(coap_observers); i++) {
+		struct coap_observer_slot *o = &coap_observers[i];
+
+		if (o->used && o->addr.sin_port == addr->sin_port &&
+		    o->addr.sin_addr.s_addr == addr->sin_addr.s_addr && o->token_len == token_len &&
+		    memcmp(o->token, token, token_len) == 0) {
+			return o;
+		}
+	}
+
+	return NULL;
+}
+
+static void coap_observer_remove(struct coap_observer_slot *o, const char *reason)
+{
+	char addr[INET_ADDRSTRLEN] = "";
+
+	zsock_inet_ntop(AF_INET, &o->addr.sin_addr, addr, sizeof(addr));
+	LOG_INF("Removing observer %s:%i, %s", addr, ntohs(o->addr.sin_port), reason);
+
+	o->used = false;
+	stat_removed++;
+}
+
+static int coap_observer_count(void)
+{
+	int n = 0;
+
+	for (int i = 0; i < ARRAY_SIZE(coap_observers); i++) {
+		n += coap_observers[i].used;
+	}
+
+	return n;
+}
+
+// ==================================================
+// Messages
+
+struct coap_request {
+	struct coap_packet pkt;
+	uint8_t type;
+	uint8_t code;
+	uint16_t mid;
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	uint8_t token_len;
+	// Uri-Path options joined with '/', without a leading '/'
+	char path[24];
+	// from a type=<type> Uri-Query, empty if there is none
+	char query_type[SIZEOF_FIELD(point, type)];
+	// -1 if the option is absent
+	int observe;
+	int accept;
+	bool block2;
+	uint32_t block_num;
+	uint8_t block_szx;
+	// a critical option that is not supported, or an invalid value
+	uint8_t error;
+};
+
+static int coap_fd = -1;
+
+static uint8_t coap_rx[256];
+static uint8_t coap_tx[4 + COAP_TOKEN_MAX_LEN + COAP_OPTS_MAX + 1 + CONFIG_SIOT_COAP_BLOCK_SIZE];
+static uint8_t coap_block[CONFIG_SIOT_COAP_BLOCK_SIZE];
+
+static void coap_parse_option(struct coap_request *req, const struct coap_option *opt)
+{
+	size_t path_len = strlen(req->path);
+
+	switch (opt->delta) {
+	case COAP_OPTION_URI_PATH:
+		// the joined path is too long for any resource, so not found
+		if (path_len + (path_len > 0) + opt->len >= sizeof(req->path)) {
+			strcpy(req->path, "-");
+			break;
+		}
+		if (path_len > 0) {
+			req->path[path_len++] = '/';
+		}
+		memcpy(req->path + path_len, opt->value, opt->len);
+		req->path[path_len + opt->len] = 0;
+		break;
+	case COAP_OPTION_URI_QUERY:
+		if (opt->len > 5 && memcmp(opt->value, "type=", 5) == 0) {
+			if (opt->len - 5 >= sizeof(req->query_type)) {
+				req->error = COAP_RESPONSE_CODE_BAD_REQUEST;
+				break;
+			}
+			memcpy(req->query_type, opt->value + 5, opt->len - 5);
+			req->query_type[opt->len - 5] = 0;
+		}
+		break;
+	case COAP_OPTION_OBSERVE:
+		req->observe = coap_option_value_to_int(opt);
+		break;
+	case COAP_OPTION_ACCEPT:
+		req->accept = coap_option_value_to_int(opt);
+		break;
+	case COAP_OPTION_BLOCK2: {
+		uint32_t b = coap_option_value_to_int(opt);
+
+		req->block2 = true;
+		req->block_num = b >> 4;
+		req->block_szx = b & 7;
+		if (req->block_szx == 7) {
+			req->error = COAP_RESPONSE_CODE_BAD_REQUEST;
+		}
+		break;
+	}
+	default:
+		// odd option numbers are critical, and must be understood
+		if (opt->delta & 1) {
+			LOG_DBG("Unsupported critical option: %u", opt->delta);
+			req->error = COAP_RESPONSE_CODE_BAD_OPTION;
+		}
+	}
+}
+
+static int coap_parse(uint8_t *buf, size_t len, struct coap_request *req)
+{
+	// option number 0 is reserved, so it marks the options that were not
+	// in the message
+	struct coap_option opts[COAP_OPTS_NUM] = {0};
+
+	memset(req, 0, sizeof(*req));
+	req->observe = -1;
+	req->accept = -1;
+
+	int ret = coap_packet_parse(&req->pkt, buf, len, opts, ARRAY_SIZE(opts));
+	if (ret < 0) {
+		return ret;
+	}
+
+	req->type = coap_header_get_type(&req->pkt);
+	req->code = coap_header_get_code(&req->pkt);
+	req->mid = coap_header_get_id(&req->pkt);
+	req->token_len = coap_header_get_token(&req->pkt, req->token);
+
+	for (int i = 0; i < ARRAY_SIZE(opts) && opts[i].delta != 0; i++) {
+		coap_parse_option(req, &opts[i]);
+	}
+
+	return 0;
+}
+
+static int coap_send(const struct sockaddr_in *addr, const struct coap_packet *pkt)
+{
+	ssize_t n = zsock_sendto(coap_fd, pkt->data, pkt->offset, 0, (const struct sockaddr *)addr,
+				 sizeof(*addr));
+	if (n < 0) {
+		LOG_ERR("Error sending CoAP message: %i", errno);
+		stat_errors++;
+		return -errno;
+	}
+
+	return 0;
+}
+
+// starts a response: piggybacked on the acknowledgement of a confirmable
+// request, or a new non-confirmable message
+static int coap_response_init(struct coap_packet *rsp, const struct coap_request *req,
+			      uint8_t code)
+{
+	if (req->type == COAP_TYPE_CON) {
+		return coap_ack_init(rsp, &req->pkt, coap_tx, sizeof(coap_tx), code);
+	}
+
+	return coap_packet_init(rsp, coap_tx, sizeof(coap_tx), COAP_VERSION_1, COAP_TYPE_NON_CON,
+				req->token_len, req->token, code, coap_next_id());
+}
+
+static void coap_reply(const struct coap_request *req, const struct sockaddr_in *addr,
+		       uint8_t code)
+{
+	struct coap_packet rsp;
+
+	if (coap_response_init(&rsp, req, code) == 0) {
+		coap_send(addr, &rsp);
+	}
+}
+
+// ==================================================
+// Resources
+//
+// The snapshot is encoded once per version of the point table and type query,
+// and the blocks of a block-wise transfer are all cut from that encoding.
+
+static uint8_t coap_snapshot[CONFIG_SIOT_COAP_POINTS * COAP_POINT_MAX];
+static size_t coap_snapshot_len;
+static bool coap_snapshot_valid;
+static uint32_t coap_snapshot_version;
+static char coap_snapshot_type[SIZEOF_FIELD(point, type)];
+
+// encodes the points of the type, or all for an empty type, unless the
+// snapshot already has them
+static size_t coap_snapshot_get(const char *type)
+{
+	if (coap_snapshot_valid && coap_snapshot_version == coap_version &&
+	    strcmp(coap_snapshot_type, type) == 0) {
+		return coap_snapshot_len;
+	}
+
+	coap_snapshot_len = 0;
+	for (int i = 0; i < ARRAY_SIZE(coap_points); i++) {
+		if (!coap_type_match(&coap_points[i], type)) {
+			continue;
+		}
+
+		// the snapshot buffer fits every point at its longest
+		size_t len = coap_snapshot_len;
+		int ret = point_bin_encode(&coap_points[i], coap_snapshot + len,
+					   sizeof(coap_snapshot) - len);
+
+		if (ret > 0) {
+			coap_snapshot_len += ret;
+		}
+	}
+
+	coap_snapshot_valid = true;
+	coap_snapshot_version = coap_version;
+	strcpy(coap_snapshot_type, type);
+	stat_encodes++;
+
+	return coap_snapshot_len;
+}
+
+// returns the registered observer, or NULL if all slots are taken
+static struct coap_observer_slot *coap_observe(const struct coap_request *req,
+					       const struct sockaddr_in *addr)
+{
+	struct coap_observer_slot *o = coap_observer_find(addr, req->token, req->token_len);
+
+	for (int i = 0; o == NULL && i < ARRAY_SIZE(coap_observers); i++) {
+		if (!coap_observers[i].used) {
+			o = &coap_observers[i];
+			memset(o, 0, sizeof(*o));
+			o->used = true;
+			o->addr = *addr;
+			memcpy(o->token, req->token, req->token_len);
+			o->token_len = req->token_len;
+		}
+	}
+
+	if (o == NULL) {
+		LOG_WRN("No free observer slot");
+		return NULL;
+	}
+
+	strcpy(o->type, req->query_type);
+	o->seq++;
+
+	return o;
+}
+
+static void coap_get_points(const struct coap_request *req, const struct sockaddr_in *addr)
+{
+	struct coap_observer_slot *o = NULL;
+	struct coap_packet rsp;
+	uint8_t szx = LOG2(CONFIG_SIOT_COAP_BLOCK_SIZE) - 4;
+	int ret;
+
+	if (req->accept >= 0 && req->accept != COAP_CONTENT_FORMAT_APP_OCTET_STREAM) {
+		coap_reply(req, addr, COAP_RESPONSE_CODE_NOT_ACCEPTABLE);
+		return;
+	}
+
+	// the client may ask for smaller blocks, but not for larger ones
+	if (req->block2 && req->block_szx < szx) {
+		szx = req->block_szx;
+	}
+
+	size_t block_size = 16 << szx;
+	size_t len = coap_snapshot_get(req->query_type);
+	size_t off = req->block2 ? req->block_num * block_size : 0;
+
+	if (off > 0 && off >= len) {
+		coap_reply(req, addr, COAP_RESPONSE_CODE_BAD_OPTION);
+		return;
+	}
+
+	if (req->observe == 0 && off == 0) {
+		o = coap_observe(req, addr);
+	} else if (req->observe == 1) {
+		struct coap_observer_slot *old =
+			coap_observer_find(addr, req->token, req->token_len);
+		if (old != NULL) {
+			old->used = false;
+		}
+	}
+
+	size_t payload_len = MIN(block_size, len - off);
+	bool more = off + payload_len < len;
+	uint8_t etag[4];
+
+	sys_put_be32(coap_version, etag);
+
+	ret = coap_response_init(&rsp, req, COAP_RESPONSE_CODE_CONTENT);
+	if (ret < 0) {
+		goto end;
+	}
+	ret = coap_packet_append_option(&rsp, COAP_OPTION_ETAG, etag, sizeof(etag));
+	if (ret < 0) {
+		goto end;
+	}
+	if (o != NULL) {
+		ret = coap_append_option_int(&rsp, COAP_OPTION_OBSERVE, o->seq & 0xFFFFFF);
+		if (ret < 0) {
+			goto end;
+		}
+	}
+	ret = coap_append_option_int(&rsp, COAP_OPTION_CONTENT_FORMAT,
+				     COAP_CONTENT_FORMAT_APP_OCTET_STREAM);
+	if (ret < 0) {
+		goto end;
+	}
+	if (req->block2 || more) {
+		ret = coap_append_option_int(&rsp, COAP_OPTION_BLOCK2,
+					     off / block_size << 4 | more << 3 | szx);
+		if (ret < 0) {
+			goto end;
+		}
+		stat_blocks++;
+	}
+	if (more && off == 0) {
+		ret = coap_append_option_int(&rsp, COAP_OPTION_SIZE2, len);
+		if (ret < 0) {
+			goto end;
+		}
+	}
+	if (payload_len > 0) {
+		ret = coap_packet_append_payload_marker(&rsp);
+		if (ret < 0) {
+			goto end;
+		}
+		ret = coap_packet_append_payload(&rsp, coap_snapshot + off, payload_len);
+		if (ret < 0) {
+			goto end;
+		}
+	}
+
+	if (coap_send(addr, &rsp) == 0 && o != NULL) {
+		o->mid = coap_header_get_id(&rsp);
+	}
+
+end:
+	if (ret < 0) {
+		LOG_ERR("Error building CoAP response: %i", ret);
+		stat_errors++;
+	}
+}
+
+// resource discovery, RFC 6690
+static void coap_get_core(const struct coap_request *req, const struct sockaddr_in *addr)
+{
+	static const char links[] = "</points>;obs;ct=42";
+	struct coap_packet rsp;
+
+	if (coap_response_init(&rsp, req, COAP_RESPONSE_CODE_CONTENT) < 0 ||
+	    coap_append_option_int(&rsp, COAP_OPTION_CONTENT_FORMAT,
+				   COAP_CONTENT_FORMAT_APP_LINK_FORMAT) < 0 ||
+	    coap_packet_append_payload_marker(&rsp) < 0 ||
+	    coap_packet_append_payload(&rsp, (const uint8_t *)links, sizeof(links) - 1) < 0) {
+		stat_errors++;
+		return;
+	}
+
+	coap_send(addr, &rsp);
+}
+
+// an acknowledgement or reset of a notification
+static void coap_handle_empty(const struct coap_request *req)
+{
+	for (int i = 0; i < ARRAY_SIZE(coap_observers); i++) {
+		struct coap_observer_slot *o = &coap_observers[i];
+
+		if (!o->used) {
+			continue;
+		}
+
+		if (req->type == COAP_TYPE_RESET &&
+		    (req->mid == o->mid || req->mid == o->con_mid)) {
+			coap_observer_remove(o, "reset");
+		} else if (req->type == COAP_TYPE_ACK && o->con_pending &&
+			   req->mid == o->con_mid) {
+			o->con_pending = false;
+			o->missed = 0;
+		}
+	}
+}
+
+static void coap_input(void)
+{
+	struct coap_request req;
+	struct sockaddr_in addr;
+	socklen_t addr_len = sizeof(addr);
+
+	ssize_t n = zsock_recvfrom(coap_fd, coap_rx, sizeof(coap_rx), ZSOCK_MSG_DONTWAIT,
+				   (struct sockaddr *)&addr, &addr_len);
+	if (n < 0) {
+		if (errno != EAGAIN) {
+			LOG_ERR("Error receiving CoAP message: %i", errno);
+			stat_errors++;
+		}
+		return;
+	}
+
+	// messages that cannot be parsed are silently ignored
+	if (coap_parse(coap_rx, n, &req)) {
+		LOG_DBG("Invalid CoAP message from port %i", ntohs(addr.sin_port));
+		return;
+	}
+
+	if (req.code == COAP_CODE_EMPTY) {
+		if (req.type == COAP_TYPE_CON) {
+			// CoAP ping
+			struct coap_packet rst;
+
+			if (coap_packet_init(&rst, coap_tx, sizeof(coap_tx), COAP_VERSION_1,
+					     COAP_TYPE_RESET, 0, NULL, COAP_CODE_EMPTY,
+					     req.mid) == 0) {
+				coap_send(&addr, &rst);
+			}
+		} else {
+			coap_handle_empty(&req);
+		}
+		return;
+	}
+
+	// only requests are handled, responses are not expected
+	if (req.code >= 0x20 || (req.type != COAP_TYPE_CON && req.type != COAP_TYPE_NON_CON)) {
+		return;
+	}
+
+	stat_requests++;
+
+	if (req.error) {
+		coap_reply(&req, &addr, req.error);
+	} else if (strcmp(req.path, "points") == 0) {
+		if (req.code == COAP_METHOD_GET) {
+			coap_get_points(&req, &addr);
+		} else {
+			coap_reply(&req, &addr, COAP_RESPONSE_CODE_NOT_ALLOWED);
+		}
+	} else if (strcmp(req.path, ".well-known/core") == 0 && req.code == COAP_METHOD_GET) {
+		coap_get_core(&req, &addr);
+	} else {
+		coap_reply(&req, &addr, COAP_RESPONSE_CODE_NOT_FOUND);
+	}
+}
+
+// ==================================================
+// Notifications
+
+// sends the changed points of the observer's type, in as many notifications
+// as needed to keep each within a block
+static void coap_notify_observer(struct coap_observer_slot *o)
+{
+	int i = 0;
+
+	while (o->used && i < ARRAY_SIZE(coap_points)) {
+		bool con = !o->con_pending && (o->sent + 1) % CONFIG_SIOT_COAP_CON_INTERVAL == 0;
+		size_t len = 0;
+
+		for (; i < ARRAY_SIZE(coap_points); i++) {
+			if (!coap_dirty[i] || !coap_type_match(&coap_points[i], o->type)) {
+				continue;
+			}
+
+			int ret = point_bin_encode(&coap_points[i], coap_block + len,
+						   sizeof(coap_block) - len);
+			if (ret == -ENOTSUP) {
+				continue;
+			} else if (ret < 0) {
+				// the block is full, the point goes in the next one
+				break;
+			}
+			len += ret;
+		}
+
+		if (len == 0) {
+			return;
+		}
+
+		struct coap_packet pkt;
+		uint8_t type = con ? COAP_TYPE_CON : COAP_TYPE_NON_CON;
+		uint16_t mid = coap_next_id();
+		uint32_t seq = (o->seq + 1) & 0xFFFFFF;
+
+		if (coap_packet_init(&pkt, coap_tx, sizeof(coap_tx), COAP_VERSION_1, type,
+				     o->token_len, o->token, COAP_RESPONSE_CODE_CONTENT, mid) < 0 ||
+		    coap_append_option_int(&pkt, COAP_OPTION_OBSERVE, seq) < 0 ||
+		    coap_append_option_int(&pkt, COAP_OPTION_CONTENT_FORMAT,
+					   COAP_CONTENT_FORMAT_APP_OCTET_STREAM) < 0 ||
+		    coap_packet_append_payload_marker(&pkt) < 0 ||
+		    coap_packet_append_payload(&pkt, coap_block, len) < 0) {
+			stat_errors++;
+			return;
+		}
+
+		if (coap_send(&o->addr, &pkt)) {
+			return;
+		}
+
+		o->seq++;
+		o->sent++;
+		o->mid = mid;
+		if (con) {
+			o->con_pending = true;
+			o->con_mid = mid;
+			o->con_ms = k_uptime_get_32();
+		}
+		stat_notifications++;
+	}
+}
+
+static void coap_notify(void)
+{
+	for (int i = 0; i < ARRAY_SIZE(coap_observers); i++) {
+		if (coap_observers[i].used) {
+			coap_notify_observer(&coap_observers[i]);
+		}
+	}
+
+	memset(coap_dirty, 0, sizeof(coap_dirty));
+}
+
+static void coap_check_acks(uint32_t now)
+{
+	for (int i = 0; i < ARRAY_SIZE(coap_observers); i++) {
+		struct coap_observer_slot *o = &coap_observers[i];
+
+		if (!o->used || !o->con_pending || now - o->con_ms < COAP_ACK_TIMEOUT_MS) {
+			continue;
+		}
+
+		o->con_pending = false;
+		if (++o->missed >= COAP_MAX_MISSED) {
+			coap_observer_remove(o, "no acknowledgement");
+		}
+	}
+}
+
+// ==================================================
+// Thread
+//
+// The thread is started by point_coap_init
+
+static int coap_open(void)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(coap_cfg->port ? coap_cfg->port : COAP_PORT),
+		.sin_addr = INADDR_ANY_INIT,
+	};
+
+	coap_fd = zsock_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (coap_fd < 0) {
+		LOG_ERR("Error opening CoAP socket: %i", errno);
+		return -errno;
+	}
+
+	if (zsock_bind(coap_fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		int ret = -errno;
+
+		LOG_ERR("Error binding CoAP socket: %i", ret);
+		zsock_close(coap_fd);
+		coap_fd = -1;
+		return ret;
+	}
+
+	LOG_INF("CoAP server on port %i", ntohs(addr.sin_port));
+
+	return 0;
+}
+
+static void coap_thread(void *arg1, void *arg2, void *arg3)
+{
+	while (true) {
+		// points are merged into the table while there is no socket, so
+		// the snapshot is complete once it is back
+		coap_merge_queued();
+
+		if (coap_fd < 0 && coap_open()) {
+			stat_errors++;
+			k_sleep(K_MSEC(COAP_RETRY_MS));
+			continue;
+		}
+
+		uint32_t now = k_uptime_get_32();
+
+		coap_check_acks(now);
+
+		if (coap_any_dirty() && now - coap_window_ms >= CONFIG_SIOT_COAP_NOTIFY_MS) {
+			coap_notify();
+		}
+
+		struct zsock_pollfd pfd = {.fd = coap_fd, .events = ZSOCK_POLLIN};
+
+		int ret = zsock_poll(&pfd, 1, COAP_POLL_MS);
+		if (ret < 0) {
+			LOG_ERR("CoAP poll error: %i", errno);
+			stat_errors++;
+			k_sleep(K_MSEC(COAP_POLL_MS));
+		} else if (ret > 0) {
+			coap_input();
+		}
+	}
+}
+
+K_THREAD_DEFINE(point_coap, STACKSIZE, coap_thread, NULL, NULL, NULL, PRIORITY, 0,
+		SYS_FOREVER_MS);
+
+int point_coap_init(const struct point_coap_config *cfg)
+{
+	coap_cfg = cfg;
+
+	int ret = zbus_chan_add_obs(&point_chan, &coap_lis, K_SECONDS(5));
+	if (ret) {
+		LOG_ERR("Error adding CoAP observer: %i", ret);
+		return ret;
+	}
+
+	k_thread_start(point_coap);
+
+	return 0;
+}
+
+void point_coap_stats(struct point_coap_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->dropped = atomic_get(&stat_dropped);
+	stats->requests = stat_requests;
+	stats->blocks = stat_blocks;
+	stats->encodes = stat_encodes;
+	stats->notifications = stat_notifications;
+	stats->observers = coap_observer_count();
+	stats->removed = stat_removed;
+	stats->errors = stat_errors;
+}
+
+static int cmd_coap_stats(const struct shell *sh, size_t argc, char **argv)
+{
+	struct point_coap_stats s;
+
+	point_coap_stats(&s);
+
+	shell_print(sh, "requests:      %u", s.requests);
+	shell_print(sh, "blocks:        %u", s.blocks);
+	shell_print(sh, "encodes:       %u", s.encodes);
+	shell_print(sh, "observers:     %u", s.observers);
+	shell_print(sh, "notifications: %u", s.notifications);
+	shell_print(sh, "removed:       %u", s.removed);
+	shell_print(sh, "dropped:       %u", s.dropped);
+	shell_print(sh, "errors:        %u", s.errors);
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(coap_cmds, SHELL_CMD(stats, NULL, "CoAP statistics", cmd_coap_stats),
+			       SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(coap, &coap_cmds, "CoAP commands", NULL);
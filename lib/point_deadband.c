@@ -0,0 +1,62 @@
+#include <point.h>
+#include <point_deadband.h>
+
+#include <math.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/zbus/zbus.h>
+
+ZBUS_CHAN_DECLARE(point_chan);
+
+// how far p moved from the last value. INT values are subtracted as integers,
+// as a float only holds integers up to 2^24 exactly.
+static float point_deadband_delta(const point *p, const point *last)
+{
+	if (p->data_type == POINT_DATA_TYPE_INT) {
+		int64_t d = (int64_t)point_get_int((point *)p) - point_get_int((point *)last);
+
+		return d < 0 ? -d : d;
+	}
+
+	return fabsf(point_get_float((point *)p) - point_get_float((point *)last));
+}
+
+bool point_deadband_check(struct point_deadband *db, const point *p, float deadband,
+			  uint32_t max_age_ms)
+{
+	// at least 1, so 0 is left for before the first point
+	int64_t now = MAX(k_uptime_get(), 1);
+	bool pass;
+
+	if (db->last_ms == 0 || db->last.data_type != p->data_type) {
+		pass = true;
+	} else if (max_age_ms > 0 && now - db->last_ms >= max_age_ms) {
+		pass = true;
+	} else if (p->data_type == POINT_DATA_TYPE_INT || p->data_type == POINT_DATA_TYPE_FLOAT) {
+		float delta = point_deadband_delta(p, &db->last);
+
+		// a deadband of 0 passes any change, but not a repeated value
+		pass = deadband > 0 ? delta > deadband : delta != 0;
+	} else {
+		pass = memcmp(db->last.data, p->data, sizeof(p->data)) != 0;
+	}
+
+	if (pass) {
+		db->last = *p;
+		db->last_ms = now;
+	}
+
+	return pass;
+}
+
+int point_deadband_publish(struct point_deadband *db, const point *p, float deadband,
+			   uint32_t max_age_ms)
+{
+	if (!point_deadband_check(db, p, deadband, max_age_ms)) {
+		return 0;
+	}
+
+	int ret = zbus_chan_pub(&point_chan, p, K_MSEC(500));
+
+	return ret < 0 ? ret : 1;
+}
@@ -0,0 +1,175 @@
+#include <point_frame.h>
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+
+#define POINT_FRAME_CRC_SEED 0xFFFF
+
+// COBS splits the data into blocks that end at a zero byte, or after 254 non
+// zero bytes. Each block is sent as its length + 1 followed by the non zero
+// bytes, and the zero is implied unless the block is 254 bytes long.
+struct cobs_enc {
+	uint8_t *dst;
+	// index of the length byte of the current block
+	size_t code_i;
+	size_t len;
+	uint8_t code;
+};
+
+static void cobs_enc_init(struct cobs_enc *e, uint8_t *dst)
+{
+	e->dst = dst;
+	e->code_i = 0;
+	e->len = 1;
+	e->code = 1;
+}
+
+static void cobs_enc_put(struct cobs_enc *e, uint8_t b)
+{
+	if (b != 0) {
+		e->dst[e->len++] = b;
+		e->code++;
+		if (e->code != 0xFF) {
+			return;
+		}
+	}
+
+	e->dst[e->code_i] = e->code;
+	e->code_i = e->len++;
+	e->code = 1;
+}
+
+static size_t cobs_enc_finish(struct cobs_enc *e)
+{
+	e->dst[e->code_i] = e->code;
+	return e->len;
+}
+
+int cobs_encode(const uint8_t *src, size_t len, uint8_t *dst, size_t dst_len)
+{
+	struct cobs_enc e;
+
+	if (dst_len < COBS_MAX_LEN(len)) {
+		return -ENOMEM;
+	}
+
+	cobs_enc_init(&e, dst);
+	for (size_t i = 0; i < len; i++) {
+		cobs_enc_put(&e, src[i]);
+	}
+
+	return cobs_enc_finish(&e);
+}
+
+int cobs_decode(const uint8_t *src, size_t len, uint8_t *dst, size_t dst_len)
+{
+	size_t i = 0;
+	size_t o = 0;
+
+	while (i < len) {
+		uint8_t code = src[i++];
+
+		if (code == 0 || i + code - 1 > len || o + code - 1 > dst_len ||
+		    memchr(src + i, 0, code - 1) != NULL) {
+			return -EINVAL;
+		}
+
+		// the output never passes the input, so this works in place
+		memmove(dst + o, src + i, code - 1);
+		o += code - 1;
+		i += code - 1;
+
+		if (code != 0xFF && i < len) {
+			if (o >= dst_len) {
+				return -EINVAL;
+			}
+			dst[o++] = 0;
+		}
+	}
+
+	return o;
+}
+
+int point_frame_encode(const uint8_t *data, size_t len, uint8_t *frame, size_t frame_len)
+{
+	struct cobs_enc e;
+
+	if (len > POINT_FRAME_DATA_LEN) {
+		return -EMSGSIZE;
+	}
+
+	if (frame_len < COBS_MAX_LEN(len + 2) + 1) {
+		return -ENOMEM;
+	}
+
+	uint16_t crc = crc16_itu_t(POINT_FRAME_CRC_SEED, data, len);
+
+	cobs_enc_init(&e, frame);
+	for (size_t i = 0; i < len; i++) {
+		cobs_enc_put(&e, data[i]);
+	}
+	cobs_enc_put(&e, crc & 0xFF);
+	cobs_enc_put(&e, crc >> 8);
+
+	size_t n = cobs_enc_finish(&e);
+	frame[n++] = 0;
+
+	return n;
+}
+
+// decodes the frame in rx->buf in place
+static void point_frame_rx_frame(struct point_frame_rx *rx, point_frame_cb cb, void *ctx)
+{
+	int len = cobs_decode(rx->buf, rx->len, rx->buf, sizeof(rx->buf));
+
+	if (len < 3) {
+		rx->errors++;
+		return;
+	}
+
+	len -= 2;
+	if (crc16_itu_t(POINT_FRAME_CRC_SEED, rx->buf, len) != sys_get_le16(rx->buf + len)) {
+		rx->errors++;
+		return;
+	}
+
+	rx->frames++;
+	cb(rx->buf, len, ctx);
+}
+
+void point_frame_rx_feed(struct point_frame_rx *rx, const uint8_t *data, size_t len,
+			 point_frame_cb cb, void *ctx)
+{
+	while (len > 0) {
+		const uint8_t *end = memchr(data, 0, len);
+		size_t n = end ? end - data : len;
+
+		if (!rx->overflow) {
+			if (rx->len + n > sizeof(rx->buf)) {
+				rx->overflow = true;
+			} else {
+				memcpy(rx->buf + rx->len, data, n);
+				rx->len += n;
+			}
+		}
+
+		if (end == NULL) {
+			return;
+		}
+
+		if (rx->overflow) {
+			rx->errors++;
+		} else if (rx->len > 0) {
+			// empty frames are ignored, so senders can send a zero to
+			// resync the receiver
+			point_frame_rx_frame(rx, cb, ctx);
+		}
+
+		rx->len = 0;
+		rx->overflow = false;
+		data += n + 1;
+		len -= n + 1;
+	}
+}
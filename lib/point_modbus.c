@@ -0,0 +1,1094 @@
+#include <point.h>
+#include <point_deadband.h>
+#include <point_modbus.h>
+#include <siot-string.h>
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/modbus/modbus.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/zbus/zbus.h>
+
+#define STACKSIZE 2048
+#define PRIORITY  7
+
+#define MODBUS_PORT 502
+// how long to wait before opening the server socket again after an error
+#define MODBUS_RETRY_MS 1000
+
+// most registers in one read request. Bits could go up to 2000, but are held
+// to the same limit so every read fits the same buffer.
+#define MODBUS_MAX_REGS 123
+
+// Zephyr Modbus interfaces in raw mode, whose ADUs the client and the server
+// carry over TCP
+#define MODBUS_TCP_CLIENT_IFACE "RAW_0"
+#define MODBUS_TCP_SERVER_IFACE "RAW_1"
+// the unit id of the server's raw interface. TCP requests are answered for any
+// unit id, so they are handed to the interface with this one.
+#define MODBUS_TCP_UNIT_ID 0xFF
+
+BUILD_ASSERT(CONFIG_MODBUS_NUMOF_RAW_ADU >= 2, "Modbus TCP needs two raw interfaces");
+
+LOG_MODULE_REGISTER(point_modbus, LOG_LEVEL_INF);
+
+ZBUS_CHAN_DECLARE(point_chan);
+
+static uint32_t stat_reads;
+static uint32_t stat_registers;
+static uint32_t stat_published;
+static uint32_t stat_suppressed;
+static uint32_t stat_overruns;
+static uint32_t stat_errors;
+static uint32_t stat_exceptions;
+static uint32_t stat_requests;
+static uint32_t stat_writes;
+static uint32_t stat_server_errors;
+
+// ==================================================
+// Registers and points
+
+static int modbus_reg_width(const struct point_modbus_reg *r)
+{
+	if (r->table == POINT_MODBUS_COIL || r->table == POINT_MODBUS_DISCRETE_INPUT) {
+		return 1;
+	}
+
+	switch (r->format) {
+	case POINT_MODBUS_U32:
+	case POINT_MODBUS_S32:
+	case POINT_MODBUS_F32:
+		return 2;
+	default:
+		return 1;
+	}
+}
+
+// the point of a register, from its value in words, one word per register or
+// bit
+static void modbus_regs_to_point(const struct point_modbus_reg *r, const uint16_t *words, point *p)
+{
+	uint32_t v32 = (uint32_t)words[0] << 16 | (modbus_reg_width(r) > 1 ? words[1] : 0);
+	float scale = r->scale != 0 ? r->scale : 1.0f;
+	int32_t i;
+	float f;
+
+	memset(p, 0, sizeof(*p));
+	point_set_type_key(p, r->point_def->type, r->key != NULL ? r->key : "0");
+
+	if (r->table == POINT_MODBUS_COIL || r->table == POINT_MODBUS_DISCRETE_INPUT) {
+		i = words[0] != 0;
+	} else {
+		switch (r->format) {
+		case POINT_MODBUS_S16:
+			i = (int16_t)words[0];
+			break;
+		case POINT_MODBUS_U32:
+		case POINT_MODBUS_S32:
+			// U32 values above INT32_MAX do not fit an INT point
+			i = (int32_t)v32;
+			break;
+		case POINT_MODBUS_F32:
+			memcpy(&f, &v32, sizeof(f));
+			if (r->point_def->data_type == POINT_DATA_TYPE_FLOAT) {
+				point_put_float(p, f * scale);
+			} else {
+				point_put_int(p, lroundf(f * scale));
+			}
+			return;
+		default:
+			i = words[0];
+		}
+	}
+
+	if (r->point_def->data_type == POINT_DATA_TYPE_FLOAT) {
+		point_put_float(p, (r->format == POINT_MODBUS_U32 ? (float)(uint32_t)i : (float)i) *
+					   scale);
+	} else if (r->scale != 0) {
+		point_put_int(p, lroundf(i * scale));
+	} else {
+		point_put_int(p, i);
+	}
+}
+
+// the register value of a point, in one word per register or bit
+static void modbus_point_to_regs(const struct point_modbus_reg *r, point *p, uint16_t *words)
+{
+	float scale = r->scale != 0 ? r->scale : 1.0f;
+	bool is_float = p->data_type == POINT_DATA_TYPE_FLOAT;
+	float v = is_float ? point_get_float(p) : point_get_int(p);
+	int64_t i = !is_float && r->scale == 0 ? point_get_int(p) : llroundf(v / scale);
+	uint32_t v32;
+
+	if (r->table == POINT_MODBUS_COIL || r->table == POINT_MODBUS_DISCRETE_INPUT) {
+		words[0] = v != 0;
+		return;
+	}
+
+	switch (r->format) {
+	case POINT_MODBUS_S16:
+		words[0] = (uint16_t)CLAMP(i, INT16_MIN, INT16_MAX);
+		return;
+	case POINT_MODBUS_U32:
+		v32 = CLAMP(i, 0, UINT32_MAX);
+		break;
+	case POINT_MODBUS_S32:
+		v32 = (uint32_t)CLAMP(i, INT32_MIN, INT32_MAX);
+		break;
+	case POINT_MODBUS_F32: {
+		float f = v / scale;
+
+		memcpy(&v32, &f, sizeof(v32));
+		break;
+	}
+	default:
+		words[0] = CLAMP(i, 0, UINT16_MAX);
+		return;
+	}
+
+	words[0] = v32 >> 16;
+	words[1] = v32 & 0xFFFF;
+}
+
+// checks that the registers are sorted by table and address, and do not
+// overlap
+static int modbus_regs_check(const struct point_modbus_reg *regs, size_t len)
+{
+	for (int i = 1; i < len; i++) {
+		const struct point_modbus_reg *prev = &regs[i - 1];
+
+		if (regs[i].table < prev->table ||
+		    (regs[i].table == prev->table &&
+		     regs[i].addr < prev->addr + modbus_reg_width(prev))) {
+			LOG_ERR("Modbus register %i:%u is not sorted", regs[i].table, regs[i].addr);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+// ==================================================
+// Client
+//
+// Contiguous registers of a device are read with one request, a span. The
+// spans of all devices are built by point_modbus_client_init.
+
+struct modbus_span {
+	uint8_t dev;
+	uint8_t table;
+	uint16_t start;
+	uint16_t count;
+	// index of the first register of the span in the device's table
+	uint16_t first;
+	uint16_t regs_len;
+	// index of the deadband state of the first register
+	uint16_t state;
+};
+
+static const struct point_modbus_device *modbus_devs;
+static size_t modbus_devs_len;
+
+static struct modbus_span modbus_spans[CONFIG_SIOT_MODBUS_READS];
+static size_t modbus_spans_len;
+
+static struct point_deadband modbus_deadband[CONFIG_SIOT_MODBUS_POINTS];
+
+// connection to each TCP device, -1 if closed
+static int modbus_fds[CONFIG_SIOT_MODBUS_DEVICES] = {
+	[0 ... CONFIG_SIOT_MODBUS_DEVICES - 1] = -1,
+};
+static uint16_t modbus_tid;
+
+// Zephyr Modbus interface of each device. The TCP devices share the client's
+// raw interface, whose requests go to modbus_tcp_dev.
+static int modbus_ifaces[CONFIG_SIOT_MODBUS_DEVICES];
+static int modbus_tcp_dev;
+// error of the connection to modbus_tcp_dev in the last request, 0 if none
+static int modbus_tcp_err;
+
+static int modbus_tcp_client_tx(const int iface, const struct modbus_adu *adu, void *user_data);
+
+static const struct modbus_iface_param modbus_tcp_client_param = {
+	.mode = MODBUS_MODE_RAW,
+	.rx_timeout = CONFIG_SIOT_MODBUS_TIMEOUT_MS * USEC_PER_MSEC,
+	.rawcb =
+		{
+			.raw_tx_cb = modbus_tcp_client_tx,
+		},
+};
+
+#if defined(CONFIG_SIOT_MODBUS_RTU)
+static const struct modbus_iface_param modbus_rtu_param = {
+	.mode = MODBUS_MODE_RTU,
+	.rx_timeout = CONFIG_SIOT_MODBUS_TIMEOUT_MS * USEC_PER_MSEC,
+	.serial =
+		{
+			.baud = CONFIG_SIOT_MODBUS_RTU_BAUDRATE,
+			.parity = IS_ENABLED(CONFIG_SIOT_MODBUS_RTU_PARITY_NONE)
+					  ? UART_CFG_PARITY_NONE
+					  : UART_CFG_PARITY_EVEN,
+		},
+};
+#endif
+
+static void modbus_close(int d)
+{
+	if (modbus_fds[d] >= 0) {
+		zsock_close(modbus_fds[d]);
+		modbus_fds[d] = -1;
+	}
+}
+
+static int modbus_connect(int d)
+{
+	const struct point_modbus_device *dev = &modbus_devs[d];
+	struct zsock_addrinfo hints = {
+		.ai_family = AF_INET,
+		.ai_socktype = SOCK_STREAM,
+	};
+	struct zsock_addrinfo *res;
+	char port[ITOA_I32_LEN];
+	int ret;
+
+	itoa_i32(dev->port ? dev->port : MODBUS_PORT, port, sizeof(port));
+
+	ret = zsock_getaddrinfo(dev->host, port, &hints, &res);
+	if (ret) {
+		LOG_ERR("Error looking up %s: %i", dev->host, ret);
+		return -EHOSTUNREACH;
+	}
+
+	modbus_fds[d] = zsock_socket(res->ai_family, SOCK_STREAM, IPPROTO_TCP);
+	if (modbus_fds[d] < 0) {
+		ret = -errno;
+		LOG_ERR("Error opening socket: %i", ret);
+		zsock_freeaddrinfo(res);
+		return ret;
+	}
+
+	ret = zsock_connect(modbus_fds[d], res->ai_addr, res->ai_addrlen);
+	zsock_freeaddrinfo(res);
+	if (ret) {
+		ret = -errno;
+		LOG_ERR("Error connecting to %s: %i", dev->host, ret);
+		modbus_close(d);
+		return ret;
+	}
+
+	return 0;
+}
+
+static int modbus_send_all(int fd, const uint8_t *buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t n = zsock_send(fd, buf, len, 0);
+		if (n < 0) {
+			return -errno;
+		}
+		buf += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+static int modbus_recv_all(int fd, uint8_t *buf, size_t len)
+{
+	while (len > 0) {
+		struct zsock_pollfd pfd = {.fd = fd, .events = ZSOCK_POLLIN};
+
+		int ret = zsock_poll(&pfd, 1, CONFIG_SIOT_MODBUS_TIMEOUT_MS);
+		if (ret < 0) {
+			return -errno;
+		} else if (ret == 0) {
+			return -ETIMEDOUT;
+		}
+
+		ssize_t n = zsock_recv(fd, buf, len, 0);
+		if (n == 0) {
+			return -ECONNRESET;
+		} else if (n < 0) {
+			return -errno;
+		}
+		buf += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+// Sends a request of the client's raw interface to modbus_tcp_dev, and hands
+// the response back to the interface. If the connection fails, the interface
+// is answered with a server failure exception at once, rather than left to
+// time out, and the error is kept in modbus_tcp_err.
+static int modbus_tcp_client_tx(const int iface, const struct modbus_adu *adu, void *user_data)
+{
+	uint8_t hdr[MODBUS_MBAP_AND_FC_LENGTH];
+	struct modbus_adu rsp;
+	int d = modbus_tcp_dev;
+	uint16_t tid = ++modbus_tid;
+	int ret = 0;
+
+	if (modbus_fds[d] < 0) {
+		ret = modbus_connect(d);
+	}
+
+	modbus_raw_put_header(adu, hdr);
+	sys_put_be16(tid, hdr);
+
+	if (ret == 0) {
+		ret = modbus_send_all(modbus_fds[d], hdr, sizeof(hdr));
+	}
+	if (ret == 0) {
+		ret = modbus_send_all(modbus_fds[d], adu->data, adu->length);
+	}
+	if (ret == 0) {
+		ret = modbus_recv_all(modbus_fds[d], hdr, sizeof(hdr));
+	}
+
+	// the length counts the unit id and the function code
+	if (ret == 0 &&
+	    (sys_get_be16(hdr) != tid || sys_get_be16(hdr + 2) != 0 || sys_get_be16(hdr + 4) < 2 ||
+	     sys_get_be16(hdr + 4) - 2 > sizeof(rsp.data))) {
+		LOG_ERR("Invalid Modbus TCP response header");
+		ret = -EBADMSG;
+	}
+
+	if (ret == 0) {
+		modbus_raw_get_header(&rsp, hdr);
+		ret = modbus_recv_all(modbus_fds[d], rsp.data, rsp.length);
+	}
+
+	if (ret) {
+		modbus_tcp_err = ret;
+		rsp.trans_id = adu->trans_id;
+		rsp.proto_id = 0;
+		rsp.unit_id = adu->unit_id;
+		rsp.fc = adu->fc;
+		modbus_raw_set_server_failure(&rsp);
+	}
+
+	return modbus_raw_submit_rx(iface, &rsp);
+}
+
+// reads a span into one word per register or bit. Returns 0, a Modbus
+// exception code, or a negative error.
+static int modbus_read(const struct modbus_span *s, uint16_t *words)
+{
+	int iface = modbus_ifaces[s->dev];
+	uint8_t unit = modbus_devs[s->dev].unit_id;
+	uint8_t bits[DIV_ROUND_UP(MODBUS_MAX_REGS, 8)];
+	int ret;
+
+	switch (s->table) {
+	case POINT_MODBUS_COIL:
+		ret = modbus_read_coils(iface, unit, s->start, bits, s->count);
+		break;
+	case POINT_MODBUS_DISCRETE_INPUT:
+		ret = modbus_read_dinputs(iface, unit, s->start, bits, s->count);
+		break;
+	case POINT_MODBUS_INPUT_REG:
+		return modbus_read_input_regs(iface, unit, s->start, words, s->count);
+	default:
+		return modbus_read_holding_regs(iface, unit, s->start, words, s->count);
+	}
+
+	for (int i = 0; ret == 0 && i < s->count; i++) {
+		words[i] = (bits[i / 8] >> (i % 8)) & 1;
+	}
+
+	return ret;
+}
+
+static void modbus_poll(int d)
+{
+	const struct point_modbus_device *dev = &modbus_devs[d];
+	uint16_t words[MODBUS_MAX_REGS];
+	point p;
+
+	for (int i = 0; i < modbus_spans_len; i++) {
+		const struct modbus_span *s = &modbus_spans[i];
+		int ret;
+
+		if (s->dev != d) {
+			continue;
+		}
+
+		modbus_tcp_dev = d;
+		modbus_tcp_err = 0;
+		ret = modbus_read(s, words);
+		if (modbus_tcp_err) {
+			ret = modbus_tcp_err;
+		}
+
+		if (ret > 0) {
+			LOG_WRN("Modbus exception %i reading %i:%u from device %i", ret, s->table,
+				s->start, d);
+			stat_exceptions++;
+		} else if (ret < 0 && dev->host != NULL) {
+			// the connection is in an unknown state after anything
+			// but an exception
+			LOG_ERR("Error reading from %s: %i", dev->host, ret);
+			modbus_close(d);
+			stat_errors++;
+			return;
+		}
+
+		if (ret) {
+			stat_errors++;
+			continue;
+		}
+
+		stat_reads++;
+		stat_registers += s->count;
+
+		for (int j = 0; j < s->regs_len; j++) {
+			const struct point_modbus_reg *r = &dev->regs[s->first + j];
+
+			modbus_regs_to_point(r, words + r->addr - s->start, &p);
+			ret = point_deadband_publish(&modbus_deadband[s->state + j], &p,
+						     r->deadband, dev->max_age_ms);
+			if (ret > 0) {
+				stat_published++;
+			} else if (ret == 0) {
+				stat_suppressed++;
+			}
+		}
+	}
+}
+
+// The thread is started by point_modbus_client_init, and polls one device at
+// a time, whichever is due first.
+static void modbus_client_thread(void *arg1, void *arg2, void *arg3)
+{
+	int64_t next[CONFIG_SIOT_MODBUS_DEVICES];
+	int64_t start = k_uptime_get();
+
+	for (int i = 0; i < modbus_devs_len; i++) {
+		next[i] = start;
+	}
+
+	while (true) {
+		int d = 0;
+
+		for (int i = 1; i < modbus_devs_len; i++) {
+			if (next[i] < next[d]) {
+				d = i;
+			}
+		}
+
+		int64_t now = k_uptime_get();
+
+		if (next[d] > now) {
+			k_sleep(K_MSEC(next[d] - now));
+			continue;
+		}
+
+		modbus_poll(d);
+
+		// a poll that takes longer than the period delays the next one,
+		// rather than starting polls back to back
+		next[d] += modbus_devs[d].period_ms;
+		now = k_uptime_get();
+		if (next[d] <= now) {
+			stat_overruns++;
+			next[d] = now + modbus_devs[d].period_ms;
+		}
+	}
+}
+
+K_THREAD_DEFINE(modbus_client, STACKSIZE, modbus_client_thread, NULL, NULL, NULL, PRIORITY, 0,
+		SYS_FOREVER_MS);
+
+// splits the registers of a device into spans
+static int modbus_spans_build(int d, size_t *state)
+{
+	const struct point_modbus_device *dev = &modbus_devs[d];
+	struct modbus_span *s = NULL;
+
+	int ret = modbus_regs_check(dev->regs, dev->regs_len);
+	if (ret) {
+		return ret;
+	}
+
+	if (*state + dev->regs_len > ARRAY_SIZE(modbus_deadband)) {
+		LOG_ERR("More than CONFIG_SIOT_MODBUS_POINTS registers");
+		return -EINVAL;
+	}
+
+	for (int i = 0; i < dev->regs_len; i++) {
+		const struct point_modbus_reg *r = &dev->regs[i];
+		int end = r->addr + modbus_reg_width(r);
+
+		if (s != NULL && s->table == r->table &&
+		    r->addr <= s->start + s->count + CONFIG_SIOT_MODBUS_MAX_GAP &&
+		    end - s->start <= MODBUS_MAX_REGS) {
+			s->count = end - s->start;
+			s->regs_len++;
+			continue;
+		}
+
+		if (modbus_spans_len == ARRAY_SIZE(modbus_spans)) {
+			LOG_ERR("More than CONFIG_SIOT_MODBUS_READS reads");
+			return -EINVAL;
+		}
+
+		s = &modbus_spans[modbus_spans_len++];
+		*s = (struct modbus_span){
+			.dev = d,
+			.table = r->table,
+			.start = r->addr,
+			.count = end - r->addr,
+			.first = i,
+			.regs_len = 1,
+			.state = *state + i,
+		};
+	}
+
+	*state += dev->regs_len;
+
+	return 0;
+}
+
+int point_modbus_client_init(const struct point_modbus_device *devs, size_t len)
+{
+	size_t state = 0;
+	int ret;
+
+	if (len > CONFIG_SIOT_MODBUS_DEVICES) {
+		LOG_ERR("More than CONFIG_SIOT_MODBUS_DEVICES devices");
+		return -EINVAL;
+	}
+
+	// with no devices, the thread would pick device 0 and poll it forever
+	if (len == 0) {
+		return 0;
+	}
+
+	modbus_devs = devs;
+	modbus_devs_len = len;
+
+	for (int d = 0; d < len; d++) {
+		ret = modbus_spans_build(d, &state);
+		if (ret) {
+			return ret;
+		}
+
+		// TCP devices go through the raw interface
+		const char *name = devs[d].host != NULL ? MODBUS_TCP_CLIENT_IFACE : devs[d].iface;
+		struct modbus_iface_param param = modbus_tcp_client_param;
+
+		if (devs[d].host == NULL) {
+#if defined(CONFIG_SIOT_MODBUS_RTU)
+			param = modbus_rtu_param;
+#else
+			LOG_ERR("Modbus RTU devices need CONFIG_SIOT_MODBUS_RTU");
+			return -ENOTSUP;
+#endif
+		}
+
+		modbus_ifaces[d] = modbus_iface_get_by_name(name);
+		if (modbus_ifaces[d] < 0) {
+			LOG_ERR("No Modbus interface %s", name);
+			return -ENODEV;
+		}
+
+		// devices on the same bus, or over TCP, share the interface
+		bool shared = false;
+
+		for (int i = 0; i < d; i++) {
+			shared |= modbus_ifaces[i] == modbus_ifaces[d];
+		}
+
+		if (!shared) {
+			ret = modbus_init_client(modbus_ifaces[d], param);
+			if (ret) {
+				LOG_ERR("Error starting Modbus client on %s: %i", name, ret);
+				return ret;
+			}
+		}
+	}
+
+	LOG_INF("Polling %zu Modbus devices with %zu reads", len, modbus_spans_len);
+	k_thread_start(modbus_client);
+
+	return 0;
+}
+
+// ==================================================
+// Server
+//
+// The value of each register in the server's table, as it is sent, is kept in
+// modbus_image. It is updated by the listener when points change, and by
+// writes from Modbus clients.
+
+static const struct point_modbus_server_config *modbus_server_cfg;
+
+K_MUTEX_DEFINE(modbus_image_lock);
+static uint16_t modbus_image[CONFIG_SIOT_MODBUS_SERVER_POINTS][2];
+
+static void modbus_server_listener(const struct zbus_channel *chan)
+{
+	const point *p = zbus_chan_const_msg(chan);
+	const struct point_modbus_server_config *cfg = modbus_server_cfg;
+
+	for (int i = 0; i < cfg->regs_len; i++) {
+		const struct point_modbus_reg *r = &cfg->regs[i];
+
+		if (strcmp(p->type, r->point_def->type) != 0 ||
+		    strcmp(p->key, r->key != NULL ? r->key : "0") != 0) {
+			continue;
+		}
+
+		k_mutex_lock(&modbus_image_lock, K_FOREVER);
+		modbus_point_to_regs(r, (point *)p, modbus_image[i]);
+		k_mutex_unlock(&modbus_image_lock);
+	}
+}
+
+ZBUS_LISTENER_DEFINE(modbus_server_lis, modbus_server_listener);
+
+// returns the index of the register covering addr, or -1
+static int modbus_server_find(enum point_modbus_table table, uint16_t addr)
+{
+	const struct point_modbus_server_config *cfg = modbus_server_cfg;
+
+	for (int i = 0; i < cfg->regs_len; i++) {
+		const struct point_modbus_reg *r = &cfg->regs[i];
+
+		if (r->table == table && addr >= r->addr && addr < r->addr + modbus_reg_width(r)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+// publishes the point of a register after a write
+static void modbus_server_publish(int i)
+{
+	const struct point_modbus_reg *r = &modbus_server_cfg->regs[i];
+	point p;
+
+	k_mutex_lock(&modbus_image_lock, K_FOREVER);
+	modbus_regs_to_point(r, modbus_image[i], &p);
+	k_mutex_unlock(&modbus_image_lock);
+
+	LOG_DBG_POINT("Modbus write", &p);
+	zbus_chan_pub(&point_chan, &p, K_MSEC(500));
+	stat_writes++;
+}
+
+// The Zephyr Modbus server asks for each register on its own, for TCP and RTU
+// alike. Points of 32 bit registers are published when their last word is
+// written.
+
+static int modbus_server_read_word(enum point_modbus_table table, uint16_t addr, uint16_t *v)
+{
+	int r = modbus_server_find(table, addr);
+
+	if (r < 0) {
+		return -ENOTSUP;
+	}
+
+	k_mutex_lock(&modbus_image_lock, K_FOREVER);
+	*v = modbus_image[r][addr - modbus_server_cfg->regs[r].addr];
+	k_mutex_unlock(&modbus_image_lock);
+
+	return 0;
+}
+
+static int modbus_server_write_word(enum point_modbus_table table, uint16_t addr, uint16_t v)
+{
+	int r = modbus_server_find(table, addr);
+
+	if (r < 0) {
+		return -ENOTSUP;
+	}
+
+	const struct point_modbus_reg *reg = &modbus_server_cfg->regs[r];
+
+	k_mutex_lock(&modbus_image_lock, K_FOREVER);
+	modbus_image[r][addr - reg->addr] = v;
+	k_mutex_unlock(&modbus_image_lock);
+
+	if (addr == reg->addr + modbus_reg_width(reg) - 1) {
+		modbus_server_publish(r);
+	}
+
+	return 0;
+}
+
+static int modbus_server_coil_rd(uint16_t addr, bool *state)
+{
+	uint16_t v;
+	int ret = modbus_server_read_word(POINT_MODBUS_COIL, addr, &v);
+
+	*state = v != 0;
+
+	return ret;
+}
+
+static int modbus_server_coil_wr(uint16_t addr, bool state)
+{
+	return modbus_server_write_word(POINT_MODBUS_COIL, addr, state);
+}
+
+static int modbus_server_discrete_input_rd(uint16_t addr, bool *state)
+{
+	uint16_t v;
+	int ret = modbus_server_read_word(POINT_MODBUS_DISCRETE_INPUT, addr, &v);
+
+	*state = v != 0;
+
+	return ret;
+}
+
+static int modbus_server_input_reg_rd(uint16_t addr, uint16_t *reg)
+{
+	return modbus_server_read_word(POINT_MODBUS_INPUT_REG, addr, reg);
+}
+
+static int modbus_server_holding_reg_rd(uint16_t addr, uint16_t *reg)
+{
+	return modbus_server_read_word(POINT_MODBUS_HOLDING_REG, addr, reg);
+}
+
+static int modbus_server_holding_reg_wr(uint16_t addr, uint16_t reg)
+{
+	return modbus_server_write_word(POINT_MODBUS_HOLDING_REG, addr, reg);
+}
+
+static struct modbus_user_callbacks modbus_server_callbacks = {
+	.coil_rd = modbus_server_coil_rd,
+	.coil_wr = modbus_server_coil_wr,
+	.discrete_input_rd = modbus_server_discrete_input_rd,
+	.input_reg_rd = modbus_server_input_reg_rd,
+	.holding_reg_rd = modbus_server_holding_reg_rd,
+	.holding_reg_wr = modbus_server_holding_reg_wr,
+};
+
+#if defined(CONFIG_SIOT_MODBUS_RTU)
+static int modbus_rtu_server_init(const struct point_modbus_server_config *cfg)
+{
+	struct modbus_iface_param param = modbus_rtu_param;
+
+	int iface = modbus_iface_get_by_name(cfg->iface);
+	if (iface < 0) {
+		LOG_ERR("No Modbus interface %s", cfg->iface);
+		return -ENODEV;
+	}
+
+	param.server.user_cb = &modbus_server_callbacks;
+	param.server.unit_id = cfg->unit_id;
+
+	return modbus_init_server(iface, param);
+}
+#endif
+
+struct modbus_conn {
+	int fd;
+	size_t len;
+	uint8_t buf[MODBUS_MBAP_AND_FC_LENGTH + CONFIG_MODBUS_BUFFER_SIZE];
+};
+
+static struct modbus_conn modbus_conns[CONFIG_SIOT_MODBUS_SERVER_CLIENTS];
+
+// TCP requests are handed to the server's raw interface one at a time. Its
+// response is sent from the system work queue on modbus_server_conn, to the
+// unit id the request was sent to.
+static int modbus_server_iface;
+static struct modbus_conn *modbus_server_conn;
+static uint8_t modbus_server_unit;
+static int modbus_server_err;
+static uint8_t modbus_server_rsp[MODBUS_MBAP_AND_FC_LENGTH + CONFIG_MODBUS_BUFFER_SIZE];
+K_SEM_DEFINE(modbus_server_done, 0, 1);
+
+static int modbus_tcp_server_tx(const int iface, const struct modbus_adu *adu, void *user_data)
+{
+	modbus_raw_put_header(adu, modbus_server_rsp);
+	modbus_server_rsp[6] = modbus_server_unit;
+	memcpy(modbus_server_rsp + MODBUS_MBAP_AND_FC_LENGTH, adu->data, adu->length);
+
+	modbus_server_err = modbus_send_all(modbus_server_conn->fd, modbus_server_rsp,
+					    MODBUS_MBAP_AND_FC_LENGTH + adu->length);
+	k_sem_give(&modbus_server_done);
+
+	return modbus_server_err;
+}
+
+static int modbus_tcp_server_init(void)
+{
+	struct modbus_iface_param param = {
+		.mode = MODBUS_MODE_RAW,
+		.server =
+			{
+				.user_cb = &modbus_server_callbacks,
+				.unit_id = MODBUS_TCP_UNIT_ID,
+			},
+		.rawcb =
+			{
+				.raw_tx_cb = modbus_tcp_server_tx,
+			},
+	};
+
+	modbus_server_iface = modbus_iface_get_by_name(MODBUS_TCP_SERVER_IFACE);
+	if (modbus_server_iface < 0) {
+		LOG_ERR("No Modbus interface %s", MODBUS_TCP_SERVER_IFACE);
+		return -ENODEV;
+	}
+
+	return modbus_init_server(modbus_server_iface, param);
+}
+
+static int modbus_server_open(void)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(modbus_server_cfg->port ? modbus_server_cfg->port : MODBUS_PORT),
+		.sin_addr = INADDR_ANY_INIT,
+	};
+	int opt = 1;
+
+	int fd = zsock_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (fd < 0) {
+		LOG_ERR("Error opening Modbus server socket: %i", errno);
+		return -errno;
+	}
+
+	if (zsock_setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) ||
+	    zsock_bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || zsock_listen(fd, 2)) {
+		int ret = -errno;
+
+		LOG_ERR("Error listening on Modbus port %i: %i", ntohs(addr.sin_port), ret);
+		zsock_close(fd);
+		return ret;
+	}
+
+	LOG_INF("Modbus TCP server on port %i", ntohs(addr.sin_port));
+
+	return fd;
+}
+
+static void modbus_conn_close(struct modbus_conn *c)
+{
+	zsock_close(c->fd);
+	c->fd = -1;
+}
+
+// reads from a client, and answers the complete requests
+static void modbus_conn_input(struct modbus_conn *c)
+{
+	struct modbus_adu adu;
+
+	ssize_t n = zsock_recv(c->fd, c->buf + c->len, sizeof(c->buf) - c->len, 0);
+	if (n <= 0) {
+		modbus_conn_close(c);
+		return;
+	}
+	c->len += n;
+
+	while (c->len >= MODBUS_MBAP_AND_FC_LENGTH) {
+		// the length counts the unit id and the function code
+		size_t data_len = sys_get_be16(c->buf + 4) - 2;
+		size_t frame_len = MODBUS_MBAP_AND_FC_LENGTH + data_len;
+
+		if (sys_get_be16(c->buf + 2) != 0 || sys_get_be16(c->buf + 4) < 2 ||
+		    data_len > sizeof(adu.data)) {
+			LOG_ERR("Invalid Modbus TCP request, closing connection");
+			stat_server_errors++;
+			modbus_conn_close(c);
+			return;
+		}
+
+		if (c->len < frame_len) {
+			return;
+		}
+
+		modbus_raw_get_header(&adu, c->buf);
+		memcpy(adu.data, c->buf + MODBUS_MBAP_AND_FC_LENGTH, adu.length);
+		modbus_server_unit = adu.unit_id;
+		adu.unit_id = MODBUS_TCP_UNIT_ID;
+		modbus_server_conn = c;
+		stat_requests++;
+
+		// the server does not answer requests it cannot parse
+		k_sem_reset(&modbus_server_done);
+		if (modbus_raw_submit_rx(modbus_server_iface, &adu) ||
+		    k_sem_take(&modbus_server_done, K_MSEC(CONFIG_SIOT_MODBUS_TIMEOUT_MS))) {
+			LOG_WRN("No response to Modbus TCP request");
+			stat_server_errors++;
+		} else if (modbus_server_err) {
+			stat_server_errors++;
+			modbus_conn_close(c);
+			return;
+		}
+
+		c->len -= frame_len;
+		memmove(c->buf, c->buf + frame_len, c->len);
+	}
+}
+
+// The thread is started by point_modbus_server_init
+static void modbus_server_thread(void *arg1, void *arg2, void *arg3)
+{
+	struct zsock_pollfd fds[1 + CONFIG_SIOT_MODBUS_SERVER_CLIENTS];
+	struct modbus_conn *conns[ARRAY_SIZE(fds)];
+	int listen_fd = -1;
+
+	for (int i = 0; i < ARRAY_SIZE(modbus_conns); i++) {
+		modbus_conns[i].fd = -1;
+	}
+
+	while (true) {
+		int n = 1;
+
+		if (listen_fd < 0) {
+			listen_fd = modbus_server_open();
+			if (listen_fd < 0) {
+				stat_server_errors++;
+				k_sleep(K_MSEC(MODBUS_RETRY_MS));
+				continue;
+			}
+		}
+
+		fds[0] = (struct zsock_pollfd){.fd = listen_fd, .events = ZSOCK_POLLIN};
+		for (int i = 0; i < ARRAY_SIZE(modbus_conns); i++) {
+			if (modbus_conns[i].fd >= 0) {
+				fds[n] = (struct zsock_pollfd){.fd = modbus_conns[i].fd,
+							       .events = ZSOCK_POLLIN};
+				conns[n++] = &modbus_conns[i];
+			}
+		}
+
+		if (zsock_poll(fds, n, -1) < 0) {
+			LOG_ERR("Modbus server poll error: %i", errno);
+			stat_server_errors++;
+			k_sleep(K_MSEC(MODBUS_RETRY_MS));
+			continue;
+		}
+
+		for (int i = 1; i < n; i++) {
+			if (fds[i].revents) {
+				modbus_conn_input(conns[i]);
+			}
+		}
+
+		if (fds[0].revents & ZSOCK_POLLIN) {
+			int fd = zsock_accept(listen_fd, NULL, NULL);
+			struct modbus_conn *c = NULL;
+
+			for (int i = 0; fd >= 0 && i < ARRAY_SIZE(modbus_conns); i++) {
+				if (modbus_conns[i].fd < 0) {
+					c = &modbus_conns[i];
+					break;
+				}
+			}
+
+			if (c != NULL) {
+				c->fd = fd;
+				c->len = 0;
+			} else if (fd >= 0) {
+				LOG_WRN("No free Modbus connection slot");
+				zsock_close(fd);
+			}
+		}
+	}
+}
+
+K_THREAD_DEFINE(modbus_server, STACKSIZE, modbus_server_thread, NULL, NULL, NULL, PRIORITY, 0,
+		SYS_FOREVER_MS);
+
+int point_modbus_server_init(const struct point_modbus_server_config *cfg)
+{
+	int ret;
+
+	if (cfg->regs_len > CONFIG_SIOT_MODBUS_SERVER_POINTS) {
+		LOG_ERR("More than CONFIG_SIOT_MODBUS_SERVER_POINTS registers");
+		return -EINVAL;
+	}
+
+	ret = modbus_regs_check(cfg->regs, cfg->regs_len);
+	if (ret) {
+		return ret;
+	}
+
+	modbus_server_cfg = cfg;
+
+	ret = zbus_chan_add_obs(&point_chan, &modbus_server_lis, K_SECONDS(5));
+	if (ret) {
+		LOG_ERR("Error adding Modbus server observer: %i", ret);
+		return ret;
+	}
+
+	if (cfg->iface != NULL) {
+#if defined(CONFIG_SIOT_MODBUS_RTU)
+		ret = modbus_rtu_server_init(cfg);
+		if (ret) {
+			LOG_ERR("Error starting Modbus server on %s: %i", cfg->iface, ret);
+			return ret;
+		}
+#else
+		LOG_ERR("Serving Modbus RTU needs CONFIG_SIOT_MODBUS_RTU");
+		return -ENOTSUP;
+#endif
+	}
+
+	ret = modbus_tcp_server_init();
+	if (ret) {
+		LOG_ERR("Error starting Modbus TCP server: %i", ret);
+		return ret;
+	}
+
+	k_thread_start(modbus_server);
+
+	return 0;
+}
+
+void point_modbus_stats(struct point_modbus_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->reads = stat_reads;
+	stats->registers = stat_registers;
+	stats->published = stat_published;
+	stats->suppressed = stat_suppressed;
+	stats->overruns = stat_overruns;
+	stats->errors = stat_errors;
+	stats->exceptions = stat_exceptions;
+	stats->requests = stat_requests;
+	stats->writes = stat_writes;
+	stats->server_errors = stat_server_errors;
+}
+
+static int cmd_modbus_stats(const struct shell *sh, size_t argc, char **argv)
+{
+	struct point_modbus_stats s;
+
+	point_modbus_stats(&s);
+
+	shell_print(sh, "client reads:      %u", s.reads);
+	shell_print(sh, "client registers:  %u", s.registers);
+	shell_print(sh, "client published:  %u", s.published);
+	shell_print(sh, "client suppressed: %u", s.suppressed);
+	shell_print(sh, "client overruns:   %u", s.overruns);
+	shell_print(sh, "client errors:     %u", s.errors);
+	shell_print(sh, "client exceptions: %u", s.exceptions);
+	shell_print(sh, "server requests:   %u", s.requests);
+	shell_print(sh, "server writes:     %u", s.writes);
+	shell_print(sh, "server errors:     %u", s.server_errors);
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(modbus_cmds,
+			       SHELL_CMD(stats, NULL, "Modbus statistics", cmd_modbus_stats),
+			       SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(modbus, &modbus_cmds, "Modbus commands", NULL);
@@ -0,0 +1,709 @@
+#include <point.h>
+#include <point_mqtt.h>
+#include <point_queue.h>
+#include <siot-string.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/mqtt.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/zbus/zbus.h>
+
+#if defined(CONFIG_SIOT_MQTT_TLS)
+#include <zephyr/net/tls_credentials.h>
+#endif
+
+#define STACKSIZE 2048
+#define PRIORITY  7
+
+// how long the thread waits for packets before it looks at the queue again
+#define MQTT_POLL_MS    100
+// how long to wait for the broker to accept the connection
+#define MQTT_TIMEOUT_MS 10000
+
+// room for the CONNECT packet, and for the header and topic of a publish
+#define MQTT_LIB_BUF_SIZE 128
+
+#define MQTT_TOPIC_LEN 64
+
+LOG_MODULE_REGISTER(point_mqtt, LOG_LEVEL_INF);
+
+ZBUS_CHAN_DECLARE(point_chan);
+
+static const struct point_mqtt_config *mqtt_cfg;
+
+POINT_QUEUE_DEFINE(mqtt_q, CONFIG_SIOT_MQTT_QUEUE_LEN);
+
+static atomic_t stat_dropped;
+static uint32_t stat_coalesced;
+static uint32_t stat_publishes;
+static uint32_t stat_points;
+static uint32_t stat_acks;
+static uint32_t stat_received;
+static uint32_t stat_connects;
+static uint32_t stat_errors;
+
+// ==================================================
+// Queue
+
+static void mqtt_listener(const struct zbus_channel *chan)
+{
+	const point *p = zbus_chan_const_msg(chan);
+
+	if (mqtt_cfg->filter != NULL && !mqtt_cfg->filter(p, 0, mqtt_cfg->filter_ctx)) {
+		return;
+	}
+
+	if (point_queue_put(&mqtt_q, p)) {
+		atomic_inc(&stat_dropped);
+	}
+}
+
+ZBUS_LISTENER_DEFINE(mqtt_lis, mqtt_listener);
+
+// ==================================================
+// Point table
+//
+// Only used by the thread. Each point is dirty if it changed since it was
+// last published, and has the packet id of its publish until the broker
+// acknowledges it.
+
+static point mqtt_points[CONFIG_SIOT_MQTT_POINTS];
+static bool mqtt_dirty[CONFIG_SIOT_MQTT_POINTS];
+static uint16_t mqtt_point_ids[CONFIG_SIOT_MQTT_POINTS];
+
+// packet ids of the publishes that were not acknowledged, 0 for a free slot
+static uint16_t mqtt_ids[CONFIG_SIOT_MQTT_INFLIGHT];
+static uint16_t mqtt_last_id;
+
+// uptime in ms when the first point of the current window changed, valid
+// while a point is dirty
+static uint32_t mqtt_window_ms;
+
+static bool mqtt_any_dirty(void)
+{
+	for (int i = 0; i < ARRAY_SIZE(mqtt_dirty); i++) {
+		if (mqtt_dirty[i]) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// frees an entry that has been published and acknowledged
+static int mqtt_evict(void)
+{
+	for (int i = 0; i < ARRAY_SIZE(mqtt_points); i++) {
+		if (!mqtt_dirty[i] && mqtt_point_ids[i] == 0) {
+			memset(&mqtt_points[i], 0, sizeof(mqtt_points[i]));
+			return i;
+		}
+	}
+
+	return -ENOMEM;
+}
+
+static void mqtt_merge_queued(void)
+{
+	point p;
+
+	while (point_queue_get(&mqtt_q, &p) == 0) {
+		if (!mqtt_any_dirty()) {
+			mqtt_window_ms = k_uptime_get_32();
+		}
+
+		int i = points_upsert(mqtt_points, ARRAY_SIZE(mqtt_points), &p);
+		if (i < 0) {
+			i = mqtt_evict();
+			if (i < 0) {
+				atomic_inc(&stat_dropped);
+				continue;
+			}
+			mqtt_points[i] = p;
+		} else if (mqtt_dirty[i]) {
+			stat_coalesced++;
+		}
+
+		mqtt_dirty[i] = true;
+	}
+}
+
+static uint16_t mqtt_next_id(void)
+{
+	if (++mqtt_last_id == 0) {
+		mqtt_last_id = 1;
+	}
+
+	return mqtt_last_id;
+}
+
+// returns the free slot for a packet id, or -EBUSY if all are in flight
+static int mqtt_id_slot(void)
+{
+	for (int i = 0; i < ARRAY_SIZE(mqtt_ids); i++) {
+		if (mqtt_ids[i] == 0) {
+			return i;
+		}
+	}
+
+	return -EBUSY;
+}
+
+static int mqtt_inflight(void)
+{
+	int n = 0;
+
+	for (int i = 0; i < ARRAY_SIZE(mqtt_ids); i++) {
+		n += mqtt_ids[i] != 0;
+	}
+
+	return n;
+}
+
+static void mqtt_acked(uint16_t id)
+{
+	for (int i = 0; i < ARRAY_SIZE(mqtt_ids); i++) {
+		if (mqtt_ids[i] == id) {
+			mqtt_ids[i] = 0;
+			stat_acks++;
+		}
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(mqtt_point_ids); i++) {
+		if (mqtt_point_ids[i] == id) {
+			mqtt_point_ids[i] = 0;
+		}
+	}
+}
+
+// ==================================================
+// Connection
+//
+// The Zephyr MQTT library encodes and decodes the packets. Its event handler
+// is called from mqtt_input(), on this thread.
+
+static struct mqtt_client mqtt_client_ctx;
+static struct sockaddr_storage mqtt_broker;
+static struct mqtt_utf8 mqtt_user;
+static struct mqtt_utf8 mqtt_password;
+#if defined(CONFIG_SIOT_MQTT_TLS)
+static sec_tag_t mqtt_sec_tag;
+#endif
+
+// the library only keeps packet headers and topics in these, the payloads
+// are sent from mqtt_tx and read into mqtt_rx
+static uint8_t mqtt_lib_rx[MQTT_LIB_BUF_SIZE];
+static uint8_t mqtt_lib_tx[MQTT_LIB_BUF_SIZE];
+
+// the library has an open connection
+static bool mqtt_open;
+// the broker accepted the connection
+static bool mqtt_connected;
+static uint32_t mqtt_rx_ms;
+// a PINGREQ was sent after nothing was received for the keepalive time
+static bool mqtt_ping_sent;
+// an error from the event handler, which cannot return one
+static int mqtt_evt_err;
+
+static uint8_t mqtt_rx[CONFIG_SIOT_MQTT_BUF_SIZE];
+
+static int mqtt_sock(void)
+{
+#if defined(CONFIG_SIOT_MQTT_TLS)
+	if (mqtt_client_ctx.transport.type == MQTT_TRANSPORT_SECURE) {
+		return mqtt_client_ctx.transport.tls.sock;
+	}
+#endif
+
+	return mqtt_client_ctx.transport.tcp.sock;
+}
+
+// drops the connection without sending DISCONNECT, as the broker is gone or
+// out of step. mqtt_disconnect() is not used, its arguments differ between
+// the Zephyr versions this module builds with.
+static void mqtt_close(void)
+{
+	if (mqtt_open) {
+		mqtt_abort(&mqtt_client_ctx);
+	}
+	mqtt_open = false;
+	mqtt_connected = false;
+}
+
+static int mqtt_send_subscribe(void)
+{
+	char topic[MQTT_TOPIC_LEN];
+
+	int len = snprintf(topic, sizeof(topic), "%s/set", mqtt_cfg->prefix);
+	if (len >= sizeof(topic)) {
+		return -ENOMEM;
+	}
+
+	struct mqtt_topic t = {
+		.topic = {.utf8 = (uint8_t *)topic, .size = len},
+		.qos = MQTT_QOS_1_AT_LEAST_ONCE,
+	};
+	const struct mqtt_subscription_list list = {
+		.list = &t,
+		.list_count = 1,
+		.message_id = mqtt_next_id(),
+	};
+
+	return mqtt_subscribe(&mqtt_client_ctx, &list);
+}
+
+// setpoints are published on point_chan. The library has read the header of
+// the publish, the payload is read here.
+static int mqtt_handle_publish(const struct mqtt_publish_param *pub)
+{
+	static point pts[CONFIG_SIOT_MQTT_RX_POINTS];
+	size_t len = pub->message.payload.len;
+
+	if (len > sizeof(mqtt_rx)) {
+		LOG_ERR("Packet too large: %zu", len);
+		return -EMSGSIZE;
+	}
+
+	int ret = mqtt_readall_publish_payload(&mqtt_client_ctx, mqtt_rx, len);
+	if (ret) {
+		return ret;
+	}
+
+	int count = points_json_decode((char *)mqtt_rx, len, pts, ARRAY_SIZE(pts));
+	if (count < 0) {
+		LOG_ERR("Error decoding setpoints: %i", count);
+	}
+
+	for (int i = 0; i < count; i++) {
+		zbus_chan_pub(&point_chan, &pts[i], K_MSEC(500));
+		stat_received++;
+	}
+
+	if (pub->message.topic.qos == MQTT_QOS_0_AT_MOST_ONCE) {
+		return 0;
+	}
+
+	const struct mqtt_puback_param ack = {.message_id = pub->message_id};
+
+	return mqtt_publish_qos1_ack(&mqtt_client_ctx, &ack);
+}
+
+static void mqtt_evt_handler(struct mqtt_client *client, const struct mqtt_evt *evt)
+{
+	mqtt_rx_ms = k_uptime_get_32();
+	mqtt_ping_sent = false;
+
+	switch (evt->type) {
+	case MQTT_EVT_CONNACK:
+		if (evt->result != 0) {
+			LOG_ERR("Broker refused connection: %i", evt->result);
+			mqtt_evt_err = -ECONNREFUSED;
+			break;
+		}
+		mqtt_connected = true;
+		break;
+	case MQTT_EVT_DISCONNECT:
+		// the library closed the connection after an error
+		mqtt_open = false;
+		mqtt_connected = false;
+		break;
+	case MQTT_EVT_PUBACK:
+		mqtt_acked(evt->param.puback.message_id);
+		break;
+	case MQTT_EVT_SUBACK:
+		if (evt->param.suback.return_codes.len < 1 ||
+		    evt->param.suback.return_codes.data[0] == MQTT_SUBACK_FAILURE) {
+			LOG_ERR("Broker refused setpoint subscription");
+		}
+		break;
+	case MQTT_EVT_PUBLISH:
+		mqtt_evt_err = mqtt_handle_publish(&evt->param.publish);
+		break;
+	default:
+		break;
+	}
+}
+
+// reads a packet from the broker and handles it
+static int mqtt_read(void)
+{
+	mqtt_evt_err = 0;
+
+	int ret = mqtt_input(&mqtt_client_ctx);
+
+	return ret ? ret : mqtt_evt_err;
+}
+
+static int mqtt_wait_input(int timeout_ms)
+{
+	struct zsock_pollfd pfd = {.fd = mqtt_sock(), .events = ZSOCK_POLLIN};
+
+	int ret = zsock_poll(&pfd, 1, timeout_ms);
+	if (ret < 0) {
+		return -errno;
+	} else if (ret == 0) {
+		return 0;
+	}
+
+	return mqtt_read();
+}
+
+static int mqtt_client_setup(void)
+{
+	struct zsock_addrinfo hints = {
+		.ai_family = AF_INET,
+		.ai_socktype = SOCK_STREAM,
+	};
+	struct zsock_addrinfo *res;
+	struct mqtt_client *c = &mqtt_client_ctx;
+	char port[ITOA_I32_LEN];
+
+	itoa_i32(mqtt_cfg->port, port, sizeof(port));
+
+	int ret = zsock_getaddrinfo(mqtt_cfg->host, port, &hints, &res);
+	if (ret) {
+		LOG_ERR("Error looking up %s: %i", mqtt_cfg->host, ret);
+		return -EHOSTUNREACH;
+	}
+
+	memcpy(&mqtt_broker, res->ai_addr, MIN(res->ai_addrlen, sizeof(mqtt_broker)));
+	zsock_freeaddrinfo(res);
+
+	mqtt_client_init(c);
+	c->broker = &mqtt_broker;
+	c->evt_cb = mqtt_evt_handler;
+	c->client_id.utf8 = (const uint8_t *)mqtt_cfg->client_id;
+	c->client_id.size = strlen(mqtt_cfg->client_id);
+	if (mqtt_cfg->user != NULL) {
+		mqtt_user.utf8 = (const uint8_t *)mqtt_cfg->user;
+		mqtt_user.size = strlen(mqtt_cfg->user);
+		c->user_name = &mqtt_user;
+	}
+	if (mqtt_cfg->password != NULL) {
+		mqtt_password.utf8 = (const uint8_t *)mqtt_cfg->password;
+		mqtt_password.size = strlen(mqtt_cfg->password);
+		c->password = &mqtt_password;
+	}
+	c->protocol_version = MQTT_VERSION_3_1_1;
+	c->keepalive = CONFIG_SIOT_MQTT_KEEPALIVE;
+	// clean session, the subscription is made again on every connect
+	c->clean_session = 1;
+	c->rx_buf = mqtt_lib_rx;
+	c->rx_buf_size = sizeof(mqtt_lib_rx);
+	c->tx_buf = mqtt_lib_tx;
+	c->tx_buf_size = sizeof(mqtt_lib_tx);
+	c->transport.type = MQTT_TRANSPORT_NON_SECURE;
+
+#if defined(CONFIG_SIOT_MQTT_TLS)
+	if (mqtt_cfg->sec_tag >= 0) {
+		struct mqtt_sec_config *tls = &c->transport.tls.config;
+
+		mqtt_sec_tag = mqtt_cfg->sec_tag;
+		c->transport.type = MQTT_TRANSPORT_SECURE;
+		tls->peer_verify = TLS_PEER_VERIFY_REQUIRED;
+		tls->sec_tag_list = &mqtt_sec_tag;
+		tls->sec_tag_count = 1;
+		tls->hostname = mqtt_cfg->host;
+		tls->session_cache = TLS_SESSION_CACHE_ENABLED;
+	}
+#endif
+
+	return 0;
+}
+
+static int mqtt_broker_connect(void)
+{
+	int ret = mqtt_client_setup();
+	if (ret) {
+		return ret;
+	}
+
+	// opens the socket and sends CONNECT
+	ret = mqtt_connect(&mqtt_client_ctx);
+	if (ret) {
+		LOG_ERR("Error connecting to %s: %i", mqtt_cfg->host, ret);
+		return ret;
+	}
+
+	mqtt_open = true;
+	mqtt_ping_sent = false;
+
+	uint32_t start = k_uptime_get_32();
+
+	while (ret == 0 && !mqtt_connected) {
+		if (k_uptime_get_32() - start >= MQTT_TIMEOUT_MS) {
+			ret = -ETIMEDOUT;
+			break;
+		}
+		ret = mqtt_wait_input(MQTT_POLL_MS);
+	}
+
+	if (ret == 0) {
+		ret = mqtt_send_subscribe();
+	}
+
+	if (ret) {
+		LOG_ERR("Error connecting to MQTT broker: %i", ret);
+		mqtt_close();
+		return ret;
+	}
+
+	// the broker does not know about publishes that were not acknowledged
+	// on the last connection, so their points are published again
+	memset(mqtt_ids, 0, sizeof(mqtt_ids));
+	for (int i = 0; i < ARRAY_SIZE(mqtt_point_ids); i++) {
+		if (mqtt_point_ids[i] != 0) {
+			if (!mqtt_any_dirty()) {
+				mqtt_window_ms = k_uptime_get_32();
+			}
+			mqtt_point_ids[i] = 0;
+			mqtt_dirty[i] = true;
+		}
+	}
+
+	stat_connects++;
+	LOG_INF("Connected to MQTT broker %s:%i", mqtt_cfg->host, mqtt_cfg->port);
+
+	return 0;
+}
+
+// ==================================================
+// Publishing
+
+static uint8_t mqtt_tx[CONFIG_SIOT_MQTT_BUF_SIZE];
+
+// the changed points of one type, at most max of them
+struct mqtt_batch {
+	const char *type;
+	int max;
+	int count;
+	// index after the last point in the batch
+	int end;
+};
+
+static bool mqtt_batch_filter(const point *p, int index, void *ctx)
+{
+	struct mqtt_batch *b = ctx;
+
+	if (b->count >= b->max || !mqtt_dirty[index] || strcmp(p->type, b->type) != 0) {
+		return false;
+	}
+
+	b->count++;
+	b->end = index + 1;
+
+	return true;
+}
+
+// publishes the batch as a JSON array on <prefix>/<type>
+static int mqtt_send_publish(struct mqtt_batch *b, uint16_t id)
+{
+	char topic[MQTT_TOPIC_LEN];
+
+	b->count = 0;
+	b->end = 0;
+
+	int topic_len = snprintf(topic, sizeof(topic), "%s/%s", mqtt_cfg->prefix, b->type);
+	if (topic_len >= sizeof(topic)) {
+		return -ENOMEM;
+	}
+
+	int ret = points_json_encode_filter(mqtt_points, ARRAY_SIZE(mqtt_points), mqtt_batch_filter,
+					    b, (char *)mqtt_tx, sizeof(mqtt_tx));
+	if (ret) {
+		return ret;
+	}
+
+	const struct mqtt_publish_param param = {
+		.message.topic =
+			{
+				.topic = {.utf8 = (uint8_t *)topic, .size = topic_len},
+				.qos = id != 0 ? MQTT_QOS_1_AT_LEAST_ONCE : MQTT_QOS_0_AT_MOST_ONCE,
+			},
+		.message.payload = {.data = mqtt_tx, .len = strlen((char *)mqtt_tx)},
+		.message_id = id,
+		.retain_flag = mqtt_cfg->retain,
+	};
+
+	return mqtt_publish(&mqtt_client_ctx, &param);
+}
+
+// publishes the changed points, one publish per type. Returns -EBUSY if
+// CONFIG_SIOT_MQTT_INFLIGHT publishes are waiting for a PUBACK, in which case
+// the rest stay changed.
+static int mqtt_publish_dirty(void)
+{
+	for (int i = 0; i < ARRAY_SIZE(mqtt_points); i++) {
+		if (!mqtt_dirty[i]) {
+			continue;
+		}
+
+		int slot = mqtt_cfg->qos > 0 ? mqtt_id_slot() : 0;
+		if (slot < 0) {
+			return slot;
+		}
+
+		uint16_t id = mqtt_cfg->qos > 0 ? mqtt_next_id() : 0;
+		struct mqtt_batch b = {.type = mqtt_points[i].type, .max = ARRAY_SIZE(mqtt_points)};
+		int ret;
+
+		// send fewer points if they do not fit in the buffer
+		while ((ret = mqtt_send_publish(&b, id)) == -ENOMEM && b.count > 1) {
+			b.max = b.count / 2;
+		}
+
+		if (ret == -ENOMEM) {
+			LOG_ERR("Point does not fit in a publish: %s", mqtt_points[i].type);
+			mqtt_dirty[i] = false;
+			continue;
+		} else if (ret) {
+			return ret;
+		}
+
+		stat_publishes++;
+		stat_points += b.count;
+		if (id != 0) {
+			mqtt_ids[slot] = id;
+		}
+
+		// the points that were in the batch
+		int end = b.end;
+
+		b.count = 0;
+		for (int j = i; j < end; j++) {
+			if (mqtt_batch_filter(&mqtt_points[j], j, &b)) {
+				mqtt_dirty[j] = false;
+				mqtt_point_ids[j] = id;
+			}
+		}
+	}
+
+	return 0;
+}
+
+// ==================================================
+// Thread
+//
+// The thread is started by point_mqtt_init
+
+static void mqtt_thread(void *arg1, void *arg2, void *arg3)
+{
+	// no connects until this time after one failed
+	uint32_t retry_ms = k_uptime_get_32();
+
+	while (true) {
+		uint32_t now = k_uptime_get_32();
+		int ret = 0;
+
+		mqtt_merge_queued();
+
+		// points are merged into the table while there is no connection,
+		// so the latest values are published once it is back
+		if (!mqtt_open && (int32_t)(now - retry_ms) < 0) {
+			k_sleep(K_MSEC(MQTT_POLL_MS));
+			continue;
+		} else if (!mqtt_open) {
+			if (mqtt_broker_connect()) {
+				stat_errors++;
+				retry_ms = now + CONFIG_SIOT_MQTT_RETRY_DELAY * MSEC_PER_SEC;
+				continue;
+			}
+			now = k_uptime_get_32();
+		}
+
+		if (mqtt_any_dirty() && now - mqtt_window_ms >= CONFIG_SIOT_MQTT_WINDOW_MS) {
+			ret = mqtt_publish_dirty();
+			if (ret == -EBUSY) {
+				ret = 0;
+			}
+		}
+
+		// pings keep the connection open when nothing is sent, and check
+		// that the broker is still there when nothing is received
+		uint32_t keepalive_ms = CONFIG_SIOT_MQTT_KEEPALIVE * MSEC_PER_SEC;
+
+		if (ret == 0 && now - mqtt_rx_ms >= keepalive_ms * 3 / 2) {
+			LOG_ERR("MQTT broker stopped answering");
+			ret = -ETIMEDOUT;
+		} else if (ret == 0 && (mqtt_keepalive_time_left(&mqtt_client_ctx) == 0 ||
+					(now - mqtt_rx_ms >= keepalive_ms && !mqtt_ping_sent))) {
+			ret = mqtt_ping(&mqtt_client_ctx);
+			mqtt_ping_sent = true;
+		}
+
+		if (ret == 0) {
+			ret = mqtt_wait_input(MQTT_POLL_MS);
+		}
+
+		if (ret) {
+			LOG_ERR("MQTT connection error: %i", ret);
+			stat_errors++;
+			mqtt_close();
+		}
+	}
+}
+
+K_THREAD_DEFINE(point_mqtt, STACKSIZE, mqtt_thread, NULL, NULL, NULL, PRIORITY, 0,
+		SYS_FOREVER_MS);
+
+int point_mqtt_init(const struct point_mqtt_config *cfg)
+{
+	mqtt_cfg = cfg;
+
+	int ret = zbus_chan_add_obs(&point_chan, &mqtt_lis, K_SECONDS(5));
+	if (ret) {
+		LOG_ERR("Error adding MQTT observer: %i", ret);
+		return ret;
+	}
+
+	k_thread_start(point_mqtt);
+
+	LOG_INF("MQTT to %s:%i, topics %s/<type>", cfg->host, cfg->port, cfg->prefix);
+
+	return 0;
+}
+
+void point_mqtt_stats(struct point_mqtt_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->dropped = atomic_get(&stat_dropped);
+	stats->coalesced = stat_coalesced;
+	stats->publishes = stat_publishes;
+	stats->points = stat_points;
+	stats->acks = stat_acks;
+	stats->inflight = mqtt_inflight();
+	stats->received = stat_received;
+	stats->connects = stat_connects;
+	stats->errors = stat_errors;
+}
+
+static int cmd_mqtt_stats(const struct shell *sh, size_t argc, char **argv)
+{
+	struct point_mqtt_stats s;
+
+	point_mqtt_stats(&s);
+
+	shell_print(sh, "connected: %s", mqtt_connected ? "yes" : "no");
+	shell_print(sh, "connects:  %u", s.connects);
+	shell_print(sh, "errors:    %u", s.errors);
+	shell_print(sh, "publishes: %u", s.publishes);
+	shell_print(sh, "points:    %u", s.points);
+	shell_print(sh, "coalesced: %u", s.coalesced);
+	shell_print(sh, "dropped:   %u", s.dropped);
+	shell_print(sh, "acks:      %u", s.acks);
+	shell_print(sh, "inflight:  %u", s.inflight);
+	shell_print(sh, "received:  %u", s.received);
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(mqtt_cmds, SHELL_CMD(stats, NULL, "MQTT statistics", cmd_mqtt_stats),
+			       SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(mqtt, &mqtt_cmds, "MQTT commands", NULL);
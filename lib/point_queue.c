@@ -0,0 +1,76 @@
+#include <point_queue.h>
+
+#include <errno.h>
+
+// A cell at ring position pos (index = pos & mask) is free for the producer
+// that claimed pos when its relative sequence is the start of the lap
+// (pos - index), and holds a point for the consumer when it is one more than
+// that. The consumer releases the cell for the next lap by advancing it to
+// the start of the next lap. Positions are free running counters, so all
+// arithmetic is done unsigned to let them wrap.
+
+static inline uintptr_t lap(struct point_queue *q, uintptr_t pos)
+{
+	return pos & ~(uintptr_t)q->mask;
+}
+
+// signed distance from b to a, valid across wrap around
+static inline intptr_t seq_diff(uintptr_t a, uintptr_t b)
+{
+	return (intptr_t)(a - b);
+}
+
+int point_queue_put(struct point_queue *q, const point *p)
+{
+	uintptr_t pos = atomic_get(&q->head);
+	struct point_queue_cell *cell;
+
+	while (true) {
+		cell = &q->cells[pos & q->mask];
+		intptr_t diff = seq_diff(atomic_get(&cell->seq), lap(q, pos));
+
+		if (diff == 0) {
+			// cell is free, try to claim this position
+			if (atomic_cas(&q->head, pos, pos + 1)) {
+				break;
+			}
+		} else if (diff < 0) {
+			// the consumer has not released the cell from the previous lap
+			return -ENOSPC;
+		}
+
+		// another producer claimed this position first
+		pos = atomic_get(&q->head);
+	}
+
+	cell->p = *p;
+	atomic_set(&cell->seq, lap(q, pos) + 1);
+
+	return 0;
+}
+
+int point_queue_get(struct point_queue *q, point *p)
+{
+	uintptr_t pos = atomic_get(&q->tail);
+	struct point_queue_cell *cell = &q->cells[pos & q->mask];
+
+	if (seq_diff(atomic_get(&cell->seq), lap(q, pos) + 1) < 0) {
+		// empty, or a producer has claimed the cell but not finished
+		// writing it yet
+		return -EAGAIN;
+	}
+
+	*p = cell->p;
+	atomic_set(&q->tail, pos + 1);
+	atomic_set(&cell->seq, lap(q, pos) + point_queue_size(q));
+
+	return 0;
+}
+
+size_t point_queue_count(struct point_queue *q)
+{
+	uintptr_t head = atomic_get(&q->head);
+	uintptr_t tail = atomic_get(&q->tail);
+
+	return head - tail;
+}
@@ -0,0 +1,290 @@
+#include <point.h>
+#include <point_frame.h>
+#include <point_serial.h>
+
+#include <errno.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/ring_buffer.h>
+#include <zephyr/zbus/zbus.h>
+
+#define STACKSIZE 1536
+#define PRIORITY  7
+
+LOG_MODULE_REGISTER(point_serial, LOG_LEVEL_INF);
+
+ZBUS_CHAN_DECLARE(point_chan);
+
+static const struct device *serial_dev;
+static point_filter serial_tx_filter;
+static void *serial_tx_ctx;
+
+static struct point_serial_stats serial_stats;
+
+// ==================================================
+// UART callback
+//
+// The UART receives into two DMA buffers, swapping to the other one when a
+// buffer fills. Received bytes are copied to a ring buffer so the DMA buffers
+// are free again before the next swap, and frames are decoded in the RX
+// thread.
+
+static uint8_t rx_dma[2][CONFIG_SIOT_SERIAL_RX_BUF_SIZE];
+static int rx_dma_next;
+
+RING_BUF_DECLARE(rx_ring, CONFIG_SIOT_SERIAL_RX_RING_SIZE);
+static struct k_spinlock rx_ring_lock;
+K_SEM_DEFINE(rx_sem, 0, 1);
+
+// one frame can be sent at a time
+K_SEM_DEFINE(tx_done, 1, 1);
+
+static int point_serial_rx_enable(const struct device *dev)
+{
+	rx_dma_next = 1;
+	return uart_rx_enable(dev, rx_dma[0], sizeof(rx_dma[0]), CONFIG_SIOT_SERIAL_RX_TIMEOUT_US);
+}
+
+static void point_serial_uart_cb(const struct device *dev, struct uart_event *evt, void *user_data)
+{
+	switch (evt->type) {
+	case UART_RX_RDY: {
+		k_spinlock_key_t key = k_spin_lock(&rx_ring_lock);
+		uint32_t n = ring_buf_put(&rx_ring, evt->data.rx.buf + evt->data.rx.offset,
+					  evt->data.rx.len);
+		k_spin_unlock(&rx_ring_lock, key);
+
+		serial_stats.rx_dropped += evt->data.rx.len - n;
+		k_sem_give(&rx_sem);
+		break;
+	}
+	case UART_RX_BUF_REQUEST:
+		uart_rx_buf_rsp(dev, rx_dma[rx_dma_next], sizeof(rx_dma[0]));
+		rx_dma_next ^= 1;
+		break;
+	case UART_RX_DISABLED:
+		// stopped by a line error, or because no buffer was provided
+		point_serial_rx_enable(dev);
+		break;
+	case UART_TX_DONE:
+	case UART_TX_ABORTED:
+		k_sem_give(&tx_done);
+		break;
+	default:
+		break;
+	}
+}
+
+// ==================================================
+// Threads
+//
+// The threads are started by point_serial_init
+
+static struct point_frame_rx frame_rx;
+
+static void point_serial_rx_frame(const uint8_t *data, size_t len, void *ctx)
+{
+	size_t offset = 0;
+	point p;
+
+	while (offset < len) {
+		int ret = point_bin_decode(data + offset, len - offset, &p);
+		if (ret < 0) {
+			LOG_ERR("Error decoding serial point: %i", ret);
+			return;
+		}
+		offset += ret;
+
+		serial_stats.rx_points++;
+		zbus_chan_pub(&point_chan, &p, K_MSEC(500));
+	}
+}
+
+static void point_serial_rx_thread(void *arg1, void *arg2, void *arg3)
+{
+	uint8_t buf[64];
+
+	while (!k_sem_take(&rx_sem, K_FOREVER)) {
+		while (true) {
+			k_spinlock_key_t key = k_spin_lock(&rx_ring_lock);
+			uint32_t n = ring_buf_get(&rx_ring, buf, sizeof(buf));
+			k_spin_unlock(&rx_ring_lock, key);
+
+			if (n == 0) {
+				break;
+			}
+
+			point_frame_rx_feed(&frame_rx, buf, n, point_serial_rx_frame, NULL);
+		}
+
+		serial_stats.rx_frames = frame_rx.frames;
+		serial_stats.rx_errors = frame_rx.errors;
+	}
+}
+
+K_THREAD_DEFINE(point_serial_rx, STACKSIZE, point_serial_rx_thread, NULL, NULL, NULL, PRIORITY, 0,
+		SYS_FOREVER_MS);
+
+ZBUS_MSG_SUBSCRIBER_DEFINE(point_serial_sub);
+
+// points waiting to be sent
+static uint8_t tx_data[POINT_FRAME_DATA_LEN];
+static size_t tx_data_len;
+static int tx_data_points;
+
+// a frame is encoded in one buffer while the other one is sent
+static uint8_t tx_frame[2][POINT_FRAME_LEN];
+static int tx_frame_next;
+
+static void point_serial_flush(void)
+{
+	uint8_t *frame = tx_frame[tx_frame_next];
+
+	if (tx_data_len == 0) {
+		return;
+	}
+
+	int n = point_frame_encode(tx_data, tx_data_len, frame, sizeof(tx_frame[0]));
+	int points = tx_data_points;
+
+	tx_data_len = 0;
+	tx_data_points = 0;
+	if (n < 0) {
+		LOG_ERR("Error encoding serial frame: %i", n);
+		return;
+	}
+
+	k_sem_take(&tx_done, K_FOREVER);
+
+	int ret = uart_tx(serial_dev, frame, n, SYS_FOREVER_US);
+	if (ret) {
+		LOG_ERR("Error sending serial frame: %i", ret);
+		k_sem_give(&tx_done);
+		return;
+	}
+
+	tx_frame_next ^= 1;
+	serial_stats.tx_frames++;
+	serial_stats.tx_points += points;
+	serial_stats.tx_bytes += n;
+}
+
+static void point_serial_queue(point *p)
+{
+	int n = point_bin_encode(p, tx_data + tx_data_len, sizeof(tx_data) - tx_data_len);
+	if (n == -ENOMEM) {
+		point_serial_flush();
+		n = point_bin_encode(p, tx_data, sizeof(tx_data));
+	}
+
+	if (n == -ENOTSUP) {
+		// no binary encoding for the data type
+		return;
+	} else if (n < 0) {
+		LOG_ERR("Error encoding %s.%s for serial: %i", p->type, p->key, n);
+		return;
+	}
+
+	tx_data_len += n;
+	tx_data_points++;
+}
+
+// Points are added to the frame until no more are waiting, then the frame is
+// sent. Sending waits for the previous frame to finish, and points that are
+// published meanwhile go in the next frame.
+static void point_serial_tx_thread(void *arg1, void *arg2, void *arg3)
+{
+	const struct zbus_channel *chan;
+	point p;
+
+	while (true) {
+		int ret = zbus_sub_wait_msg(&point_serial_sub, &chan, &p,
+					    tx_data_len > 0 ? K_NO_WAIT : K_FOREVER);
+		if (ret) {
+			point_serial_flush();
+			continue;
+		}
+
+		if (chan != &point_chan) {
+			continue;
+		}
+
+		if (serial_tx_filter != NULL && !serial_tx_filter(&p, 0, serial_tx_ctx)) {
+			continue;
+		}
+
+		point_serial_queue(&p);
+	}
+}
+
+K_THREAD_DEFINE(point_serial_tx, STACKSIZE, point_serial_tx_thread, NULL, NULL, NULL, PRIORITY, 0,
+		SYS_FOREVER_MS);
+
+int point_serial_init(const struct device *dev, point_filter tx_filter, void *ctx)
+{
+	int ret;
+
+	if (!device_is_ready(dev)) {
+		LOG_ERR("Serial device %s is not ready", dev->name);
+		return -ENODEV;
+	}
+
+	serial_dev = dev;
+	serial_tx_filter = tx_filter;
+	serial_tx_ctx = ctx;
+
+	ret = uart_callback_set(dev, point_serial_uart_cb, NULL);
+	if (ret) {
+		LOG_ERR("Error setting UART callback, is the async API supported? %i", ret);
+		return ret;
+	}
+
+	ret = point_serial_rx_enable(dev);
+	if (ret) {
+		LOG_ERR("Error enabling UART receive: %i", ret);
+		return ret;
+	}
+
+	ret = zbus_chan_add_obs(&point_chan, &point_serial_sub, K_SECONDS(5));
+	if (ret) {
+		LOG_ERR("Error adding serial observer: %i", ret);
+		return ret;
+	}
+
+	k_thread_start(point_serial_rx);
+	k_thread_start(point_serial_tx);
+
+	LOG_INF("Serial points on %s", dev->name);
+
+	return 0;
+}
+
+void point_serial_stats(struct point_serial_stats *stats)
+{
+	*stats = serial_stats;
+}
+
+static int cmd_serial_stats(const struct shell *sh, size_t argc, char **argv)
+{
+	struct point_serial_stats s;
+
+	point_serial_stats(&s);
+
+	shell_print(sh, "rx frames:   %u", s.rx_frames);
+	shell_print(sh, "rx errors:   %u", s.rx_errors);
+	shell_print(sh, "rx points:   %u", s.rx_points);
+	shell_print(sh, "rx dropped:  %u", s.rx_dropped);
+	shell_print(sh, "tx frames:   %u", s.tx_frames);
+	shell_print(sh, "tx points:   %u", s.tx_points);
+	shell_print(sh, "tx bytes:    %u", s.tx_bytes);
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(serial_cmds,
+			       SHELL_CMD(stats, NULL, "Serial link statistics", cmd_serial_stats),
+			       SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(serial, &serial_cmds, "Serial point link commands", NULL);
@@ -1,5 +1,18 @@
 #include <siot-string.h>
 
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+// stdlib.h can't be included as it conflicts with atof and atoi below
+float strtof(const char *str, char **endptr);
+
 void ftoa(float num, char *str, int precision)
 {
 	int i = 0;
@@ -86,6 +99,11 @@ char *itoa(int num, char *str, int base)
 	int i = 0;
 	int isNegative = 0;
 
+	if (base == 10) {
+		itoa_i32(num, str, ITOA_I32_LEN);
+		return str;
+	}
+
 	// Handle 0 explicitly
 	if (num == 0) {
 		str[i++] = '0';
@@ -119,64 +137,933 @@ char *itoa(int num, char *str, int base)
 	return str;
 }
 
+// length of the number at the start of str, in the form accepted by
+// parse_float
+static size_t number_prefix_len(const char *str)
+{
+	const char *s = str;
+
+	if (*s == '-' || *s == '+') {
+		s++;
+	}
+	while (*s >= '0' && *s <= '9') {
+		s++;
+	}
+	if (*s == '.') {
+		s++;
+		while (*s >= '0' && *s <= '9') {
+			s++;
+		}
+	}
+	if (*s == 'e' || *s == 'E') {
+		const char *e = s + 1;
+		if (*e == '-' || *e == '+') {
+			e++;
+		}
+		if (*e >= '0' && *e <= '9') {
+			s = e;
+			while (*s >= '0' && *s <= '9') {
+				s++;
+			}
+		}
+	}
+
+	return s - str;
+}
+
+// converts the number at the start of str, ignoring anything after it
 int atoi(const char *str)
 {
-	int result = 0;
-	int sign = 1;
-	int i = 0;
+	size_t len = 0;
+	int32_t v = 0;
 
-	// Handle negative numbers
-	if (str[0] == '-') {
-		sign = -1;
-		i++;
+	if (str[0] == '-' || str[0] == '+') {
+		len++;
+	}
+	while (str[len] >= '0' && str[len] <= '9') {
+		len++;
 	}
 
-	// Convert each digit
-	while (str[i] != '\0') {
-		if (str[i] >= '0' && str[i] <= '9') {
-			result = result * 10 + (str[i] - '0');
-		} else {
-			break; // Stop at non-digit character
+	parse_int(str, len, &v);
+
+	return v;
+}
+
+// converts the number at the start of str, ignoring anything after it
+float atof(const char *str)
+{
+	float v = 0;
+
+	parse_float(str, number_prefix_len(str), &v);
+
+	return v;
+}
+
+// ==================================================
+// Integer formatting
+
+// Digits are written two at a time from a table, back to front from the end
+// of the number, which is found first from its bit length. Numbers are split
+// into groups of 4 digits, and each group is split into pairs with a multiply
+// and shift, so a 10 digit number needs 2 divides. This matters on parts like
+// the Cortex-M0 where every divide is a library call.
+
+static const char digit_pairs[200] = "00010203040506070809"
+				     "10111213141516171819"
+				     "20212223242526272829"
+				     "30313233343536373839"
+				     "40414243444546474849"
+				     "50515253545556575859"
+				     "60616263646566676869"
+				     "70717273747576777879"
+				     "80818283848586878889"
+				     "90919293949596979899";
+
+static const uint64_t itoa_pow10[] = {
+	1ull,
+	10ull,
+	100ull,
+	1000ull,
+	10000ull,
+	100000ull,
+	1000000ull,
+	10000000ull,
+	100000000ull,
+	1000000000ull,
+	10000000000ull,
+	100000000000ull,
+	1000000000000ull,
+	10000000000000ull,
+	100000000000000ull,
+	1000000000000000ull,
+	10000000000000000ull,
+	100000000000000000ull,
+	1000000000000000000ull,
+	10000000000000000000ull,
+};
+
+static int count_digits_u32(uint32_t v)
+{
+	// 1233 / 4096 is just over log10(2), so t is the number of digits or one
+	// more than it. v | 1 has the same number of digits as v, and is not 0.
+	v |= 1;
+	int t = ((32 - __builtin_clz(v)) * 1233) >> 12;
+
+	return t + 1 - (v < itoa_pow10[t]);
+}
+
+static int count_digits_u64(uint64_t v)
+{
+	v |= 1;
+	int t = ((64 - __builtin_clzll(v)) * 1233) >> 12;
+
+	return t + 1 - (v < itoa_pow10[t]);
+}
+
+// v / 100 for v < 43699
+static inline uint32_t div100(uint32_t v)
+{
+	return (v * 5243) >> 19;
+}
+
+// writes the 4 digits of v < 10000, with leading zeros
+static inline void write_4_digits(char *s, uint32_t v)
+{
+	uint32_t hi = div100(v);
+
+	memcpy(s, &digit_pairs[hi * 2], 2);
+	memcpy(s + 2, &digit_pairs[(v - hi * 100) * 2], 2);
+}
+
+// writes the digits of v so the last one is just before end
+static void write_u32(char *end, uint32_t v)
+{
+	while (v >= 10000) {
+		uint32_t q = v / 10000;
+		end -= 4;
+		write_4_digits(end, v - q * 10000);
+		v = q;
+	}
+
+	if (v >= 100) {
+		uint32_t q = div100(v);
+		end -= 2;
+		memcpy(end, &digit_pairs[(v - q * 100) * 2], 2);
+		v = q;
+	}
+
+	if (v >= 10) {
+		memcpy(end - 2, &digit_pairs[v * 2], 2);
+	} else {
+		end[-1] = '0' + v;
+	}
+}
+
+static void write_u64(char *end, uint64_t v)
+{
+	// peel off 8 digits at a time with 64 bit divides until the rest fits in
+	// 32 bits, at most twice
+	while (v > UINT32_MAX) {
+		uint64_t q = v / 100000000;
+		uint32_t r = v - q * 100000000;
+		uint32_t r_hi = r / 10000;
+
+		end -= 8;
+		write_4_digits(end, r_hi);
+		write_4_digits(end + 4, r - r_hi * 10000);
+		v = q;
+	}
+
+	write_u32(end, v);
+}
+
+int itoa_i32(int32_t num, char *str, size_t len)
+{
+	bool neg = num < 0;
+	uint32_t v = neg ? 0 - (uint32_t)num : num;
+	int n = neg + count_digits_u32(v);
+
+	if (n + 1 > len) {
+		return -ENOMEM;
+	}
+
+	if (neg) {
+		str[0] = '-';
+	}
+	write_u32(str + n, v);
+	str[n] = 0;
+
+	return n;
+}
+
+int itoa_i64(int64_t num, char *str, size_t len)
+{
+	bool neg = num < 0;
+	uint64_t v = neg ? 0 - (uint64_t)num : num;
+	int n = neg + count_digits_u64(v);
+
+	if (n + 1 > len) {
+		return -ENOMEM;
+	}
+
+	if (neg) {
+		str[0] = '-';
+	}
+	write_u64(str + n, v);
+	str[n] = 0;
+
+	return n;
+}
+
+int itoa_u64(uint64_t num, char *str, size_t len)
+{
+	int n = count_digits_u64(num);
+
+	if (n + 1 > len) {
+		return -ENOMEM;
+	}
+
+	write_u64(str + n, num);
+	str[n] = 0;
+
+	return n;
+}
+
+// ==================================================
+// Shortest float formatting
+//
+// This is the Ryu algorithm (Ulf Adams, "Ryu: fast float-to-string
+// conversion", PLDI 2018) for 32 bit floats. It finds the shortest decimal
+// that parses back to the same float using only integer math, and when there
+// are several, the one closest to the exact value.
+
+#define FTOA_MANTISSA_BITS       23
+#define FTOA_BIAS                127
+#define FTOA_POW5_INV_BITCOUNT   59
+#define FTOA_POW5_BITCOUNT       61
+
+// ceil(log2(5^e)) for e > 0
+static inline int32_t ftoa_pow5bits(int32_t e)
+{
+	return (int32_t)(((uint32_t)e * 1217359) >> 19) + 1;
+}
+
+// floor(log10(2^e))
+static inline uint32_t ftoa_log10_pow2(int32_t e)
+{
+	return ((uint32_t)e * 78913) >> 18;
+}
+
+// floor(log10(5^e))
+static inline uint32_t ftoa_log10_pow5(int32_t e)
+{
+	return ((uint32_t)e * 732923) >> 20;
+}
+
+#ifdef CONFIG_SIOT_STRING_FTOA_COMPACT
+
+// Table entries are computed when needed instead of being stored, using
+// 160 bit integers stored as 32 bit words, least significant first.
+#define FTOA_WORDS 5
+
+// returns the 64 bits of w starting at bit shift
+static uint64_t ftoa_bits(const uint32_t *w, int shift)
+{
+	int ws = shift / 32;
+	int bs = shift % 32;
+	uint64_t r = 0;
+
+	for (int b = 0; b < 2; b++) {
+		uint32_t v = w[ws + b] >> bs;
+		if (bs != 0 && ws + b + 1 < FTOA_WORDS) {
+			v |= w[ws + b + 1] << (32 - bs);
 		}
-		i++;
+		r |= (uint64_t)v << (32 * b);
 	}
 
-	return sign * result;
+	return r;
 }
 
-float atof(const char *str)
+// floor(2^(pow5bits(q) - 1 + FTOA_POW5_INV_BITCOUNT) / 5^q) + 1
+static uint64_t ftoa_pow5_inv_split(uint32_t q)
+{
+	uint32_t w[FTOA_WORDS] = {0};
+	int n = ftoa_pow5bits(q) - 1 + FTOA_POW5_INV_BITCOUNT;
+
+	w[n / 32] = 1u << (n % 32);
+
+	// repeated floor division by 5 is the same as floor division by 5^q
+	for (uint32_t j = 0; j < q; j++) {
+		uint32_t rem = 0;
+		for (int k = FTOA_WORDS - 1; k >= 0; k--) {
+			uint64_t cur = ((uint64_t)rem << 32) | w[k];
+			w[k] = cur / 5;
+			rem = cur % 5;
+		}
+	}
+
+	return ftoa_bits(w, 0) + 1;
+}
+
+// 5^i scaled to FTOA_POW5_BITCOUNT bits
+static uint64_t ftoa_pow5_split(uint32_t i)
+{
+	uint32_t w[FTOA_WORDS] = {1};
+	int shift = ftoa_pow5bits(i) - FTOA_POW5_BITCOUNT;
+
+	for (uint32_t j = 0; j < i; j++) {
+		uint32_t carry = 0;
+		for (int k = 0; k < FTOA_WORDS; k++) {
+			uint64_t cur = (uint64_t)w[k] * 5 + carry;
+			w[k] = (uint32_t)cur;
+			carry = cur >> 32;
+		}
+	}
+
+	if (shift < 0) {
+		return ftoa_bits(w, 0) << -shift;
+	}
+
+	return ftoa_bits(w, shift);
+}
+
+#else
+
+// FTOA_POW5_INV_SPLIT[q] = floor(2^(pow5bits(q) - 1 + FTOA_POW5_INV_BITCOUNT) / 5^q) + 1
+// FTOA_POW5_SPLIT[i] = 5^i scaled to FTOA_POW5_BITCOUNT bits
+static const uint64_t FTOA_POW5_INV_SPLIT[32] = {
+	0x0800000000000001u, 0x0666666666666667u, 0x051eb851eb851eb9u, 0x04189374bc6a7efau,
+	0x068db8bac710cb2au, 0x053e2d6238da3c22u, 0x0431bde82d7b634eu, 0x06b5fca6af2bd216u,
+	0x055e63b88c230e78u, 0x044b82fa09b5a52du, 0x06df37f675ef6eaeu, 0x057f5ff85e592558u,
+	0x0465e6604b7a8447u, 0x0709709a125da071u, 0x05a126e1a84ae6c1u, 0x0480ebe7b9d58567u,
+	0x0734aca5f6226f0bu, 0x05c3bd5191b525a3u, 0x049c97747490eae9u, 0x0760f253edb4ab0eu,
+	0x05e72843249088d8u, 0x04b8ed0283a6d3e0u, 0x078e480405d7b966u, 0x060b6cd004ac9452u,
+	0x04d5f0a66a23a9dbu, 0x07bcb43d769f762bu, 0x063090312bb2c4efu, 0x04f3a68dbc8f03f3u,
+	0x07ec3daf94180651u, 0x065697bfa9acd1dau, 0x051212ffbaf0a7e2u, 0x040e7599625a1fe8u,
+};
+
+static const uint64_t FTOA_POW5_SPLIT[48] = {
+	0x1000000000000000u, 0x1400000000000000u, 0x1900000000000000u, 0x1f40000000000000u,
+	0x1388000000000000u, 0x186a000000000000u, 0x1e84800000000000u, 0x1312d00000000000u,
+	0x17d7840000000000u, 0x1dcd650000000000u, 0x12a05f2000000000u, 0x174876e800000000u,
+	0x1d1a94a200000000u, 0x12309ce540000000u, 0x16bcc41e90000000u, 0x1c6bf52634000000u,
+	0x11c37937e0800000u, 0x16345785d8a00000u, 0x1bc16d674ec80000u, 0x1158e460913d0000u,
+	0x15af1d78b58c4000u, 0x1b1ae4d6e2ef5000u, 0x10f0cf064dd59200u, 0x152d02c7e14af680u,
+	0x1a784379d99db420u, 0x108b2a2c28029094u, 0x14adf4b7320334b9u, 0x19d971e4fe8401e7u,
+	0x1027e72f1f128130u, 0x1431e0fae6d7217cu, 0x193e5939a08ce9dbu, 0x1f8def8808b02452u,
+	0x13b8b5b5056e16b3u, 0x18a6e32246c99c60u, 0x1ed09bead87c0378u, 0x13426172c74d822bu,
+	0x1812f9cf7920e2b6u, 0x1e17b84357691b64u, 0x12ced32a16a1b11eu, 0x178287f49c4a1d66u,
+	0x1d6329f1c35ca4bfu, 0x125dfa371a19e6f7u, 0x16f578c4e0a060b5u, 0x1cb2d6f618c878e3u,
+	0x11efc659cf7d4b8du, 0x166bb7f0435c9e71u, 0x1c06a5ec5433c60du, 0x118427b3b4a05bc8u,
+};
+static inline uint64_t ftoa_pow5_inv_split(uint32_t q)
+{
+	return FTOA_POW5_INV_SPLIT[q];
+}
+
+static inline uint64_t ftoa_pow5_split(uint32_t i)
+{
+	return FTOA_POW5_SPLIT[i];
+}
+
+#endif
+
+static inline uint32_t ftoa_pow5_factor(uint32_t value)
+{
+	uint32_t count = 0;
+
+	while (value % 5 == 0) {
+		value /= 5;
+		count++;
+	}
+
+	return count;
+}
+
+static inline bool ftoa_multiple_of_pow5(uint32_t value, uint32_t p)
+{
+	return ftoa_pow5_factor(value) >= p;
+}
+
+static inline bool ftoa_multiple_of_pow2(uint32_t value, uint32_t p)
+{
+	return (value & ((1u << p) - 1)) == 0;
+}
+
+// (m * factor) >> shift, shift must be > 32
+static inline uint32_t ftoa_mul_shift(uint32_t m, uint64_t factor, int32_t shift)
+{
+	uint64_t bits0 = (uint64_t)m * (uint32_t)factor;
+	uint64_t bits1 = (uint64_t)m * (uint32_t)(factor >> 32);
+	uint64_t sum = (bits0 >> 32) + bits1;
+
+	return (uint32_t)(sum >> (shift - 32));
+}
+
+// converts a finite, non-zero float to the shortest decimal mantissa * 10^exponent
+static void ftoa_decimal(uint32_t ieee_mantissa, uint32_t ieee_exponent, uint32_t *mantissa,
+			 int32_t *exponent)
+{
+	int32_t e2;
+	uint32_t m2;
+
+	if (ieee_exponent == 0) {
+		e2 = 1 - FTOA_BIAS - FTOA_MANTISSA_BITS - 2;
+		m2 = ieee_mantissa;
+	} else {
+		e2 = (int32_t)ieee_exponent - FTOA_BIAS - FTOA_MANTISSA_BITS - 2;
+		m2 = (1u << FTOA_MANTISSA_BITS) | ieee_mantissa;
+	}
+
+	// round to even: the interval bounds are included if the mantissa is even
+	bool accept_bounds = (m2 & 1) == 0;
+
+	// the value and the halfway points to its neighbors, times 4
+	uint32_t mv = 4 * m2;
+	uint32_t mp = 4 * m2 + 2;
+	uint32_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+	uint32_t mm = 4 * m2 - 1 - mm_shift;
+
+	uint32_t vr, vp, vm;
+	int32_t e10;
+	bool vm_trailing_zeros = false;
+	bool vr_trailing_zeros = false;
+	uint8_t last_removed_digit = 0;
+
+	// convert the interval to base 10
+	if (e2 >= 0) {
+		uint32_t q = ftoa_log10_pow2(e2);
+		int32_t k = FTOA_POW5_INV_BITCOUNT + ftoa_pow5bits(q) - 1;
+		int32_t i = -e2 + (int32_t)q + k;
+		uint64_t factor = ftoa_pow5_inv_split(q);
+
+		e10 = q;
+		vr = ftoa_mul_shift(mv, factor, i);
+		vp = ftoa_mul_shift(mp, factor, i);
+		vm = ftoa_mul_shift(mm, factor, i);
+
+		if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+			// one more digit is removed below than is computed here, so
+			// compute the last removed digit separately
+			int32_t l = FTOA_POW5_INV_BITCOUNT + ftoa_pow5bits(q - 1) - 1;
+			last_removed_digit =
+				ftoa_mul_shift(mv, ftoa_pow5_inv_split(q - 1), -e2 + (int32_t)q - 1 + l) %
+				10;
+		}
+
+		if (q <= 9) {
+			// only one of mp, mv, and mm can be a multiple of 5
+			if (mv % 5 == 0) {
+				vr_trailing_zeros = ftoa_multiple_of_pow5(mv, q);
+			} else if (accept_bounds) {
+				vm_trailing_zeros = ftoa_multiple_of_pow5(mm, q);
+			} else {
+				vp -= ftoa_multiple_of_pow5(mp, q);
+			}
+		}
+	} else {
+		uint32_t q = ftoa_log10_pow5(-e2);
+		int32_t i = -e2 - (int32_t)q;
+		int32_t k = ftoa_pow5bits(i) - FTOA_POW5_BITCOUNT;
+		int32_t j = (int32_t)q - k;
+		uint64_t factor = ftoa_pow5_split(i);
+
+		e10 = (int32_t)q + e2;
+		vr = ftoa_mul_shift(mv, factor, j);
+		vp = ftoa_mul_shift(mp, factor, j);
+		vm = ftoa_mul_shift(mm, factor, j);
+
+		if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+			j = (int32_t)q - 1 - (ftoa_pow5bits(i + 1) - FTOA_POW5_BITCOUNT);
+			last_removed_digit = ftoa_mul_shift(mv, ftoa_pow5_split(i + 1), j) % 10;
+		}
+
+		if (q <= 1) {
+			// mv has at least q trailing 0 bits, so vr has q trailing zeros
+			vr_trailing_zeros = true;
+			if (accept_bounds) {
+				vm_trailing_zeros = mm_shift == 1;
+			} else {
+				vp--;
+			}
+		} else if (q < 31) {
+			vr_trailing_zeros = ftoa_multiple_of_pow2(mv, q - 1);
+		}
+	}
+
+	// remove digits while the interval still contains a shorter number
+	int32_t removed = 0;
+	uint32_t output;
+
+	if (vm_trailing_zeros || vr_trailing_zeros) {
+		// rare, the general case is below
+		while (vp / 10 > vm / 10) {
+			vm_trailing_zeros &= vm % 10 == 0;
+			vr_trailing_zeros &= last_removed_digit == 0;
+			last_removed_digit = vr % 10;
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			removed++;
+		}
+
+		if (vm_trailing_zeros) {
+			while (vm % 10 == 0) {
+				vr_trailing_zeros &= last_removed_digit == 0;
+				last_removed_digit = vr % 10;
+				vr /= 10;
+				vp /= 10;
+				vm /= 10;
+				removed++;
+			}
+		}
+
+		if (vr_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0) {
+			// round even if exactly halfway
+			last_removed_digit = 4;
+		}
+
+		output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) ||
+			       last_removed_digit >= 5);
+	} else {
+		while (vp / 10 > vm / 10) {
+			last_removed_digit = vr % 10;
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			removed++;
+		}
+
+		output = vr + (vr == vm || last_removed_digit >= 5);
+	}
+
+	*mantissa = output;
+	*exponent = e10 + removed;
+}
+
+static inline int ftoa_digit_count(uint32_t v)
 {
-	float result = 0.0f;
-	float fraction = 0.1f;
-	int sign = 1;
+	int n = 1;
+
+	while (v >= 10) {
+		v /= 10;
+		n++;
+	}
+
+	return n;
+}
+
+int ftoa_shortest(float num, char *str, size_t len)
+{
+	union {
+		float f;
+		uint32_t u;
+	} bits = {.f = num};
+
+	bool sign = bits.u >> 31;
+	uint32_t ieee_mantissa = bits.u & ((1u << FTOA_MANTISSA_BITS) - 1);
+	uint32_t ieee_exponent = (bits.u >> FTOA_MANTISSA_BITS) & 0xff;
+	char tmp[FTOA_SHORTEST_LEN];
 	int i = 0;
-	int in_fraction = 0;
 
-	// Handle negative numbers
-	if (str[0] == '-') {
-		sign = -1;
-		i++;
+	if (sign) {
+		tmp[i++] = '-';
 	}
 
-	// Convert digits
-	while (str[i] != '\0') {
-		if (str[i] >= '0' && str[i] <= '9') {
-			if (!in_fraction) {
-				result = result * 10.0f + (str[i] - '0');
+	if (ieee_exponent == 0xff) {
+		// names accepted by strtof and by Go's strconv.ParseFloat
+		if (ieee_mantissa != 0) {
+			i = 0;
+			memcpy(tmp, "NaN", 3);
+		} else {
+			memcpy(tmp + i, "Inf", 3);
+		}
+		i += 3;
+	} else if (ieee_exponent == 0 && ieee_mantissa == 0) {
+		tmp[i++] = '0';
+	} else {
+		uint32_t mantissa;
+		int32_t exponent;
+
+		ftoa_decimal(ieee_mantissa, ieee_exponent, &mantissa, &exponent);
+
+		int n = ftoa_digit_count(mantissa);
+		// number of digits before the decimal point
+		int point = n + exponent;
+
+		if (point >= -3 && point <= 9) {
+			// fixed notation, e.g. 0.00123, 1.5, 1200
+			char *digits;
+
+			if (point <= 0) {
+				tmp[i++] = '0';
+				tmp[i++] = '.';
+				for (int z = 0; z < -point; z++) {
+					tmp[i++] = '0';
+				}
+				digits = tmp + i;
+				i += n;
+			} else if (point < n) {
+				digits = tmp + i;
+				i += n + 1;
 			} else {
-				result += (str[i] - '0') * fraction;
-				fraction *= 0.1f;
+				digits = tmp + i;
+				i += point;
+				memset(tmp + i - (point - n), '0', point - n);
+			}
+
+			for (int d = n - 1; d >= 0; d--) {
+				// leave a gap for the decimal point
+				digits[d + (point > 0 && d >= point)] = '0' + mantissa % 10;
+				mantissa /= 10;
+			}
+
+			if (point > 0 && point < n) {
+				digits[point] = '.';
+			}
+		} else {
+			// scientific notation, e.g. 1.5e-7, 3e12
+			char *digits = tmp + i;
+
+			i += n + (n > 1);
+			for (int d = n - 1; d > 0; d--) {
+				digits[d + 1] = '0' + mantissa % 10;
+				mantissa /= 10;
+			}
+			digits[0] = '0' + mantissa;
+			if (n > 1) {
+				digits[1] = '.';
 			}
-		} else if (str[i] == '.') {
-			if (in_fraction) {
-				break; // Multiple decimal points, invalid
+
+			int e = point - 1;
+			tmp[i++] = 'e';
+			if (e < 0) {
+				tmp[i++] = '-';
+				e = -e;
+			}
+			if (e >= 10) {
+				tmp[i++] = '0' + e / 10;
+			}
+			tmp[i++] = '0' + e % 10;
+		}
+	}
+
+	if (i + 1 > len) {
+		return -ENOMEM;
+	}
+
+	memcpy(str, tmp, i);
+	str[i] = 0;
+
+	return i;
+}
+
+// ==================================================
+// Number parsing
+
+// SWAR (SIMD within a register) digit parsing: 4 ASCII digits are checked and
+// converted at once in a 32 bit word, which suits 32 bit MCUs.
+
+// returns true if all 4 bytes of v are '0' to '9'
+static inline bool swar_is_4_digits(uint32_t v)
+{
+	return (((v + 0x46464646) | (v - 0x30303030)) & 0x80808080) == 0;
+}
+
+// converts 4 digits loaded little endian (first digit in the low byte)
+static inline uint32_t swar_parse_4_digits(uint32_t v)
+{
+	v -= 0x30303030;
+	// combine digit pairs: byte 0 = d0 * 10 + d1, byte 2 = d2 * 10 + d3
+	v = v * 10 + (v >> 8);
+	return (v & 0xff) * 100 + ((v >> 16) & 0xff);
+}
+
+// accumulates decimal digits from s into *v until a non-digit or end, and
+// returns the number of digits consumed. Digits past the capacity of *v must
+// be limited by the caller.
+static size_t parse_digits(const char *s, const char *end, uint64_t *v)
+{
+	const char *start = s;
+
+	while (end - s >= 4) {
+		uint32_t chunk = sys_get_le32((const uint8_t *)s);
+		if (!swar_is_4_digits(chunk)) {
+			break;
+		}
+		*v = *v * 10000 + swar_parse_4_digits(chunk);
+		s += 4;
+	}
+
+	while (s < end && *s >= '0' && *s <= '9') {
+		*v = *v * 10 + (*s - '0');
+		s++;
+	}
+
+	return s - start;
+}
+
+int parse_int(const char *str, size_t len, int32_t *out)
+{
+	const char *s = str;
+	const char *end = str + len;
+	bool neg = false;
+	uint64_t v = 0;
+
+	if (s < end && (*s == '-' || *s == '+')) {
+		neg = *s == '-';
+		s++;
+	}
+
+	while (end - s > 1 && *s == '0') {
+		s++;
+	}
+
+	// 10 digits always fit in 64 bits, more can't fit in 32
+	size_t n = parse_digits(s, MIN(end, s + 10), &v);
+
+	if (n == 0) {
+		return -EINVAL;
+	}
+
+	s += n;
+	bool overflow = v > (uint64_t)INT32_MAX + neg;
+
+	while (s < end && *s >= '0' && *s <= '9') {
+		overflow = true;
+		s++;
+	}
+
+	if (s != end) {
+		return -EINVAL;
+	}
+
+	if (overflow) {
+		*out = neg ? INT32_MIN : INT32_MAX;
+		return -ERANGE;
+	}
+
+	*out = neg ? (int32_t)(0 - v) : (int32_t)v;
+
+	return 0;
+}
+
+// exact powers of 10 for the fast paths
+static const float parse_pow10f[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+				     1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+static const double parse_pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+				     1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+				     1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// for numbers the fast paths can't round correctly
+static int parse_float_slow(const char *str, size_t len, float *out)
+{
+	char buf[64];
+	char *end;
+
+	if (len >= sizeof(buf)) {
+		return -EINVAL;
+	}
+
+	memcpy(buf, str, len);
+	buf[len] = 0;
+	*out = strtof(buf, &end);
+
+	return end == buf + len ? 0 : -EINVAL;
+}
+
+static bool parse_match(const char *s, const char *end, const char *word)
+{
+	size_t len = strlen(word);
+
+	return (size_t)(end - s) == len && strncasecmp(s, word, len) == 0;
+}
+
+int parse_float(const char *str, size_t len, float *out)
+{
+	const char *s = str;
+	const char *end = str + len;
+	bool neg = false;
+	uint64_t mantissa = 0;
+	// number of significant digits, and the decimal exponent of the last one
+	int digits = 0;
+	int exp10 = 0;
+	bool truncated = false;
+
+	if (s < end && (*s == '-' || *s == '+')) {
+		neg = *s == '-';
+		s++;
+	}
+
+	if (parse_match(s, end, "inf") || parse_match(s, end, "infinity")) {
+		*out = neg ? -INFINITY : INFINITY;
+		return 0;
+	}
+
+	if (parse_match(s, end, "nan")) {
+		*out = NAN;
+		return 0;
+	}
+
+	const char *mantissa_start = s;
+
+	// integer part, leading zeros are not significant
+	while (s < end && *s == '0') {
+		s++;
+	}
+
+	size_t n = parse_digits(s, MIN(end, s + 19), &mantissa);
+	digits += n;
+	s += n;
+
+	// digits past 19 don't fit, but still scale the value
+	while (s < end && *s >= '0' && *s <= '9') {
+		truncated |= *s != '0';
+		exp10++;
+		s++;
+	}
+
+	if (s < end && *s == '.') {
+		s++;
+		const char *frac = s;
+
+		if (digits == 0) {
+			while (s < end && *s == '0') {
+				s++;
 			}
-			in_fraction = 1;
+			exp10 -= s - frac;
+		}
+
+		n = parse_digits(s, MIN(end, s + 19 - digits), &mantissa);
+		digits += n;
+		exp10 -= n;
+		s += n;
+
+		while (s < end && *s >= '0' && *s <= '9') {
+			truncated |= *s != '0';
+			s++;
+		}
+
+		if (s == frac && frac - 1 == mantissa_start) {
+			// just a decimal point
+			return -EINVAL;
+		}
+	} else if (s == mantissa_start) {
+		return -EINVAL;
+	}
+
+	if (s < end && (*s == 'e' || *s == 'E')) {
+		s++;
+		bool exp_neg = false;
+		uint64_t e = 0;
+
+		if (s < end && (*s == '-' || *s == '+')) {
+			exp_neg = *s == '-';
+			s++;
+		}
+
+		// limit the exponent digits so e can't overflow, any exponent
+		// with more digits over or underflows anyway
+		while (end - s > 1 && *s == '0' && s[1] >= '0' && s[1] <= '9') {
+			s++;
+		}
+		n = parse_digits(s, MIN(end, s + 8), &e);
+		if (n == 0) {
+			return -EINVAL;
+		}
+		s += n;
+		while (s < end && *s >= '0' && *s <= '9') {
+			e = 99999999;
+			s++;
+		}
+		exp10 += exp_neg ? -(int)e : (int)e;
+	}
+
+	if (s != end) {
+		return -EINVAL;
+	}
+
+	float v = 0;
+	bool slow = mantissa != 0 && (truncated || exp10 + digits > 40 || exp10 + digits < -46);
+
+	if (mantissa == 0) {
+		v = 0;
+	} else if (!slow && mantissa <= (1u << 24) && exp10 >= -10 && exp10 <= 10) {
+		// mantissa and power of 10 are exact floats, so one operation
+		// rounds correctly
+		v = exp10 < 0 ? mantissa / parse_pow10f[-exp10] : mantissa * parse_pow10f[exp10];
+	} else if (!slow && mantissa <= (1ull << 53) && exp10 >= -22 && exp10 <= 22) {
+		// one double operation on exact operands, rounded correctly to
+		// double. Rounding that to float can only go wrong if it lands
+		// exactly halfway between two floats.
+		double d = exp10 < 0 ? mantissa / parse_pow10[-exp10]
+				     : mantissa * parse_pow10[exp10];
+		uint64_t bits;
+
+		memcpy(&bits, &d, sizeof(bits));
+		if ((bits & 0x1fffffff) == 0x10000000) {
+			slow = true;
 		} else {
-			break; // Stop at non-digit, non-decimal point character
+			v = d;
 		}
-		i++;
+	} else {
+		slow = true;
+	}
+
+	if (slow) {
+		int ret = parse_float_slow(str, len, &v);
+		if (ret < 0) {
+			return ret;
+		}
+		v = fabsf(v);
+	}
+
+	*out = neg ? -v : v;
+
+	if (isinf(v) || (v == 0 && mantissa != 0)) {
+		return -ERANGE;
 	}
 
-	return sign * result;
+	return 0;
 }
@@ -0,0 +1,864 @@
+#include <gzip.h>
+#include <point.h>
+#include <point_queue.h>
+#include <siot-string.h>
+#include <uplink.h>
+#include <uplink_store.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/zbus/zbus.h>
+
+#if defined(CONFIG_SIOT_UPLINK_TLS)
+#include <zephyr/net/tls_credentials.h>
+#endif
+
+#define STACKSIZE 2048
+#define PRIORITY  7
+
+// how long to wait for the server to answer
+#define UPLINK_TIMEOUT_MS 10000
+
+#ifdef CONFIG_SIOT_UPLINK_FORMAT_BINARY
+#define UPLINK_CONTENT_TYPE "application/octet-stream"
+#else
+#define UPLINK_CONTENT_TYPE "application/json"
+#endif
+
+LOG_MODULE_REGISTER(uplink, LOG_LEVEL_INF);
+
+ZBUS_CHAN_DECLARE(point_chan);
+
+BUILD_ASSERT(CONFIG_SIOT_UPLINK_BATCH_LEN <= CONFIG_SIOT_UPLINK_QUEUE_LEN,
+	     "uplink batch must fit in the queue");
+
+#ifdef CONFIG_SIOT_UPLINK_STORE
+BUILD_ASSERT(CONFIG_SIOT_UPLINK_STORE_DRAIN_SIZE >= CONFIG_SIOT_UPLINK_PAYLOAD_SIZE,
+	     "a stored batch must fit in a drain request");
+#endif
+
+static const struct uplink_config *uplink_cfg;
+
+POINT_QUEUE_DEFINE(uplink_q, CONFIG_SIOT_UPLINK_QUEUE_LEN);
+K_SEM_DEFINE(uplink_sem, 0, 1);
+
+#define UPLINK_FLUSH_NOW  0
+#define UPLINK_FLUSH_FULL 1
+
+static atomic_t uplink_flags;
+// uptime in ms when the queue last went from empty to not empty
+static atomic_t uplink_first_ms;
+
+static atomic_t stat_queued;
+static atomic_t stat_dropped;
+static uint32_t stat_sent;
+static uint32_t stat_posts;
+static uint32_t stat_errors;
+static uint32_t stat_connects;
+static uint32_t stat_connect_ms;
+static uint32_t stat_gzip_in;
+static uint32_t stat_gzip_out;
+
+#ifdef CONFIG_SIOT_UPLINK_STORE
+static struct uplink_store uplink_store;
+#endif
+
+// ==================================================
+// Queue
+
+static void uplink_listener(const struct zbus_channel *chan)
+{
+	const point *p = zbus_chan_const_msg(chan);
+
+	// The uplink's own metrics are published when it connects. Queued,
+	// they would wake it to connect again to send them, so a device in PSM
+	// would never stay asleep.
+	if (strcmp(p->type, POINT_TYPE_METRIC_UPLINK_CONNECTS) == 0 ||
+	    strcmp(p->type, POINT_TYPE_METRIC_UPLINK_CONNECT_MS) == 0) {
+		return;
+	}
+
+	if (uplink_cfg->filter != NULL && !uplink_cfg->filter(p, 0, uplink_cfg->filter_ctx)) {
+		return;
+	}
+
+	if (point_queue_put(&uplink_q, p)) {
+		atomic_inc(&stat_dropped);
+		return;
+	}
+	atomic_inc(&stat_queued);
+
+	size_t n = point_queue_count(&uplink_q);
+	if (n == 1) {
+		atomic_set(&uplink_first_ms, k_uptime_get_32());
+		k_sem_give(&uplink_sem);
+	}
+	if (n >= CONFIG_SIOT_UPLINK_BATCH_LEN) {
+		atomic_set_bit(&uplink_flags, UPLINK_FLUSH_FULL);
+		k_sem_give(&uplink_sem);
+	}
+}
+
+ZBUS_LISTENER_DEFINE(uplink_lis, uplink_listener);
+
+void uplink_flush(void)
+{
+	atomic_set_bit(&uplink_flags, UPLINK_FLUSH_NOW);
+	k_sem_give(&uplink_sem);
+}
+
+// ==================================================
+// HTTP
+//
+// The connection is kept open between posts, and opened again when it is
+// needed after the server closed it, or after it was idle for
+// CONFIG_SIOT_UPLINK_KEEPALIVE seconds. The server address is looked up once,
+// and again after a connect fails.
+
+static int uplink_fd = -1;
+static uint32_t uplink_used_ms;
+
+static struct sockaddr uplink_addr;
+static socklen_t uplink_addr_len;
+
+static int uplink_resolve(void)
+{
+	struct zsock_addrinfo hints = {
+		.ai_family = AF_INET,
+		.ai_socktype = SOCK_STREAM,
+	};
+	struct zsock_addrinfo *res;
+	char port[ITOA_I32_LEN];
+
+	itoa_i32(uplink_cfg->port, port, sizeof(port));
+
+	int ret = zsock_getaddrinfo(uplink_cfg->host, port, &hints, &res);
+	if (ret) {
+		LOG_ERR("Error looking up %s: %i", uplink_cfg->host, ret);
+		return -EHOSTUNREACH;
+	}
+
+	memcpy(&uplink_addr, res->ai_addr, MIN(res->ai_addrlen, sizeof(uplink_addr)));
+	uplink_addr_len = res->ai_addrlen;
+	zsock_freeaddrinfo(res);
+
+	return 0;
+}
+
+static void uplink_disconnect(void)
+{
+	if (uplink_fd >= 0) {
+		zsock_close(uplink_fd);
+		uplink_fd = -1;
+	}
+}
+
+static void uplink_publish_metric(const char *type, int value)
+{
+	point p = {0};
+
+	point_set_type_key(&p, type, "0");
+	point_put_int(&p, value);
+	zbus_chan_pub(&point_chan, &p, K_MSEC(500));
+}
+
+static int uplink_connect(void)
+{
+	int proto = IPPROTO_TCP;
+	int ret;
+
+	if (uplink_addr_len == 0) {
+		ret = uplink_resolve();
+		if (ret) {
+			return ret;
+		}
+	}
+
+#if defined(CONFIG_SIOT_UPLINK_TLS)
+	if (uplink_cfg->sec_tag >= 0) {
+		proto = IPPROTO_TLS_1_2;
+	}
+#endif
+
+	uint32_t start = k_uptime_get_32();
+
+	uplink_fd = zsock_socket(uplink_addr.sa_family, SOCK_STREAM, proto);
+	if (uplink_fd < 0) {
+		ret = -errno;
+		LOG_ERR("Error opening socket: %i", ret);
+		return ret;
+	}
+
+	// a send or receive on a link that stopped moving data, e.g. after the
+	// modem lost the network, fails instead of blocking the thread
+	struct timeval timeout = {.tv_sec = UPLINK_TIMEOUT_MS / MSEC_PER_SEC};
+
+	if (zsock_setsockopt(uplink_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) ||
+	    zsock_setsockopt(uplink_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout))) {
+		ret = -errno;
+		LOG_ERR("Error setting socket timeouts: %i", ret);
+		uplink_disconnect();
+		return ret;
+	}
+
+#if defined(CONFIG_SIOT_UPLINK_TLS)
+	if (uplink_cfg->sec_tag >= 0) {
+		const sec_tag_t sec_tags[] = {uplink_cfg->sec_tag};
+		int verify = TLS_PEER_VERIFY_REQUIRED;
+		// reconnects resume the TLS session instead of a full handshake
+		int cache = TLS_SESSION_CACHE_ENABLED;
+
+		if (zsock_setsockopt(uplink_fd, SOL_TLS, TLS_SEC_TAG_LIST, sec_tags,
+				     sizeof(sec_tags)) ||
+		    zsock_setsockopt(uplink_fd, SOL_TLS, TLS_HOSTNAME, uplink_cfg->host,
+				     strlen(uplink_cfg->host)) ||
+		    zsock_setsockopt(uplink_fd, SOL_TLS, TLS_PEER_VERIFY, &verify, sizeof(verify)) ||
+		    zsock_setsockopt(uplink_fd, SOL_TLS, TLS_SESSION_CACHE, &cache, sizeof(cache))) {
+			ret = -errno;
+			LOG_ERR("Error setting TLS options: %i", ret);
+			uplink_disconnect();
+			return ret;
+		}
+	}
+#endif
+
+	ret = zsock_connect(uplink_fd, &uplink_addr, uplink_addr_len);
+	if (ret) {
+		ret = -errno;
+		LOG_ERR("Error connecting to %s: %i", uplink_cfg->host, ret);
+		uplink_disconnect();
+		// the address may have changed
+		uplink_addr_len = 0;
+		return ret;
+	}
+
+	uint32_t connect_ms = k_uptime_get_32() - start;
+
+	stat_connects++;
+	stat_connect_ms = connect_ms;
+	uplink_used_ms = k_uptime_get_32();
+
+	uplink_publish_metric(POINT_TYPE_METRIC_UPLINK_CONNECTS, stat_connects);
+	uplink_publish_metric(POINT_TYPE_METRIC_UPLINK_CONNECT_MS, connect_ms);
+
+	return 0;
+}
+
+static int uplink_send_all(int fd, const void *buf, size_t len)
+{
+	const uint8_t *b = buf;
+
+	while (len > 0) {
+		ssize_t n = zsock_send(fd, b, len, 0);
+		if (n < 0) {
+			return -errno;
+		}
+		b += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+static int uplink_recv(int fd, char *buf, size_t len)
+{
+	struct zsock_pollfd pfd = {.fd = fd, .events = ZSOCK_POLLIN};
+
+	int ret = zsock_poll(&pfd, 1, UPLINK_TIMEOUT_MS);
+	if (ret <= 0) {
+		return ret < 0 ? -errno : -ETIMEDOUT;
+	}
+
+	ssize_t n = zsock_recv(fd, buf, len, 0);
+	if (n < 0) {
+		return -errno;
+	}
+	if (n == 0) {
+		return -ECONNRESET;
+	}
+
+	return n;
+}
+
+// returns the value of header name, or NULL
+static const char *uplink_header(const char *headers, const char *name)
+{
+	size_t name_len = strlen(name);
+
+	for (const char *line = strstr(headers, "\r\n"); line != NULL;
+	     line = strstr(line, "\r\n")) {
+		line += 2;
+		if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+			line += name_len + 1;
+			while (*line == ' ') {
+				line++;
+			}
+			return line;
+		}
+	}
+
+	return NULL;
+}
+
+// Reads the whole response, so the next request can use the connection, and
+// returns the HTTP status code. keep is set if the server keeps the
+// connection open.
+static int uplink_read_response(int fd, bool *keep)
+{
+	char buf[512];
+	size_t len = 0;
+	char *end;
+	int32_t status;
+
+	*keep = false;
+
+	do {
+		if (len >= sizeof(buf) - 1) {
+			return -EBADMSG;
+		}
+		int n = uplink_recv(fd, buf + len, sizeof(buf) - 1 - len);
+		if (n < 0) {
+			return n;
+		}
+		len += n;
+		buf[len] = 0;
+	} while ((end = strstr(buf, "\r\n\r\n")) == NULL);
+
+	// HTTP/1.1 200 OK
+	if (len < 12 || strncmp(buf, "HTTP/1.", 7) != 0 || parse_int(buf + 9, 3, &status)) {
+		return -EBADMSG;
+	}
+
+	end[2] = 0;
+
+	const char *conn = uplink_header(buf, "Connection");
+	const char *cl = uplink_header(buf, "Content-Length");
+	int32_t body_len = 0;
+	bool keep_open = buf[7] == '1' && (conn == NULL || strncasecmp(conn, "close", 5) != 0);
+
+	// without a length the body ends when the connection is closed
+	if (cl == NULL || parse_int(cl, strcspn(cl, "\r"), &body_len) || body_len < 0) {
+		return status;
+	}
+
+	// discard the body
+	size_t body = len - (end + 4 - buf);
+
+	while (body < body_len) {
+		int n = uplink_recv(fd, buf, MIN(sizeof(buf), body_len - body));
+		if (n < 0) {
+			return n;
+		}
+		body += n;
+	}
+
+	*keep = keep_open;
+
+	return status;
+}
+
+// the body of a request, a buffer or batches read from the store
+struct uplink_body {
+	const uint8_t *data;
+	size_t len;
+#ifdef CONFIG_SIOT_UPLINK_STORE
+	const struct uplink_store_batch *stored;
+	// sequence number of the first point
+	uint32_t seq;
+#endif
+	// data is compressed with gzip
+	bool gzip;
+};
+
+#ifdef CONFIG_SIOT_UPLINK_STORE
+// stored JSON batches are arrays without the brackets, so they are joined with
+// commas
+static int uplink_send_stored(const uint8_t *buf, size_t len, bool start, void *ctx)
+{
+	bool *first = ctx;
+
+	if (!IS_ENABLED(CONFIG_SIOT_UPLINK_FORMAT_BINARY) && start && !*first) {
+		int ret = uplink_send_all(uplink_fd, ",", 1);
+		if (ret) {
+			return ret;
+		}
+	}
+	*first = false;
+
+	return uplink_send_all(uplink_fd, buf, len);
+}
+
+static size_t uplink_stored_len(const struct uplink_store_batch *b)
+{
+	if (IS_ENABLED(CONFIG_SIOT_UPLINK_FORMAT_BINARY)) {
+		return b->len;
+	}
+
+	return b->len + (b->entries - 1) + 2;
+}
+#endif
+
+static int uplink_send_body(const struct uplink_body *body)
+{
+#ifdef CONFIG_SIOT_UPLINK_STORE
+	if (body->stored != NULL) {
+		bool binary = IS_ENABLED(CONFIG_SIOT_UPLINK_FORMAT_BINARY);
+		bool first = true;
+
+		int ret = binary ? 0 : uplink_send_all(uplink_fd, "[", 1);
+		if (ret == 0) {
+			ret = uplink_store_read(&uplink_store, body->stored, uplink_send_stored,
+						&first);
+		}
+		if (ret == 0 && !binary) {
+			ret = uplink_send_all(uplink_fd, "]", 1);
+		}
+
+		return ret;
+	}
+#endif
+
+	return uplink_send_all(uplink_fd, body->data, body->len);
+}
+
+// returns the HTTP status code, or less than 0 if the connection failed
+static int uplink_request(const char *header, size_t header_len, const struct uplink_body *body)
+{
+	bool keep;
+
+	int ret = uplink_send_all(uplink_fd, header, header_len);
+	if (ret == 0) {
+		ret = uplink_send_body(body);
+	}
+	if (ret == 0) {
+		ret = uplink_read_response(uplink_fd, &keep);
+	}
+
+	if (ret < 0 || !keep || CONFIG_SIOT_UPLINK_KEEPALIVE == 0) {
+		uplink_disconnect();
+	} else {
+		uplink_used_ms = k_uptime_get_32();
+	}
+
+	return ret;
+}
+
+// returns the HTTP status code, or less than 0 if the connection failed
+static int uplink_post_body(const struct uplink_body *body)
+{
+	char header[256];
+	char seq[32] = "";
+	int ret;
+
+#ifdef CONFIG_SIOT_UPLINK_STORE
+	// lets the server drop points it has received before
+	snprintf(seq, sizeof(seq), "X-Siot-Seq: %u\r\n", body->seq);
+#endif
+
+	int header_len = snprintf(header, sizeof(header),
+				  "POST %s HTTP/1.1\r\n"
+				  "Host: %s\r\n"
+				  "Content-Type: " UPLINK_CONTENT_TYPE "\r\n"
+				  "Content-Length: %zu\r\n"
+				  "%s"
+				  "%s"
+				  "\r\n",
+				  uplink_cfg->path, uplink_cfg->host, body->len,
+				  body->gzip ? "Content-Encoding: gzip\r\n" : "", seq);
+	if (header_len >= sizeof(header)) {
+		return -ENOMEM;
+	}
+
+	if (uplink_fd >= 0 &&
+	    k_uptime_get_32() - uplink_used_ms >= CONFIG_SIOT_UPLINK_KEEPALIVE * MSEC_PER_SEC) {
+		uplink_disconnect();
+	}
+
+	bool reused = uplink_fd >= 0;
+
+	if (!reused) {
+		ret = uplink_connect();
+		if (ret) {
+			return ret;
+		}
+	}
+
+	ret = uplink_request(header, header_len, body);
+
+	// the server may have closed the connection while it was idle
+	if (ret < 0 && reused) {
+		ret = uplink_connect();
+		if (ret) {
+			return ret;
+		}
+		ret = uplink_request(header, header_len, body);
+	}
+
+	return ret;
+}
+
+#ifdef CONFIG_SIOT_UPLINK_GZIP
+// set when the server answers 415 Unsupported Media Type to a compressed
+// request, after which requests are sent as is (RFC 7694)
+static bool uplink_gzip_off;
+
+static struct gzip uplink_gz;
+static uint8_t uplink_gz_buf[CONFIG_SIOT_UPLINK_PAYLOAD_SIZE];
+
+// compresses the body into uplink_gz_buf, unless that does not make it smaller
+static bool uplink_compress(const struct uplink_body *body, struct uplink_body *gz)
+{
+	if (uplink_gzip_off || body->data == NULL) {
+		return false;
+	}
+
+	int ret = gzip_compress(&uplink_gz, body->data, body->len, uplink_gz_buf,
+				sizeof(uplink_gz_buf));
+	if (ret < 0 || ret >= body->len) {
+		return false;
+	}
+
+	*gz = *body;
+	gz->data = uplink_gz_buf;
+	gz->len = ret;
+	gz->gzip = true;
+
+	return true;
+}
+#endif
+
+static int uplink_post(const struct uplink_body *body)
+{
+	int ret;
+
+#ifdef CONFIG_SIOT_UPLINK_GZIP
+	struct uplink_body gz;
+
+	if (uplink_compress(body, &gz)) {
+		ret = uplink_post_body(&gz);
+		if (ret == 415) {
+			LOG_WRN("Server does not accept gzip, sending uncompressed");
+			uplink_gzip_off = true;
+			ret = uplink_post_body(body);
+		} else {
+			stat_gzip_in += body->len;
+			stat_gzip_out += gz.len;
+		}
+	} else {
+		ret = uplink_post_body(body);
+	}
+#else
+	ret = uplink_post_body(body);
+#endif
+
+	if (ret >= 200 && ret < 300) {
+		return 0;
+	} else if (ret > 0) {
+		LOG_ERR("Server answered %i", ret);
+		return -EIO;
+	}
+
+	return ret;
+}
+
+// ==================================================
+// Thread
+//
+// The thread is started by uplink_init
+
+// points taken from the queue that the server has not accepted yet
+static point uplink_batch[CONFIG_SIOT_UPLINK_BATCH_LEN];
+static int uplink_batch_len;
+
+// points are encoded directly into this buffer, so the memory used for a
+// request does not depend on the points sent
+static uint8_t uplink_payload[CONFIG_SIOT_UPLINK_PAYLOAD_SIZE];
+
+// returns the payload length, or less than 0 for error
+static int uplink_encode(int count)
+{
+#ifdef CONFIG_SIOT_UPLINK_FORMAT_BINARY
+	return points_bin_encode(uplink_batch, count, uplink_payload, sizeof(uplink_payload));
+#else
+	int ret = points_json_encode(uplink_batch, count, (char *)uplink_payload,
+				     sizeof(uplink_payload));
+
+	return ret < 0 ? ret : strlen((char *)uplink_payload);
+#endif
+}
+
+#ifdef CONFIG_SIOT_UPLINK_STORE
+static int uplink_store_payload(uint32_t seq, int count, size_t len)
+{
+	if (IS_ENABLED(CONFIG_SIOT_UPLINK_FORMAT_BINARY)) {
+		return uplink_store_append(&uplink_store, seq, count, uplink_payload, len);
+	}
+
+	// without the brackets, so stored batches can be joined
+	return uplink_store_append(&uplink_store, seq, count, uplink_payload + 1, len - 2);
+}
+
+// sends the stored batches oldest first, as many in each request as fit in
+// CONFIG_SIOT_UPLINK_STORE_DRAIN_SIZE, until none are left or a post fails
+static int uplink_drain(void)
+{
+	struct uplink_store_batch b;
+
+	while (uplink_store_peek(&uplink_store, CONFIG_SIOT_UPLINK_STORE_DRAIN_SIZE, &b) == 0) {
+		struct uplink_body body = {
+			.len = uplink_stored_len(&b),
+			.stored = &b,
+			.seq = b.seq,
+		};
+
+		int ret = uplink_post(&body);
+		stat_posts++;
+		if (ret) {
+			stat_errors++;
+			return ret;
+		}
+		stat_sent += b.count;
+
+		uplink_store_sent(&uplink_store, &b);
+	}
+
+	return 0;
+}
+#endif
+
+static void uplink_batch_remove(int count)
+{
+	uplink_batch_len -= count;
+	memmove(uplink_batch, uplink_batch + count, uplink_batch_len * sizeof(point));
+}
+
+static int uplink_send_batch(void)
+{
+	while (uplink_batch_len < ARRAY_SIZE(uplink_batch) &&
+	       point_queue_get(&uplink_q, &uplink_batch[uplink_batch_len]) == 0) {
+		uplink_batch_len++;
+	}
+
+#ifdef CONFIG_SIOT_UPLINK_STORE
+	if (uplink_batch_len == 0 && uplink_store.pending > 0) {
+		return uplink_drain();
+	}
+#endif
+
+	if (uplink_batch_len == 0) {
+		return 0;
+	}
+
+	// send fewer points if they do not fit in the payload
+	int count = uplink_batch_len;
+	int ret;
+
+	while ((ret = uplink_encode(count)) == -ENOMEM && count > 1) {
+		count /= 2;
+	}
+
+	if (ret < 0) {
+		LOG_ERR("Error encoding uplink points: %i", ret);
+		// drop the point that does not fit, or it is retried forever
+		count = 1;
+	} else {
+		struct uplink_body body = {.data = uplink_payload, .len = ret};
+
+#ifdef CONFIG_SIOT_UPLINK_STORE
+		body.seq = uplink_store_seq(&uplink_store, count);
+
+		// while there is a backlog, batches are stored behind it, so points
+		// are sent in order
+		if (uplink_store.pending > 0 && uplink_store_payload(body.seq, count, body.len) == 0) {
+			uplink_batch_remove(count);
+			return uplink_drain();
+		}
+#endif
+
+		ret = uplink_post(&body);
+		stat_posts++;
+		if (ret) {
+			stat_errors++;
+#ifdef CONFIG_SIOT_UPLINK_STORE
+			// sent later from the store, instead of holding up the queue
+			if (uplink_store_payload(body.seq, count, body.len) == 0) {
+				uplink_batch_remove(count);
+			}
+#endif
+			return ret;
+		}
+		stat_sent += count;
+	}
+
+	uplink_batch_remove(count);
+
+	return 0;
+}
+
+static int uplink_pending(void)
+{
+	int pending = uplink_batch_len + point_queue_count(&uplink_q);
+
+#ifdef CONFIG_SIOT_UPLINK_STORE
+	pending += uplink_store.pending;
+#endif
+
+	return pending;
+}
+
+// sends until the queue is empty, or a post fails
+static int uplink_send(void)
+{
+	int ret = 0;
+
+	while (uplink_pending() > 0) {
+		ret = uplink_send_batch();
+		if (ret) {
+			LOG_ERR("Error sending uplink points: %i", ret);
+			break;
+		}
+	}
+
+	if (uplink_pending() > 0) {
+		atomic_set(&uplink_first_ms, k_uptime_get_32());
+	}
+
+	return ret;
+}
+
+static void uplink_thread(void *arg1, void *arg2, void *arg3)
+{
+	// no automatic flushes until retry_ms after a failed post. The 32 bit
+	// times only compare correctly within 2^31 ms of each other, so
+	// retry_ms is only looked at while the retry is pending.
+	bool retry = false;
+	uint32_t retry_ms = 0;
+
+	while (true) {
+		k_timeout_t timeout = K_FOREVER;
+
+		if (retry && (int32_t)(k_uptime_get_32() - retry_ms) >= 0) {
+			retry = false;
+		}
+
+		if (uplink_pending() > 0) {
+			uint32_t now = k_uptime_get_32();
+			uint32_t due = (uint32_t)atomic_get(&uplink_first_ms) +
+				       CONFIG_SIOT_UPLINK_MAX_DELAY * MSEC_PER_SEC;
+
+			if (retry && (int32_t)(retry_ms - due) > 0) {
+				due = retry_ms;
+			}
+			timeout = (int32_t)(due - now) > 0 ? K_MSEC(due - now) : K_NO_WAIT;
+		}
+
+		bool timed_out = k_sem_take(&uplink_sem, timeout) == -EAGAIN;
+		bool now = atomic_test_and_clear_bit(&uplink_flags, UPLINK_FLUSH_NOW);
+		bool full = atomic_test_and_clear_bit(&uplink_flags, UPLINK_FLUSH_FULL) &&
+			    (!retry || (int32_t)(k_uptime_get_32() - retry_ms) >= 0);
+
+		if (!timed_out && !now && !full) {
+			continue;
+		}
+
+		retry = uplink_send() != 0;
+		if (retry) {
+			retry_ms = k_uptime_get_32() + CONFIG_SIOT_UPLINK_RETRY_DELAY * MSEC_PER_SEC;
+		}
+	}
+}
+
+K_THREAD_DEFINE(uplink, STACKSIZE, uplink_thread, NULL, NULL, NULL, PRIORITY, 0, SYS_FOREVER_MS);
+
+int uplink_init(const struct uplink_config *cfg)
+{
+	int ret;
+
+	uplink_cfg = cfg;
+
+#ifdef CONFIG_SIOT_UPLINK_STORE
+	ret = uplink_store_init(&uplink_store, FIXED_PARTITION_ID(uplink_partition));
+	if (ret) {
+		LOG_ERR("Error opening uplink store: %i", ret);
+		return ret;
+	}
+#endif
+
+	ret = zbus_chan_add_obs(&point_chan, &uplink_lis, K_SECONDS(5));
+	if (ret) {
+		LOG_ERR("Error adding uplink observer: %i", ret);
+		return ret;
+	}
+
+	k_thread_start(uplink);
+
+	LOG_INF("Uplink to %s:%i%s", cfg->host, cfg->port, cfg->path);
+
+	return 0;
+}
+
+void uplink_stats(struct uplink_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->queued = atomic_get(&stat_queued);
+	stats->dropped = atomic_get(&stat_dropped);
+	stats->sent = stat_sent;
+	stats->posts = stat_posts;
+	stats->errors = stat_errors;
+	stats->connects = stat_connects;
+	stats->connect_ms = stat_connect_ms;
+	stats->gzip_in = stat_gzip_in;
+	stats->gzip_out = stat_gzip_out;
+#ifdef CONFIG_SIOT_UPLINK_STORE
+	stats->stored = uplink_store.pending;
+	stats->lost = uplink_store.lost;
+#endif
+}
+
+static int cmd_uplink_stats(const struct shell *sh, size_t argc, char **argv)
+{
+	struct uplink_stats s;
+
+	uplink_stats(&s);
+
+	shell_print(sh, "pending:   %i", uplink_pending());
+	shell_print(sh, "queued:    %u", s.queued);
+	shell_print(sh, "dropped:   %u", s.dropped);
+	shell_print(sh, "sent:      %u", s.sent);
+	shell_print(sh, "posts:     %u", s.posts);
+	shell_print(sh, "errors:    %u", s.errors);
+	shell_print(sh, "connects:  %u", s.connects);
+	shell_print(sh, "connect:   %u ms", s.connect_ms);
+	shell_print(sh, "connected: %s", uplink_fd >= 0 ? "yes" : "no");
+#ifdef CONFIG_SIOT_UPLINK_STORE
+	shell_print(sh, "stored:    %u", s.stored);
+	shell_print(sh, "lost:      %u", s.lost);
+#endif
+#ifdef CONFIG_SIOT_UPLINK_GZIP
+	shell_print(sh, "gzip:      %u -> %u bytes%s", s.gzip_in, s.gzip_out,
+		    uplink_gzip_off ? " (refused by server)" : "");
+#endif
+
+	return 0;
+}
+
+static int cmd_uplink_flush(const struct shell *sh, size_t argc, char **argv)
+{
+	uplink_flush();
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(uplink_cmds,
+			       SHELL_CMD(stats, NULL, "Uplink statistics", cmd_uplink_stats),
+			       SHELL_CMD(flush, NULL, "Send queued points now", cmd_uplink_flush),
+			       SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(uplink, &uplink_cmds, "Uplink commands", NULL);
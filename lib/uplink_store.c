@@ -0,0 +1,365 @@
+#include <uplink_store.h>
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(uplink_store, LOG_LEVEL_INF);
+
+#define UPLINK_STORE_MAGIC   0x53494f55
+#define UPLINK_STORE_VERSION 1
+
+// sequence numbers reserved by each mark, so a mark is written at most once
+// per this many points
+#define UPLINK_STORE_SEQ_BLOCK 1024
+
+// entries are written through a buffer of this size, so writes are a multiple
+// of the flash write block size
+#define UPLINK_STORE_WRITE_BUF 32
+
+#define STORE_ENTRY_BATCH 1
+#define STORE_ENTRY_MARK  2
+
+struct store_batch {
+	uint8_t kind;
+	uint8_t pad;
+	uint16_t count;
+	uint32_t seq;
+} __packed;
+
+struct store_mark {
+	uint8_t kind;
+	uint8_t pad[3];
+	uint32_t sent;
+	uint32_t reserved;
+} __packed;
+
+union store_entry {
+	uint8_t kind;
+	struct store_batch batch;
+	struct store_mark mark;
+};
+
+static int store_read_entry(struct uplink_store *s, struct fcb_entry *loc, union store_entry *e)
+{
+	size_t len = MIN(loc->fe_data_len, sizeof(*e));
+
+	memset(e, 0, sizeof(*e));
+
+	int ret = flash_area_read(s->fcb.fap, FCB_ENTRY_FA_DATA_OFF((*loc)), e, len);
+	if (ret) {
+		return ret;
+	}
+
+	if ((e->kind == STORE_ENTRY_BATCH && len < sizeof(e->batch)) ||
+	    (e->kind == STORE_ENTRY_MARK && len < sizeof(e->mark))) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+// returns true if the entry is a batch that was not delivered
+static bool store_entry_pending(struct uplink_store *s, const union store_entry *e)
+{
+	return e->kind == STORE_ENTRY_BATCH && e->batch.seq + e->batch.count > s->sent;
+}
+
+// returns the number of points that were not delivered in the oldest sector
+static uint32_t store_oldest_pending(struct uplink_store *s)
+{
+	struct fcb_entry loc = {0};
+	union store_entry e;
+	uint32_t pending = 0;
+
+	while (fcb_getnext(&s->fcb, &loc) == 0 && loc.fe_sector == s->fcb.f_oldest) {
+		if (store_read_entry(s, &loc, &e) == 0 && store_entry_pending(s, &e)) {
+			pending += e.batch.count;
+		}
+	}
+
+	return pending;
+}
+
+static void store_drop_oldest(struct uplink_store *s)
+{
+	uint32_t lost = store_oldest_pending(s);
+
+	if (lost > 0) {
+		LOG_WRN("Uplink store full, dropping %u points", lost);
+	}
+
+	s->lost += lost;
+	s->pending -= MIN(s->pending, lost);
+	fcb_rotate(&s->fcb);
+}
+
+// appends an entry made of a header and data, erasing the oldest sector if
+// the store is full
+static int store_write(struct uplink_store *s, const void *hdr, size_t hdr_len, const void *data,
+		       size_t len)
+{
+	struct fcb_entry loc;
+	uint8_t buf[UPLINK_STORE_WRITE_BUF];
+	size_t buf_len = 0;
+	off_t off;
+	int ret = -ENOSPC;
+
+	// FCB entries can not be longer than FCB_MAX_LEN
+	if (hdr_len + len > FCB_MAX_LEN) {
+		return -EINVAL;
+	}
+
+	for (int i = 0; i < s->fcb.f_sector_cnt; i++) {
+		ret = fcb_append(&s->fcb, hdr_len + len, &loc);
+		if (ret != -ENOSPC) {
+			break;
+		}
+		store_drop_oldest(s);
+	}
+
+	if (ret) {
+		return ret;
+	}
+
+	off = FCB_ENTRY_FA_DATA_OFF(loc);
+
+	for (size_t i = 0; i < hdr_len + len; i++) {
+		buf[buf_len++] = i < hdr_len ? ((const uint8_t *)hdr)[i]
+					     : ((const uint8_t *)data)[i - hdr_len];
+
+		if (buf_len == sizeof(buf) || i == hdr_len + len - 1) {
+			// pad the last write to the write block size
+			size_t n = ROUND_UP(buf_len, s->fcb.f_align);
+
+			memset(buf + buf_len, s->fcb.f_erase_value, n - buf_len);
+			ret = flash_area_write(s->fcb.fap, off, buf, n);
+			if (ret) {
+				return ret;
+			}
+			off += n;
+			buf_len = 0;
+		}
+	}
+
+	return fcb_append_finish(&s->fcb, &loc);
+}
+
+static int store_write_mark(struct uplink_store *s, uint32_t reserved)
+{
+	struct store_mark m = {
+		.kind = STORE_ENTRY_MARK,
+		.sent = s->sent,
+		.reserved = reserved,
+	};
+
+	int ret = store_write(s, &m, sizeof(m), NULL, 0);
+	if (ret) {
+		LOG_ERR("Error writing uplink store mark: %i", ret);
+		return ret;
+	}
+
+	s->reserved = reserved;
+
+	return 0;
+}
+
+int uplink_store_init(struct uplink_store *s, uint8_t area_id)
+{
+	uint32_t sector_cnt = ARRAY_SIZE(s->sectors);
+	struct fcb_entry loc = {0};
+	union store_entry e;
+	uint32_t end = 0;
+	int ret;
+
+	memset(s, 0, sizeof(*s));
+
+	ret = flash_area_get_sectors(area_id, &sector_cnt, s->sectors);
+	if (ret) {
+		LOG_ERR("Error reading uplink store sectors: %i", ret);
+		return ret;
+	}
+
+	s->fcb.f_magic = UPLINK_STORE_MAGIC;
+	s->fcb.f_version = UPLINK_STORE_VERSION;
+	s->fcb.f_sector_cnt = sector_cnt;
+	s->fcb.f_sectors = s->sectors;
+
+	ret = fcb_init(area_id, &s->fcb);
+	if (ret) {
+		LOG_ERR("Error opening uplink store: %i", ret);
+		return ret;
+	}
+
+	if (s->fcb.f_align > UPLINK_STORE_WRITE_BUF) {
+		return -ENOTSUP;
+	}
+
+	// the last mark tells what was delivered, and the batches after it may
+	// have used sequence numbers above the last reserved one
+	while (fcb_getnext(&s->fcb, &loc) == 0) {
+		if (store_read_entry(s, &loc, &e)) {
+			continue;
+		}
+
+		if (e.kind == STORE_ENTRY_MARK) {
+			s->sent = MAX(s->sent, e.mark.sent);
+			s->reserved = MAX(s->reserved, e.mark.reserved);
+		} else if (e.kind == STORE_ENTRY_BATCH) {
+			end = MAX(end, e.batch.seq + e.batch.count);
+		}
+	}
+
+	memset(&loc, 0, sizeof(loc));
+	while (fcb_getnext(&s->fcb, &loc) == 0) {
+		if (store_read_entry(s, &loc, &e) == 0 && store_entry_pending(s, &e)) {
+			s->pending += e.batch.count;
+		}
+	}
+
+	s->next_seq = MAX(s->reserved, end);
+
+	LOG_INF("Uplink store: %u points pending, next sequence number %u", s->pending,
+		s->next_seq);
+
+	return store_write_mark(s, s->next_seq + UPLINK_STORE_SEQ_BLOCK);
+}
+
+uint32_t uplink_store_seq(struct uplink_store *s, uint32_t count)
+{
+	uint32_t seq = s->next_seq;
+
+	s->next_seq += count;
+	if (s->next_seq > s->reserved) {
+		// on failure the next call tries again
+		store_write_mark(s, s->next_seq + UPLINK_STORE_SEQ_BLOCK);
+	}
+
+	return seq;
+}
+
+int uplink_store_append(struct uplink_store *s, uint32_t seq, uint32_t count, const void *data,
+			size_t len)
+{
+	struct store_batch b = {
+		.kind = STORE_ENTRY_BATCH,
+		.count = count,
+		.seq = seq,
+	};
+
+	if (count == 0 || count > UINT16_MAX) {
+		return -EINVAL;
+	}
+
+	int ret = store_write(s, &b, sizeof(b), data, len);
+	if (ret) {
+		LOG_ERR("Error storing uplink batch: %i", ret);
+		return ret;
+	}
+
+	s->pending += count;
+
+	return 0;
+}
+
+int uplink_store_peek(struct uplink_store *s, size_t max_len, struct uplink_store_batch *b)
+{
+	struct fcb_entry loc = {0};
+	union store_entry e;
+
+	memset(b, 0, sizeof(*b));
+
+	while (fcb_getnext(&s->fcb, &loc) == 0) {
+		if (store_read_entry(s, &loc, &e) || !store_entry_pending(s, &e)) {
+			continue;
+		}
+
+		size_t len = loc.fe_data_len - sizeof(e.batch);
+
+		if (b->entries == 0) {
+			b->first = loc;
+			b->seq = e.batch.seq;
+		} else if (e.batch.seq != b->seq + b->count || b->len + len > max_len) {
+			break;
+		}
+
+		b->count += e.batch.count;
+		b->len += len;
+		b->entries++;
+	}
+
+	if (b->entries == 0) {
+		s->pending = 0;
+		return -ENOENT;
+	}
+
+	return 0;
+}
+
+int uplink_store_read(struct uplink_store *s, const struct uplink_store_batch *b,
+		      uplink_store_read_fn fn, void *ctx)
+{
+	struct fcb_entry loc = b->first;
+	uint8_t buf[128];
+	union store_entry e;
+	int ret;
+
+	for (int n = 0; n < b->entries;) {
+		if (n > 0 && fcb_getnext(&s->fcb, &loc)) {
+			return -ENOENT;
+		}
+
+		// marks can be stored between batches
+		ret = store_read_entry(s, &loc, &e);
+		if (ret) {
+			return ret;
+		}
+		if (!store_entry_pending(s, &e)) {
+			if (n == 0) {
+				return -ENOENT;
+			}
+			continue;
+		}
+		n++;
+
+		for (size_t off = sizeof(e.batch); off < loc.fe_data_len;) {
+			size_t chunk = MIN(sizeof(buf), loc.fe_data_len - off);
+
+			ret = flash_area_read(s->fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc) + off, buf,
+					      chunk);
+			if (ret) {
+				return ret;
+			}
+
+			ret = fn(buf, chunk, off == sizeof(e.batch), ctx);
+			if (ret < 0) {
+				return ret;
+			}
+			off += chunk;
+		}
+	}
+
+	return 0;
+}
+
+int uplink_store_sent(struct uplink_store *s, const struct uplink_store_batch *b)
+{
+	s->sent = b->seq + b->count;
+	s->pending -= MIN(s->pending, b->count);
+
+	int ret = store_write_mark(s, s->reserved);
+	if (ret) {
+		return ret;
+	}
+
+	// the active sector holds the mark just written, so it is never erased
+	while (s->fcb.f_oldest != s->fcb.f_active.fe_sector && store_oldest_pending(s) == 0) {
+		ret = fcb_rotate(&s->fcb);
+		if (ret) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
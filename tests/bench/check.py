@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Compare benchmark results against the checked-in baseline.
+
+Reads the output of the bench app (a file, or stdin) and compares the median
+time of each benchmark against baseline.json for the same board. Exits with 1
+if any benchmark is slower than the baseline by more than its threshold. A
+board with no baseline yet is skipped (exit 0) unless --require-baseline is
+given, then it exits with 2.
+
+  ./build/zephyr/zephyr.exe | tests/bench/check.py
+  tests/bench/check.py bench.txt --update   # record a new baseline
+
+Benchmarks of the frozen legacy implementations are only there for
+comparison, so they are not checked.
+"""
+
+import argparse
+import json
+import os
+import sys
+
+PREFIX = "BENCH_JSON "
+DEFAULT_BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "baseline.json")
+
+
+def parse(lines):
+    board = None
+    results = {}
+
+    for line in lines:
+        i = line.find(PREFIX)
+        if i < 0:
+            continue
+        rec = json.loads(line[i + len(PREFIX) :])
+        if "board" in rec:
+            board = rec["board"]
+        elif not rec["name"].endswith("_legacy"):
+            results[rec["suite"] + "/" + rec["name"]] = rec["median_ns"]
+
+    return board, results
+
+
+def board_key(boards, board):
+    # native_sim/native matches a baseline recorded for native_sim
+    if board in boards:
+        return board
+    return board.split("/")[0]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("report", nargs="?", help="bench output, default stdin")
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE)
+    parser.add_argument("--threshold", type=float, help="override the default threshold")
+    parser.add_argument("--update", action="store_true", help="write results to the baseline")
+    parser.add_argument(
+        "--require-baseline",
+        action="store_true",
+        help="fail instead of skipping the check for a board with no baseline",
+    )
+    args = parser.parse_args()
+
+    if args.report:
+        with open(args.report) as f:
+            board, results = parse(f)
+    else:
+        board, results = parse(sys.stdin)
+
+    if board is None or not results:
+        print("no benchmark results found", file=sys.stderr)
+        return 2
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+
+    boards = baseline.setdefault("boards", {})
+    key = board_key(boards, board)
+
+    if args.update:
+        boards[key] = results
+        with open(args.baseline, "w") as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print(f"updated {len(results)} baselines for {key}")
+        return 0
+
+    if key not in boards:
+        if args.require_baseline:
+            print(f"no baseline for {board}, record one with --update", file=sys.stderr)
+            return 2
+        print(f"no baseline for {board}, skipping the check (record one with --update)")
+        return 0
+
+    default = args.threshold if args.threshold is not None else baseline.get("threshold", 0.25)
+    thresholds = baseline.get("thresholds", {})
+    base = boards[key]
+    failed = 0
+
+    print(f"{'benchmark':<36} {'baseline':>10} {'now':>10} {'change':>8}")
+    for name in sorted(set(base) | set(results)):
+        if name not in results:
+            print(f"{name:<36} {base[name]:>10} {'missing':>10}")
+            continue
+        if name not in base:
+            print(f"{name:<36} {'new':>10} {results[name]:>10}")
+            continue
+
+        change = results[name] / base[name] - 1
+        limit = thresholds.get(name, default)
+        status = ""
+        if change > limit:
+            status = f"  REGRESSED (limit +{limit:.0%})"
+            failed += 1
+        print(f"{name:<36} {base[name]:>10} {results[name]:>10} {change:>+8.1%}{status}")
+
+    if failed:
+        print(f"{failed} benchmarks regressed on {board}")
+        return 1
+
+    print(f"no regressions on {board}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,11 @@
+#include <time.h>
+#include <stdint.h>
+
+uint64_t bench_host_clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
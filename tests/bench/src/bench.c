@@ -0,0 +1,80 @@
+#include "bench.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+volatile uint32_t bench_sink;
+
+#ifdef CONFIG_ARCH_POSIX
+
+uint64_t bench_host_clock_ns(void);
+
+bench_time_t bench_start(void)
+{
+	return bench_host_clock_ns();
+}
+
+uint64_t bench_elapsed_ns(bench_time_t start)
+{
+	return bench_host_clock_ns() - start;
+}
+
+#else
+
+// a single benchmark must finish before the 32 bit cycle counter wraps
+bench_time_t bench_start(void)
+{
+	return k_cycle_get_32();
+}
+
+uint64_t bench_elapsed_ns(bench_time_t start)
+{
+	return k_cyc_to_ns_floor64((uint32_t)(k_cycle_get_32() - (uint32_t)start));
+}
+
+#endif
+
+// writes v / 10 with one decimal place
+static void fmt_tenths(char *buf, size_t len, uint64_t v)
+{
+	snprintk(buf, len, "%llu.%u", (unsigned long long)(v / 10), (unsigned int)(v % 10));
+}
+
+void bench_report(const char *suite, const char *name, uint32_t iterations, uint64_t *round_ns,
+		  int rounds)
+{
+	char median[24];
+	char min[24];
+	char max[24];
+	char cycles[32] = "";
+
+	// insertion sort, there are only a few rounds
+	for (int i = 1; i < rounds; i++) {
+		uint64_t v = round_ns[i];
+		int j = i;
+
+		for (; j > 0 && round_ns[j - 1] > v; j--) {
+			round_ns[j] = round_ns[j - 1];
+		}
+		round_ns[j] = v;
+	}
+
+	uint64_t median_ns = round_ns[rounds / 2];
+
+	fmt_tenths(median, sizeof(median), median_ns * 10 / iterations);
+	fmt_tenths(min, sizeof(min), round_ns[0] * 10 / iterations);
+	fmt_tenths(max, sizeof(max), round_ns[rounds - 1] * 10 / iterations);
+
+#ifndef CONFIG_ARCH_POSIX
+	snprintk(cycles, sizeof(cycles), ",\"median_cycles\":%llu",
+		 (unsigned long long)(k_ns_to_cyc_near64(median_ns) / iterations));
+#endif
+
+	printk("%-8s %-28s %8u x %i %10s ns/op (min %s, max %s)\n", suite, name, iterations,
+	       rounds, median, min, max);
+
+	// machine readable copy for check.py
+	printk("BENCH_JSON {\"suite\":\"%s\",\"name\":\"%s\",\"iterations\":%u,\"rounds\":%i,"
+	       "\"median_ns\":%s,\"min_ns\":%s,\"max_ns\":%s%s}\n",
+	       suite, name, iterations, rounds, median, min, max, cycles);
+}
@@ -0,0 +1,48 @@
+#ifndef __BENCH_H_
+#define __BENCH_H_
+
+#include <stdint.h>
+
+typedef uint64_t bench_time_t;
+
+bench_time_t bench_start(void);
+uint64_t bench_elapsed_ns(bench_time_t start);
+
+// Each benchmark runs one untimed warm-up round, then BENCH_ROUNDS timed rounds,
+// and reports the median, min and max time per iteration of the rounds.
+#define BENCH_ROUNDS 7
+
+// reports a benchmark from the total time of each round. round_ns is sorted in
+// place.
+void bench_report(const char *suite, const char *name, uint32_t iterations, uint64_t *round_ns,
+		  int rounds);
+
+// results of benchmarked code are written here so the compiler cannot
+// optimize the code away
+extern volatile uint32_t bench_sink;
+
+// runs body iterations times per round and reports the time per iteration
+#define BENCH(suite, name, iterations, body)                                                       \
+	do {                                                                                       \
+		uint64_t _round_ns[BENCH_ROUNDS];                                                  \
+		for (int _r = -1; _r < BENCH_ROUNDS; _r++) {                                       \
+			bench_time_t _start = bench_start();                                       \
+			for (uint32_t _i = 0; _i < (iterations); _i++) {                           \
+				body;                                                              \
+			}                                                                          \
+			uint64_t _ns = bench_elapsed_ns(_start);                                   \
+			if (_r >= 0) {                                                             \
+				_round_ns[_r] = _ns;                                               \
+			}                                                                          \
+		}                                                                                  \
+		bench_report(suite, name, iterations, _round_ns, BENCH_ROUNDS);                    \
+	} while (0)
+
+// benchmark suites
+void bench_gzip(void);
+void bench_html(void);
+void bench_string(void);
+void bench_point(void);
+void bench_zbus(void);
+
+#endif // __BENCH_H_
@@ -0,0 +1,102 @@
+#include "bench.h"
+
+#include <gzip.h>
+#include <point.h>
+
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define ITERATIONS 200
+
+// a batch as the uplink sends it: readings of 4 temperature sensors with
+// 1/16 degree resolution that drift slowly, and the uptime every 8th point
+static point batch[32];
+
+// the /v1/points response of siot-net, a mix of data types
+static point web[40];
+
+static struct gzip gz;
+static char src[4096];
+static uint8_t dst[GZIP_MAX_LEN(sizeof(src))];
+
+static void init_points(void)
+{
+	uint32_t x = 1;
+	int temp[4] = {340, 352, 371, 298};
+
+	for (int i = 0; i < ARRAY_SIZE(batch); i++) {
+		point *p = &batch[i];
+		char key[8];
+
+		if (i % 8 == 7) {
+			point_set_type_key(p, POINT_TYPE_UPTIME, "0");
+			point_put_int(p, 86400 + i * 15);
+			continue;
+		}
+
+		x = x * 1103515245 + 12345;
+		int s = i % 4;
+		temp[s] += (int)(x >> 30) - 1;
+
+		snprintf(key, sizeof(key), "%i", s);
+		point_set_type_key(p, POINT_TYPE_TEMPERATURE, key);
+		point_put_float(p, temp[s] / 16.0f);
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(web); i++) {
+		point *p = &web[i];
+		char key[8];
+
+		snprintf(key, sizeof(key), "%i", i);
+
+		switch (i % 4) {
+		case 0:
+			point_set_type_key(p, POINT_TYPE_TEMPERATURE, key);
+			point_put_float(p, 20.0f + i * 0.25f);
+			break;
+		case 1:
+			point_set_type_key(p, POINT_TYPE_METRIC_SYS_CPU_PERCENT, key);
+			point_put_float(p, 1.0f / (i + 1));
+			break;
+		case 2:
+			point_set_type_key(p, POINT_TYPE_UPTIME, key);
+			point_put_int(p, 1000 * i * i);
+			break;
+		default:
+			point_set_type_key(p, POINT_TYPE_DESCRIPTION, key);
+			point_put_string(p, "lab unit #3");
+		}
+	}
+}
+
+// prints the compressed size of src and times compressing it
+static void bench_compress(const char *name, size_t len)
+{
+	int ret = gzip_compress(&gz, (const uint8_t *)src, len, dst, sizeof(dst));
+
+	printk("gzip     %-31s %5zu -> %5i bytes (%i%%)\n", name, len, ret,
+	       ret > 0 ? (int)(ret * 100 / len) : 0);
+
+	BENCH("gzip", name, ITERATIONS, {
+		bench_sink += gzip_compress(&gz, (const uint8_t *)src, len, dst, sizeof(dst));
+	});
+}
+
+void bench_gzip(void)
+{
+	int len;
+
+	init_points();
+
+	points_json_encode(batch, ARRAY_SIZE(batch), src, sizeof(src));
+	bench_compress("uplink_json_32", strlen(src));
+
+	len = points_bin_encode(batch, ARRAY_SIZE(batch), (uint8_t *)src, sizeof(src));
+	bench_compress("uplink_bin_32", len);
+
+	points_json_encode(web, ARRAY_SIZE(web), src, sizeof(src));
+	bench_compress("web_points_40", strlen(src));
+}
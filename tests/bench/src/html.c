@@ -0,0 +1,53 @@
+#include "bench.h"
+#include "legacy/legacy.h"
+
+#include <html.h>
+
+#include <zephyr/sys/util.h>
+
+#include <string.h>
+
+#define ITERATIONS 10000
+
+// a settings form as posted by the siot-net UI
+static const char form[] = "did=Z-MR+lab+unit+%231&ipstatic=on&ipaddr=192.168.1.50"
+			   "&subnet-mask=255.255.255.0&gateway=192.168.1.1";
+
+static void legacy_cb(char *key, char *value)
+{
+	bench_sink += value[0];
+}
+
+static int form_cb(const char *key, const char *value, void *ctx)
+{
+	bench_sink += value[0];
+	return 0;
+}
+
+static void parse_chunked(size_t chunk)
+{
+	char buf[64];
+	struct html_form_parser p;
+
+	html_form_parser_init(&p, buf, sizeof(buf), form_cb, NULL);
+	for (size_t i = 0; i < sizeof(form) - 1; i += chunk) {
+		html_form_parser_feed(&p, form + i, MIN(chunk, sizeof(form) - 1 - i));
+	}
+	html_form_parser_finish(&p);
+}
+
+void bench_html(void)
+{
+	BENCH("html", "form_legacy", ITERATIONS, html_parse_form_data_legacy(form, legacy_cb));
+	BENCH("html", "form_parse", ITERATIONS, parse_chunked(sizeof(form)));
+	BENCH("html", "form_parse_16b_chunks", ITERATIONS, parse_chunked(16));
+	BENCH("html", "form_parse_compat", ITERATIONS, html_parse_form_data(form, legacy_cb));
+
+	static char encoded[] = "Z-MR+lab+unit+%231+%2F+bench%20room";
+	char decoded[sizeof(encoded)];
+
+	BENCH("html", "url_decode", ITERATIONS, {
+		url_decode(encoded, decoded);
+		bench_sink += decoded[0];
+	});
+}
@@ -0,0 +1,47 @@
+// html_parse_form_data before the streaming form parser was added
+
+#include "legacy.h"
+
+#include <zephyr/kernel.h>
+#include <string.h>
+
+static char *z_strdup_legacy(const char *str)
+{
+	size_t len = strlen(str) + 1;
+	char *new_str = k_malloc(len);
+	if (new_str) {
+		memcpy(new_str, str, len);
+	}
+	return new_str;
+}
+
+// Function to parse form data (key=value pairs separated by '&')
+void html_parse_form_data_legacy(const char *body, html_form_callback callback)
+{
+	char *key_value, *key, *value, *decoded_value;
+	char *form_data = z_strdup_legacy(body); // Duplicate the string as we'll modify it
+	char *saveptr1, *saveptr2;
+
+	key_value = strtok_r(form_data, "&", &saveptr1);
+
+	while (key_value != NULL) {
+		key = strtok_r(key_value, "=", &saveptr2); // Extract the key
+		value = strtok_r(NULL, "=", &saveptr2);    // Extract the value
+
+		if (key) {
+			value = value ? value : "";
+			decoded_value = (char *)k_malloc(strlen(value) +
+							 1); // Allocate space for decoded value
+			url_decode(value,
+				   decoded_value); // Decode the value (since it's URL-encoded)
+
+			callback(key, decoded_value);
+
+			k_free(decoded_value); // Free the decoded value after use
+		}
+
+		key_value = strtok_r(NULL, "&", &saveptr1); // Get the next key-value pair
+	}
+
+	k_free(form_data); // Free the duplicated form data string
+}
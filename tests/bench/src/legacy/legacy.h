@@ -0,0 +1,21 @@
+#ifndef __LEGACY_H_
+#define __LEGACY_H_
+
+// Frozen copies of library code that has since been replaced, kept so the
+// benchmarks can compare the current implementation against them.
+
+#include <html.h>
+#include <point.h>
+
+void html_parse_form_data_legacy(const char *body, html_form_callback callback);
+
+char *itoa_legacy(int num, char *str, int base);
+int atoi_legacy(const char *str);
+float atof_legacy(const char *str);
+
+int point_json_encode_legacy(point *p, char *buf, size_t len);
+int point_json_decode_legacy(char *json, size_t json_len, point *p);
+int points_json_encode_legacy(point *pts_in, int count, char *buf, size_t len);
+int points_json_decode_legacy(char *json, size_t json_len, point *pts, size_t p_cnt);
+
+#endif // __LEGACY_H_
@@ -0,0 +1,216 @@
+// point JSON encoding and decoding before the single pass codec, using the
+// Zephyr JSON library and the point_js struct
+
+#include "legacy.h"
+
+#include <siot-string.h>
+
+#include <zephyr/data/json.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+#include <errno.h>
+#include <string.h>
+
+LOG_MODULE_REGISTER(point_legacy, LOG_LEVEL_INF);
+
+// When transmitting points over web APIs using JSON, we encode
+// then using all text fields. The JSON encoder cannot encode fixed
+// length char fields, so we have use pointers for now.
+struct point_js {
+	char *t;                 // type
+	char *k;                 // key
+	char *dt;                // datatype
+	struct json_obj_token d; // data
+};
+
+#define POINT_JS_ARRAY_MAX 47
+
+struct point_js_array {
+	struct point_js points[POINT_JS_ARRAY_MAX];
+	size_t len;
+};
+
+static const struct json_obj_descr point_js_descr[] = {
+	JSON_OBJ_DESCR_PRIM(struct point_js, t, JSON_TOK_STRING),
+	JSON_OBJ_DESCR_PRIM(struct point_js, k, JSON_TOK_STRING),
+	JSON_OBJ_DESCR_PRIM(struct point_js, dt, JSON_TOK_STRING),
+	JSON_OBJ_DESCR_PRIM(struct point_js, d, JSON_TOK_OPAQUE)};
+
+static const struct json_obj_descr point_js_array_descr[] = {
+	JSON_OBJ_DESCR_OBJ_ARRAY(struct point_js_array, points, POINT_JS_ARRAY_MAX, len,
+				 point_js_descr, ARRAY_SIZE(point_js_descr)),
+};
+
+// point_js has pointers to strings, so the buf is used to store these strings
+// Note: this functions assumes the input point will be valid for the duration of
+// of the p_js lifecycle, as we are populating points to strings in the original
+// p.
+static void point_to_point_js(point *p, struct point_js *p_js, char *buf, size_t buf_len)
+{
+	p_js->t = p->type;
+	p_js->k = p->key;
+
+	switch (p->data_type) {
+	case POINT_DATA_TYPE_FLOAT: {
+		p_js->dt = POINT_DATA_TYPE_FLOAT_S;
+		// snprintf has caused problems in the past, so use a leaner custom version
+		int ret = ftoa_shortest(point_get_float(p), buf, buf_len);
+		p_js->d.start = buf;
+		p_js->d.length = ret < 0 ? 0 : ret;
+		break;
+	}
+	case POINT_DATA_TYPE_INT: {
+		p_js->dt = POINT_DATA_TYPE_INT_S;
+		int ret = itoa_i32(point_get_int(p), buf, buf_len);
+		p_js->d.start = buf;
+		p_js->d.length = ret < 0 ? 0 : ret;
+		break;
+	}
+	case POINT_DATA_TYPE_STRING:
+		p_js->dt = POINT_DATA_TYPE_STRING_S;
+		strncpy(buf, p->data, buf_len);
+		p_js->d.start = buf;
+		p_js->d.length = strlen(buf);
+		break;
+	default:
+		p_js->d.start = NULL;
+		p_js->d.length = 0;
+	}
+}
+
+static int point_js_to_point(struct point_js *p_js, point *p)
+{
+	int ret = 0;
+	p->time = 0;
+
+	if (p_js->t == NULL || p_js->k == NULL) {
+		LOG_ERR("Refusing to decode point with null type or key");
+		return -1;
+	}
+
+	strncpy(p->type, p_js->t, sizeof(p->type));
+	strncpy(p->key, p_js->k, sizeof(p->key));
+
+	if (strncmp(p_js->dt, POINT_DATA_TYPE_FLOAT_S, 3) == 0) {
+		p->data_type = POINT_DATA_TYPE_FLOAT;
+		ret = parse_float(p_js->d.start, p_js->d.length, (float *)p->data);
+	} else if (strncmp(p_js->dt, POINT_DATA_TYPE_INT_S, 3) == 0) {
+		p->data_type = POINT_DATA_TYPE_INT;
+		ret = parse_int(p_js->d.start, p_js->d.length, (int32_t *)p->data);
+	} else if (strncmp(p_js->dt, POINT_DATA_TYPE_STRING_S, 3) == 0) {
+		p->data_type = POINT_DATA_TYPE_STRING;
+		int cnt = MIN(p_js->d.length, sizeof(p->data) - 1);
+		memcpy(p->data, p_js->d.start, cnt);
+		// make sure string is null terminated
+		p->data[cnt] = 0;
+	} else {
+		p->data_type = POINT_DATA_TYPE_UNKNOWN;
+		p->data[0] = 0;
+		return -1;
+	}
+
+	if (ret == -ERANGE) {
+		// keep the saturated value, same as the sender overflowing
+		LOG_WRN("Point %s value out of range: %.*s", p->type, (int)p_js->d.length,
+			p_js->d.start);
+	} else if (ret < 0) {
+		LOG_ERR("Point %s has invalid value: %.*s", p->type, (int)p_js->d.length,
+			p_js->d.start);
+		p->data_type = POINT_DATA_TYPE_UNKNOWN;
+		p->data[0] = 0;
+		return ret;
+	}
+
+	return 0;
+}
+
+// all of the point_js fields MUST be filled in or the encoder will crash
+int point_json_encode_legacy(point *p, char *buf, size_t len)
+{
+	struct point_js p_js = {};
+
+	char data_buf[20];
+
+	point_to_point_js(p, &p_js, data_buf, sizeof(data_buf));
+
+	/* Calculate the encoded length. (could be smaller) */
+	ssize_t enc_len = json_calc_encoded_len(point_js_descr, ARRAY_SIZE(point_js_descr), &p_js);
+	if (enc_len > len) {
+		return -ENOMEM;
+	}
+
+	return json_obj_encode_buf(point_js_descr, ARRAY_SIZE(point_js_descr), &p_js, buf, len);
+}
+
+int point_json_decode_legacy(char *json, size_t json_len, point *p)
+{
+	struct point_js p_js = {};
+	int ret = json_obj_parse(json, json_len, point_js_descr, ARRAY_SIZE(point_js_descr), &p_js);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (p_js.t == NULL || p_js.k == NULL) {
+		LOG_ERR("Invalid JSON, does not have type or key");
+		return -200;
+	}
+
+	point_js_to_point(&p_js, p);
+	return 0;
+}
+
+// encodes only the points the filter returns true for. A NULL filter encodes
+// all points.
+static int points_json_encode_filter_legacy(point *pts_in, int count, point_filter filter,
+					    void *ctx, char *buf, size_t len)
+{
+	// buffers for data types and fields
+	char data_buf[POINT_JS_ARRAY_MAX][20];
+	struct point_js_array pts_out = {.len = 0};
+
+	if (count > POINT_JS_ARRAY_MAX) {
+		return -ENOMEM;
+	}
+
+	for (int i = 0; i < count; i++) {
+		// make sure it is not an empty point
+		if (pts_in[i].type[0] != 0 && (filter == NULL || filter(&pts_in[i], i, ctx))) {
+			point_to_point_js(&pts_in[i], &pts_out.points[pts_out.len],
+					  data_buf[pts_out.len], sizeof(data_buf[pts_out.len]));
+			pts_out.len++;
+		}
+	}
+
+	return json_arr_encode_buf(point_js_array_descr, &pts_out, buf, len);
+}
+
+int points_json_encode_legacy(point *pts_in, int count, char *buf, size_t len)
+{
+	return points_json_encode_filter_legacy(pts_in, count, NULL, NULL, buf, len);
+}
+
+// returns the number of points decoded, or less than 0 for error
+int points_json_decode_legacy(char *json, size_t json_len, point *pts, size_t p_cnt)
+{
+	struct point_js_array pts_js;
+
+	int ret = json_arr_parse(json, json_len, point_js_array_descr, &pts_js);
+	if (ret != 0) {
+		return ret;
+	}
+
+	if (pts_js.len > p_cnt) {
+		LOG_ERR("Points array decode, decoded more points than target array: %zu",
+			pts_js.len);
+	}
+
+	int len = MIN(p_cnt, pts_js.len);
+	int i;
+	for (i = 0; i < len; i++) {
+		point_js_to_point(&pts_js.points[i], &pts[i]);
+	}
+
+	return i;
+}
+
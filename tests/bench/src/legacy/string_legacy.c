@@ -0,0 +1,117 @@
+// itoa before table-driven formatting, and atoi and atof before they were
+// rebuilt on parse_int and parse_float
+
+#include "legacy.h"
+
+static void reverse_legacy(char *str, int length)
+{
+	int start = 0;
+	int end = length - 1;
+	while (start < end) {
+		char temp = str[start];
+		str[start] = str[end];
+		str[end] = temp;
+		start++;
+		end--;
+	}
+}
+
+char *itoa_legacy(int num, char *str, int base)
+{
+	int i = 0;
+	int isNegative = 0;
+
+	// Handle 0 explicitly
+	if (num == 0) {
+		str[i++] = '0';
+		str[i] = '\0';
+		return str;
+	}
+
+	// Handle negative numbers for base 10
+	if (num < 0 && base == 10) {
+		isNegative = 1;
+		num = -num;
+	}
+
+	// Process individual digits
+	while (num != 0) {
+		int rem = num % base;
+		str[i++] = (rem > 9) ? (rem - 10) + 'a' : rem + '0';
+		num = num / base;
+	}
+
+	// Append negative sign for base 10
+	if (isNegative) {
+		str[i++] = '-';
+	}
+
+	str[i] = '\0';
+
+	// Reverse the string
+	reverse_legacy(str, i);
+
+	return str;
+}
+
+int atoi_legacy(const char *str)
+{
+	int result = 0;
+	int sign = 1;
+	int i = 0;
+
+	// Handle negative numbers
+	if (str[0] == '-') {
+		sign = -1;
+		i++;
+	}
+
+	// Convert each digit
+	while (str[i] != '\0') {
+		if (str[i] >= '0' && str[i] <= '9') {
+			result = result * 10 + (str[i] - '0');
+		} else {
+			break; // Stop at non-digit character
+		}
+		i++;
+	}
+
+	return sign * result;
+}
+
+float atof_legacy(const char *str)
+{
+	float result = 0.0f;
+	float fraction = 0.1f;
+	int sign = 1;
+	int i = 0;
+	int in_fraction = 0;
+
+	// Handle negative numbers
+	if (str[0] == '-') {
+		sign = -1;
+		i++;
+	}
+
+	// Convert digits
+	while (str[i] != '\0') {
+		if (str[i] >= '0' && str[i] <= '9') {
+			if (!in_fraction) {
+				result = result * 10.0f + (str[i] - '0');
+			} else {
+				result += (str[i] - '0') * fraction;
+				fraction *= 0.1f;
+			}
+		} else if (str[i] == '.') {
+			if (in_fraction) {
+				break; // Multiple decimal points, invalid
+			}
+			in_fraction = 1;
+		} else {
+			break; // Stop at non-digit, non-decimal point character
+		}
+		i++;
+	}
+
+	return sign * result;
+}
@@ -0,0 +1,31 @@
+#include "bench.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+
+#ifdef CONFIG_ARCH_POSIX
+#include <posix_board_if.h>
+#endif
+
+int main(void)
+{
+	printk("SIOT library benchmarks on %s\n", CONFIG_BOARD_TARGET);
+	printk("BENCH_JSON {\"board\":\"%s\"}\n", CONFIG_BOARD_TARGET);
+
+	bench_html();
+	bench_string();
+	if (IS_ENABLED(CONFIG_BENCH_POINT)) {
+		bench_point();
+	}
+	if (IS_ENABLED(CONFIG_BENCH_GZIP)) {
+		bench_gzip();
+	}
+	bench_zbus();
+
+#ifdef CONFIG_ARCH_POSIX
+	posix_exit(0);
+#endif
+
+	return 0;
+}
@@ -0,0 +1,138 @@
+#include "bench.h"
+#include "legacy/legacy.h"
+
+#include <point.h>
+
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define ITERATIONS 1000
+
+// a mix of points like the siot-net web store holds
+static point pts[40];
+
+// each point encoded on its own, and the whole array
+static char pts_json[ARRAY_SIZE(pts)][96];
+static char array_json[4096];
+
+// JSON decoding with the Zephyr library modifies the input, so each decode
+// works on a copy
+static char work[4096];
+
+static void init_points(void)
+{
+	for (int i = 0; i < ARRAY_SIZE(pts); i++) {
+		point *p = &pts[i];
+		char key[8];
+
+		snprintf(key, sizeof(key), "%i", i);
+
+		switch (i % 4) {
+		case 0:
+			point_set_type_key(p, POINT_TYPE_TEMPERATURE, key);
+			point_put_float(p, 20.0f + i * 0.25f);
+			break;
+		case 1:
+			point_set_type_key(p, POINT_TYPE_METRIC_SYS_CPU_PERCENT, key);
+			point_put_float(p, 1.0f / (i + 1));
+			break;
+		case 2:
+			point_set_type_key(p, POINT_TYPE_UPTIME, key);
+			point_put_int(p, 1000 * i * i);
+			break;
+		default:
+			point_set_type_key(p, POINT_TYPE_DESCRIPTION, key);
+			point_put_string(p, "lab unit #3");
+		}
+
+		point_json_encode(p, pts_json[i], sizeof(pts_json[i]));
+	}
+
+	points_json_encode(pts, ARRAY_SIZE(pts), array_json, sizeof(array_json));
+}
+
+void bench_point(void)
+{
+	char buf[96];
+	point p;
+	uint32_t n = ITERATIONS * ARRAY_SIZE(pts);
+
+	init_points();
+
+	BENCH("point", "json_encode_legacy", n, {
+		point_json_encode_legacy(&pts[_i % ARRAY_SIZE(pts)], buf, sizeof(buf));
+		bench_sink += buf[0];
+	});
+
+	BENCH("point", "json_encode", n, {
+		point_json_encode(&pts[_i % ARRAY_SIZE(pts)], buf, sizeof(buf));
+		bench_sink += buf[0];
+	});
+
+	BENCH("point", "json_decode_legacy", n, {
+		const char *json = pts_json[_i % ARRAY_SIZE(pts)];
+		size_t len = strlen(json);
+		memcpy(work, json, len + 1);
+		point_json_decode_legacy(work, len, &p);
+		bench_sink += p.data_type;
+	});
+
+	BENCH("point", "json_decode", n, {
+		const char *json = pts_json[_i % ARRAY_SIZE(pts)];
+		size_t len = strlen(json);
+		memcpy(work, json, len + 1);
+		point_json_decode(work, len, &p);
+		bench_sink += p.data_type;
+	});
+
+	// arrays of 40 points, as served by /v1/points
+	static point out[ARRAY_SIZE(pts)];
+	size_t array_len = strlen(array_json);
+
+	BENCH("point", "json_array_encode_legacy", ITERATIONS, {
+		points_json_encode_legacy(pts, ARRAY_SIZE(pts), work, sizeof(work));
+		bench_sink += work[0];
+	});
+
+	BENCH("point", "json_array_encode", ITERATIONS, {
+		points_json_encode(pts, ARRAY_SIZE(pts), work, sizeof(work));
+		bench_sink += work[0];
+	});
+
+	// the binary form the uplink can send instead of JSON
+	BENCH("point", "bin_array_encode", ITERATIONS, {
+		bench_sink += points_bin_encode(pts, ARRAY_SIZE(pts), (uint8_t *)work,
+						sizeof(work));
+	});
+
+	BENCH("point", "json_array_decode_legacy", ITERATIONS, {
+		memcpy(work, array_json, array_len + 1);
+		bench_sink += points_json_decode_legacy(work, array_len, out, ARRAY_SIZE(out));
+	});
+
+	BENCH("point", "json_array_decode", ITERATIONS, {
+		memcpy(work, array_json, array_len + 1);
+		bench_sink += points_json_decode(work, array_len, out, ARRAY_SIZE(out));
+	});
+
+	// merging into an array filled to different levels. The point matches
+	// the last one filled, so the whole fill is scanned.
+	static const int fills[] = {10, 20, 40};
+
+	for (int f = 0; f < ARRAY_SIZE(fills); f++) {
+		int fill = fills[f];
+		char name[24];
+
+		memset(out, 0, sizeof(out));
+		memcpy(out, pts, fill * sizeof(point));
+		p = pts[fill - 1];
+
+		snprintk(name, sizeof(name), "merge_fill_%i", fill);
+		BENCH("point", name, n, {
+			bench_sink += points_merge(out, ARRAY_SIZE(out), &p);
+		});
+	}
+}
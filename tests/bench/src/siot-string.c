@@ -0,0 +1,136 @@
+#include "bench.h"
+#include "legacy/legacy.h"
+
+#include <siot-string.h>
+#include <zephyr/sys/util.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// stdlib.h can't be included as it conflicts with the atof in siot-string.h
+float strtof(const char *str, char **endptr);
+long strtol(const char *str, char **endptr, int base);
+
+#define ITERATIONS 2000
+
+// typical sensor and metric values, plus some large and small magnitudes
+static const float floats[] = {
+	23.5f, -40.0f,   0.1f,  1013.25f, 3.3f,     99.99f,   -0.0035f,    1234567.0f,
+	1e-7f, 6.02e23f, 12.0f, 4.75f,    65535.0f, -273.15f, 0.33333334f, 3.1415927f,
+};
+
+// counters, enums and ADC readings
+static const int32_t ints[] = {
+	0, 1, -1, 7, 42, 255, 1013, -273, 4095, 65535, 100000, -8388608, 16777215, INT32_MAX,
+	INT32_MIN, 3,
+};
+
+// uptimes in ns and byte counters
+static const uint64_t u64s[] = {
+	0, 1000, 86400000000000ull, 123456789012ull, 4294967296ull, UINT64_MAX,
+	3600000000ull, 18446744073ull,
+};
+
+// values as they arrive in point JSON
+static const char *const float_strs[] = {
+	"23.5", "-40", "0.1", "1013.25", "3.3", "99.99", "-0.0035", "1234567",
+	"1e-7", "6.02e23", "12", "4.75", "65535", "-273.15", "0.33333334", "3.1415927",
+};
+
+static const char *const int_strs[] = {
+	"0", "1", "-1", "42", "255", "1013", "-273", "65535", "100000", "2147483647",
+};
+
+void bench_string(void)
+{
+	size_t float_lens[ARRAY_SIZE(float_strs)];
+	size_t int_lens[ARRAY_SIZE(int_strs)];
+	char buf[32];
+	uint32_t n = ITERATIONS * ARRAY_SIZE(floats);
+
+	BENCH("string", "ftoa_precision_4", n, {
+		ftoa(floats[_i % ARRAY_SIZE(floats)], buf, 4);
+		bench_sink += buf[0];
+	});
+
+	BENCH("string", "ftoa_shortest", n, {
+		ftoa_shortest(floats[_i % ARRAY_SIZE(floats)], buf, sizeof(buf));
+		bench_sink += buf[0];
+	});
+
+	BENCH("string", "snprintf_g", n, {
+		snprintf(buf, sizeof(buf), "%g", (double)floats[_i % ARRAY_SIZE(floats)]);
+		bench_sink += buf[0];
+	});
+
+	BENCH("string", "snprintf_9g", n, {
+		snprintf(buf, sizeof(buf), "%.9g", (double)floats[_i % ARRAY_SIZE(floats)]);
+		bench_sink += buf[0];
+	});
+
+	n = ITERATIONS * ARRAY_SIZE(ints);
+
+	BENCH("string", "itoa_legacy", n, {
+		itoa_legacy(ints[_i % ARRAY_SIZE(ints)], buf, 10);
+		bench_sink += buf[0];
+	});
+
+	BENCH("string", "itoa_i32", n, {
+		itoa_i32(ints[_i % ARRAY_SIZE(ints)], buf, sizeof(buf));
+		bench_sink += buf[0];
+	});
+
+	BENCH("string", "snprintf_d", n, {
+		snprintf(buf, sizeof(buf), "%d", (int)ints[_i % ARRAY_SIZE(ints)]);
+		bench_sink += buf[0];
+	});
+
+	n = ITERATIONS * ARRAY_SIZE(u64s);
+
+	BENCH("string", "itoa_u64", n, {
+		itoa_u64(u64s[_i % ARRAY_SIZE(u64s)], buf, sizeof(buf));
+		bench_sink += buf[0];
+	});
+
+	for (int i = 0; i < ARRAY_SIZE(float_strs); i++) {
+		float_lens[i] = strlen(float_strs[i]);
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(int_strs); i++) {
+		int_lens[i] = strlen(int_strs[i]);
+	}
+
+	n = ITERATIONS * ARRAY_SIZE(float_strs);
+
+	BENCH("string", "atof_legacy", n, {
+		bench_sink += (int)atof_legacy(float_strs[_i % ARRAY_SIZE(float_strs)]);
+	});
+
+	BENCH("string", "parse_float", n, {
+		uint32_t j = _i % ARRAY_SIZE(float_strs);
+		float v;
+		parse_float(float_strs[j], float_lens[j], &v);
+		bench_sink += (int)v;
+	});
+
+	BENCH("string", "strtof", n, {
+		bench_sink += (int)strtof(float_strs[_i % ARRAY_SIZE(float_strs)], NULL);
+	});
+
+	n = ITERATIONS * ARRAY_SIZE(int_strs);
+
+	BENCH("string", "atoi_legacy", n, {
+		bench_sink += atoi_legacy(int_strs[_i % ARRAY_SIZE(int_strs)]);
+	});
+
+	BENCH("string", "parse_int", n, {
+		uint32_t j = _i % ARRAY_SIZE(int_strs);
+		int32_t v;
+		parse_int(int_strs[j], int_lens[j], &v);
+		bench_sink += v;
+	});
+
+	BENCH("string", "strtol", n, {
+		bench_sink += strtol(int_strs[_i % ARRAY_SIZE(int_strs)], NULL, 10);
+	});
+}
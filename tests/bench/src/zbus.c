@@ -0,0 +1,59 @@
+#include "bench.h"
+
+#include <point.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/zbus/zbus.h>
+
+#define ITERATIONS 1000
+
+// A separate channel with the same message type as point_chan, so the
+// library's own observers (NVS storage) do not see the benchmark points.
+ZBUS_MSG_SUBSCRIBER_DEFINE(bench_sub);
+ZBUS_CHAN_DEFINE(bench_chan, point, NULL, NULL, ZBUS_OBSERVERS(bench_sub), ZBUS_MSG_INIT(0));
+
+K_SEM_DEFINE(bench_zbus_received, 0, 1);
+
+// total publish to receive latency of the current round
+static uint64_t bench_zbus_ns;
+
+// point.time carries the publish time
+static void bench_zbus_thread(void *arg1, void *arg2, void *arg3)
+{
+	const struct zbus_channel *chan;
+	point p;
+
+	while (!zbus_sub_wait_msg(&bench_sub, &chan, &p, K_FOREVER)) {
+		bench_zbus_ns += bench_elapsed_ns(p.time);
+		k_sem_give(&bench_zbus_received);
+	}
+}
+
+// same priority as the application threads that consume points
+K_THREAD_DEFINE(bench_zbus, 1024, bench_zbus_thread, NULL, NULL, NULL, 7, 0, 0);
+
+void bench_zbus(void)
+{
+	uint64_t round_ns[BENCH_ROUNDS];
+	point p = {0};
+
+	point_set_type_key(&p, POINT_TYPE_TEMPERATURE, "0");
+	point_put_float(&p, 23.5f);
+
+	// one warm-up round, then the timed rounds
+	for (int r = -1; r < BENCH_ROUNDS; r++) {
+		bench_zbus_ns = 0;
+
+		for (int i = 0; i < ITERATIONS; i++) {
+			p.time = bench_start();
+			zbus_chan_pub(&bench_chan, &p, K_FOREVER);
+			k_sem_take(&bench_zbus_received, K_FOREVER);
+		}
+
+		if (r >= 0) {
+			round_ns[r] = bench_zbus_ns;
+		}
+	}
+
+	bench_report("zbus", "publish_to_receive", ITERATIONS, round_ns, BENCH_ROUNDS);
+}
@@ -0,0 +1,146 @@
+#include "gunzip.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+
+struct gunzip_in {
+	const uint8_t *buf;
+	size_t len;
+	size_t pos;
+	int bit;
+};
+
+static int gunzip_bits(struct gunzip_in *in, int count)
+{
+	int v = 0;
+
+	for (int i = 0; i < count; i++) {
+		if (in->pos >= in->len) {
+			return -EINVAL;
+		}
+		v |= ((in->buf[in->pos] >> in->bit) & 1) << i;
+		if (++in->bit == 8) {
+			in->bit = 0;
+			in->pos++;
+		}
+	}
+
+	return v;
+}
+
+// reads a Huffman code, which is packed starting at the most significant bit
+static int gunzip_code(struct gunzip_in *in, int code, int count)
+{
+	for (int i = 0; i < count; i++) {
+		int b = gunzip_bits(in, 1);
+		if (b < 0) {
+			return b;
+		}
+		code = (code << 1) | b;
+	}
+
+	return code;
+}
+
+// literal/length symbol with the fixed codes of RFC 1951 section 3.2.6
+static int gunzip_symbol(struct gunzip_in *in)
+{
+	int code = gunzip_code(in, 0, 7);
+
+	if (code < 0 || code <= 0x17) {
+		return code < 0 ? code : 256 + code;
+	}
+
+	code = gunzip_code(in, code, 1);
+	if (code >= 0x30 && code <= 0xBF) {
+		return code - 0x30;
+	} else if (code >= 0xC0 && code <= 0xC7) {
+		return 280 + code - 0xC0;
+	}
+
+	code = gunzip_code(in, code, 1);
+	if (code < 0) {
+		return code;
+	}
+
+	return 144 + code - 0x190;
+}
+
+static const uint16_t len_base[] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+				    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t len_extra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+				    2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t dist_base[] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+				     33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+				     1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+
+int test_gunzip(const uint8_t *src, size_t len, uint8_t *dst, size_t dst_len)
+{
+	struct gunzip_in in = {.buf = src, .len = len, .pos = 10};
+	size_t out = 0;
+	bool last = false;
+
+	// no optional header fields are written
+	if (len < 18 || src[0] != 0x1F || src[1] != 0x8B || src[2] != 8 || src[3] != 0) {
+		return -EINVAL;
+	}
+
+	while (!last) {
+		last = gunzip_bits(&in, 1) == 1;
+		if (gunzip_bits(&in, 2) != 1) {
+			return -ENOTSUP;
+		}
+
+		while (true) {
+			int sym = gunzip_symbol(&in);
+
+			if (sym < 0 || sym > 285) {
+				return -EINVAL;
+			} else if (sym < 256) {
+				if (out >= dst_len) {
+					return -ENOMEM;
+				}
+				dst[out++] = sym;
+				continue;
+			} else if (sym == 256) {
+				break;
+			}
+
+			int extra = gunzip_bits(&in, len_extra[sym - 257]);
+			int d = gunzip_code(&in, 0, 5);
+			if (extra < 0 || d < 0 || d >= 30) {
+				return -EINVAL;
+			}
+			int dist_extra = gunzip_bits(&in, d < 4 ? 0 : d / 2 - 1);
+			if (dist_extra < 0) {
+				return -EINVAL;
+			}
+
+			size_t match = len_base[sym - 257] + extra;
+			size_t dist = dist_base[d] + dist_extra;
+
+			if (dist > out) {
+				return -EINVAL;
+			}
+			if (out + match > dst_len) {
+				return -ENOMEM;
+			}
+			for (size_t i = 0; i < match; i++, out++) {
+				dst[out] = dst[out - dist];
+			}
+		}
+	}
+
+	// the trailer starts at the next byte
+	if (in.bit > 0) {
+		in.pos++;
+	}
+	if (in.pos + 8 != len || sys_get_le32(src + in.pos) != crc32_ieee(dst, out) ||
+	    sys_get_le32(src + in.pos + 4) != out) {
+		return -EINVAL;
+	}
+
+	return out;
+}
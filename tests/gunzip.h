@@ -0,0 +1,13 @@
+#ifndef __TEST_GUNZIP_H_
+#define __TEST_GUNZIP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Decompresses the gzip data written by gzip_compress, to check it in tests.
+// Only the fixed Huffman blocks it writes are supported. Returns the length of
+// the data, or less than 0 if it is invalid, including a CRC or length that
+// does not match.
+int test_gunzip(const uint8_t *src, size_t len, uint8_t *dst, size_t dst_len);
+
+#endif // __TEST_GUNZIP_H_
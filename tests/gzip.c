@@ -0,0 +1,102 @@
+#include "gunzip.h"
+#include "gzip.h"
+#include "point.h"
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/ztest.h>
+
+LOG_MODULE_REGISTER(gzip_tests, LOG_LEVEL_DBG);
+
+ZTEST_SUITE(gzip_tests, NULL, NULL, NULL, NULL, NULL);
+
+static struct gzip gz;
+static uint8_t src[4096], dst[GZIP_MAX_LEN(4096)], out[4096];
+
+// compresses len bytes of src, and checks they decompress to the same
+static int round_trip(size_t len)
+{
+	int n = gzip_compress(&gz, src, len, dst, sizeof(dst));
+
+	zassert_true(n > 0, "compress %zu: %i", len, n);
+	zassert_true(n <= GZIP_MAX_LEN(len));
+	zassert_equal(test_gunzip(dst, n, out, sizeof(out)), len, "length %zu", len);
+	zassert_mem_equal(out, src, len, "length %zu", len);
+
+	return n;
+}
+
+ZTEST(gzip_tests, header_trailer)
+{
+	memcpy(src, "hello hello hello", 17);
+
+	int n = round_trip(17);
+
+	zassert_equal(dst[0], 0x1F);
+	zassert_equal(dst[1], 0x8B);
+	zassert_equal(dst[2], 8, "method is deflate");
+	zassert_equal(sys_get_le32(dst + n - 8), crc32_ieee(src, 17));
+	zassert_equal(sys_get_le32(dst + n - 4), 17);
+}
+
+ZTEST(gzip_tests, empty)
+{
+	zassert_equal(round_trip(0), 20);
+}
+
+ZTEST(gzip_tests, random)
+{
+	uint32_t x = 1;
+
+	// nothing to match, so this is the worst case length
+	for (int i = 0; i < sizeof(src); i++) {
+		x = x * 1103515245 + 12345;
+		src[i] = x >> 24;
+	}
+
+	for (int len = 1; len < 300; len++) {
+		round_trip(len);
+	}
+	round_trip(sizeof(src));
+}
+
+ZTEST(gzip_tests, runs)
+{
+	// matches longer than the longest deflate match, and overlapping ones
+	memset(src, 'a', sizeof(src));
+	zassert_true(round_trip(sizeof(src)) < 64);
+
+	for (int i = 0; i < sizeof(src); i++) {
+		src[i] = "abc"[i % 3];
+	}
+	round_trip(sizeof(src));
+}
+
+ZTEST(gzip_tests, points_json)
+{
+	point pts[32];
+
+	for (int i = 0; i < ARRAY_SIZE(pts); i++) {
+		memset(&pts[i], 0, sizeof(pts[i]));
+		point_set_type_key(&pts[i], POINT_TYPE_TEMPERATURE, i % 2 ? "1" : "0");
+		point_put_float(&pts[i], 20.5f + i * 0.25f);
+	}
+
+	zassert_ok(points_json_encode(pts, ARRAY_SIZE(pts), (char *)src, sizeof(src)));
+	size_t len = strlen((char *)src);
+
+	// the keys repeated in every point are mostly what is left out
+	int n = round_trip(len);
+	LOG_INF("%zu bytes of JSON compressed to %i", len, n);
+	zassert_true(n < len / 3, "compressed to %i of %zu", n, len);
+}
+
+ZTEST(gzip_tests, errors)
+{
+	memset(src, 'x', 100);
+
+	zassert_equal(gzip_compress(&gz, src, 100, dst, 10), -ENOMEM);
+	zassert_equal(gzip_compress(&gz, src, 100, dst, 15), -ENOMEM);
+	zassert_equal(gzip_compress(&gz, src, UINT16_MAX + 1, dst, sizeof(dst)), -EINVAL);
+}
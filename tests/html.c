@@ -0,0 +1,192 @@
+#include "html.h"
+#include <zephyr/logging/log.h>
+#include <zephyr/ztest.h>
+
+LOG_MODULE_REGISTER(html_tests, LOG_LEVEL_DBG);
+
+ZTEST_SUITE(html_tests, NULL, NULL, NULL, NULL, NULL);
+
+// fields are appended to out as key|value;
+struct form_result {
+	char out[256];
+	int count;
+};
+
+static int form_cb(const char *key, const char *value, void *ctx)
+{
+	struct form_result *r = ctx;
+
+	strcat(r->out, key);
+	strcat(r->out, "|");
+	strcat(r->out, value);
+	strcat(r->out, ";");
+	r->count++;
+
+	return 0;
+}
+
+// parses body fed in chunks of chunk bytes
+static int parse_form(const char *body, size_t chunk, char *buf, size_t buf_len,
+		      struct form_result *r)
+{
+	struct html_form_parser p;
+	size_t len = strlen(body);
+	int ret = 0;
+
+	memset(r, 0, sizeof(*r));
+	html_form_parser_init(&p, buf, buf_len, form_cb, r);
+
+	for (size_t i = 0; i < len && ret == 0; i += chunk) {
+		ret = html_form_parser_feed(&p, body + i, MIN(chunk, len - i));
+	}
+
+	if (ret == 0) {
+		ret = html_form_parser_finish(&p);
+	}
+
+	return ret;
+}
+
+ZTEST(html_tests, form_parse)
+{
+	const char *body = "did=abc&ipaddr=10.0.0.1&ipstatic=on";
+	struct form_result r;
+	char buf[32];
+
+	zassert_equal(parse_form(body, strlen(body), buf, sizeof(buf), &r), 0);
+	zassert_equal(r.count, 3);
+	zassert_str_equal(r.out, "did|abc;ipaddr|10.0.0.1;ipstatic|on;");
+}
+
+ZTEST(html_tests, form_parse_chunked)
+{
+	// every split point, including inside escapes, must give the same result
+	const char *body = "a=hello+world%21&%41%42=%e2%82%ac&c=1=2";
+	struct form_result r;
+	char buf[32];
+
+	for (size_t chunk = 1; chunk <= strlen(body); chunk++) {
+		zassert_equal(parse_form(body, chunk, buf, sizeof(buf), &r), 0);
+		zassert_str_equal(r.out, "a|hello world!;AB|\xe2\x82\xac;c|1=2;", "chunk %zu",
+				  chunk);
+	}
+}
+
+ZTEST(html_tests, form_parse_edge_cases)
+{
+	struct form_result r;
+	char buf[32];
+
+	// empty fields are skipped, and a missing value is empty
+	zassert_equal(parse_form("k&&=v&x=", 3, buf, sizeof(buf), &r), 0);
+	zassert_str_equal(r.out, "k|;|v;x|;");
+
+	// invalid escapes are passed through
+	zassert_equal(parse_form("b=%2x&c=%", 1, buf, sizeof(buf), &r), 0);
+	zassert_str_equal(r.out, "b|%2x;c|%;");
+
+	zassert_equal(parse_form("", 1, buf, sizeof(buf), &r), 0);
+	zassert_equal(r.count, 0);
+}
+
+ZTEST(html_tests, form_parse_overflow)
+{
+	struct form_result r;
+	char buf[16];
+
+	// key, value and two terminators need 16 bytes
+	zassert_equal(parse_form("abcdef=ghijklmn", 4, buf, sizeof(buf), &r), 0);
+	zassert_equal(parse_form("abcdef=ghijklmno&x=1", 4, buf, sizeof(buf), &r), -ENOMEM);
+	zassert_equal(r.count, 0);
+}
+
+static struct form_result legacy_result;
+
+static void legacy_cb(char *key, char *value)
+{
+	form_cb(key, value, &legacy_result);
+}
+
+ZTEST(html_tests, form_parse_data)
+{
+	char body[200];
+	char want[sizeof(legacy_result.out)];
+
+	// keys are decoded like values, and '=' in a value is kept
+	memset(&legacy_result, 0, sizeof(legacy_result));
+	html_parse_form_data("%41b=1=2&c=x+y", legacy_cb);
+	zassert_str_equal(legacy_result.out, "Ab|1=2;c|x y;");
+
+	// fields are not limited to a fixed buffer size
+	memset(body, 'v', sizeof(body) - 1);
+	body[sizeof(body) - 1] = 0;
+	memcpy(body, "k=", 2);
+	snprintf(want, sizeof(want), "k|%s;", body + 2);
+
+	memset(&legacy_result, 0, sizeof(legacy_result));
+	html_parse_form_data(body, legacy_cb);
+	zassert_equal(legacy_result.count, 1);
+	zassert_str_equal(legacy_result.out, want);
+}
+
+static int stop_cb(const char *key, const char *value, void *ctx)
+{
+	(*(int *)ctx)++;
+	return -ECANCELED;
+}
+
+ZTEST(html_tests, form_parse_callback_error)
+{
+	struct html_form_parser p;
+	char buf[16];
+	int count = 0;
+
+	html_form_parser_init(&p, buf, sizeof(buf), stop_cb, &count);
+	zassert_equal(html_form_parser_feed(&p, "a=1&b=2&c=3", 11), -ECANCELED);
+	zassert_equal(html_form_parser_finish(&p), -ECANCELED);
+	zassert_equal(count, 1);
+}
+
+ZTEST(html_tests, etag_match)
+{
+	zassert_false(html_etag_match(NULL, "\"p1-5\""));
+	zassert_true(html_etag_match("\"p1-5\"", "\"p1-5\""));
+	zassert_true(html_etag_match("\"a\", \"p1-5\"", "\"p1-5\""));
+	zassert_true(html_etag_match("*", "\"p1-5\""));
+	zassert_false(html_etag_match("\"p1-55\"", "\"p1-5\""));
+
+	// the two encodings never match each other
+	zassert_false(html_etag_match("\"p1-5-gz\"", "\"p1-5\""));
+	zassert_false(html_etag_match("\"p1-5\"", "\"p1-5-gz\""));
+}
+
+ZTEST(html_tests, etag_gzip)
+{
+	char etag[12] = "\"p1-5\"";
+
+	zassert_ok(html_etag_gzip(etag, sizeof(etag)));
+	zassert_str_equal(etag, "\"p1-5-gz\"");
+
+	strcpy(etag, "\"p1-5000\"");
+	zassert_equal(html_etag_gzip(etag, sizeof(etag)), -ENOMEM);
+	zassert_str_equal(etag, "\"p1-5000\"");
+}
+
+ZTEST(html_tests, etag_match_gzip)
+{
+	char etag[16] = "\"p1-5\"";
+
+	// a body under 256 bytes is sent as is to a client that accepts gzip,
+	// which then revalidates with the plain tag
+	zassert_true(html_etag_match_gzip("\"p1-5\"", etag, sizeof(etag)));
+	zassert_str_equal(etag, "\"p1-5\"");
+
+	zassert_true(html_etag_match_gzip("\"p1-5-gz\"", etag, sizeof(etag)));
+	zassert_str_equal(etag, "\"p1-5-gz\"");
+
+	strcpy(etag, "\"p1-6\"");
+	zassert_false(html_etag_match_gzip("\"p1-5-gz\"", etag, sizeof(etag)));
+	zassert_str_equal(etag, "\"p1-6\"");
+	zassert_false(html_etag_match_gzip(NULL, etag, sizeof(etag)));
+	zassert_str_equal(etag, "\"p1-6\"");
+}
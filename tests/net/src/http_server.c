@@ -0,0 +1,201 @@
+#include "http_server.h"
+#include "gunzip.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/socket.h>
+
+LOG_MODULE_REGISTER(test_http_server, LOG_LEVEL_INF);
+
+K_MSGQ_DEFINE(test_http_requests, sizeof(struct test_http_request), 4, 4);
+
+static atomic_t response_status = ATOMIC_INIT(200);
+static atomic_t close_after;
+static atomic_t refuse_encoding;
+
+void test_http_server_status(int status)
+{
+	atomic_set(&response_status, status);
+}
+
+void test_http_server_refuse_encoding(bool refuse)
+{
+	atomic_set(&refuse_encoding, refuse);
+}
+
+void test_http_server_close_after(int n)
+{
+	atomic_set(&close_after, n);
+}
+
+int test_http_server_get(struct test_http_request *req, int timeout_ms)
+{
+	return k_msgq_get(&test_http_requests, req, K_MSEC(timeout_ms));
+}
+
+void test_http_server_reset(void)
+{
+	k_msgq_purge(&test_http_requests);
+}
+
+// returns the value of header name in the headers, or NULL
+static const char *find_header(const char *headers, const char *name)
+{
+	size_t name_len = strlen(name);
+	const char *line = strstr(headers, "\r\n");
+
+	while (line != NULL && line[2] != '\r') {
+		line += 2;
+		if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+			const char *v = line + name_len + 1;
+			while (*v == ' ') {
+				v++;
+			}
+			return v;
+		}
+		line = strstr(line, "\r\n");
+	}
+
+	return NULL;
+}
+
+static char conn_buf[4096];
+
+// serves requests on one connection until it is closed
+static void serve_conn(int fd)
+{
+	static struct test_http_request req;
+	size_t len = 0;
+	int requests = 0;
+
+	while (true) {
+		char *end;
+
+		// read the headers
+		while ((end = strstr(conn_buf, "\r\n\r\n")) == NULL) {
+			ssize_t n = zsock_recv(fd, conn_buf + len, sizeof(conn_buf) - 1 - len, 0);
+			if (n <= 0) {
+				return;
+			}
+			len += n;
+			conn_buf[len] = 0;
+		}
+
+		size_t header_len = end + 4 - conn_buf;
+		const char *cl = find_header(conn_buf, "Content-Length");
+		const char *conn = find_header(conn_buf, "Connection");
+		size_t body_len = cl ? strtoul(cl, NULL, 10) : 0;
+		bool conn_close = conn != NULL && strncasecmp(conn, "close", 5) == 0;
+
+		memset(&req, 0, sizeof(req));
+		sscanf(conn_buf, "%7s %63s", req.method, req.path);
+		const char *ct = find_header(conn_buf, "Content-Type");
+		if (ct != NULL) {
+			sscanf(ct, "%31[^\r]", req.content_type);
+		}
+		const char *ce = find_header(conn_buf, "Content-Encoding");
+		if (ce != NULL) {
+			sscanf(ce, "%15[^\r]", req.content_encoding);
+		}
+		const char *seq = find_header(conn_buf, "X-Siot-Seq");
+		req.seq = seq != NULL ? strtol(seq, NULL, 10) : -1;
+		req.conn_requests = ++requests;
+		// like a server that closes idle connections, without telling
+		// the client
+		if (atomic_get(&close_after) > 0 && requests >= atomic_get(&close_after)) {
+			conn_close = true;
+		}
+
+		if (header_len + body_len > sizeof(conn_buf) - 1) {
+			LOG_ERR("Request too large: %zu", body_len);
+			return;
+		}
+
+		// read the body
+		while (len < header_len + body_len) {
+			ssize_t n = zsock_recv(fd, conn_buf + len, sizeof(conn_buf) - 1 - len, 0);
+			if (n <= 0) {
+				return;
+			}
+			len += n;
+		}
+
+		int status = atomic_get(&response_status);
+
+		if (req.content_encoding[0] != 0 && atomic_get(&refuse_encoding)) {
+			status = 415;
+			req.body_len = 0;
+		} else if (strcmp(req.content_encoding, "gzip") == 0) {
+			int n = test_gunzip((const uint8_t *)conn_buf + header_len, body_len,
+					    (uint8_t *)req.body, sizeof(req.body) - 1);
+			if (n < 0) {
+				LOG_ERR("Invalid gzip body: %i", n);
+				status = 400;
+			}
+			req.body_len = MAX(n, 0);
+		} else {
+			req.body_len = MIN(body_len, sizeof(req.body) - 1);
+			memcpy(req.body, conn_buf + header_len, req.body_len);
+		}
+		k_msgq_put(&test_http_requests, &req, K_NO_WAIT);
+
+		// keep anything that came after this request
+		len -= header_len + body_len;
+		memmove(conn_buf, conn_buf + header_len + body_len, len);
+		conn_buf[len] = 0;
+
+		char rsp[64];
+		int rsp_len = snprintf(rsp, sizeof(rsp), "HTTP/1.1 %i X\r\nContent-Length: 0\r\n\r\n",
+				       status);
+		if (zsock_send(fd, rsp, rsp_len, 0) < 0 || conn_close) {
+			return;
+		}
+	}
+}
+
+static void test_http_server_thread(void *arg1, void *arg2, void *arg3)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(TEST_HTTP_SERVER_PORT),
+		.sin_addr = INADDR_ANY_INIT,
+	};
+	int opt = 1;
+
+	int fd = zsock_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (fd < 0 || zsock_setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) ||
+	    zsock_bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || zsock_listen(fd, 2)) {
+		LOG_ERR("Error starting test HTTP server: %i", errno);
+		return;
+	}
+
+	while (true) {
+		int c = zsock_accept(fd, NULL, NULL);
+		if (c < 0) {
+			LOG_ERR("Error accepting connection: %i", errno);
+			continue;
+		}
+
+		conn_buf[0] = 0;
+		serve_conn(c);
+		zsock_close(c);
+	}
+}
+
+K_THREAD_DEFINE(test_http_server, 2048, test_http_server_thread, NULL, NULL, NULL, 5, 0,
+		SYS_FOREVER_MS);
+
+void test_http_server_start(void)
+{
+	static bool started;
+
+	if (!started) {
+		k_thread_start(test_http_server);
+		started = true;
+	}
+}
@@ -0,0 +1,47 @@
+#ifndef __TEST_HTTP_SERVER_H_
+#define __TEST_HTTP_SERVER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A minimal HTTP server on the loopback interface that stands in for a cloud
+// server in tests. It records the body of each request, decompressed if it was
+// sent with Content-Encoding: gzip, and answers with the status set by
+// test_http_server_status.
+
+#define TEST_HTTP_SERVER_PORT 8080
+
+struct test_http_request {
+	char method[8];
+	char path[64];
+	char content_type[32];
+	char content_encoding[16];
+	// X-Siot-Seq header, or -1 without one
+	long seq;
+	char body[2048];
+	size_t body_len;
+	// request number on its connection, starting at 1
+	int conn_requests;
+};
+
+// starts the server, safe to call more than once
+void test_http_server_start(void);
+
+// status of the following responses, 200 by default
+void test_http_server_status(int status);
+
+// answers 415 Unsupported Media Type to requests with a Content-Encoding
+void test_http_server_refuse_encoding(bool refuse);
+
+// closes connections after n requests without a Connection: close header, 0
+// keeps them open until the client closes them
+void test_http_server_close_after(int n);
+
+// waits for the next request
+int test_http_server_get(struct test_http_request *req, int timeout_ms);
+
+// drops requests that have not been read
+void test_http_server_reset(void);
+
+#endif // __TEST_HTTP_SERVER_H_
@@ -0,0 +1,160 @@
+#include "modbus_sim.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/sys/byteorder.h>
+
+LOG_MODULE_REGISTER(test_modbus_sim, LOG_LEVEL_INF);
+
+K_MSGQ_DEFINE(test_modbus_requests, sizeof(struct test_modbus_request), 32, 4);
+
+K_MUTEX_DEFINE(sim_lock);
+static uint16_t coils[TEST_MODBUS_SIM_REGS];
+static uint16_t input_regs[TEST_MODBUS_SIM_REGS];
+static uint16_t holding_regs[TEST_MODBUS_SIM_REGS];
+
+static uint16_t *sim_table(uint8_t fc)
+{
+	switch (fc) {
+	case 1:
+		return coils;
+	case 3:
+		return holding_regs;
+	case 4:
+		return input_regs;
+	default:
+		return NULL;
+	}
+}
+
+void test_modbus_sim_set(uint8_t fc, uint16_t addr, uint16_t value)
+{
+	k_mutex_lock(&sim_lock, K_FOREVER);
+	sim_table(fc)[addr] = value;
+	k_mutex_unlock(&sim_lock);
+}
+
+int test_modbus_sim_get(struct test_modbus_request *req, int timeout_ms)
+{
+	return k_msgq_get(&test_modbus_requests, req, K_MSEC(timeout_ms));
+}
+
+void test_modbus_sim_reset(void)
+{
+	k_msgq_purge(&test_modbus_requests);
+}
+
+// answers a read request PDU, and returns the length of the response PDU
+static size_t handle_pdu(const uint8_t *req, uint8_t *rsp)
+{
+	struct test_modbus_request r = {
+		.fc = req[0],
+		.start = sys_get_be16(req + 1),
+		.count = sys_get_be16(req + 3),
+		.time_ms = k_uptime_get(),
+	};
+	uint16_t *table = sim_table(r.fc);
+
+	k_msgq_put(&test_modbus_requests, &r, K_NO_WAIT);
+
+	if (table == NULL) {
+		rsp[0] = r.fc | 0x80;
+		rsp[1] = 1;
+		return 2;
+	}
+
+	if (r.count < 1 || r.start + r.count > TEST_MODBUS_SIM_REGS) {
+		rsp[0] = r.fc | 0x80;
+		rsp[1] = 2;
+		return 2;
+	}
+
+	rsp[0] = r.fc;
+	rsp[1] = r.fc == 1 ? (r.count + 7) / 8 : r.count * 2;
+	memset(rsp + 2, 0, rsp[1]);
+
+	k_mutex_lock(&sim_lock, K_FOREVER);
+	for (int i = 0; i < r.count; i++) {
+		if (r.fc == 1) {
+			rsp[2 + i / 8] |= (table[r.start + i] != 0) << (i % 8);
+		} else {
+			sys_put_be16(table[r.start + i], rsp + 2 + i * 2);
+		}
+	}
+	k_mutex_unlock(&sim_lock);
+
+	return 2 + rsp[1];
+}
+
+static void serve_conn(int fd)
+{
+	uint8_t buf[260];
+	uint8_t rsp[260];
+	size_t len = 0;
+
+	while (true) {
+		ssize_t n = zsock_recv(fd, buf + len, sizeof(buf) - len, 0);
+		if (n <= 0) {
+			return;
+		}
+		len += n;
+
+		while (len >= 7 && len >= 6 + sys_get_be16(buf + 4)) {
+			size_t adu_len = 6 + sys_get_be16(buf + 4);
+			size_t rsp_len = handle_pdu(buf + 7, rsp + 7);
+
+			memcpy(rsp, buf, 7);
+			sys_put_be16(rsp_len + 1, rsp + 4);
+			if (zsock_send(fd, rsp, 7 + rsp_len, 0) != 7 + rsp_len) {
+				return;
+			}
+
+			len -= adu_len;
+			memmove(buf, buf + adu_len, len);
+		}
+	}
+}
+
+static void test_modbus_sim_thread(void *arg1, void *arg2, void *arg3)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(TEST_MODBUS_SIM_PORT),
+		.sin_addr = INADDR_ANY_INIT,
+	};
+	int opt = 1;
+
+	int fd = zsock_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (fd < 0 || zsock_setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) ||
+	    zsock_bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || zsock_listen(fd, 2)) {
+		LOG_ERR("Error starting test Modbus device: %i", errno);
+		return;
+	}
+
+	while (true) {
+		int c = zsock_accept(fd, NULL, NULL);
+		if (c < 0) {
+			LOG_ERR("Error accepting connection: %i", errno);
+			continue;
+		}
+
+		serve_conn(c);
+		zsock_close(c);
+	}
+}
+
+K_THREAD_DEFINE(test_modbus_sim, 2048, test_modbus_sim_thread, NULL, NULL, NULL, 5, 0,
+		SYS_FOREVER_MS);
+
+void test_modbus_sim_start(void)
+{
+	static bool started;
+
+	if (!started) {
+		k_thread_start(test_modbus_sim);
+		started = true;
+	}
+}
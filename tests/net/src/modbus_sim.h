@@ -0,0 +1,33 @@
+#ifndef __TEST_MODBUS_SIM_H_
+#define __TEST_MODBUS_SIM_H_
+
+#include <stdint.h>
+
+// A minimal Modbus TCP device on the loopback interface that stands in for a
+// real one in tests. It has 64 coils, input registers and holding registers,
+// records the read requests it answers, and answers reads outside them with
+// exception 2.
+
+#define TEST_MODBUS_SIM_PORT 1502
+#define TEST_MODBUS_SIM_REGS 64
+
+struct test_modbus_request {
+	uint8_t fc;
+	uint16_t start;
+	uint16_t count;
+	int64_t time_ms;
+};
+
+// starts the device, safe to call more than once
+void test_modbus_sim_start(void);
+
+// sets a register, or a coil with fc 1
+void test_modbus_sim_set(uint8_t fc, uint16_t addr, uint16_t value);
+
+// waits for the next read request
+int test_modbus_sim_get(struct test_modbus_request *req, int timeout_ms);
+
+// drops requests that have not been read
+void test_modbus_sim_reset(void);
+
+#endif // __TEST_MODBUS_SIM_H_
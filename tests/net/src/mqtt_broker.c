@@ -0,0 +1,299 @@
+#include "mqtt_broker.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/sys/byteorder.h>
+
+LOG_MODULE_REGISTER(test_mqtt_broker, LOG_LEVEL_INF);
+
+K_MSGQ_DEFINE(test_mqtt_publishes, sizeof(struct test_mqtt_publish), 8, 4);
+K_MSGQ_DEFINE(test_mqtt_acks, sizeof(uint16_t), 4, 2);
+
+// the connection is written by the broker thread and the tests
+K_MUTEX_DEFINE(broker_lock);
+static int conn_fd = -1;
+static bool hold_acks;
+static uint16_t held_acks[16];
+static int held_count;
+
+static atomic_t drop_conn;
+static atomic_t connects;
+static char subscription[64];
+
+static int broker_send(const uint8_t *buf, size_t len)
+{
+	int ret = 0;
+
+	k_mutex_lock(&broker_lock, K_FOREVER);
+	if (conn_fd < 0 || zsock_send(conn_fd, buf, len, 0) != len) {
+		ret = -ENOTCONN;
+	}
+	k_mutex_unlock(&broker_lock);
+
+	return ret;
+}
+
+static int broker_send_id(uint8_t type, uint16_t id)
+{
+	uint8_t buf[4] = {type, 2};
+
+	sys_put_be16(id, buf + 2);
+
+	return broker_send(buf, sizeof(buf));
+}
+
+void test_mqtt_broker_hold_acks(bool hold)
+{
+	k_mutex_lock(&broker_lock, K_FOREVER);
+	hold_acks = hold;
+	if (!hold) {
+		for (int i = 0; i < held_count; i++) {
+			broker_send_id(0x40, held_acks[i]);
+		}
+		held_count = 0;
+	}
+	k_mutex_unlock(&broker_lock);
+}
+
+int test_mqtt_broker_send(const char *topic, const char *payload, uint16_t id)
+{
+	uint8_t buf[256];
+	size_t topic_len = strlen(topic);
+	size_t payload_len = strlen(payload);
+	size_t rem = 2 + topic_len + (id ? 2 : 0) + payload_len;
+	size_t pos = 0;
+
+	if (rem > 127 + 127 * 128 || rem + 3 > sizeof(buf)) {
+		return -ENOMEM;
+	}
+
+	buf[pos++] = 0x30 | (id ? 0x02 : 0);
+	if (rem > 127) {
+		buf[pos++] = 0x80 | (rem % 128);
+		buf[pos++] = rem / 128;
+	} else {
+		buf[pos++] = rem;
+	}
+	sys_put_be16(topic_len, buf + pos);
+	memcpy(buf + pos + 2, topic, topic_len);
+	pos += 2 + topic_len;
+	if (id) {
+		sys_put_be16(id, buf + pos);
+		pos += 2;
+	}
+	memcpy(buf + pos, payload, payload_len);
+
+	return broker_send(buf, pos + payload_len);
+}
+
+int test_mqtt_broker_get(struct test_mqtt_publish *pub, int timeout_ms)
+{
+	return k_msgq_get(&test_mqtt_publishes, pub, K_MSEC(timeout_ms));
+}
+
+int test_mqtt_broker_get_ack(int timeout_ms)
+{
+	uint16_t id;
+
+	int ret = k_msgq_get(&test_mqtt_acks, &id, K_MSEC(timeout_ms));
+
+	return ret ? ret : id;
+}
+
+void test_mqtt_broker_reset(void)
+{
+	k_msgq_purge(&test_mqtt_publishes);
+	k_msgq_purge(&test_mqtt_acks);
+}
+
+void test_mqtt_broker_disconnect(void)
+{
+	atomic_set(&drop_conn, 1);
+}
+
+int test_mqtt_broker_connects(void)
+{
+	return atomic_get(&connects);
+}
+
+const char *test_mqtt_broker_subscription(void)
+{
+	return subscription;
+}
+
+static void handle_publish(uint8_t flags, const uint8_t *body, size_t len)
+{
+	static struct test_mqtt_publish pub;
+	size_t topic_len = sys_get_be16(body);
+	size_t off = 2 + topic_len;
+
+	memset(&pub, 0, sizeof(pub));
+	pub.qos = (flags >> 1) & 3;
+	pub.retain = flags & 1;
+	memcpy(pub.topic, body + 2, MIN(topic_len, sizeof(pub.topic) - 1));
+	if (pub.qos > 0) {
+		pub.id = sys_get_be16(body + off);
+		off += 2;
+	}
+	pub.payload_len = MIN(len - off, sizeof(pub.payload) - 1);
+	memcpy(pub.payload, body + off, pub.payload_len);
+	k_msgq_put(&test_mqtt_publishes, &pub, K_NO_WAIT);
+
+	if (pub.qos == 0) {
+		return;
+	}
+
+	k_mutex_lock(&broker_lock, K_FOREVER);
+	if (hold_acks && held_count < ARRAY_SIZE(held_acks)) {
+		held_acks[held_count++] = pub.id;
+	} else {
+		broker_send_id(0x40, pub.id);
+	}
+	k_mutex_unlock(&broker_lock);
+}
+
+// returns less than 0 to close the connection
+static int handle_packet(uint8_t type, const uint8_t *body, size_t len)
+{
+	switch (type & 0xF0) {
+	case 0x10: {
+		static const uint8_t connack[] = {0x20, 2, 0, 0};
+
+		atomic_inc(&connects);
+		return broker_send(connack, sizeof(connack));
+	}
+	case 0x30:
+		handle_publish(type & 0x0F, body, len);
+		return 0;
+	case 0x40: {
+		uint16_t id = sys_get_be16(body);
+
+		k_msgq_put(&test_mqtt_acks, &id, K_NO_WAIT);
+		return 0;
+	}
+	case 0x80: {
+		uint8_t suback[5] = {0x90, 3, body[0], body[1], 1};
+		size_t topic_len = sys_get_be16(body + 2);
+
+		snprintf(subscription, sizeof(subscription), "%.*s", (int)topic_len, body + 4);
+		return broker_send(suback, sizeof(suback));
+	}
+	case 0xC0: {
+		static const uint8_t pingresp[] = {0xD0, 0};
+
+		return broker_send(pingresp, sizeof(pingresp));
+	}
+	case 0xE0:
+		return -ECONNRESET;
+	default:
+		LOG_ERR("Unexpected packet type: 0x%02x", type);
+		return -EBADMSG;
+	}
+}
+
+// serves the client until it closes the connection, or the test drops it
+static void serve_conn(int fd)
+{
+	static uint8_t buf[2048];
+	size_t len = 0;
+
+	while (!atomic_get(&drop_conn)) {
+		struct zsock_pollfd pfd = {.fd = fd, .events = ZSOCK_POLLIN};
+
+		if (zsock_poll(&pfd, 1, 50) <= 0) {
+			continue;
+		}
+
+		ssize_t n = zsock_recv(fd, buf + len, sizeof(buf) - len, 0);
+		if (n <= 0) {
+			return;
+		}
+		len += n;
+
+		while (len >= 2) {
+			size_t rem = 0;
+			size_t hdr = 1;
+			bool more = true;
+
+			do {
+				if (hdr >= len) {
+					break;
+				}
+				rem |= (buf[hdr] & 0x7F) << (7 * (hdr - 1));
+				more = buf[hdr++] & 0x80;
+			} while (more);
+
+			if (more || hdr + rem > len) {
+				break;
+			}
+
+			if (handle_packet(buf[0], buf + hdr, rem)) {
+				return;
+			}
+
+			len -= hdr + rem;
+			memmove(buf, buf + hdr + rem, len);
+		}
+
+		if (len == sizeof(buf)) {
+			LOG_ERR("Packet too large");
+			return;
+		}
+	}
+}
+
+static void test_mqtt_broker_thread(void *arg1, void *arg2, void *arg3)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(TEST_MQTT_BROKER_PORT),
+		.sin_addr = INADDR_ANY_INIT,
+	};
+	int opt = 1;
+
+	int fd = zsock_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (fd < 0 || zsock_setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) ||
+	    zsock_bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || zsock_listen(fd, 2)) {
+		LOG_ERR("Error starting test MQTT broker: %i", errno);
+		return;
+	}
+
+	while (true) {
+		int c = zsock_accept(fd, NULL, NULL);
+		if (c < 0) {
+			LOG_ERR("Error accepting connection: %i", errno);
+			continue;
+		}
+
+		k_mutex_lock(&broker_lock, K_FOREVER);
+		conn_fd = c;
+		k_mutex_unlock(&broker_lock);
+
+		atomic_set(&drop_conn, 0);
+		serve_conn(c);
+
+		k_mutex_lock(&broker_lock, K_FOREVER);
+		conn_fd = -1;
+		// acks are lost with the connection
+		held_count = 0;
+		k_mutex_unlock(&broker_lock);
+		zsock_close(c);
+	}
+}
+
+K_THREAD_DEFINE(test_mqtt_broker, 2048, test_mqtt_broker_thread, NULL, NULL, NULL, 5, 0,
+		SYS_FOREVER_MS);
+
+void test_mqtt_broker_start(void)
+{
+	static bool started;
+
+	if (!started) {
+		k_thread_start(test_mqtt_broker);
+		started = true;
+	}
+}
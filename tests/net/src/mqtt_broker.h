@@ -0,0 +1,50 @@
+#ifndef __TEST_MQTT_BROKER_H_
+#define __TEST_MQTT_BROKER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A minimal MQTT 3.1.1 broker on the loopback interface that stands in for a
+// real broker in tests. It accepts one client at a time, records its publishes
+// and subscriptions, and acknowledges QoS 1 publishes unless acks are held.
+
+#define TEST_MQTT_BROKER_PORT 1883
+
+struct test_mqtt_publish {
+	char topic[64];
+	char payload[512];
+	size_t payload_len;
+	int qos;
+	bool retain;
+	uint16_t id;
+};
+
+// starts the broker, safe to call more than once
+void test_mqtt_broker_start(void);
+
+// waits for the next publish from the client
+int test_mqtt_broker_get(struct test_mqtt_publish *pub, int timeout_ms);
+
+// drops publishes that have not been read
+void test_mqtt_broker_reset(void);
+
+// holds back PUBACKs while hold is true, and sends the held ones when it is
+// set to false
+void test_mqtt_broker_hold_acks(bool hold);
+
+// publishes to the client with QoS 1 if id is not 0
+int test_mqtt_broker_send(const char *topic, const char *payload, uint16_t id);
+
+// waits for the client to acknowledge a publish, and returns its packet id
+int test_mqtt_broker_get_ack(int timeout_ms);
+
+// closes the connection to the client, and drops held acks like a broker that
+// lost them
+void test_mqtt_broker_disconnect(void);
+
+// number of clients that connected, and the topic of their last subscription
+int test_mqtt_broker_connects(void);
+const char *test_mqtt_broker_subscription(void);
+
+#endif // __TEST_MQTT_BROKER_H_
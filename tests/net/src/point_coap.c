@@ -0,0 +1,479 @@
+#include <point.h>
+#include <point_coap.h>
+#include <stdio.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/zbus/zbus.h>
+#include <zephyr/ztest.h>
+
+LOG_MODULE_REGISTER(coap_tests, LOG_LEVEL_DBG);
+
+ZBUS_CHAN_DECLARE(point_chan);
+
+#define TEST_COAP_PORT 5683
+
+#define CON 0
+#define NON 1
+#define ACK 2
+#define RST 3
+
+// only the points published by the tests are served
+static bool coap_test_filter(const point *p, int index, void *ctx)
+{
+	return strncmp(p->type, "coap", 4) == 0;
+}
+
+static const struct point_coap_config coap_test_config = {
+	.port = TEST_COAP_PORT,
+	.filter = coap_test_filter,
+};
+
+// ==================================================
+// A minimal CoAP client, independent of the server code
+
+struct coap_msg {
+	uint8_t type;
+	uint8_t code;
+	uint16_t mid;
+	uint8_t token[8];
+	uint8_t token_len;
+	// -1 if the option is absent
+	int observe;
+	int content_format;
+	long block2;
+	long etag;
+	uint8_t payload[1024];
+	size_t payload_len;
+};
+
+static int client_fd = -1;
+static uint16_t client_mid = 0x1000;
+static struct coap_msg rsp;
+
+static uint8_t *put_opt(uint8_t *p, unsigned int *last, unsigned int num, const void *v,
+			size_t len)
+{
+	unsigned int delta = num - *last;
+
+	// the options of the tests are short, with small deltas
+	zassert_true(delta < 269 && len < 13);
+	if (delta < 13) {
+		*p++ = delta << 4 | len;
+	} else {
+		*p++ = 13 << 4 | len;
+		*p++ = delta - 13;
+	}
+	memcpy(p, v, len);
+	*last = num;
+
+	return p + len;
+}
+
+static uint8_t *put_uint_opt(uint8_t *p, unsigned int *last, unsigned int num, uint32_t v)
+{
+	uint8_t b[3] = {v >> 16, v >> 8, v};
+	int n = v > 0xFFFF ? 3 : v > 0xFF ? 2 : v > 0 ? 1 : 0;
+
+	return put_opt(p, last, num, b + 3 - n, n);
+}
+
+static void client_send(const uint8_t *buf, size_t len)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(TEST_COAP_PORT),
+	};
+
+	zsock_inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+	zassert_equal(zsock_sendto(client_fd, buf, len, 0, (struct sockaddr *)&addr, sizeof(addr)),
+		      len);
+}
+
+// sends a request for path, with the options that are not NULL or -1.
+// Returns the message id.
+static uint16_t client_request(uint8_t type, uint8_t code, const char *token, const char *path,
+			       const char *query, int observe, long block2)
+{
+	uint8_t buf[128];
+	size_t token_len = strlen(token);
+	unsigned int last = 0;
+	uint16_t mid = client_mid++;
+
+	buf[0] = 1 << 6 | type << 4 | token_len;
+	buf[1] = code;
+	sys_put_be16(mid, buf + 2);
+	memcpy(buf + 4, token, token_len);
+	uint8_t *p = buf + 4 + token_len;
+
+	if (observe >= 0) {
+		p = put_uint_opt(p, &last, 6, observe);
+	}
+	while (path != NULL && *path != 0) {
+		const char *end = strchr(path, '/');
+		size_t len = end ? end - path : strlen(path);
+
+		p = put_opt(p, &last, 11, path, len);
+		path += end ? len + 1 : len;
+	}
+	if (query != NULL) {
+		p = put_opt(p, &last, 15, query, strlen(query));
+	}
+	if (block2 >= 0) {
+		p = put_uint_opt(p, &last, 23, block2);
+	}
+
+	client_send(buf, p - buf);
+
+	return mid;
+}
+
+static void client_send_empty(uint8_t type, uint16_t mid)
+{
+	uint8_t buf[4] = {1 << 6 | type << 4, 0};
+
+	sys_put_be16(mid, buf + 2);
+	client_send(buf, sizeof(buf));
+}
+
+static uint32_t get_uint(const uint8_t *v, size_t len)
+{
+	uint32_t n = 0;
+
+	for (size_t i = 0; i < len; i++) {
+		n = n << 8 | v[i];
+	}
+
+	return n;
+}
+
+// receives a message, returns -EAGAIN if none arrives in time
+static int client_recv(struct coap_msg *m, int timeout_ms)
+{
+	struct zsock_pollfd pfd = {.fd = client_fd, .events = ZSOCK_POLLIN};
+	uint8_t buf[1100];
+	unsigned int num = 0;
+
+	if (zsock_poll(&pfd, 1, timeout_ms) <= 0) {
+		return -EAGAIN;
+	}
+
+	ssize_t len = zsock_recv(client_fd, buf, sizeof(buf), 0);
+	if (len < 4) {
+		return -EBADMSG;
+	}
+
+	memset(m, 0, sizeof(*m));
+	m->observe = -1;
+	m->content_format = -1;
+	m->block2 = -1;
+	m->etag = -1;
+	m->type = (buf[0] >> 4) & 3;
+	m->token_len = buf[0] & 0xF;
+	m->code = buf[1];
+	m->mid = sys_get_be16(buf + 2);
+	memcpy(m->token, buf + 4, m->token_len);
+
+	size_t off = 4 + m->token_len;
+
+	while (off < len && buf[off] != 0xFF) {
+		unsigned int delta = buf[off] >> 4;
+		size_t opt_len = buf[off] & 0xF;
+
+		off++;
+		if (delta == 13) {
+			delta = buf[off++] + 13;
+		}
+		if (opt_len == 13) {
+			opt_len = buf[off++] + 13;
+		}
+		num += delta;
+
+		uint32_t v = get_uint(buf + off, MIN(opt_len, 4));
+
+		switch (num) {
+		case 4:
+			m->etag = v;
+			break;
+		case 6:
+			m->observe = v;
+			break;
+		case 12:
+			m->content_format = v;
+			break;
+		case 23:
+			m->block2 = v;
+			break;
+		}
+		off += opt_len;
+	}
+
+	if (off < len) {
+		m->payload_len = len - off - 1;
+		memcpy(m->payload, buf + off + 1, m->payload_len);
+	}
+
+	return 0;
+}
+
+static void publish(const char *type, const char *key, int value)
+{
+	point p = {0};
+
+	point_set_type_key(&p, type, key);
+	point_put_int(&p, value);
+	zassert_ok(zbus_chan_pub(&point_chan, &p, K_MSEC(500)));
+}
+
+// returns the value of the point in the decoded points, or -1
+static int find_value(point *pts, int count, const char *type, const char *key)
+{
+	for (int i = 0; i < count; i++) {
+		if (strcmp(pts[i].type, type) == 0 && strcmp(pts[i].key, key) == 0) {
+			return point_get_int(&pts[i]);
+		}
+	}
+
+	return -1;
+}
+
+// ==================================================
+// Tests
+
+static void *coap_setup(void)
+{
+	struct sockaddr_in addr = {.sin_family = AF_INET};
+
+	client_fd = zsock_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(client_fd >= 0);
+	zassert_ok(zsock_bind(client_fd, (struct sockaddr *)&addr, sizeof(addr)));
+
+	zassert_ok(point_coap_init(&coap_test_config));
+	// let the server open its socket
+	k_sleep(K_MSEC(200));
+
+	return NULL;
+}
+
+static void coap_before(void *fixture)
+{
+	// let the points of the last test be merged, and drop anything left
+	// over
+	k_sleep(K_MSEC(CONFIG_SIOT_COAP_NOTIFY_MS * 2));
+	while (client_recv(&rsp, 0) != -EAGAIN) {
+	}
+}
+
+ZTEST_SUITE(coap_tests, NULL, coap_setup, coap_before, NULL, NULL);
+
+ZTEST(coap_tests, get)
+{
+	point pts[40];
+
+	publish("coapA", "0", 1);
+	publish("coapA", "1", 2);
+	publish("coapB", "0", 3);
+	k_sleep(K_MSEC(200));
+
+	// a confirmable request gets a piggybacked response
+	uint16_t mid = client_request(CON, 0x01, "t1", "points", NULL, -1, -1);
+	zassert_ok(client_recv(&rsp, 1000));
+	zassert_equal(rsp.type, ACK);
+	zassert_equal(rsp.mid, mid);
+	zassert_equal(rsp.code, 0x45);
+	zassert_equal(rsp.token_len, 2);
+	zassert_mem_equal(rsp.token, "t1", 2);
+	zassert_equal(rsp.content_format, 42);
+	zassert_equal(rsp.observe, -1);
+	zassert_equal(rsp.block2, -1);
+
+	int n = points_bin_decode(rsp.payload, rsp.payload_len, pts, ARRAY_SIZE(pts));
+	zassert_true(n >= 3);
+	zassert_equal(find_value(pts, n, "coapA", "0"), 1);
+	zassert_equal(find_value(pts, n, "coapA", "1"), 2);
+	zassert_equal(find_value(pts, n, "coapB", "0"), 3);
+
+	// the ETag changes with the points
+	long etag = rsp.etag;
+	publish("coapA", "0", 4);
+	k_sleep(K_MSEC(200));
+	client_request(NON, 0x01, "t2", "points", NULL, -1, -1);
+	zassert_ok(client_recv(&rsp, 1000));
+	zassert_equal(rsp.type, NON);
+	zassert_not_equal(rsp.etag, etag);
+}
+
+ZTEST(coap_tests, get_type)
+{
+	point pts[40];
+
+	publish("coapA", "0", 1);
+	publish("coapB", "0", 2);
+	k_sleep(K_MSEC(200));
+
+	client_request(CON, 0x01, "t3", "points", "type=coapB", -1, -1);
+	zassert_ok(client_recv(&rsp, 1000));
+	zassert_equal(rsp.code, 0x45);
+
+	int n = points_bin_decode(rsp.payload, rsp.payload_len, pts, ARRAY_SIZE(pts));
+	zassert_equal(n, 1);
+	zassert_str_equal(pts[0].type, "coapB");
+}
+
+ZTEST(coap_tests, block)
+{
+	static uint8_t snapshot[2048];
+	struct point_coap_stats before, after;
+	size_t len = 0;
+	point pts[40];
+	long etag = -1;
+	char key[4];
+
+	for (int i = 0; i < 16; i++) {
+		snprintf(key, sizeof(key), "%i", i);
+		publish("coapC", key, 100 + i);
+	}
+	k_sleep(K_MSEC(200));
+	point_coap_stats(&before);
+
+	// the client asks for 16 byte blocks, smaller than the server's
+	for (int num = 0; num < 64; num++) {
+		client_request(CON, 0x01, "t4", "points", "type=coapC", -1, num << 4 | 0);
+		zassert_ok(client_recv(&rsp, 1000));
+		zassert_equal(rsp.code, 0x45);
+		zassert_true(rsp.block2 >= 0, "no Block2 in block %i", num);
+		zassert_equal(rsp.block2 >> 4, num);
+		zassert_equal(rsp.block2 & 7, 0);
+		if (etag >= 0) {
+			zassert_equal(rsp.etag, etag, "snapshot changed between blocks");
+		}
+		etag = rsp.etag;
+
+		memcpy(snapshot + len, rsp.payload, rsp.payload_len);
+		len += rsp.payload_len;
+		if (!(rsp.block2 & 8)) {
+			break;
+		}
+		zassert_equal(rsp.payload_len, 16);
+	}
+
+	// the blocks are all cut from one encoding of the snapshot
+	point_coap_stats(&after);
+	zassert_equal(after.encodes - before.encodes, 1);
+
+	int n = points_bin_decode(snapshot, len, pts, ARRAY_SIZE(pts));
+	zassert_equal(n, 16);
+	for (int i = 0; i < 16; i++) {
+		snprintf(key, sizeof(key), "%i", i);
+		zassert_equal(find_value(pts, n, "coapC", key), 100 + i);
+	}
+
+	// a block past the end
+	client_request(CON, 0x01, "t5", "points", "type=coapC", -1, 1000 << 4);
+	zassert_ok(client_recv(&rsp, 1000));
+	zassert_equal(rsp.code, 0x82);
+}
+
+ZTEST(coap_tests, observe)
+{
+	struct point_coap_stats stats;
+	point pts[8];
+
+	client_request(CON, 0x01, "ob1", "points", "type=coapD", 0, -1);
+	zassert_ok(client_recv(&rsp, 1000));
+	zassert_equal(rsp.code, 0x45);
+	zassert_true(rsp.observe >= 0, "not registered");
+	int seq = rsp.observe;
+
+	// changes within the window are sent in one notification, with the
+	// latest value of each point
+	publish("coapD", "0", 1);
+	publish("coapD", "0", 2);
+	publish("coapD", "1", 3);
+	publish("coapE", "0", 4);
+
+	zassert_ok(client_recv(&rsp, 2000));
+	zassert_equal(rsp.type, NON);
+	zassert_equal(rsp.code, 0x45);
+	zassert_mem_equal(rsp.token, "ob1", 3);
+	zassert_true(rsp.observe > seq);
+	zassert_equal(rsp.content_format, 42);
+
+	int n = points_bin_decode(rsp.payload, rsp.payload_len, pts, ARRAY_SIZE(pts));
+	zassert_equal(n, 2);
+	zassert_equal(find_value(pts, n, "coapD", "0"), 2);
+	zassert_equal(find_value(pts, n, "coapD", "1"), 3);
+	zassert_equal(client_recv(&rsp, CONFIG_SIOT_COAP_NOTIFY_MS * 2), -EAGAIN);
+
+	// deregistering
+	client_request(CON, 0x01, "ob1", "points", "type=coapD", 1, -1);
+	zassert_ok(client_recv(&rsp, 1000));
+	zassert_equal(rsp.observe, -1);
+
+	publish("coapD", "0", 5);
+	zassert_equal(client_recv(&rsp, CONFIG_SIOT_COAP_NOTIFY_MS * 2), -EAGAIN);
+
+	point_coap_stats(&stats);
+	zassert_equal(stats.observers, 0);
+}
+
+ZTEST(coap_tests, confirmable)
+{
+	struct point_coap_stats before, after;
+
+	point_coap_stats(&before);
+
+	client_request(NON, 0x01, "ob2", "points", "type=coapF", 0, -1);
+	zassert_ok(client_recv(&rsp, 1000));
+	zassert_true(rsp.observe >= 0);
+
+	// every CONFIG_SIOT_COAP_CON_INTERVAL notification is confirmable
+	for (int i = 1; i <= CONFIG_SIOT_COAP_CON_INTERVAL; i++) {
+		publish("coapF", "0", i);
+		zassert_ok(client_recv(&rsp, 2000));
+		zassert_equal(rsp.type, i == CONFIG_SIOT_COAP_CON_INTERVAL ? CON : NON);
+	}
+	client_send_empty(ACK, rsp.mid);
+
+	// a reset removes the observer
+	publish("coapF", "0", 100);
+	zassert_ok(client_recv(&rsp, 2000));
+	client_send_empty(RST, rsp.mid);
+	k_sleep(K_MSEC(200));
+
+	publish("coapF", "0", 101);
+	zassert_equal(client_recv(&rsp, CONFIG_SIOT_COAP_NOTIFY_MS * 2), -EAGAIN);
+
+	point_coap_stats(&after);
+	zassert_equal(after.observers, before.observers);
+	zassert_equal(after.removed - before.removed, 1);
+	zassert_true(after.notifications - before.notifications >= CONFIG_SIOT_COAP_CON_INTERVAL + 1);
+}
+
+ZTEST(coap_tests, errors)
+{
+	client_request(CON, 0x01, "e1", "nothing", NULL, -1, -1);
+	zassert_ok(client_recv(&rsp, 1000));
+	zassert_equal(rsp.code, 0x84);
+
+	// POST
+	client_request(CON, 0x02, "e2", "points", NULL, -1, -1);
+	zassert_ok(client_recv(&rsp, 1000));
+	zassert_equal(rsp.code, 0x85);
+
+	// a ping is answered with a reset
+	client_send_empty(CON, 0x4242);
+	zassert_ok(client_recv(&rsp, 1000));
+	zassert_equal(rsp.type, RST);
+	zassert_equal(rsp.mid, 0x4242);
+}
+
+ZTEST(coap_tests, discovery)
+{
+	client_request(CON, 0x01, "d1", ".well-known/core", NULL, -1, -1);
+	zassert_ok(client_recv(&rsp, 1000));
+	zassert_equal(rsp.code, 0x45);
+	zassert_equal(rsp.content_format, 40);
+	rsp.payload[rsp.payload_len] = 0;
+	zassert_str_equal((char *)rsp.payload, "</points>;obs;ct=42");
+}
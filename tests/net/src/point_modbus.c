@@ -0,0 +1,371 @@
+#include "modbus_sim.h"
+
+#include <point.h>
+#include <point_modbus.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/zbus/zbus.h>
+#include <zephyr/ztest.h>
+
+LOG_MODULE_REGISTER(modbus_tests, LOG_LEVEL_DBG);
+
+ZBUS_CHAN_DECLARE(point_chan);
+
+#define TEST_MODBUS_PERIOD_MS   200
+#define TEST_MODBUS_SERVER_PORT 1503
+
+static const point_def modbus_a = {"modbusA", POINT_DATA_TYPE_FLOAT};
+static const point_def modbus_b = {"modbusB", POINT_DATA_TYPE_INT};
+static const point_def modbus_c = {"modbusC", POINT_DATA_TYPE_INT};
+static const point_def modbus_d = {"modbusD", POINT_DATA_TYPE_FLOAT};
+static const point_def modbus_e = {"modbusE", POINT_DATA_TYPE_INT};
+static const point_def modbus_f = {"modbusF", POINT_DATA_TYPE_INT};
+
+// holding registers 0 to 5 are read with one request, the input register and
+// the coil with one each
+static const struct point_modbus_reg modbus_test_regs[] = {
+	{POINT_MODBUS_COIL, 3, POINT_MODBUS_U16, &modbus_f},
+	{POINT_MODBUS_INPUT_REG, 10, POINT_MODBUS_U16, &modbus_e},
+	{POINT_MODBUS_HOLDING_REG, 0, POINT_MODBUS_U16, &modbus_a, "0", 0.1f, 0.5f},
+	{POINT_MODBUS_HOLDING_REG, 1, POINT_MODBUS_S16, &modbus_b},
+	{POINT_MODBUS_HOLDING_REG, 2, POINT_MODBUS_U32, &modbus_c},
+	{POINT_MODBUS_HOLDING_REG, 4, POINT_MODBUS_F32, &modbus_d},
+};
+
+static const struct point_modbus_device modbus_test_devs[] = {
+	{
+		.host = "127.0.0.1",
+		.port = TEST_MODBUS_SIM_PORT,
+		.unit_id = 1,
+		.period_ms = TEST_MODBUS_PERIOD_MS,
+		.regs = modbus_test_regs,
+		.regs_len = ARRAY_SIZE(modbus_test_regs),
+	},
+};
+
+static const point_def modbus_s = {"modbusS", POINT_DATA_TYPE_FLOAT};
+static const point_def modbus_t = {"modbusT", POINT_DATA_TYPE_INT};
+static const point_def modbus_u = {"modbusU", POINT_DATA_TYPE_INT};
+
+static const struct point_modbus_reg modbus_test_server_regs[] = {
+	{POINT_MODBUS_COIL, 0, POINT_MODBUS_U16, &modbus_u},
+	{POINT_MODBUS_HOLDING_REG, 0, POINT_MODBUS_U16, &modbus_s, "0", 0.1f},
+	{POINT_MODBUS_HOLDING_REG, 1, POINT_MODBUS_S32, &modbus_t},
+};
+
+static const struct point_modbus_server_config modbus_test_server = {
+	.port = TEST_MODBUS_SERVER_PORT,
+	.regs = modbus_test_server_regs,
+	.regs_len = ARRAY_SIZE(modbus_test_server_regs),
+};
+
+K_MSGQ_DEFINE(modbus_test_points, sizeof(point), 16, 4);
+
+static void modbus_test_listener(const struct zbus_channel *chan)
+{
+	const point *p = zbus_chan_const_msg(chan);
+
+	if (strncmp(p->type, "modbus", 6) == 0) {
+		k_msgq_put(&modbus_test_points, p, K_NO_WAIT);
+	}
+}
+
+ZBUS_LISTENER_DEFINE(modbus_test_lis, modbus_test_listener);
+
+static void *modbus_setup(void)
+{
+	test_modbus_sim_start();
+	zassert_ok(zbus_chan_add_obs(&point_chan, &modbus_test_lis, K_SECONDS(1)));
+	zassert_ok(point_modbus_server_init(&modbus_test_server));
+	// no devices does not start the client, so it can still be started below
+	zassert_ok(point_modbus_client_init(NULL, 0));
+	zassert_ok(point_modbus_client_init(modbus_test_devs, ARRAY_SIZE(modbus_test_devs)));
+
+	return NULL;
+}
+
+static void modbus_before(void *fixture)
+{
+	k_sleep(K_MSEC(TEST_MODBUS_PERIOD_MS));
+	test_modbus_sim_reset();
+	k_msgq_purge(&modbus_test_points);
+}
+
+ZTEST_SUITE(modbus_tests, NULL, modbus_setup, modbus_before, NULL, NULL);
+
+// waits for the next point of a type, skipping others
+static int get_point(const char *type, point *p, int timeout_ms)
+{
+	int64_t end = k_uptime_get() + timeout_ms;
+
+	while (k_msgq_get(&modbus_test_points, p, K_MSEC(MAX(end - k_uptime_get(), 0))) == 0) {
+		if (strcmp(p->type, type) == 0) {
+			return 0;
+		}
+	}
+
+	return -EAGAIN;
+}
+
+static void publish(const char *type, float value)
+{
+	point p = {0};
+
+	point_set_type_key(&p, type, "0");
+	if (strcmp(type, "modbusS") == 0) {
+		point_put_float(&p, value);
+	} else {
+		point_put_int(&p, value);
+	}
+	zassert_ok(zbus_chan_pub(&point_chan, &p, K_MSEC(500)));
+}
+
+ZTEST(modbus_tests, coalesce)
+{
+	struct test_modbus_request req;
+
+	// skip to the start of a poll
+	do {
+		zassert_ok(test_modbus_sim_get(&req, 1000));
+	} while (req.fc != 1);
+
+	zassert_ok(test_modbus_sim_get(&req, 1000));
+	zassert_equal(req.fc, 4);
+	zassert_equal(req.start, 10);
+	zassert_equal(req.count, 1);
+
+	zassert_ok(test_modbus_sim_get(&req, 1000));
+	zassert_equal(req.fc, 3);
+	zassert_equal(req.start, 0);
+	zassert_equal(req.count, 6);
+
+	// nothing else until the next poll
+	zassert_ok(test_modbus_sim_get(&req, 1000));
+	zassert_equal(req.fc, 1);
+	zassert_equal(req.start, 3);
+	zassert_equal(req.count, 1);
+}
+
+ZTEST(modbus_tests, period)
+{
+	struct test_modbus_request req;
+	int64_t first = 0;
+	int polls = 0;
+
+	while (test_modbus_sim_get(&req, 1000) == 0 && polls < 5) {
+		if (req.fc != 1) {
+			continue;
+		}
+		if (polls++ == 0) {
+			first = req.time_ms;
+		}
+	}
+
+	zassert_equal(polls, 5);
+	zassert_within(req.time_ms - first, 4 * TEST_MODBUS_PERIOD_MS, TEST_MODBUS_PERIOD_MS / 2);
+}
+
+// the last point of a type among pts, as a poll may see a value half set
+static const point *last_point(const point *pts, int len, const char *type)
+{
+	const point *p = NULL;
+
+	for (int i = 0; i < len; i++) {
+		if (strcmp(pts[i].type, type) == 0) {
+			p = &pts[i];
+		}
+	}
+
+	zassert_not_null(p, "no point for %s", type);
+
+	return p;
+}
+
+ZTEST(modbus_tests, values)
+{
+	point pts[16];
+	float f = 1.5f;
+	uint32_t v;
+	int len = 0;
+
+	memcpy(&v, &f, sizeof(v));
+
+	test_modbus_sim_set(1, 3, 1);
+	test_modbus_sim_set(4, 10, 1234);
+	test_modbus_sim_set(3, 1, (uint16_t)-5);
+	test_modbus_sim_set(3, 2, 70000 >> 16);
+	test_modbus_sim_set(3, 3, 70000 & 0xFFFF);
+	test_modbus_sim_set(3, 4, v >> 16);
+	test_modbus_sim_set(3, 5, v & 0xFFFF);
+
+	k_sleep(K_MSEC(3 * TEST_MODBUS_PERIOD_MS));
+	while (len < ARRAY_SIZE(pts) &&
+	       k_msgq_get(&modbus_test_points, &pts[len], K_NO_WAIT) == 0) {
+		len++;
+	}
+
+	zassert_equal(point_get_int((point *)last_point(pts, len, "modbusF")), 1);
+	zassert_equal(point_get_int((point *)last_point(pts, len, "modbusE")), 1234);
+	zassert_equal(point_get_int((point *)last_point(pts, len, "modbusB")), -5);
+	zassert_equal(point_get_int((point *)last_point(pts, len, "modbusC")), 70000);
+	zassert_within(point_get_float((point *)last_point(pts, len, "modbusD")), 1.5f, 0.001f);
+}
+
+ZTEST(modbus_tests, deadband)
+{
+	struct point_modbus_stats before, after;
+	point p;
+
+	test_modbus_sim_set(3, 0, 235);
+	zassert_ok(get_point("modbusA", &p, 1000));
+	zassert_within(point_get_float(&p), 23.5f, 0.001f);
+
+	// 0.3 is inside the deadband of 0.5
+	point_modbus_stats(&before);
+	test_modbus_sim_set(3, 0, 238);
+	zassert_equal(get_point("modbusA", &p, 3 * TEST_MODBUS_PERIOD_MS), -EAGAIN);
+	point_modbus_stats(&after);
+	zassert_true(after.suppressed - before.suppressed >= 2);
+
+	// 1.0 from the last published value
+	test_modbus_sim_set(3, 0, 245);
+	zassert_ok(get_point("modbusA", &p, 1000));
+	zassert_within(point_get_float(&p), 24.5f, 0.001f);
+}
+
+// ==================================================
+// A minimal Modbus TCP client for the server tests
+
+static int client_fd = -1;
+static uint16_t client_tid;
+static uint8_t rsp[260];
+
+// sends a request PDU and returns the length of the response PDU in rsp
+static int request(const uint8_t *pdu, size_t len)
+{
+	uint8_t adu[260] = {0};
+	size_t rsp_len = 0;
+
+	if (client_fd < 0) {
+		struct sockaddr_in addr = {
+			.sin_family = AF_INET,
+			.sin_port = htons(TEST_MODBUS_SERVER_PORT),
+		};
+
+		zsock_inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+		client_fd = zsock_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		zassert_true(client_fd >= 0);
+		zassert_ok(zsock_connect(client_fd, (struct sockaddr *)&addr, sizeof(addr)));
+	}
+
+	sys_put_be16(++client_tid, adu);
+	sys_put_be16(len + 1, adu + 4);
+	adu[6] = 1;
+	memcpy(adu + 7, pdu, len);
+	zassert_equal(zsock_send(client_fd, adu, 7 + len, 0), 7 + len);
+
+	while (rsp_len < 7 || rsp_len < 6 + sys_get_be16(rsp + 4)) {
+		struct zsock_pollfd pfd = {.fd = client_fd, .events = ZSOCK_POLLIN};
+
+		zassert_equal(zsock_poll(&pfd, 1, 1000), 1, "no response");
+		ssize_t n = zsock_recv(client_fd, rsp + rsp_len, sizeof(rsp) - rsp_len, 0);
+		zassert_true(n > 0);
+		rsp_len += n;
+	}
+
+	zassert_equal(sys_get_be16(rsp), client_tid);
+	zassert_equal(rsp[6], 1);
+	memmove(rsp, rsp + 7, rsp_len - 7);
+
+	return rsp_len - 7;
+}
+
+static int read_regs(uint8_t fc, uint16_t addr, uint16_t count)
+{
+	uint8_t pdu[5] = {fc};
+
+	sys_put_be16(addr, pdu + 1);
+	sys_put_be16(count, pdu + 3);
+
+	return request(pdu, sizeof(pdu));
+}
+
+ZTEST(modbus_tests, serve)
+{
+	publish("modbusS", 12.3f);
+	publish("modbusT", -2);
+
+	zassert_equal(read_regs(3, 0, 3), 8);
+	zassert_equal(rsp[0], 3);
+	zassert_equal(rsp[1], 6);
+	zassert_equal(sys_get_be16(rsp + 2), 123);
+	zassert_equal(sys_get_be16(rsp + 4), 0xFFFF);
+	zassert_equal(sys_get_be16(rsp + 6), 0xFFFE);
+
+	publish("modbusU", 1);
+	zassert_equal(read_regs(1, 0, 1), 3);
+	zassert_equal(rsp[1], 1);
+	zassert_equal(rsp[2], 1);
+}
+
+ZTEST(modbus_tests, write)
+{
+	uint8_t write_reg[] = {6, 0, 0, 456 >> 8, 456 & 0xFF};
+	uint8_t write_regs[] = {16, 0, 1, 0, 2, 4, 0, 1, 0, 2};
+	uint8_t write_coil[] = {5, 0, 0, 0xFF, 0};
+	point p;
+
+	zassert_equal(request(write_reg, sizeof(write_reg)), 5);
+	zassert_mem_equal(rsp, write_reg, sizeof(write_reg));
+	zassert_ok(get_point("modbusS", &p, 1000));
+	zassert_within(point_get_float(&p), 45.6f, 0.001f);
+
+	zassert_equal(request(write_regs, sizeof(write_regs)), 5);
+	zassert_mem_equal(rsp, write_regs, 5);
+	zassert_ok(get_point("modbusT", &p, 1000));
+	zassert_equal(point_get_int(&p), 0x10002);
+
+	zassert_equal(request(write_coil, sizeof(write_coil)), 5);
+	zassert_ok(get_point("modbusU", &p, 1000));
+	zassert_equal(point_get_int(&p), 1);
+
+	// the written values are served
+	zassert_equal(read_regs(3, 0, 1), 4);
+	zassert_equal(sys_get_be16(rsp + 2), 456);
+}
+
+ZTEST(modbus_tests, write_twice)
+{
+	uint8_t first[] = {6, 0, 0, 111 >> 8, 111 & 0xFF};
+	uint8_t second[] = {6, 0, 0, 222 >> 8, 222 & 0xFF};
+	point p;
+
+	// each write is echoed, not whatever the last response left behind
+	zassert_equal(request(first, sizeof(first)), 5);
+	zassert_mem_equal(rsp, first, sizeof(first));
+	zassert_equal(request(second, sizeof(second)), 5);
+	zassert_mem_equal(rsp, second, sizeof(second));
+
+	zassert_ok(get_point("modbusS", &p, 1000));
+	zassert_within(point_get_float(&p), 11.1f, 0.001f);
+	zassert_ok(get_point("modbusS", &p, 1000));
+	zassert_within(point_get_float(&p), 22.2f, 0.001f);
+}
+
+ZTEST(modbus_tests, exceptions)
+{
+	uint8_t unknown[] = {0x2B, 0x0E, 1, 0};
+
+	// holding register 3 is not mapped
+	zassert_equal(read_regs(3, 0, 4), 2);
+	zassert_equal(rsp[0], 0x83);
+	zassert_equal(rsp[1], 2);
+
+	zassert_equal(request(unknown, sizeof(unknown)), 2);
+	zassert_equal(rsp[0], 0xAB);
+	zassert_equal(rsp[1], 1);
+
+	zassert_equal(read_regs(4, 0, 200), 2);
+	zassert_equal(rsp[1], 3);
+}
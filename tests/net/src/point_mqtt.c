@@ -0,0 +1,244 @@
+#include "mqtt_broker.h"
+
+#include <point.h>
+#include <point_mqtt.h>
+#include <stdio.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/zbus/zbus.h>
+#include <zephyr/ztest.h>
+
+LOG_MODULE_REGISTER(mqtt_tests, LOG_LEVEL_DBG);
+
+ZBUS_CHAN_DECLARE(point_chan);
+
+// only the points published by the tests are sent
+static bool mqtt_test_filter(const point *p, int index, void *ctx)
+{
+	return strncmp(p->type, "test", 4) == 0;
+}
+
+static const struct point_mqtt_config mqtt_test_config = {
+	.host = "127.0.0.1",
+	.port = TEST_MQTT_BROKER_PORT,
+	.client_id = "siot-test",
+	.prefix = "siot/test",
+	.qos = 1,
+	.sec_tag = -1,
+	.filter = mqtt_test_filter,
+};
+
+static struct test_mqtt_publish pub;
+
+static void *mqtt_setup(void)
+{
+	struct point_mqtt_stats stats;
+
+	test_mqtt_broker_start();
+	zassert_ok(point_mqtt_init(&mqtt_test_config));
+
+	for (int i = 0; i < 20; i++) {
+		point_mqtt_stats(&stats);
+		if (stats.connects > 0) {
+			break;
+		}
+		k_sleep(K_MSEC(100));
+	}
+	zassert_equal(stats.connects, 1);
+
+	return NULL;
+}
+
+static void mqtt_before(void *fixture)
+{
+	test_mqtt_broker_hold_acks(false);
+	// let anything left over from the last test be published
+	k_sleep(K_MSEC(CONFIG_SIOT_MQTT_WINDOW_MS * 2));
+	test_mqtt_broker_reset();
+}
+
+ZTEST_SUITE(mqtt_tests, NULL, mqtt_setup, mqtt_before, NULL, NULL);
+
+static void publish(const char *type, const char *key, int value)
+{
+	point p = {0};
+
+	point_set_type_key(&p, type, key);
+	point_put_int(&p, value);
+	zassert_ok(zbus_chan_pub(&point_chan, &p, K_MSEC(500)));
+}
+
+// waits for a publish to <prefix>/<type> and decodes its points
+static int get_points(const char *type, point *pts, int count)
+{
+	char topic[64];
+
+	snprintf(topic, sizeof(topic), "siot/test/%s", type);
+
+	zassert_ok(test_mqtt_broker_get(&pub, 2000), "no publish for %s", type);
+	zassert_str_equal(pub.topic, topic);
+	zassert_equal(pub.qos, 1);
+	zassert_false(pub.retain);
+
+	return points_json_decode(pub.payload, pub.payload_len, pts, count);
+}
+
+ZTEST(mqtt_tests, subscribe)
+{
+	zassert_str_equal(test_mqtt_broker_subscription(), "siot/test/set");
+}
+
+ZTEST(mqtt_tests, coalesce)
+{
+	struct point_mqtt_stats before, after;
+	point pts[4];
+
+	point_mqtt_stats(&before);
+
+	// one publish per type, with the last value of each point
+	publish("testA", "0", 1);
+	publish("testA", "0", 2);
+	publish("testA", "1", 3);
+	k_sleep(K_MSEC(CONFIG_SIOT_MQTT_WINDOW_MS * 2));
+
+	zassert_equal(get_points("testA", pts, ARRAY_SIZE(pts)), 2);
+	zassert_str_equal(pts[0].key, "0");
+	zassert_equal(point_get_int(&pts[0]), 2);
+	zassert_str_equal(pts[1].key, "1");
+	zassert_equal(point_get_int(&pts[1]), 3);
+
+	publish("testB", "0", 4);
+	zassert_equal(get_points("testB", pts, ARRAY_SIZE(pts)), 1);
+	zassert_equal(point_get_int(&pts[0]), 4);
+
+	zassert_equal(test_mqtt_broker_get(&pub, CONFIG_SIOT_MQTT_WINDOW_MS * 2), -EAGAIN);
+
+	k_sleep(K_MSEC(100));
+	point_mqtt_stats(&after);
+	zassert_equal(after.coalesced - before.coalesced, 1);
+	zassert_equal(after.publishes - before.publishes, 2);
+	zassert_equal(after.points - before.points, 3);
+}
+
+ZTEST(mqtt_tests, window)
+{
+	point pts[4];
+
+	publish("testC", "0", 1);
+	zassert_equal(test_mqtt_broker_get(&pub, CONFIG_SIOT_MQTT_WINDOW_MS / 2), -EAGAIN,
+		      "published before the window closed");
+
+	zassert_equal(get_points("testC", pts, ARRAY_SIZE(pts)), 1);
+}
+
+ZTEST(mqtt_tests, pipelined)
+{
+	struct point_mqtt_stats before, after;
+	uint16_t ids[CONFIG_SIOT_MQTT_INFLIGHT];
+	char type[8];
+	point pts[4];
+
+	point_mqtt_stats(&before);
+
+	// publishes go out without waiting for acks, up to the in flight limit
+	test_mqtt_broker_hold_acks(true);
+	for (int i = 0; i < CONFIG_SIOT_MQTT_INFLIGHT + 2; i++) {
+		snprintf(type, sizeof(type), "test%i", i);
+		publish(type, "0", i);
+	}
+
+	for (int i = 0; i < CONFIG_SIOT_MQTT_INFLIGHT; i++) {
+		zassert_ok(test_mqtt_broker_get(&pub, 2000));
+		ids[i] = pub.id;
+		for (int j = 0; j < i; j++) {
+			zassert_not_equal(ids[i], ids[j], "packet id used twice");
+		}
+	}
+	zassert_equal(test_mqtt_broker_get(&pub, CONFIG_SIOT_MQTT_WINDOW_MS * 2), -EAGAIN);
+
+	point_mqtt_stats(&after);
+	zassert_equal(after.inflight, CONFIG_SIOT_MQTT_INFLIGHT);
+
+	// the rest are sent once the acks arrive
+	test_mqtt_broker_hold_acks(false);
+	for (int i = 0; i < 2; i++) {
+		zassert_ok(test_mqtt_broker_get(&pub, 2000));
+		zassert_equal(points_json_decode(pub.payload, pub.payload_len, pts, 4), 1);
+	}
+
+	k_sleep(K_MSEC(100));
+	point_mqtt_stats(&after);
+	zassert_equal(after.inflight, 0);
+	zassert_equal(after.acks - before.acks, CONFIG_SIOT_MQTT_INFLIGHT + 2);
+}
+
+ZTEST(mqtt_tests, setpoint)
+{
+	struct point_mqtt_stats before, after;
+	point pts[4];
+
+	point_mqtt_stats(&before);
+
+	zassert_ok(test_mqtt_broker_send("siot/test/set",
+					 "[{\"t\":\"testS\",\"k\":\"0\",\"dt\":\"INT\",\"d\":\"42\"}]",
+					 7));
+	zassert_equal(test_mqtt_broker_get_ack(2000), 7);
+
+	// the setpoint was published on point_chan, so it comes back
+	zassert_equal(get_points("testS", pts, ARRAY_SIZE(pts)), 1);
+	zassert_equal(point_get_int(&pts[0]), 42);
+
+	point_mqtt_stats(&after);
+	zassert_equal(after.received - before.received, 1);
+}
+
+ZTEST(mqtt_tests, setpoint_bad_data)
+{
+	struct point_mqtt_stats before, after;
+	point pts[4];
+
+	point_mqtt_stats(&before);
+
+	// a point whose data does not parse drops the whole message, but it is
+	// still acknowledged so the broker does not send it again
+	zassert_ok(test_mqtt_broker_send(
+		"siot/test/set",
+		"[{\"t\":\"testX\",\"k\":\"0\",\"dt\":\"INT\",\"d\":\"4x\"}]", 8));
+	zassert_equal(test_mqtt_broker_get_ack(2000), 8);
+
+	zassert_ok(test_mqtt_broker_send(
+		"siot/test/set",
+		"[{\"t\":\"testY\",\"k\":\"0\",\"dt\":\"INT\",\"d\":\"5\"}]", 9));
+	zassert_equal(test_mqtt_broker_get_ack(2000), 9);
+
+	// only the good setpoint comes back
+	zassert_equal(get_points("testY", pts, ARRAY_SIZE(pts)), 1);
+	zassert_equal(point_get_int(&pts[0]), 5);
+
+	point_mqtt_stats(&after);
+	zassert_equal(after.received - before.received, 1);
+}
+
+ZTEST(mqtt_tests, reconnect)
+{
+	point pts[4];
+	int connects = test_mqtt_broker_connects();
+
+	test_mqtt_broker_hold_acks(true);
+	publish("testR", "0", 1);
+	zassert_equal(get_points("testR", pts, ARRAY_SIZE(pts)), 1);
+	publish("testR", "0", 2);
+
+	// the publish was not acknowledged, so the point is published again
+	// with its latest value after reconnecting
+	test_mqtt_broker_disconnect();
+	test_mqtt_broker_hold_acks(false);
+
+	for (int i = 0; i < 30 && test_mqtt_broker_connects() == connects; i++) {
+		k_sleep(K_MSEC(100));
+	}
+	zassert_equal(test_mqtt_broker_connects(), connects + 1);
+
+	zassert_equal(get_points("testR", pts, ARRAY_SIZE(pts)), 1);
+	zassert_equal(point_get_int(&pts[0]), 2);
+	zassert_str_equal(test_mqtt_broker_subscription(), "siot/test/set");
+}
@@ -0,0 +1,324 @@
+#include "http_server.h"
+
+#include <point.h>
+#include <uplink.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/zbus/zbus.h>
+#include <zephyr/ztest.h>
+
+LOG_MODULE_REGISTER(uplink_tests, LOG_LEVEL_DBG);
+
+ZBUS_CHAN_DECLARE(point_chan);
+
+// only the points published by the tests are sent. The uplink's own metrics
+// pass the filter too, as the uplink has to keep them out of its queue itself.
+static bool uplink_test_filter(const point *p, int index, void *ctx)
+{
+	return strcmp(p->type, POINT_TYPE_TEMPERATURE) == 0 ||
+	       strcmp(p->type, POINT_TYPE_METRIC_UPLINK_CONNECTS) == 0 ||
+	       strcmp(p->type, POINT_TYPE_METRIC_UPLINK_CONNECT_MS) == 0;
+}
+
+static const struct uplink_config uplink_test_config = {
+	.host = "127.0.0.1",
+	.port = TEST_HTTP_SERVER_PORT,
+	.path = "/v1/points",
+	.sec_tag = -1,
+	.filter = uplink_test_filter,
+};
+
+static struct test_http_request req;
+
+static void *uplink_setup(void)
+{
+#ifdef CONFIG_SIOT_UPLINK_STORE
+	const struct flash_area *fa;
+
+	// the flash simulator keeps its contents between runs
+	zassert_ok(flash_area_open(FIXED_PARTITION_ID(uplink_partition), &fa));
+	zassert_ok(flash_area_erase(fa, 0, fa->fa_size));
+	flash_area_close(fa);
+#endif
+
+	test_http_server_start();
+	zassert_ok(uplink_init(&uplink_test_config));
+
+	return NULL;
+}
+
+static void uplink_before(void *fixture)
+{
+	test_http_server_status(200);
+	// send anything left over from the last test
+	uplink_flush();
+	k_sleep(K_MSEC(100));
+	test_http_server_reset();
+}
+
+ZTEST_SUITE(uplink_tests, NULL, uplink_setup, uplink_before, NULL, NULL);
+
+static void publish(int first, int count)
+{
+	point p = {0};
+
+	for (int i = first; i < first + count; i++) {
+		point_set_type_key(&p, POINT_TYPE_TEMPERATURE, "0");
+		point_put_int(&p, i);
+		zassert_ok(zbus_chan_pub(&point_chan, &p, K_MSEC(500)));
+	}
+}
+
+// checks that the request body holds the points first to first + count - 1
+static void check_points(struct test_http_request *r, int first, int count)
+{
+	point pts[8];
+
+	zassert_str_equal(r->method, "POST");
+	zassert_str_equal(r->path, "/v1/points");
+#ifdef CONFIG_SIOT_UPLINK_FORMAT_BINARY
+	zassert_str_equal(r->content_type, "application/octet-stream");
+	zassert_equal(points_bin_decode((const uint8_t *)r->body, r->body_len, pts, ARRAY_SIZE(pts)), count);
+#else
+	zassert_str_equal(r->content_type, "application/json");
+	zassert_equal(points_json_decode(r->body, r->body_len, pts, ARRAY_SIZE(pts)), count,
+		      "body: %s", r->body);
+#endif
+	for (int i = 0; i < count; i++) {
+		zassert_str_equal(pts[i].type, POINT_TYPE_TEMPERATURE);
+		zassert_equal(point_get_int(&pts[i]), first + i);
+	}
+}
+
+ZTEST(uplink_tests, batch_full)
+{
+	publish(0, 3);
+	zassert_equal(test_http_server_get(&req, 300), -EAGAIN, "sent before the batch was full");
+
+	publish(3, 1);
+	zassert_ok(test_http_server_get(&req, 2000));
+	check_points(&req, 0, 4);
+}
+
+ZTEST(uplink_tests, flush)
+{
+	publish(10, 2);
+	uplink_flush();
+
+	zassert_ok(test_http_server_get(&req, 2000));
+	check_points(&req, 10, 2);
+}
+
+ZTEST(uplink_tests, max_delay)
+{
+	publish(20, 1);
+	zassert_equal(test_http_server_get(&req, 500), -EAGAIN);
+
+	// CONFIG_SIOT_UPLINK_MAX_DELAY is 1s
+	zassert_ok(test_http_server_get(&req, 1000));
+	check_points(&req, 20, 1);
+}
+
+ZTEST(uplink_tests, retry)
+{
+	struct uplink_stats before, after;
+
+	uplink_stats(&before);
+
+	test_http_server_status(503);
+	publish(30, 4);
+	zassert_ok(test_http_server_get(&req, 2000));
+	check_points(&req, 30, 4);
+
+	// the same points are sent again once the server accepts them
+	test_http_server_status(200);
+	uplink_flush();
+	zassert_ok(test_http_server_get(&req, 2000));
+	check_points(&req, 30, 4);
+
+	// the request is recorded before the uplink reads the answer
+	k_sleep(K_MSEC(100));
+	uplink_stats(&after);
+	zassert_equal(after.sent - before.sent, 4);
+	zassert_equal(after.errors - before.errors, 1);
+}
+
+ZTEST(uplink_tests, many)
+{
+	// several full batches are sent back to back
+	publish(40, 12);
+
+	for (int i = 0; i < 3; i++) {
+		zassert_ok(test_http_server_get(&req, 2000));
+		check_points(&req, 40 + i * 4, 4);
+	}
+}
+
+ZTEST(uplink_tests, keepalive)
+{
+	struct uplink_stats before, after;
+
+	uplink_stats(&before);
+
+	publish(50, 1);
+	uplink_flush();
+	zassert_ok(test_http_server_get(&req, 2000));
+	int first = req.conn_requests;
+
+	publish(51, 1);
+	uplink_flush();
+	zassert_ok(test_http_server_get(&req, 2000));
+	check_points(&req, 51, 1);
+	zassert_equal(req.conn_requests, first + 1, "connection not reused");
+
+	uplink_stats(&after);
+	zassert_true(after.connects - before.connects <= 1);
+}
+
+ZTEST(uplink_tests, reconnect)
+{
+	struct uplink_stats before, after;
+
+	test_http_server_close_after(1);
+
+	publish(60, 1);
+	uplink_flush();
+	zassert_ok(test_http_server_get(&req, 2000));
+	k_sleep(K_MSEC(100));
+
+	// the connection was closed by the server, so it is opened again
+	uplink_stats(&before);
+	publish(61, 1);
+	uplink_flush();
+	zassert_ok(test_http_server_get(&req, 2000));
+	check_points(&req, 61, 1);
+	zassert_equal(req.conn_requests, 1);
+
+	k_sleep(K_MSEC(100));
+	uplink_stats(&after);
+	zassert_equal(after.connects - before.connects, 1);
+	zassert_equal(after.errors, before.errors);
+	zassert_equal(after.sent - before.sent, 1);
+
+	test_http_server_close_after(0);
+}
+
+static K_SEM_DEFINE(connect_metric_sem, 0, 1);
+
+static void uplink_test_listener(const struct zbus_channel *chan)
+{
+	const point *p = zbus_chan_const_msg(chan);
+
+	if (strcmp(p->type, POINT_TYPE_METRIC_UPLINK_CONNECTS) == 0) {
+		k_sem_give(&connect_metric_sem);
+	}
+}
+
+ZBUS_LISTENER_DEFINE(uplink_test_lis, uplink_test_listener);
+
+ZTEST(uplink_tests, connect_metrics)
+{
+	struct uplink_stats before, after;
+
+	zassert_ok(zbus_chan_add_obs(&point_chan, &uplink_test_lis, K_SECONDS(1)));
+
+	// the server closes the connection after this request, so the next one
+	// connects again
+	test_http_server_close_after(1);
+	publish(70, 1);
+	uplink_flush();
+	zassert_ok(test_http_server_get(&req, 2000));
+	k_sleep(K_MSEC(100));
+	k_sem_reset(&connect_metric_sem);
+
+	uplink_stats(&before);
+	publish(71, 1);
+	uplink_flush();
+	zassert_ok(test_http_server_get(&req, 2000));
+	zassert_ok(k_sem_take(&connect_metric_sem, K_SECONDS(2)));
+
+	// the metrics are not queued, or they would be sent in the next batch
+	// and the uplink would keep waking itself up
+	uplink_stats(&after);
+	zassert_equal(after.queued - before.queued, 1);
+	zassert_equal(test_http_server_get(&req, 1500), -EAGAIN, "metrics were sent");
+
+	test_http_server_close_after(0);
+	zassert_ok(zbus_chan_rm_obs(&point_chan, &uplink_test_lis, K_SECONDS(1)));
+}
+
+#ifdef CONFIG_SIOT_UPLINK_STORE
+ZTEST(uplink_tests, store)
+{
+	struct uplink_stats stats;
+
+	// the failed batch is stored, and the next one is stored behind it
+	test_http_server_status(503);
+	publish(80, 4);
+	zassert_ok(test_http_server_get(&req, 2000));
+	check_points(&req, 80, 4);
+	long seq = req.seq;
+	zassert_true(seq >= 0);
+
+	publish(84, 4);
+	uplink_flush();
+	zassert_ok(test_http_server_get(&req, 2000));
+	k_sleep(K_MSEC(100));
+	uplink_stats(&stats);
+	zassert_equal(stats.stored, 8);
+
+	// the backlog is sent in one request once the server is back
+	test_http_server_status(200);
+	uplink_flush();
+	zassert_ok(test_http_server_get(&req, 2000));
+	check_points(&req, 80, 8);
+	zassert_equal(req.seq, seq);
+
+	k_sleep(K_MSEC(100));
+	uplink_stats(&stats);
+	zassert_equal(stats.stored, 0);
+
+	// points sent directly continue the sequence
+	publish(88, 1);
+	uplink_flush();
+	zassert_ok(test_http_server_get(&req, 2000));
+	check_points(&req, 88, 1);
+	zassert_equal(req.seq, seq + 8);
+}
+#endif
+
+#ifdef CONFIG_SIOT_UPLINK_GZIP
+ZTEST(uplink_tests, gzip)
+{
+	struct uplink_stats before, after;
+
+	uplink_stats(&before);
+
+	// the test server decompresses the body before it is checked
+	publish(90, 4);
+	zassert_ok(test_http_server_get(&req, 2000));
+	zassert_str_equal(req.content_encoding, "gzip");
+	check_points(&req, 90, 4);
+
+	k_sleep(K_MSEC(100));
+	uplink_stats(&after);
+	zassert_true(after.gzip_out - before.gzip_out < after.gzip_in - before.gzip_in);
+
+	// a server that does not accept gzip gets the batch again uncompressed,
+	// and so all later batches
+	test_http_server_refuse_encoding(true);
+	publish(94, 4);
+	zassert_ok(test_http_server_get(&req, 2000));
+	zassert_str_equal(req.content_encoding, "gzip");
+	zassert_ok(test_http_server_get(&req, 2000));
+	zassert_str_equal(req.content_encoding, "");
+	check_points(&req, 94, 4);
+
+	publish(98, 4);
+	zassert_ok(test_http_server_get(&req, 2000));
+	zassert_str_equal(req.content_encoding, "");
+	check_points(&req, 98, 4);
+
+	test_http_server_refuse_encoding(false);
+}
+#endif
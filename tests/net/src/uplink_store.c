@@ -0,0 +1,168 @@
+#include <uplink_store.h>
+
+#include <string.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/ztest.h>
+
+#define TEST_AREA FIXED_PARTITION_ID(uplink_test_partition)
+
+static struct uplink_store store;
+
+static void store_before(void *fixture)
+{
+	const struct flash_area *fa;
+
+	zassert_ok(flash_area_open(TEST_AREA, &fa));
+	zassert_ok(flash_area_erase(fa, 0, fa->fa_size));
+	flash_area_close(fa);
+
+	zassert_ok(uplink_store_init(&store, TEST_AREA));
+}
+
+ZTEST_SUITE(uplink_store_tests, NULL, NULL, store_before, NULL, NULL);
+
+struct read_ctx {
+	char buf[512];
+	size_t len;
+	int batches;
+};
+
+static int read_cb(const uint8_t *buf, size_t len, bool start, void *ctx)
+{
+	struct read_ctx *r = ctx;
+
+	zassert_true(r->len + len < sizeof(r->buf));
+	memcpy(r->buf + r->len, buf, len);
+	r->len += len;
+	r->batches += start;
+
+	return 0;
+}
+
+// stores a batch of count points, with data made from its sequence number
+static uint32_t append(uint32_t count)
+{
+	uint32_t seq = uplink_store_seq(&store, count);
+	char data[16];
+
+	snprintf(data, sizeof(data), "batch%u;", seq);
+	zassert_ok(uplink_store_append(&store, seq, count, data, strlen(data)));
+
+	return seq;
+}
+
+ZTEST(uplink_store_tests, drain)
+{
+	struct uplink_store_batch b;
+	struct read_ctx r = {0};
+
+	zassert_equal(uplink_store_peek(&store, 1024, &b), -ENOENT);
+
+	uint32_t seq = append(3);
+	append(2);
+	zassert_equal(store.pending, 5);
+
+	// both batches are read in one go
+	zassert_ok(uplink_store_peek(&store, 1024, &b));
+	zassert_equal(b.seq, seq);
+	zassert_equal(b.count, 5);
+	zassert_equal(b.entries, 2);
+
+	zassert_ok(uplink_store_read(&store, &b, read_cb, &r));
+	zassert_equal(r.batches, 2);
+	zassert_equal(r.len, b.len);
+	r.buf[r.len] = 0;
+
+	char want[32];
+	snprintf(want, sizeof(want), "batch%u;batch%u;", seq, seq + 3);
+	zassert_str_equal(r.buf, want);
+
+	zassert_ok(uplink_store_sent(&store, &b));
+	zassert_equal(store.pending, 0);
+	zassert_equal(uplink_store_peek(&store, 1024, &b), -ENOENT);
+}
+
+ZTEST(uplink_store_tests, drain_size)
+{
+	struct uplink_store_batch b;
+
+	uint32_t seq = append(1);
+	append(1);
+
+	// a batch larger than the limit is still sent on its own
+	zassert_ok(uplink_store_peek(&store, 1, &b));
+	zassert_equal(b.seq, seq);
+	zassert_equal(b.entries, 1);
+	zassert_ok(uplink_store_sent(&store, &b));
+
+	zassert_ok(uplink_store_peek(&store, 1, &b));
+	zassert_equal(b.seq, seq + 1);
+	zassert_ok(uplink_store_sent(&store, &b));
+	zassert_equal(store.pending, 0);
+}
+
+ZTEST(uplink_store_tests, reboot)
+{
+	struct uplink_store_batch b;
+
+	uint32_t first = append(4);
+	zassert_ok(uplink_store_peek(&store, 1024, &b));
+	zassert_ok(uplink_store_sent(&store, &b));
+
+	uint32_t second = append(2);
+	uint32_t used = uplink_store_seq(&store, 10);
+
+	// the batch that was not delivered is found again, and sequence numbers
+	// are not used twice
+	zassert_ok(uplink_store_init(&store, TEST_AREA));
+	zassert_equal(store.pending, 2);
+	zassert_true(uplink_store_seq(&store, 1) >= used + 10);
+
+	zassert_ok(uplink_store_peek(&store, 1024, &b));
+	zassert_equal(b.seq, second);
+	zassert_equal(b.count, 2);
+	zassert_true(b.seq > first);
+	zassert_ok(uplink_store_sent(&store, &b));
+
+	zassert_ok(uplink_store_init(&store, TEST_AREA));
+	zassert_equal(store.pending, 0);
+}
+
+ZTEST(uplink_store_tests, too_large)
+{
+	static uint8_t data[FCB_MAX_LEN];
+	uint32_t seq = append(2);
+
+	// with the entry header this is over the FCB entry limit
+	zassert_equal(uplink_store_append(&store, seq + 2, 1, data, sizeof(data)), -EINVAL);
+	zassert_equal(store.pending, 2);
+	zassert_equal(store.lost, 0);
+}
+
+ZTEST(uplink_store_tests, full)
+{
+	struct uplink_store_batch b;
+	uint8_t data[512];
+	uint32_t total = 0;
+
+	memset(data, 'x', sizeof(data));
+
+	// more than the partition holds
+	for (int i = 0; i < 100; i++) {
+		uint32_t seq = uplink_store_seq(&store, 10);
+
+		zassert_ok(uplink_store_append(&store, seq, 10, data, sizeof(data)));
+		total += 10;
+	}
+
+	zassert_true(store.lost > 0);
+	zassert_equal(store.pending + store.lost, total);
+
+	// the newest batches are kept
+	zassert_ok(uplink_store_peek(&store, 1024 * 1024, &b));
+	zassert_equal(b.count, store.pending);
+	zassert_equal(b.seq + b.count, uplink_store_seq(&store, 0));
+
+	zassert_ok(uplink_store_init(&store, TEST_AREA));
+	zassert_equal(store.pending, b.count);
+}
@@ -359,3 +359,280 @@ ZTEST(point_tests, decode_point_invalid_json)
 	int ret = point_json_decode(buf, sizeof(test_point1_invalid_json), &p);
 	zassert(ret != 0, "decode should have returned an error");
 }
+
+ZTEST(point_tests, bin_round_trip)
+{
+	uint8_t buf[128];
+	point pts[5] = {0};
+
+	int len = points_bin_encode(test_points, ARRAY_SIZE(test_points), buf, sizeof(buf));
+	zassert(len > 0, "encode failed");
+
+	int ret = points_bin_decode(buf, len, pts, ARRAY_SIZE(pts));
+	zassert_equal(ret, 3, "did not decode 3 points");
+
+	zassert_str_equal(pts[0].type, POINT_TYPE_METRIC_SYS_CPU_PERCENT);
+	zassert_equal(point_get_int(&pts[0]), -232);
+	zassert_equal(point_get_float(&pts[1]), (float)-572.2);
+	zassert_str_equal(pts[2].data, "device #4");
+}
+
+ZTEST(point_tests, bin_decode_truncated)
+{
+	uint8_t buf[64];
+	point p;
+
+	int len = point_bin_encode(&test_points[2], buf, sizeof(buf));
+	zassert(len > 0, "encode failed");
+
+	int ret = point_bin_decode(buf, len - 1, &p);
+	zassert(ret < 0, "decode of truncated point should fail");
+
+	ret = point_bin_encode(&test_points[2], buf, 8);
+	zassert_equal(ret, -ENOMEM);
+}
+
+ZTEST(point_tests, bin_data_types)
+{
+	uint8_t buf[128];
+	point pts[4] = {0};
+	point out[4];
+
+	// a string that fills the data field has no null terminator
+	point_set_type_key(&pts[0], POINT_TYPE_DESCRIPTION, "0");
+	pts[0].data_type = POINT_DATA_TYPE_STRING;
+	memset(pts[0].data, 'a', sizeof(pts[0].data));
+
+	// 4 character strings are not swapped like INT data
+	point_set_type_key(&pts[1], POINT_TYPE_DESCRIPTION, "1");
+	point_put_string(&pts[1], "abcd");
+
+	// points without a data type, as a POST without dt gives
+	point_set_type_key(&pts[2], POINT_TYPE_TEMPERATURE, "0");
+	point_set_type_key(&pts[3], POINT_TYPE_TEMPERATURE, "1");
+	pts[3].data_type = POINT_DATA_TYPE_JSON;
+
+	zassert_equal(point_bin_encode(&pts[2], buf, sizeof(buf)), -ENOTSUP);
+	zassert_equal(point_bin_encode(&pts[3], buf, sizeof(buf)), -ENOTSUP);
+
+	int len = points_bin_encode(pts, ARRAY_SIZE(pts), buf, sizeof(buf));
+	zassert_true(len > 0);
+	zassert_equal(buf[len - 6], POINT_DATA_TYPE_STRING);
+	zassert_equal(buf[len - 5], 4);
+	zassert_mem_equal(buf + len - 4, "abcd", 4);
+
+	zassert_equal(points_bin_decode(buf, len, out, ARRAY_SIZE(out)), 2);
+	zassert_equal(strlen(out[0].data), sizeof(out[0].data) - 1);
+	zassert_str_equal(out[1].data, "abcd");
+}
+
+ZTEST(point_tests, put_text)
+{
+	point p = {0};
+
+	zassert_ok(point_put_text(&p, POINT_DATA_TYPE_INT, "-2147483648"));
+	zassert_equal(point_get_int(&p), INT32_MIN);
+	zassert_ok(point_put_text(&p, POINT_DATA_TYPE_FLOAT, "1.5"));
+	zassert_equal(point_get_float(&p), 1.5f);
+	zassert_ok(point_put_text(&p, POINT_DATA_TYPE_STRING, "1234567890123456789"));
+	zassert_str_equal(p.data, "1234567890123456789");
+
+	// out of range numbers are not saturated, and the point is unchanged
+	zassert_equal(point_put_text(&p, POINT_DATA_TYPE_INT, "2147483648"), -EINVAL);
+	zassert_equal(point_put_text(&p, POINT_DATA_TYPE_INT, "99999999999999999999"),
+		      -EINVAL);
+	zassert_equal(point_put_text(&p, POINT_DATA_TYPE_FLOAT, "1e39"), -EINVAL);
+	zassert_equal(point_put_text(&p, POINT_DATA_TYPE_INT, "12a"), -EINVAL);
+	zassert_equal(point_put_text(&p, POINT_DATA_TYPE_INT, ""), -EINVAL);
+
+	// a string must leave room for the null terminator
+	zassert_equal(point_put_text(&p, POINT_DATA_TYPE_STRING, "12345678901234567890"),
+		      -ENOMEM);
+	zassert_equal(point_put_text(&p, POINT_DATA_TYPE_JSON, "{}"), -ENOTSUP);
+	zassert_equal(p.data_type, POINT_DATA_TYPE_STRING);
+	zassert_str_equal(p.data, "1234567890123456789");
+}
+
+ZTEST(point_tests, upsert_index)
+{
+	point pts[5] = {0};
+
+	int ret = points_upsert(pts, ARRAY_SIZE(pts), &test_points[0]);
+	zassert_equal(ret, 0);
+
+	ret = points_upsert(pts, ARRAY_SIZE(pts), &test_points[1]);
+	zassert_equal(ret, 1);
+
+	point p = test_points[0];
+	point_put_int(&p, 55);
+
+	ret = points_upsert(pts, ARRAY_SIZE(pts), &p);
+	zassert_equal(ret, 0, "existing point should be updated in place");
+	zassert_equal(55, point_get_int(&pts[0]));
+}
+
+static bool skip_index_one(const point *p, int index, void *ctx)
+{
+	return index != 1;
+}
+
+ZTEST(point_tests, encode_point_array_filter)
+{
+	char buf[512];
+	char exp[] = "[{\"t\":\"metricSysCPUPercent\",\"k\":\"\",\"dt\":\"INT\",\"d\":\"-232\"},"
+		     "{\"t\":\"description\",\"k\":\"\",\"dt\":\"STR\",\"d\":\"device #4\"}]";
+
+	int ret = points_json_encode_filter(test_points, ARRAY_SIZE(test_points), skip_index_one,
+					    NULL, buf, sizeof(buf));
+	zassert_ok(ret);
+
+	zassert_str_equal(buf, exp, "filtered encoding not correct");
+}
+
+ZTEST(point_tests, json_escape_round_trip)
+{
+	char buf[128];
+	point p = {.type = POINT_TYPE_DESCRIPTION, .key = "a\"b"};
+	point out;
+
+	point_put_string(&p, "tab\there \\ \x01");
+
+	int ret = point_json_encode(&p, buf, sizeof(buf));
+	zassert_ok(ret);
+	zassert_str_equal(buf, "{\"t\":\"description\",\"k\":\"a\\\"b\",\"dt\":\"STR\","
+			       "\"d\":\"tab\\there \\\\ \\u0001\"}");
+
+	ret = point_json_decode(buf, strlen(buf), &out);
+	zassert_ok(ret);
+	zassert_str_equal(out.key, "a\"b");
+	zassert_str_equal(out.data, "tab\there \\ \x01");
+
+	char unicode[] = "{\"t\":\"description\",\"k\":\"\\u00e9\",\"dt\":\"STR\","
+			 "\"d\":\"\\/\\ud83d\\ude00\"}";
+	ret = point_json_decode(unicode, sizeof(unicode), &out);
+	zassert_ok(ret);
+	zassert_str_equal(out.key, "\xc3\xa9");
+	zassert_str_equal(out.data, "/\xf0\x9f\x98\x80");
+}
+
+ZTEST(point_tests, json_decode_field_order)
+{
+	// data before data type, whitespace, unknown fields of any type, and data
+	// as a bare number
+	char buf[] = " { \"d\" : \"12.5\", \"tm\": {\"a\":[1, \"]\", null]}, \"dt\":\"FLT\",\n"
+		     "\"k\":\"1\",\"t\":\"temp\",\"x\":true } ";
+	char bare[] = "{\"t\":\"temp\",\"k\":\"\",\"dt\":\"INT\",\"d\":-7}";
+	point p;
+
+	int ret = point_json_decode(buf, sizeof(buf), &p);
+	zassert_ok(ret);
+	zassert_str_equal(p.type, POINT_TYPE_TEMPERATURE);
+	zassert_str_equal(p.key, "1");
+	zassert_equal(p.data_type, POINT_DATA_TYPE_FLOAT);
+	zassert_equal(point_get_float(&p), 12.5f);
+
+	ret = point_json_decode(bare, sizeof(bare), &p);
+	zassert_ok(ret);
+	zassert_equal(point_get_int(&p), -7);
+}
+
+ZTEST(point_tests, json_decode_invalid)
+{
+	const char *tests[] = {
+		"",
+		"[]",
+		"{\"t\":\"temp\",\"k\":\"\"",
+		"{\"t\":\"temp\",\"k\":\"\",}",
+		"{\"t\":\"temp\" \"k\":\"\"}",
+		"{\"t\":temp,\"k\":\"\"}",
+		"{\"t\":\"temp,\"k\":\"\"}",
+		"{\"t\":\"temp\",\"k\":\"\"} x",
+		"{\"t\":\"\\u12\",\"k\":\"\"}",
+		"{\"t\":\"temp\",\"x\":}",
+	};
+	point p;
+
+	for (int i = 0; i < ARRAY_SIZE(tests); i++) {
+		char buf[64];
+		strncpy(buf, tests[i], sizeof(buf));
+		int ret = point_json_decode(buf, strlen(buf), &p);
+		zassert_true(ret < 0, "%s", tests[i]);
+	}
+
+	// invalid data is an error, and leaves the data type unknown
+	char bad_data[] = "{\"t\":\"temp\",\"k\":\"\",\"dt\":\"INT\",\"d\":\"12x\"}";
+	int ret = point_json_decode(bad_data, sizeof(bad_data), &p);
+	zassert_equal(ret, -EINVAL);
+	zassert_equal(p.data_type, POINT_DATA_TYPE_UNKNOWN);
+}
+
+ZTEST(point_tests, decode_bad_data)
+{
+	const char *tests[] = {
+		"{\"t\":\"temp\",\"k\":\"0\",\"dt\":\"INT\",\"d\":\"\"}",
+		"{\"t\":\"temp\",\"k\":\"0\",\"dt\":\"INT\",\"d\":\"1.5\"}",
+		"{\"t\":\"temp\",\"k\":\"0\",\"dt\":\"INT\"}",
+		"{\"t\":\"temp\",\"k\":\"0\",\"dt\":\"FLT\",\"d\":\"abc\"}",
+		"{\"t\":\"temp\",\"k\":\"0\",\"dt\":\"FLT\",\"d\":true}",
+		"{\"t\":\"temp\",\"k\":\"0\",\"dt\":\"XYZ\",\"d\":\"1\"}",
+	};
+	point pts[2];
+	point p;
+
+	for (int i = 0; i < ARRAY_SIZE(tests); i++) {
+		char buf[128];
+
+		strncpy(buf, tests[i], sizeof(buf));
+		zassert_equal(point_json_decode(buf, strlen(buf), &p), -EINVAL, "%s", tests[i]);
+	}
+
+	// one bad point fails the whole array, so none of it is published
+	char arr[] = "[{\"t\":\"temp\",\"k\":\"0\",\"dt\":\"INT\",\"d\":\"1\"},"
+		     "{\"t\":\"temp\",\"k\":\"1\",\"dt\":\"INT\",\"d\":\"x\"}]";
+	zassert_equal(points_json_decode(arr, sizeof(arr), pts, ARRAY_SIZE(pts)), -EINVAL);
+
+	// out of range values saturate rather than fail
+	char big[] = "{\"t\":\"temp\",\"k\":\"0\",\"dt\":\"INT\",\"d\":\"99999999999\"}";
+	zassert_ok(point_json_decode(big, sizeof(big), &p));
+	zassert_equal(point_get_int(&p), INT32_MAX);
+}
+
+ZTEST(point_tests, json_encode_len)
+{
+	char buf[128];
+
+	int ret = point_json_encode(&test_points[2], buf, sizeof(buf));
+	zassert_ok(ret);
+
+	size_t len = strlen(buf);
+
+	zassert_equal(point_json_encode(&test_points[2], buf, len), -ENOMEM);
+	zassert_ok(point_json_encode(&test_points[2], buf, len + 1));
+
+	ret = points_json_encode(test_points, ARRAY_SIZE(test_points), buf, 20);
+	zassert_equal(ret, -ENOMEM);
+
+	ret = points_json_encode(test_points, 0, buf, 3);
+	zassert_ok(ret);
+	zassert_str_equal(buf, "[]");
+}
+
+ZTEST(point_tests, json_decode_array_limits)
+{
+	char buf[] = "[{\"t\":\"a\",\"k\":\"\",\"dt\":\"INT\",\"d\":\"1\"},"
+		     "{\"k\":\"\",\"dt\":\"INT\",\"d\":\"2\"},"
+		     "{\"t\":\"c\",\"k\":\"\",\"dt\":\"INT\",\"d\":\"3\"},"
+		     "{\"t\":\"d\",\"k\":\"\",\"dt\":\"INT\",\"d\":\"4\"}]";
+	point pts[2];
+
+	// the point without a type is skipped, and points past the end of pts are
+	// checked but dropped
+	int ret = points_json_decode(buf, sizeof(buf), pts, ARRAY_SIZE(pts));
+	zassert_equal(ret, 2);
+	zassert_str_equal(pts[0].type, "a");
+	zassert_str_equal(pts[1].type, "c");
+
+	char empty[] = " [ ] ";
+	ret = points_json_decode(empty, sizeof(empty), pts, ARRAY_SIZE(pts));
+	zassert_equal(ret, 0);
+}
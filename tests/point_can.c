@@ -0,0 +1,310 @@
+#include "point_can.h"
+#include <zephyr/canbus/isotp.h>
+#include <zephyr/drivers/can.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/zbus/zbus.h>
+#include <zephyr/ztest.h>
+
+LOG_MODULE_REGISTER(point_can_tests, LOG_LEVEL_DBG);
+
+ZTEST_SUITE(point_can_tests, NULL, NULL, NULL, NULL, NULL);
+
+static const struct point_can_type types[] = {
+	{1, &point_def_temperature, POINT_CAN_TX},
+	{2, &point_def_uptime, POINT_CAN_TX},
+	{3, &point_def_description, POINT_CAN_RX},
+};
+
+static bool filter_match(const struct can_filter *f, const struct can_frame *frame)
+{
+	return (frame->id & f->mask) == (f->id & f->mask);
+}
+
+ZTEST(point_can_tests, id)
+{
+	zassert_equal(point_can_id(0x12, 0x34, 0x56), 0x123456);
+	zassert_equal(point_can_id(0xff, 0xff, 0xff), 0xffffff);
+}
+
+ZTEST(point_can_tests, round_trip)
+{
+	struct can_frame frame;
+	point p = {0}, out;
+
+	point_set_type_key(&p, POINT_TYPE_TEMPERATURE, "7");
+	point_put_float(&p, 23.5f);
+	zassert_ok(point_can_encode(types, ARRAY_SIZE(types), &p, &frame));
+	zassert_equal(frame.id, point_can_id(1, 7, CONFIG_SIOT_CAN_NODE_ID));
+	zassert_true(frame.flags & CAN_FRAME_IDE);
+	zassert_equal(can_dlc_to_bytes(frame.dlc), 4);
+	zassert_ok(point_can_decode(types, ARRAY_SIZE(types), &frame, &out));
+	zassert_mem_equal(&out, &p, sizeof(p));
+
+	memset(&p, 0, sizeof(p));
+	point_set_type_key(&p, POINT_TYPE_UPTIME, "255");
+	point_put_int(&p, -123456);
+	zassert_ok(point_can_encode(types, ARRAY_SIZE(types), &p, &frame));
+	zassert_ok(point_can_decode(types, ARRAY_SIZE(types), &frame, &out));
+	zassert_mem_equal(&out, &p, sizeof(p));
+
+	memset(&p, 0, sizeof(p));
+	point_set_type_key(&p, POINT_TYPE_DESCRIPTION, "0");
+	point_put_string(&p, "pump 1");
+	zassert_ok(point_can_encode(types, ARRAY_SIZE(types), &p, &frame));
+	zassert_equal(can_dlc_to_bytes(frame.dlc), 6);
+	zassert_ok(point_can_decode(types, ARRAY_SIZE(types), &frame, &out));
+	zassert_mem_equal(&out, &p, sizeof(p));
+
+	// empty strings are sent as frames with no data
+	memset(&p, 0, sizeof(p));
+	point_set_type_key(&p, POINT_TYPE_DESCRIPTION, "0");
+	point_put_string(&p, "");
+	zassert_ok(point_can_encode(types, ARRAY_SIZE(types), &p, &frame));
+	zassert_equal(frame.dlc, 0);
+	zassert_ok(point_can_decode(types, ARRAY_SIZE(types), &frame, &out));
+	zassert_mem_equal(&out, &p, sizeof(p));
+}
+
+ZTEST(point_can_tests, string)
+{
+	struct can_frame frame;
+	uint8_t buf[32];
+	point p = {0}, out;
+
+	point_set_type_key(&p, POINT_TYPE_DESCRIPTION, "2");
+	point_put_string(&p, "boiler room pump 12");
+
+#if !defined(CONFIG_SIOT_CAN_FD)
+	zassert_equal(point_can_encode(types, ARRAY_SIZE(types), &p, &frame), -EMSGSIZE);
+#else
+	zassert_ok(point_can_encode(types, ARRAY_SIZE(types), &p, &frame));
+	zassert_ok(point_can_decode(types, ARRAY_SIZE(types), &frame, &out));
+	zassert_mem_equal(&out, &p, sizeof(p));
+#endif
+
+	int len = point_can_string_encode(types, ARRAY_SIZE(types), &p, buf, sizeof(buf));
+	zassert_equal(len, 2 + 19);
+	zassert_equal(buf[0], 3);
+	zassert_equal(buf[1], 2);
+	zassert_ok(point_can_string_decode(types, ARRAY_SIZE(types), buf, len, &out));
+	zassert_mem_equal(&out, &p, sizeof(p));
+
+	zassert_equal(point_can_string_encode(types, ARRAY_SIZE(types), &p, buf, 20), -EMSGSIZE);
+
+	point_set_type_key(&p, POINT_TYPE_UPTIME, "0");
+	point_put_int(&p, 5);
+	zassert_equal(point_can_string_encode(types, ARRAY_SIZE(types), &p, buf, sizeof(buf)),
+		      -ENOTSUP);
+
+	// too long for a point, and not a string type
+	memset(buf + 2, 'a', 20);
+	zassert_equal(point_can_string_decode(types, ARRAY_SIZE(types), buf, 22, &out), -EINVAL);
+	buf[0] = 2;
+	zassert_equal(point_can_string_decode(types, ARRAY_SIZE(types), buf, 4, &out), -EINVAL);
+	buf[0] = 9;
+	zassert_equal(point_can_string_decode(types, ARRAY_SIZE(types), buf, 4, &out), -ENOENT);
+	zassert_equal(point_can_string_decode(types, ARRAY_SIZE(types), buf, 1, &out), -EINVAL);
+}
+
+ZTEST(point_can_tests, encode_invalid)
+{
+	struct can_frame frame;
+	point p = {0};
+
+	point_set_type_key(&p, POINT_TYPE_BOARD, "0");
+	point_put_string(&p, "x");
+	zassert_equal(point_can_encode(types, ARRAY_SIZE(types), &p, &frame), -ENOENT);
+
+	const char *keys[] = {"256", "-1", "a", ""};
+
+	for (int i = 0; i < ARRAY_SIZE(keys); i++) {
+		point_set_type_key(&p, POINT_TYPE_UPTIME, keys[i]);
+		point_put_int(&p, 1);
+		zassert_equal(point_can_encode(types, ARRAY_SIZE(types), &p, &frame), -EINVAL,
+			      "key %s", keys[i]);
+	}
+
+	// the data type must match the table
+	point_set_type_key(&p, POINT_TYPE_UPTIME, "0");
+	point_put_float(&p, 1.5f);
+	zassert_equal(point_can_encode(types, ARRAY_SIZE(types), &p, &frame), -EINVAL);
+}
+
+ZTEST(point_can_tests, decode_invalid)
+{
+	struct can_frame frame = {
+		.id = point_can_id(2, 0, 5),
+		.flags = CAN_FRAME_IDE,
+		.dlc = 3,
+	};
+	point p;
+
+	zassert_equal(point_can_decode(types, ARRAY_SIZE(types), &frame, &p), -EINVAL);
+
+	frame.dlc = 4;
+	zassert_ok(point_can_decode(types, ARRAY_SIZE(types), &frame, &p));
+
+	frame.flags = 0;
+	zassert_equal(point_can_decode(types, ARRAY_SIZE(types), &frame, &p), -EINVAL);
+
+	// ISO-TP frame
+	frame.flags = CAN_FRAME_IDE;
+	frame.id = 0x18DA0105;
+	zassert_equal(point_can_decode(types, ARRAY_SIZE(types), &frame, &p), -EINVAL);
+
+	frame.id = point_can_id(9, 0, 5);
+	zassert_equal(point_can_decode(types, ARRAY_SIZE(types), &frame, &p), -ENOENT);
+
+	// strings can fill the whole frame
+	frame.id = point_can_id(3, 0, 5);
+	frame.dlc = can_bytes_to_dlc(8);
+	memset(frame.data, 'a', 8);
+	zassert_ok(point_can_decode(types, ARRAY_SIZE(types), &frame, &p));
+	zassert_str_equal(p.data, "aaaaaaaa");
+}
+
+ZTEST(point_can_tests, filter)
+{
+	struct can_filter f;
+	struct can_frame frame = {.flags = CAN_FRAME_IDE};
+
+	point_can_filter(3, &f);
+	zassert_true(f.flags & CAN_FILTER_IDE);
+
+	frame.id = point_can_id(3, 0, 0);
+	zassert_true(filter_match(&f, &frame));
+	frame.id = point_can_id(3, 0xff, 0xff);
+	zassert_true(filter_match(&f, &frame));
+
+	frame.id = point_can_id(2, 0, 0);
+	zassert_false(filter_match(&f, &frame));
+	frame.id = point_can_id(4, 0xff, 0xff);
+	zassert_false(filter_match(&f, &frame));
+
+	// frames with the upper bits set, like ISO-TP
+	frame.id = 0x18DA0300;
+	zassert_false(filter_match(&f, &frame));
+	frame.id = 0x18030000;
+	zassert_false(filter_match(&f, &frame));
+}
+
+// The tests below run the transport on the chosen CAN device (the loopback
+// driver on native_sim), which delivers sent frames to its own filters.
+
+ZBUS_CHAN_DECLARE(point_chan);
+
+static const struct device *const can_dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_canbus));
+
+// frames sent by the transport
+CAN_MSGQ_DEFINE(point_can_test_frames, 4);
+
+// all points published on the point channel, so points the transport should
+// not have published show up too
+K_MSGQ_DEFINE(point_can_test_points, sizeof(point), 4, 4);
+
+static void point_can_test_listener(const struct zbus_channel *chan)
+{
+	k_msgq_put(&point_can_test_points, zbus_chan_const_msg(chan), K_NO_WAIT);
+}
+
+ZBUS_LISTENER_DEFINE(point_can_test_lis, point_can_test_listener);
+
+static void *point_can_bus_setup(void)
+{
+	struct can_filter filter;
+
+	zassert_true(device_is_ready(can_dev));
+	zassert_ok(can_set_mode(can_dev, CAN_MODE_LOOPBACK));
+	zassert_ok(can_start(can_dev));
+	zassert_ok(point_can_init(can_dev, types, ARRAY_SIZE(types)));
+
+	point_can_filter(2, &filter);
+	zassert_true(can_add_rx_filter_msgq(can_dev, &point_can_test_frames, &filter) >= 0);
+	zassert_ok(zbus_chan_add_obs(&point_chan, &point_can_test_lis, K_SECONDS(1)));
+
+	return NULL;
+}
+
+static void point_can_bus_before(void *fixture)
+{
+	k_msgq_purge(&point_can_test_frames);
+	k_msgq_purge(&point_can_test_points);
+}
+
+ZTEST_SUITE(point_can_bus_tests, NULL, point_can_bus_setup, point_can_bus_before, NULL, NULL);
+
+ZTEST(point_can_bus_tests, receive)
+{
+	struct can_frame frame = {
+		.id = point_can_id(3, 4, 5),
+		.flags = CAN_FRAME_IDE,
+		.dlc = 5,
+		.data = "hello",
+	};
+	point p;
+
+	zassert_ok(can_send(can_dev, &frame, K_MSEC(100), NULL, NULL));
+	zassert_ok(k_msgq_get(&point_can_test_points, &p, K_MSEC(100)));
+	zassert_str_equal(p.type, POINT_TYPE_DESCRIPTION);
+	zassert_str_equal(p.key, "4");
+	zassert_str_equal(p.data, "hello");
+}
+
+ZTEST(point_can_bus_tests, receive_filtered)
+{
+	// uptime is only sent by this node, so the transport does not see it
+	struct can_frame frame = {
+		.id = point_can_id(2, 0, 5),
+		.flags = CAN_FRAME_IDE,
+		.dlc = 4,
+	};
+	point p;
+
+	zassert_ok(can_send(can_dev, &frame, K_MSEC(100), NULL, NULL));
+	zassert_equal(k_msgq_get(&point_can_test_points, &p, K_MSEC(50)), -EAGAIN,
+		      "received %s", p.type);
+}
+
+#if !defined(CONFIG_SIOT_CAN_FD)
+ZTEST(point_can_bus_tests, receive_string)
+{
+	// a string that does not fit in a frame, sent by node 9 with ISO-TP
+	static struct isotp_send_ctx ctx;
+	const struct isotp_msg_id tx_addr = {
+		.ext_id = 0x18DA0009 | (CONFIG_SIOT_CAN_NODE_ID << ISOTP_FIXED_ADDR_TA_POS),
+		.flags = ISOTP_MSG_IDE | ISOTP_MSG_FIXED_ADDR,
+	};
+	const struct isotp_msg_id rx_addr = {
+		.ext_id = 0x18DA0900 | (CONFIG_SIOT_CAN_NODE_ID << ISOTP_FIXED_ADDR_SA_POS),
+		.flags = ISOTP_MSG_IDE | ISOTP_MSG_FIXED_ADDR,
+	};
+	uint8_t buf[32];
+	point p = {0}, out;
+
+	point_set_type_key(&p, POINT_TYPE_DESCRIPTION, "2");
+	point_put_string(&p, "boiler room pump 12");
+
+	int len = point_can_string_encode(types, ARRAY_SIZE(types), &p, buf, sizeof(buf));
+	zassert_equal(isotp_send(&ctx, can_dev, buf, len, &tx_addr, &rx_addr, NULL, NULL),
+		      ISOTP_N_OK);
+
+	zassert_ok(k_msgq_get(&point_can_test_points, &out, K_MSEC(100)));
+	zassert_mem_equal(&out, &p, sizeof(p));
+}
+#endif
+
+ZTEST(point_can_bus_tests, send)
+{
+	struct can_frame frame;
+	point p = {0};
+
+	point_set_type_key(&p, POINT_TYPE_UPTIME, "0");
+	point_put_int(&p, 1234);
+	zassert_ok(zbus_chan_pub(&point_chan, &p, K_MSEC(100)));
+
+	zassert_ok(k_msgq_get(&point_can_test_frames, &frame, K_MSEC(100)));
+	zassert_equal(frame.id, point_can_id(2, 0, CONFIG_SIOT_CAN_NODE_ID));
+	zassert_equal(frame.dlc, 4);
+	zassert_equal(sys_get_le32(frame.data), 1234);
+}
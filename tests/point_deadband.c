@@ -0,0 +1,102 @@
+#include <point.h>
+#include <point_deadband.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/ztest.h>
+
+LOG_MODULE_REGISTER(point_deadband_tests, LOG_LEVEL_DBG);
+
+ZTEST_SUITE(point_deadband_tests, NULL, NULL, NULL, NULL, NULL);
+
+static point float_point(float v)
+{
+	point p = {0};
+
+	point_set_type_key(&p, POINT_TYPE_TEMPERATURE, "0");
+	point_put_float(&p, v);
+
+	return p;
+}
+
+ZTEST(point_deadband_tests, float)
+{
+	struct point_deadband db = {0};
+	point p;
+
+	p = float_point(20.0f);
+	zassert_true(point_deadband_check(&db, &p, 0.5f, 0), "first point suppressed");
+
+	p = float_point(20.4f);
+	zassert_false(point_deadband_check(&db, &p, 0.5f, 0));
+
+	// compared with the last value that passed, so slow drift passes
+	// eventually
+	p = float_point(20.6f);
+	zassert_true(point_deadband_check(&db, &p, 0.5f, 0));
+
+	p = float_point(20.2f);
+	zassert_false(point_deadband_check(&db, &p, 0.5f, 0));
+	p = float_point(20.0f);
+	zassert_true(point_deadband_check(&db, &p, 0.5f, 0));
+}
+
+ZTEST(point_deadband_tests, int_and_zero)
+{
+	struct point_deadband db = {0};
+	point p = {0};
+
+	point_set_type_key(&p, POINT_TYPE_UPTIME, "0");
+	point_put_int(&p, 10);
+	zassert_true(point_deadband_check(&db, &p, 0, 0));
+
+	// with no deadband, only repeats are suppressed
+	zassert_false(point_deadband_check(&db, &p, 0, 0));
+	point_put_int(&p, 11);
+	zassert_true(point_deadband_check(&db, &p, 0, 0));
+
+	point_put_int(&p, 13);
+	zassert_false(point_deadband_check(&db, &p, 2, 0));
+	point_put_int(&p, 14);
+	zassert_true(point_deadband_check(&db, &p, 2, 0));
+
+	// changes of large values are not lost to float rounding
+	point_put_int(&p, 16777216);
+	zassert_true(point_deadband_check(&db, &p, 0, 0));
+	point_put_int(&p, 16777217);
+	zassert_true(point_deadband_check(&db, &p, 0, 0));
+	point_put_int(&p, 16777219);
+	zassert_false(point_deadband_check(&db, &p, 2, 0));
+	point_put_int(&p, INT32_MIN);
+	zassert_true(point_deadband_check(&db, &p, 2, 0));
+
+	// a changed data type always passes
+	point_put_float(&p, 14.0f);
+	zassert_true(point_deadband_check(&db, &p, 2, 0));
+}
+
+ZTEST(point_deadband_tests, string)
+{
+	struct point_deadband db = {0};
+	point p = {0};
+
+	point_set_type_key(&p, POINT_TYPE_DESCRIPTION, "0");
+	point_put_string(&p, "pump");
+	zassert_true(point_deadband_check(&db, &p, 100, 0));
+	zassert_false(point_deadband_check(&db, &p, 100, 0));
+
+	point_put_string(&p, "fan");
+	zassert_true(point_deadband_check(&db, &p, 100, 0));
+}
+
+ZTEST(point_deadband_tests, max_age)
+{
+	struct point_deadband db = {0};
+	point p = float_point(5.0f);
+
+	zassert_true(point_deadband_check(&db, &p, 1.0f, 50));
+	zassert_false(point_deadband_check(&db, &p, 1.0f, 50));
+
+	// an unchanged value is repeated once it is old
+	k_sleep(K_MSEC(60));
+	zassert_true(point_deadband_check(&db, &p, 1.0f, 50));
+	zassert_false(point_deadband_check(&db, &p, 1.0f, 50));
+}
@@ -0,0 +1,195 @@
+#include "point_frame.h"
+#include "point.h"
+#include <zephyr/logging/log.h>
+#include <zephyr/ztest.h>
+
+LOG_MODULE_REGISTER(point_frame_tests, LOG_LEVEL_DBG);
+
+ZTEST_SUITE(point_frame_tests, NULL, NULL, NULL, NULL, NULL);
+
+struct cobs_vector {
+	const uint8_t *dec;
+	size_t dec_len;
+	const uint8_t *enc;
+	size_t enc_len;
+};
+
+#define COBS_VECTOR(d, e) {(const uint8_t *)d, sizeof(d) - 1, (const uint8_t *)e, sizeof(e) - 1}
+
+ZTEST(point_frame_tests, cobs_vectors)
+{
+	const struct cobs_vector vectors[] = {
+		COBS_VECTOR("", "\x01"),
+		COBS_VECTOR("\x00", "\x01\x01"),
+		COBS_VECTOR("\x00\x00", "\x01\x01\x01"),
+		COBS_VECTOR("\x11\x22\x00\x33", "\x03\x11\x22\x02\x33"),
+		COBS_VECTOR("\x11\x22\x33\x44", "\x05\x11\x22\x33\x44"),
+		COBS_VECTOR("\x11\x00\x00\x00", "\x02\x11\x01\x01\x01"),
+	};
+	uint8_t buf[16];
+
+	for (int i = 0; i < ARRAY_SIZE(vectors); i++) {
+		const struct cobs_vector *v = &vectors[i];
+
+		zassert_equal(cobs_encode(v->dec, v->dec_len, buf, sizeof(buf)), v->enc_len,
+			      "vector %i", i);
+		zassert_mem_equal(buf, v->enc, v->enc_len, "vector %i", i);
+		zassert_equal(cobs_decode(v->enc, v->enc_len, buf, sizeof(buf)), v->dec_len,
+			      "vector %i", i);
+		zassert_mem_equal(buf, v->dec, v->dec_len, "vector %i", i);
+	}
+}
+
+// runs of 254 non zero bytes end a block without an implied zero
+ZTEST(point_frame_tests, cobs_long_blocks)
+{
+	static uint8_t src[600], enc[COBS_MAX_LEN(600)], dec[600];
+
+	for (int len = 250; len <= sizeof(src); len++) {
+		for (int i = 0; i < len; i++) {
+			src[i] = i % 255 + 1;
+		}
+		if (len % 3 == 0) {
+			src[len / 2] = 0;
+		}
+
+		int n = cobs_encode(src, len, enc, sizeof(enc));
+		zassert_true(n > 0 && n <= COBS_MAX_LEN(len), "len %i", len);
+		zassert_is_null(memchr(enc, 0, n), "len %i", len);
+		zassert_equal(cobs_decode(enc, n, dec, sizeof(dec)), len, "len %i", len);
+		zassert_mem_equal(dec, src, len, "len %i", len);
+
+		// in place
+		zassert_equal(cobs_decode(enc, n, enc, sizeof(enc)), len, "len %i", len);
+		zassert_mem_equal(enc, src, len, "len %i", len);
+	}
+
+	zassert_equal(cobs_encode(src, 254, enc, 255), -ENOMEM);
+}
+
+ZTEST(point_frame_tests, cobs_invalid)
+{
+	uint8_t buf[8];
+
+	// zero in the data, and a block longer than the data
+	zassert_equal(cobs_decode((const uint8_t *)"\x02\x00", 2, buf, sizeof(buf)), -EINVAL);
+	zassert_equal(cobs_decode((const uint8_t *)"\x05\x11\x22", 3, buf, sizeof(buf)), -EINVAL);
+	zassert_equal(cobs_decode((const uint8_t *)"\x05\x11\x22\x33\x44", 5, buf, 3), -EINVAL);
+}
+
+struct frame_rx_result {
+	int frames;
+	uint8_t data[POINT_FRAME_DATA_LEN];
+	size_t len;
+};
+
+static void frame_rx_cb(const uint8_t *data, size_t len, void *ctx)
+{
+	struct frame_rx_result *r = ctx;
+
+	r->frames++;
+	memcpy(r->data, data, len);
+	r->len = len;
+}
+
+static int encode_points(uint8_t *data, size_t len, int count)
+{
+	point p = {0};
+	int offset = 0;
+
+	for (int i = 0; i < count; i++) {
+		point_set_type_key(&p, POINT_TYPE_TEMPERATURE, "0");
+		point_put_int(&p, i * 1000);
+		offset += point_bin_encode(&p, data + offset, len - offset);
+	}
+
+	return offset;
+}
+
+ZTEST(point_frame_tests, frame_round_trip)
+{
+	struct point_frame_rx rx = {0};
+	struct frame_rx_result r = {0};
+	uint8_t data[POINT_FRAME_DATA_LEN];
+	uint8_t frame[POINT_FRAME_LEN];
+	point pts[20];
+
+	int len = encode_points(data, sizeof(data), 10);
+	int n = point_frame_encode(data, len, frame, sizeof(frame));
+	zassert_true(n > len + 2);
+	zassert_equal(frame[n - 1], 0);
+	zassert_is_null(memchr(frame, 0, n - 1));
+
+	// one byte at a time
+	for (int i = 0; i < n; i++) {
+		point_frame_rx_feed(&rx, frame + i, 1, frame_rx_cb, &r);
+	}
+
+	zassert_equal(r.frames, 1);
+	zassert_equal(r.len, len);
+	zassert_mem_equal(r.data, data, len);
+	zassert_equal(points_bin_decode(r.data, r.len, pts, ARRAY_SIZE(pts)), 10);
+	zassert_equal(point_get_int(&pts[9]), 9000);
+
+	zassert_equal(rx.frames, 1);
+	zassert_equal(rx.errors, 0);
+}
+
+ZTEST(point_frame_tests, frame_stream)
+{
+	struct point_frame_rx rx = {0};
+	struct frame_rx_result r = {0};
+	uint8_t data[POINT_FRAME_DATA_LEN];
+	static uint8_t stream[4 * POINT_FRAME_LEN];
+	size_t stream_len = 0;
+
+	int len = encode_points(data, sizeof(data), 15);
+
+	// garbage before the first delimiter, then three frames, an empty
+	// frame, and a corrupted frame
+	memcpy(stream, "\x12\x34", 2);
+	stream_len = 2;
+	stream[stream_len++] = 0;
+	for (int i = 0; i < 3; i++) {
+		stream_len += point_frame_encode(data, len, stream + stream_len,
+						 sizeof(stream) - stream_len);
+	}
+	stream[stream_len++] = 0;
+	int n = point_frame_encode(data, len, stream + stream_len, sizeof(stream) - stream_len);
+	stream[stream_len + n / 2] ^= 0x40;
+	stream_len += n;
+
+	point_frame_rx_feed(&rx, stream, stream_len, frame_rx_cb, &r);
+
+	zassert_equal(r.frames, 3);
+	zassert_mem_equal(r.data, data, len);
+	zassert_equal(rx.frames, 3);
+	zassert_equal(rx.errors, 2);
+}
+
+ZTEST(point_frame_tests, frame_limits)
+{
+	struct point_frame_rx rx = {0};
+	struct frame_rx_result r = {0};
+	static uint8_t data[POINT_FRAME_DATA_LEN + 1];
+	uint8_t frame[POINT_FRAME_LEN];
+
+	memset(data, 0x55, sizeof(data));
+
+	zassert_equal(point_frame_encode(data, sizeof(data), frame, sizeof(frame)), -EMSGSIZE);
+	zassert_equal(point_frame_encode(data, 10, frame, 13), -ENOMEM);
+
+	int n = point_frame_encode(data, POINT_FRAME_DATA_LEN, frame, sizeof(frame));
+	zassert_true(n > 0 && n <= POINT_FRAME_LEN);
+
+	// a frame that is too long is dropped, and the next one is received
+	for (int i = 0; i < 2; i++) {
+		point_frame_rx_feed(&rx, frame, n - 1, frame_rx_cb, &r);
+	}
+	point_frame_rx_feed(&rx, frame, n, frame_rx_cb, &r);
+	point_frame_rx_feed(&rx, frame, n, frame_rx_cb, &r);
+
+	zassert_equal(r.frames, 1);
+	zassert_equal(r.len, POINT_FRAME_DATA_LEN);
+	zassert_equal(rx.errors, 1);
+}
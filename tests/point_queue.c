@@ -0,0 +1,65 @@
+#include "point_queue.h"
+#include <zephyr/logging/log.h>
+#include <zephyr/ztest.h>
+
+LOG_MODULE_REGISTER(point_queue_tests, LOG_LEVEL_DBG);
+
+ZTEST_SUITE(point_queue_tests, NULL, NULL, NULL, NULL, NULL);
+
+static void queue_point(point *p, int v)
+{
+	point_set_type_key(p, "temp", "0");
+	point_put_int(p, v);
+}
+
+ZTEST(point_queue_tests, empty)
+{
+	POINT_QUEUE_DEFINE(q, 4);
+	point p;
+
+	zassert_equal(point_queue_count(&q), 0);
+	zassert_equal(point_queue_get(&q, &p), -EAGAIN);
+}
+
+ZTEST(point_queue_tests, full)
+{
+	POINT_QUEUE_DEFINE(q, 4);
+	point p;
+
+	for (int i = 0; i < 4; i++) {
+		queue_point(&p, i);
+		zassert_equal(point_queue_put(&q, &p), 0);
+	}
+
+	zassert_equal(point_queue_count(&q), 4);
+	zassert_equal(point_queue_put(&q, &p), -ENOSPC);
+
+	// freeing one cell makes room for one more point
+	zassert_equal(point_queue_get(&q, &p), 0);
+	zassert_equal(point_get_int(&p), 0);
+	zassert_equal(point_queue_put(&q, &p), 0);
+	zassert_equal(point_queue_put(&q, &p), -ENOSPC);
+}
+
+ZTEST(point_queue_tests, fifo_wrap)
+{
+	POINT_QUEUE_DEFINE(q, 4);
+	point p;
+	int next_put = 0;
+	int next_get = 0;
+
+	// run many laps of the ring with a varying fill level
+	for (int lap = 0; lap < 100; lap++) {
+		for (int i = 0; i < lap % 4 + 1; i++) {
+			queue_point(&p, next_put++);
+			zassert_equal(point_queue_put(&q, &p), 0);
+		}
+
+		while (point_queue_get(&q, &p) == 0) {
+			zassert_equal(point_get_int(&p), next_get++);
+		}
+	}
+
+	zassert_equal(next_get, next_put);
+	zassert_equal(point_queue_count(&q), 0);
+}
@@ -3,6 +3,13 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/ztest.h>
 
+#include <math.h>
+#include <stdio.h>
+
+// stdlib.h can't be included as it conflicts with the atof in siot-string.h
+float strtof(const char *str, char **endptr);
+long strtol(const char *str, char **endptr, int base);
+
 LOG_MODULE_REGISTER(siot_string_tests, LOG_LEVEL_DBG);
 
 ZTEST_SUITE(siot_string_tests, NULL, NULL, NULL, NULL, NULL);
@@ -45,3 +52,306 @@ ZTEST(siot_string_tests, ftoa_round)
 	ftoa(-1.58, buf, 5);
 	zassert_str_equal(buf, "-1.58");
 }
+
+ZTEST(siot_string_tests, ftoa_shortest)
+{
+	struct {
+		float v;
+		const char *s;
+	} tests[] = {
+		{0, "0"},
+		{-0.0f, "-0"},
+		{1, "1"},
+		{-1.5f, "-1.5"},
+		{0.1f, "0.1"},
+		{23.5f, "23.5"},
+		{-572.2f, "-572.2"},
+		{1.0f / 3, "0.33333334"},
+		{1200, "1200"},
+		{16777216, "16777216"},
+		{123456789, "123456790"},
+		{1e9f, "1e9"},
+		{0.001f, "0.001"},
+		{0.0001f, "0.0001"},
+		{0.00001f, "1e-5"},
+		{-1.2345678e-30f, "-1.2345678e-30"},
+		// largest, smallest normal, and smallest subnormal float
+		{3.4028235e38f, "3.4028235e38"},
+		{1.1754944e-38f, "1.1754944e-38"},
+		{1e-45f, "1e-45"},
+		{INFINITY, "Inf"},
+		{-INFINITY, "-Inf"},
+		{NAN, "NaN"},
+	};
+	char buf[FTOA_SHORTEST_LEN];
+
+	for (int i = 0; i < ARRAY_SIZE(tests); i++) {
+		int ret = ftoa_shortest(tests[i].v, buf, sizeof(buf));
+		zassert_equal(ret, strlen(tests[i].s));
+		zassert_str_equal(buf, tests[i].s);
+	}
+}
+
+ZTEST(siot_string_tests, ftoa_shortest_round_trip)
+{
+	char buf[FTOA_SHORTEST_LEN];
+	char ref[20];
+
+	// every float was checked on a host, this covers a spread of all
+	// exponents and mantissas
+	for (uint32_t u = 0; u < 0x7f800000; u += 65521) {
+		float v;
+		memcpy(&v, &u, sizeof(v));
+
+		int ret = ftoa_shortest(v, buf, sizeof(buf));
+		zassert_true(ret > 0 && ret < FTOA_SHORTEST_LEN);
+		zassert_true(strtof(buf, NULL) == v, "%08x: %s", u, buf);
+
+		// count significant digits, and check that the closest number with
+		// one less digit does not parse back to v
+		int digits = 0;
+		int trailing_zeros = 0;
+		for (const char *c = buf; *c != 0 && *c != 'e'; c++) {
+			if (*c == '0' && digits == 0) {
+				continue;
+			}
+			if (*c >= '0' && *c <= '9') {
+				digits++;
+				trailing_zeros = *c == '0' ? trailing_zeros + 1 : 0;
+			}
+		}
+		digits -= trailing_zeros;
+
+		if (digits > 1) {
+			snprintf(ref, sizeof(ref), "%.*e", digits - 2, (double)v);
+			zassert_true(strtof(ref, NULL) != v, "%08x: %s %s", u, buf, ref);
+		}
+	}
+}
+
+ZTEST(siot_string_tests, ftoa_shortest_len)
+{
+	char buf[FTOA_SHORTEST_LEN];
+
+	zassert_equal(ftoa_shortest(-1.2345678e-30f, buf, 14), -ENOMEM);
+	zassert_equal(ftoa_shortest(-1.2345678e-30f, buf, 15), 14);
+	zassert_equal(ftoa_shortest(1.5f, buf, 3), -ENOMEM);
+}
+
+ZTEST(siot_string_tests, itoa)
+{
+	struct {
+		int64_t v;
+		const char *s;
+	} tests[] = {
+		{0, "0"},
+		{7, "7"},
+		{-7, "-7"},
+		{10, "10"},
+		{99, "99"},
+		{100, "100"},
+		{-1013, "-1013"},
+		{9999, "9999"},
+		{10000, "10000"},
+		{123456789, "123456789"},
+		{INT32_MAX, "2147483647"},
+		{INT32_MIN, "-2147483648"},
+		{4294967296, "4294967296"},
+		{-100000000000, "-100000000000"},
+		{INT64_MAX, "9223372036854775807"},
+		{INT64_MIN, "-9223372036854775808"},
+	};
+	char buf[ITOA_I64_LEN];
+
+	for (int i = 0; i < ARRAY_SIZE(tests); i++) {
+		int ret = itoa_i64(tests[i].v, buf, sizeof(buf));
+		zassert_equal(ret, strlen(tests[i].s));
+		zassert_str_equal(buf, tests[i].s);
+
+		if (tests[i].v >= INT32_MIN && tests[i].v <= INT32_MAX) {
+			ret = itoa_i32(tests[i].v, buf, ITOA_I32_LEN);
+			zassert_equal(ret, strlen(tests[i].s));
+			zassert_str_equal(buf, tests[i].s);
+		}
+	}
+
+	zassert_equal(itoa_u64(UINT64_MAX, buf, sizeof(buf)), 20);
+	zassert_str_equal(buf, "18446744073709551615");
+
+	// itoa keeps working for other bases
+	zassert_str_equal(itoa(-572, buf, 10), "-572");
+	zassert_str_equal(itoa(255, buf, 16), "ff");
+}
+
+ZTEST(siot_string_tests, itoa_powers_of_10)
+{
+	char buf[ITOA_I64_LEN];
+	char ref[ITOA_I64_LEN];
+	uint64_t p = 1;
+
+	// digit counts change at every power of 10
+	for (int i = 0; i < 20; i++, p *= 10) {
+		uint64_t vals[] = {p - 1, p, p + 1};
+
+		for (int j = 0; j < ARRAY_SIZE(vals); j++) {
+			snprintf(ref, sizeof(ref), "%llu", (unsigned long long)vals[j]);
+			zassert_equal(itoa_u64(vals[j], buf, sizeof(buf)), strlen(ref));
+			zassert_str_equal(buf, ref);
+
+			if (vals[j] <= INT32_MAX) {
+				zassert_equal(itoa_i32(-(int32_t)vals[j], buf, sizeof(buf)),
+					      strlen(ref) + (vals[j] != 0));
+			}
+		}
+	}
+}
+
+ZTEST(siot_string_tests, itoa_len)
+{
+	char buf[ITOA_I64_LEN];
+
+	zassert_equal(itoa_i32(-1013, buf, 5), -ENOMEM);
+	zassert_equal(itoa_i32(-1013, buf, 6), 5);
+	zassert_equal(itoa_i32(INT32_MIN, buf, ITOA_I32_LEN), 11);
+	zassert_equal(itoa_i64(INT64_MIN, buf, ITOA_I64_LEN), 20);
+	zassert_equal(itoa_u64(UINT64_MAX, buf, ITOA_I64_LEN - 1), -ENOMEM);
+}
+
+ZTEST(siot_string_tests, parse_int)
+{
+	struct {
+		const char *s;
+		int ret;
+		int32_t v;
+	} tests[] = {
+		{"0", 0, 0},
+		{"-0", 0, 0},
+		{"+17", 0, 17},
+		{"-572", 0, -572},
+		{"0000000000001234", 0, 1234},
+		{"2147483647", 0, INT32_MAX},
+		{"-2147483648", 0, INT32_MIN},
+		{"2147483648", -ERANGE, INT32_MAX},
+		{"-2147483649", -ERANGE, INT32_MIN},
+		{"123456789012345678901234", -ERANGE, INT32_MAX},
+		{"", -EINVAL},
+		{"-", -EINVAL},
+		{"12a", -EINVAL},
+		{"1.5", -EINVAL},
+		{" 1", -EINVAL},
+		{"123456789012345678901234a", -EINVAL},
+	};
+
+	for (int i = 0; i < ARRAY_SIZE(tests); i++) {
+		int32_t v = 0;
+		int ret = parse_int(tests[i].s, strlen(tests[i].s), &v);
+		zassert_equal(ret, tests[i].ret, "%s: %i", tests[i].s, ret);
+		if (ret != -EINVAL) {
+			zassert_equal(v, tests[i].v, "%s: %i", tests[i].s, v);
+		}
+	}
+
+	// only len characters are parsed
+	int32_t v;
+	zassert_equal(parse_int("1234xyz", 4, &v), 0);
+	zassert_equal(v, 1234);
+}
+
+ZTEST(siot_string_tests, parse_float)
+{
+	struct {
+		const char *s;
+		int ret;
+		float v;
+	} tests[] = {
+		{"0", 0, 0},
+		{"-1.5", 0, -1.5f},
+		{"+23.5", 0, 23.5f},
+		{".5", 0, 0.5f},
+		{"5.", 0, 5},
+		{"0.1", 0, 0.1f},
+		{"1e9", 0, 1e9f},
+		{"1.5E-7", 0, 1.5e-7f},
+		{"-1.2345678e-30", 0, -1.2345678e-30f},
+		{"0.000000000000000000000000000000000000000000001401298464324817", 0, 1e-45f},
+		{"3.4028235e38", 0, 3.4028235e38f},
+		{"340282346638528859811704183484516925440", 0, 3.4028235e38f},
+		// exactly halfway between 1 and the next float, rounds to even
+		{"1.000000059604644775390625", 0, 1},
+		{"1.000000059604644775390626", 0, 1.0000001f},
+		{"16777217", 0, 16777216},
+		{"Inf", 0, INFINITY},
+		{"-infinity", 0, -INFINITY},
+		{"3.5e38", -ERANGE, INFINITY},
+		{"-1e999999999", -ERANGE, -INFINITY},
+		{"1e-50", -ERANGE, 0},
+		{"", -EINVAL},
+		{".", -EINVAL},
+		{"-", -EINVAL},
+		{"e5", -EINVAL},
+		{"1e", -EINVAL},
+		{"1e+", -EINVAL},
+		{"1.2.3", -EINVAL},
+		{"1,5", -EINVAL},
+		{"0x10", -EINVAL},
+	};
+
+	for (int i = 0; i < ARRAY_SIZE(tests); i++) {
+		float v = 0;
+		int ret = parse_float(tests[i].s, strlen(tests[i].s), &v);
+		zassert_equal(ret, tests[i].ret, "%s: %i", tests[i].s, ret);
+		if (ret != -EINVAL) {
+			zassert_true(v == tests[i].v, "%s: %g", tests[i].s, (double)v);
+		}
+	}
+
+	float v;
+	zassert_equal(parse_float("NaN", 3, &v), 0);
+	zassert_true(isnan(v));
+	zassert_equal(parse_float("-0", 2, &v), 0);
+	zassert_true(v == 0 && signbit(v));
+	zassert_equal(parse_float("12.5}", 4, &v), 0);
+	zassert_true(v == 12.5f);
+}
+
+ZTEST(siot_string_tests, parse_differential)
+{
+	char buf[40];
+
+	// compare against libc over a spread of floats in the formats the fast
+	// and slow paths see
+	for (uint32_t u = 0; u < 0x7f800000; u += 65521) {
+		const char *formats[] = {"%.6g", "%.9g", "%.17g", "%.25e"};
+		float f;
+		memcpy(&f, &u, sizeof(f));
+
+		for (int i = 0; i < ARRAY_SIZE(formats); i++) {
+			float v;
+			snprintf(buf, sizeof(buf), formats[i], (double)f);
+			float ref = strtof(buf, NULL);
+
+			int ret = parse_float(buf, strlen(buf), &v);
+			zassert_true(ret == 0 || ret == -ERANGE, "%s: %i", buf, ret);
+			zassert_true(memcmp(&v, &ref, sizeof(v)) == 0, "%s: %a %a", buf, (double)v,
+				     (double)ref);
+		}
+
+		int32_t i;
+		snprintf(buf, sizeof(buf), "%i", (int32_t)(u * 3));
+		zassert_equal(parse_int(buf, strlen(buf), &i), 0);
+		zassert_equal(i, strtol(buf, NULL, 10), "%s", buf);
+	}
+}
+
+ZTEST(siot_string_tests, atof_atoi)
+{
+	// the number at the start of the string is converted, the rest ignored
+	zassert_true(atof("23.5C") == 23.5f);
+	zassert_true(atof("-1e3,") == -1000);
+	zassert_true(atof("2e") == 2);
+	zassert_true(atof("0.1") == 0.1f);
+	zassert_true(atof("x") == 0);
+	zassert_equal(atoi("-572 "), -572);
+	zassert_equal(atoi("+12.5"), 12);
+	zassert_equal(atoi("x"), 0);
+}